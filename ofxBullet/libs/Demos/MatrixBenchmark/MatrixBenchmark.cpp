@@ -0,0 +1,351 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///MatrixBenchmark checks the btMatrix3x3 and btTransform kernels against the scalar formulas of Bullet 2.73 and times both.
+///Every operation is run on random input and the x, y and z lanes must match the reference bit for bit, w is ignored.
+///The reference below is plain scalar code, so a build with BT_USE_SSE compares the SSE kernels and a BT_NO_SSE build
+///compares the scalar path. Don't allow the compiler to contract a*b+c into fused multiply-adds, that changes the rounding:
+///
+///	g++ -O2 -ffp-contract=off -I../../src MatrixBenchmark.cpp ../../src/LinearMath/*.cpp -o MatrixBenchmark
+///
+///Returns 0 when all results are identical, 1 otherwise.
+
+#include "LinearMath/btTransform.h"
+#include "LinearMath/btQuickprof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///scalar reference, a copy of the Bullet 2.73 formulas on plain arrays
+struct RefMatrix
+{
+	btScalar m[3][3];
+};
+
+struct RefTransform
+{
+	RefMatrix	basis;
+	btScalar	origin[3];
+};
+
+static btScalar refDot(const btScalar* a, const btScalar* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static btScalar refTdot(const RefMatrix& m, int column, const btScalar* v)
+{
+	return m.m[0][column] * v[0] + m.m[1][column] * v[1] + m.m[2][column] * v[2];
+}
+
+static void refMulVec(const RefMatrix& m, const btScalar* v, btScalar* out)
+{
+	btScalar r[3] = { refDot(m.m[0], v), refDot(m.m[1], v), refDot(m.m[2], v) };
+	memcpy(out, r, sizeof(r));
+}
+
+static void refVecMul(const btScalar* v, const RefMatrix& m, btScalar* out)
+{
+	btScalar r[3] = { refTdot(m, 0, v), refTdot(m, 1, v), refTdot(m, 2, v) };
+	memcpy(out, r, sizeof(r));
+}
+
+static RefMatrix refMul(const RefMatrix& m1, const RefMatrix& m2)
+{
+	RefMatrix r;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			r.m[i][j] = refTdot(m2, j, m1.m[i]);
+	return r;
+}
+
+static RefMatrix refTranspose(const RefMatrix& m)
+{
+	RefMatrix r;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			r.m[i][j] = m.m[j][i];
+	return r;
+}
+
+static RefMatrix refAbsolute(const RefMatrix& m)
+{
+	RefMatrix r;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			r.m[i][j] = btFabs(m.m[i][j]);
+	return r;
+}
+
+static RefMatrix refTransposeTimes(const RefMatrix& a, const RefMatrix& b)
+{
+	RefMatrix r;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			r.m[i][j] = a.m[0][i] * b.m[0][j] + a.m[1][i] * b.m[1][j] + a.m[2][i] * b.m[2][j];
+	return r;
+}
+
+static RefMatrix refTimesTranspose(const RefMatrix& a, const RefMatrix& b)
+{
+	RefMatrix r;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			r.m[i][j] = refDot(a.m[i], b.m[j]);
+	return r;
+}
+
+static void refXform(const RefTransform& t, const btScalar* v, btScalar* out)
+{
+	btScalar r[3] = { refDot(t.basis.m[0], v) + t.origin[0], refDot(t.basis.m[1], v) + t.origin[1], refDot(t.basis.m[2], v) + t.origin[2] };
+	memcpy(out, r, sizeof(r));
+}
+
+static void refInvXform(const RefTransform& t, const btScalar* v, btScalar* out)
+{
+	btScalar d[3] = { v[0] - t.origin[0], v[1] - t.origin[1], v[2] - t.origin[2] };
+	refMulVec(refTranspose(t.basis), d, out);
+}
+
+static RefTransform refTransformMul(const RefTransform& a, const RefTransform& b)
+{
+	RefTransform r;
+	r.basis = refMul(a.basis, b.basis);
+	refXform(a, b.origin, r.origin);
+	return r;
+}
+
+static RefTransform refInverseTimes(const RefTransform& a, const RefTransform& b)
+{
+	RefTransform r;
+	btScalar d[3] = { b.origin[0] - a.origin[0], b.origin[1] - a.origin[1], b.origin[2] - a.origin[2] };
+	r.basis = refTransposeTimes(a.basis, b.basis);
+	refVecMul(d, a.basis, r.origin);
+	return r;
+}
+
+static btScalar randomScalar()
+{
+	//mix magnitudes, so rounding differences in the accumulation order would show up
+	btScalar s = btScalar(rand()) / btScalar(RAND_MAX) * btScalar(2.) - btScalar(1.);
+	switch (rand() & 3)
+	{
+	case 0: return s * btScalar(1e-3);
+	case 1: return s * btScalar(1e3);
+	default: return s;
+	}
+}
+
+static void randomMatrix(RefMatrix& ref, btMatrix3x3& m)
+{
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			ref.m[i][j] = randomScalar();
+	m.setValue(ref.m[0][0], ref.m[0][1], ref.m[0][2], ref.m[1][0], ref.m[1][1], ref.m[1][2], ref.m[2][0], ref.m[2][1], ref.m[2][2]);
+}
+
+static void randomVector(btScalar* ref, btVector3& v)
+{
+	for (int i = 0; i < 3; i++)
+		ref[i] = randomScalar();
+	v.setValue(ref[0], ref[1], ref[2]);
+}
+
+static void randomTransform(RefTransform& ref, btTransform& t)
+{
+	randomMatrix(ref.basis, t.getBasis());
+	randomVector(ref.origin, t.getOrigin());
+}
+
+static int gMismatches = 0;
+
+static void checkVector(const char* name, const btVector3& v, const btScalar* ref)
+{
+	if (memcmp(&v[0], ref, 3 * sizeof(btScalar)) != 0)
+	{
+		if (gMismatches < 10)
+			printf("%s differs: %.9g %.9g %.9g, reference %.9g %.9g %.9g\n", name, v[0], v[1], v[2], ref[0], ref[1], ref[2]);
+		gMismatches++;
+	}
+}
+
+static void checkMatrix(const char* name, const btMatrix3x3& m, const RefMatrix& ref)
+{
+	for (int i = 0; i < 3; i++)
+		checkVector(name, m[i], ref.m[i]);
+}
+
+static void checkTransform(const char* name, const btTransform& t, const RefTransform& ref)
+{
+	checkMatrix(name, t.getBasis(), ref.basis);
+	checkVector(name, t.getOrigin(), ref.origin);
+}
+
+static void verify(int numTrials)
+{
+	for (int i = 0; i < numTrials; i++)
+	{
+		RefMatrix ra, rb;
+		btMatrix3x3 a, b;
+		btScalar rv[3], rout[3];
+		btVector3 v;
+		randomMatrix(ra, a);
+		randomMatrix(rb, b);
+		randomVector(rv, v);
+
+		refMulVec(ra, rv, rout);
+		checkVector("matrix * vector", a * v, rout);
+		refVecMul(rv, ra, rout);
+		checkVector("vector * matrix", v * a, rout);
+		checkMatrix("matrix * matrix", a * b, refMul(ra, rb));
+		btMatrix3x3 c = a;
+		c *= b;
+		checkMatrix("matrix *= matrix", c, refMul(ra, rb));
+		checkMatrix("transpose", a.transpose(), refTranspose(ra));
+		checkMatrix("absolute", a.absolute(), refAbsolute(ra));
+		checkMatrix("transposeTimes", a.transposeTimes(b), refTransposeTimes(ra, rb));
+		checkMatrix("timesTranspose", a.timesTranspose(b), refTimesTranspose(ra, rb));
+
+		RefTransform rta, rtb;
+		btTransform ta, tb;
+		randomTransform(rta, ta);
+		randomTransform(rtb, tb);
+
+		refXform(rta, rv, rout);
+		checkVector("transform(vector)", ta(v), rout);
+		checkVector("transform * vector", ta * v, rout);
+		refInvXform(rta, rv, rout);
+		checkVector("invXform", ta.invXform(v), rout);
+		checkTransform("transform * transform", ta * tb, refTransformMul(rta, rtb));
+		btTransform tc;
+		tc.mult(ta, tb);
+		checkTransform("mult", tc, refTransformMul(rta, rtb));
+		checkTransform("inverseTimes", ta.inverseTimes(tb), refInverseTimes(rta, rtb));
+	}
+}
+
+#define NUM_ELEMENTS 1024
+#define NUM_ROUNDS 2000
+
+static RefTransform	gRefTransforms[NUM_ELEMENTS];
+static btTransform	gTransforms[NUM_ELEMENTS];
+static btScalar		gRefVectors[NUM_ELEMENTS][3];
+static btVector3	gVectors[NUM_ELEMENTS];
+
+static void report(const char* name, unsigned long kernelTime, unsigned long refTime, btScalar sink)
+{
+	double scale = 1000.0 / (double(NUM_ELEMENTS) * NUM_ROUNDS);
+	printf("%-24s %8.2f ns %8.2f ns  (%g)\n", name, kernelTime * scale, refTime * scale, sink);
+}
+
+static void benchmark()
+{
+	for (int i = 0; i < NUM_ELEMENTS; i++)
+	{
+		randomTransform(gRefTransforms[i], gTransforms[i]);
+		randomVector(gRefVectors[i], gVectors[i]);
+	}
+	printf("%-24s %11s %11s\n", "operation", "kernel", "reference");
+
+	btClock clock;
+	btScalar sink = btScalar(0.);
+	btVector3 acc(0, 0, 0);
+	btScalar racc[3] = { 0, 0, 0 };
+
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+			acc += gTransforms[i](gVectors[i]);
+	unsigned long kernelTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			btScalar out[3];
+			refXform(gRefTransforms[i], gRefVectors[i], out);
+			racc[0] += out[0]; racc[1] += out[1]; racc[2] += out[2];
+		}
+	report("transform(vector)", kernelTime, clock.getTimeMicroseconds(), acc.x() + racc[0]);
+
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+			acc += gTransforms[i].invXform(gVectors[i]);
+	kernelTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			btScalar out[3];
+			refInvXform(gRefTransforms[i], gRefVectors[i], out);
+			racc[0] += out[0]; racc[1] += out[1]; racc[2] += out[2];
+		}
+	report("invXform", kernelTime, clock.getTimeMicroseconds(), acc.y() + racc[1]);
+
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			btTransform t = gTransforms[i] * gTransforms[(i + 1) & (NUM_ELEMENTS - 1)];
+			acc += t.getOrigin();
+		}
+	kernelTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			RefTransform t = refTransformMul(gRefTransforms[i], gRefTransforms[(i + 1) & (NUM_ELEMENTS - 1)]);
+			racc[0] += t.origin[0];
+		}
+	report("transform * transform", kernelTime, clock.getTimeMicroseconds(), acc.z() + racc[0]);
+
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			btTransform t = gTransforms[i].inverseTimes(gTransforms[(i + 1) & (NUM_ELEMENTS - 1)]);
+			acc += t.getOrigin();
+		}
+	kernelTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int r = 0; r < NUM_ROUNDS; r++)
+		for (int i = 0; i < NUM_ELEMENTS; i++)
+		{
+			RefTransform t = refInverseTimes(gRefTransforms[i], gRefTransforms[(i + 1) & (NUM_ELEMENTS - 1)]);
+			racc[1] += t.origin[1];
+		}
+	report("inverseTimes", kernelTime, clock.getTimeMicroseconds(), acc.x() + racc[1]);
+
+	sink += acc.x() + racc[2];
+	if (sink == btScalar(1234.5))
+		printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+	int numTrials = argc > 1 ? atoi(argv[1]) : 100000;
+	srand(1);
+
+#ifdef BT_USE_SSE
+	printf("btMatrix3x3 / btTransform kernels: SSE\n");
+#else
+	printf("btMatrix3x3 / btTransform kernels: scalar\n");
+#endif
+	verify(numTrials);
+	printf("%d trials, %d mismatches\n\n", numTrials, gMismatches);
+
+	benchmark();
+	return gMismatches ? 1 : 0;
+}
@@ -20,6 +20,7 @@
 #define AXIS_SWEEP_3_H
 
 #include "LinearMath/btVector3.h"
+#include "LinearMath/btAabbUtil2.h"
 #include "btOverlappingPairCache.h"
 #include "btBroadphaseInterface.h"
 #include "btBroadphaseProxy.h"
@@ -150,6 +151,8 @@ public:
 	virtual void  getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
+
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo,int numRays, btBroadphaseRayCallback** rayCallbacks, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	
 	void quantize(BP_FP_INT_TYPE* out, const btVector3& point, int isMax) const;
 	///unQuantize should be conservative: aabbMin/aabbMax should be larger then 'getAabb' result
@@ -264,6 +267,18 @@ void	btAxisSweep3Internal<BP_FP_INT_TYPE>::setAabb(btBroadphaseProxy* proxy,cons
 
 }
 
+template <typename BP_FP_INT_TYPE>
+void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo,int numRays, btBroadphaseRayCallback** rayCallbacks,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (m_raycastAccelerator)
+	{
+		m_raycastAccelerator->rayTestPacket(rayFrom,rayTo,numRays,rayCallbacks,aabbMin,aabbMax);
+	} else
+	{
+		btBroadphaseInterface::rayTestPacket(rayFrom,rayTo,numRays,rayCallbacks,aabbMin,aabbMax);
+	}
+}
+
 template <typename BP_FP_INT_TYPE>
 void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback,const btVector3& aabbMin,const btVector3& aabbMax)
 {
@@ -279,7 +294,16 @@ void	btAxisSweep3Internal<BP_FP_INT_TYPE>::rayTest(const btVector3& rayFrom,cons
 		{
 			if (m_pEdges[axis][i].IsMax())
 			{
-				rayCallback.process(getHandle(m_pEdges[axis][i].m_handle));
+				Handle* handle = getHandle(m_pEdges[axis][i].m_handle);
+				//skip proxies beyond the closest hit found so far
+				btVector3 bounds[2];
+				bounds[0] = handle->m_aabbMin+aabbMin;
+				bounds[1] = handle->m_aabbMax+aabbMax;
+				btScalar tmin;
+				if (btRayAabb2(rayFrom,rayCallback.m_rayDirectionInverse,rayCallback.m_signs,bounds,tmin,btScalar(0.),rayCallback.m_lambda_max))
+				{
+					rayCallback.process(handle);
+				}
 			}
 		}
 	}
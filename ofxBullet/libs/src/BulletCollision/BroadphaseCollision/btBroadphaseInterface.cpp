@@ -0,0 +1,36 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btBroadphaseInterface.h"
+#include "btOverlappingPairCache.h"
+
+void	btBroadphaseInterface::createProxies(int numProxies,const btVector3* aabbMin,const btVector3* aabbMax,const int* shapeTypes,void* const* userPtrs,
+											 const short int* collisionFilterGroups,const short int* collisionFilterMasks,btDispatcher* dispatcher,btBroadphaseProxy** proxies)
+{
+	for (int i=0;i<numProxies;i++)
+	{
+		proxies[i] = createProxy(aabbMin[i],aabbMax[i],shapeTypes[i],userPtrs[i],collisionFilterGroups[i],collisionFilterMasks[i],dispatcher,0);
+	}
+}
+
+void	btBroadphaseInterface::destroyProxies(btBroadphaseProxy* const* proxies,int numProxies,btDispatcher* dispatcher)
+{
+	for (int i=0;i<numProxies;i++)
+	{
+		getOverlappingPairCache()->cleanProxyFromPairs(proxies[i],dispatcher);
+		destroyProxy(proxies[i],dispatcher);
+	}
+}
@@ -31,6 +31,8 @@ struct	btBroadphaseRayCallback
 	///added some cached data to accelerate ray-AABB tests
 	btVector3		m_rayDirectionInverse;
 	unsigned int	m_signs[3];
+	///length of the ray along the normalized direction. process may lower it to the closest hit found so far,
+	///the broadphase then skips proxies and subtrees beyond it.
 	btScalar		m_lambda_max;
 
 	virtual ~btBroadphaseRayCallback() {}
@@ -52,8 +54,27 @@ public:
 	virtual void	setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax, btDispatcher* dispatcher)=0;
 	virtual void	getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const =0;
 
+	///createProxies creates numProxies proxies at once, proxies[i] receives the proxy for the i-th entry of the input arrays.
+	///The default implementation calls createProxy for each, btDbvtBroadphase rebuilds its tree once for large batches.
+	virtual void	createProxies(int numProxies,const btVector3* aabbMin,const btVector3* aabbMax,const int* shapeTypes,void* const* userPtrs,
+								  const short int* collisionFilterGroups,const short int* collisionFilterMasks,btDispatcher* dispatcher,btBroadphaseProxy** proxies);
+
+	///destroyProxies removes the overlapping pairs of the proxies, releasing their collision algorithms, and destroys the proxies.
+	///The default implementation calls cleanProxyFromPairs and destroyProxy for each, btDbvtBroadphase removes all pairs in one pass.
+	virtual void	destroyProxies(btBroadphaseProxy* const* proxies,int numProxies,btDispatcher* dispatcher);
+
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0)) = 0;
 
+	///rayTestPacket tests a group of rays, rayCallbacks[i] receives the proxies that ray rayFrom[i]-rayTo[i] may hit.
+	///The default implementation calls rayTest for each ray, btDbvtBroadphase traverses its trees once per packet.
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo,int numRays, btBroadphaseRayCallback** rayCallbacks, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0))
+	{
+		for (int i=0;i<numRays;i++)
+		{
+			rayTest(rayFrom[i],rayTo[i],*rayCallbacks[i],aabbMin,aabbMax);
+		}
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
@@ -69,21 +69,43 @@ static void						getmaxdepth(const btDbvtNode* node,int depth,int& maxdepth)
 static DBVT_INLINE void			deletenode(	btDbvt* pdbvt,
 										   btDbvtNode* node)
 {
-	btAlignedFree(pdbvt->m_free);
+	node->parent=pdbvt->m_free;
 	pdbvt->m_free=node;
 }
 
 //
-static void						recursedeletenode(	btDbvt* pdbvt,
-												  btDbvtNode* node)
+static btDbvtNode*				newblock(int size)
 {
-	if(!node->isleaf())
+	btDbvtNode*	block=(btDbvtNode*)btAlignedAlloc(sizeof(btDbvtNode)*size,16);
+	for(int i=0;i<size;++i) new(&block[i]) btDbvtNode();
+	return(block);
+}
+
+//
+static btDbvtNode*				allocateblock(	btDbvt* pdbvt,
+											  int size)
+{
+	btDbvtNode*	block=newblock(size);
+	pdbvt->m_blocks.push_back(block);
+	pdbvt->m_poolsize+=size;
+	return(block);
+}
+
+//
+static void						releaseblocks(btDbvt* pdbvt)
+{
+	for(int i=0;i<pdbvt->m_blocks.size();++i)
 	{
-		recursedeletenode(pdbvt,node->childs[0]);
-		recursedeletenode(pdbvt,node->childs[1]);
+		btAlignedFree(pdbvt->m_blocks[i]);
 	}
-	if(node==pdbvt->m_root) pdbvt->m_root=0;
-	deletenode(pdbvt,node);
+	pdbvt->m_blocks.clear();
+	if(pdbvt->m_spareblock) btAlignedFree(pdbvt->m_spareblock);
+	pdbvt->m_poolsize=0;
+	pdbvt->m_free=0;
+	pdbvt->m_layoutblock=0;
+	pdbvt->m_layoutsize=0;
+	pdbvt->m_spareblock=0;
+	pdbvt->m_sparesize=0;
 }
 
 //
@@ -91,11 +113,14 @@ static DBVT_INLINE btDbvtNode*	createnode(	btDbvt* pdbvt,
 										   btDbvtNode* parent,
 										   void* data)
 {
-	btDbvtNode*	node;
-	if(pdbvt->m_free)
-	{ node=pdbvt->m_free;pdbvt->m_free=0; }
-	else
-	{ node=new(btAlignedAlloc(sizeof(btDbvtNode),16)) btDbvtNode(); }
+	if(!pdbvt->m_free)
+	{
+		const int	size=btMin<int>(btDbvt::MAX_BLOCKSIZE,btMax<int>(btDbvt::MIN_BLOCKSIZE,pdbvt->m_poolsize/2));
+		btDbvtNode*	block=allocateblock(pdbvt,size);
+		for(int i=size-1;i>=0;--i) deletenode(pdbvt,&block[i]);
+	}
+	btDbvtNode*	node=pdbvt->m_free;
+	pdbvt->m_free	=	node->parent;
 	node->parent	=	parent;
 	node->data		=	data;
 	node->childs[1]	=	0;
@@ -130,6 +155,7 @@ static void						insertleaf(	btDbvt* pdbvt,
 										   btDbvtNode* root,
 										   btDbvtNode* leaf)
 {
+	++pdbvt->m_revision;
 	if(!pdbvt->m_root)
 	{
 		pdbvt->m_root	=	leaf;
@@ -173,6 +199,7 @@ static void						insertleaf(	btDbvt* pdbvt,
 static btDbvtNode*				removeleaf(	btDbvt* pdbvt,
 										   btDbvtNode* leaf)
 {
+	++pdbvt->m_revision;
 	if(leaf==pdbvt->m_root)
 	{
 		pdbvt->m_root=0;
@@ -215,6 +242,7 @@ static void						fetchleaves(btDbvt* pdbvt,
 											tNodeArray& leaves,
 											int depth=-1)
 {
+	++pdbvt->m_revision;
 	if(root->isinternal()&&depth)
 	{
 		fetchleaves(pdbvt,root->childs[0],leaves,depth-1);
@@ -400,6 +428,38 @@ static DBVT_INLINE btDbvtNode*	walkup(btDbvtNode* n,int count)
 	return(n);
 }
 
+//
+static DBVT_INLINE btScalar		halfsurface(const btDbvtVolume& v)
+{
+	const btVector3	d=v.Lengths();
+	return(d.x()*d.y()+d.y()*d.z()+d.z()*d.x());
+}
+
+//
+static void						collectleaves(btDbvtNode* root,tNodeArray& leaves)
+{
+	if(root->isinternal())
+	{
+		collectleaves(root->childs[0],leaves);
+		collectleaves(root->childs[1],leaves);
+	}
+	else
+	{
+		leaves.push_back(root);
+	}
+}
+
+//
+static void						deleteinternals(btDbvt* pdbvt,btDbvtNode* node)
+{
+	if(node->isinternal())
+	{
+		deleteinternals(pdbvt,node->childs[0]);
+		deleteinternals(pdbvt,node->childs[1]);
+		deletenode(pdbvt,node);
+	}
+}
+
 //
 // Api
 //
@@ -409,9 +469,17 @@ btDbvt::btDbvt()
 {
 	m_root		=	0;
 	m_free		=	0;
+	m_poolsize	=	0;
+	m_layoutblock	=	0;
+	m_layoutsize	=	0;
+	m_spareblock	=	0;
+	m_sparesize		=	0;
+	m_pending	=	0;
 	m_lkhd		=	-1;
 	m_leaves	=	0;
 	m_opath		=	0;
+	m_revision	=	0;
+	m_leafrevision	=	0;
 }
 
 //
@@ -423,9 +491,12 @@ btDbvt::~btDbvt()
 //
 void			btDbvt::clear()
 {
-	if(m_root)	recursedeletenode(this,m_root);
-	btAlignedFree(m_free);
-	m_free=0;
+	btAssert(m_pending==0);
+	releaseblocks(this);
+	m_root=0;
+	m_leaves=0;
+	++m_revision;
+	++m_leafrevision;
 }
 
 //
@@ -453,6 +524,21 @@ void			btDbvt::optimizeTopDown(int bu_treshold)
 	}
 }
 
+//
+void			btDbvt::optimizeSAH()
+{
+	if(m_root&&m_root->isinternal())
+	{
+		btDbvtBuilder	builder;
+		builder.prepare(this);
+		for(int i=0;i<builder.getNumJobs();++i)
+		{
+			builder.buildJob(i);
+		}
+		builder.commit();
+	}
+}
+
 //
 void			btDbvt::optimizeIncremental(int passes)
 {
@@ -473,15 +559,117 @@ void			btDbvt::optimizeIncremental(int passes)
 	}
 }
 
+//
+bool			btDbvt::optimizeLayout(IRelocate* irelocate)
+{
+	if(m_pending>0) return(false);
+	if(!m_root) { releaseblocks(this);return(true); }
+	const int	count=m_leaves*2-1;
+	btDbvtNode*	block;
+	int			size;
+	if(m_spareblock&&(m_sparesize>=count))
+	{
+		block=m_spareblock;
+		size=m_sparesize;
+	}
+	else
+	{
+		if(m_spareblock) btAlignedFree(m_spareblock);
+		/* Room for inserts until the next pass					*/ 
+		size=count+btMax<int>(MIN_BLOCKSIZE,count/4);
+		block=newblock(size);
+	}
+	m_spareblock=0;
+	m_sparesize=0;
+	/* Old nodes are only read, their parents lead back up the tree	*/ 
+	const btDbvtNode*	o=m_root;
+	btDbvtNode*			p=0;
+	int					next=0;
+	for(;;)
+	{
+		btAssert(next<count);
+		btDbvtNode*		n=&block[next++];
+		n->volume	=	o->volume;
+		n->parent	=	p;
+		if(p)
+			p->childs[p->childs[0]?1:0]=n;
+		else
+			m_root=n;
+		if(o->isinternal())
+		{
+			/* Left child right after its parent			*/ 
+			n->childs[0]=0;
+			p=n;
+			o=o->childs[0];
+			continue;
+		}
+		n->data			=	o->data;
+		n->childs[1]	=	0;
+		irelocate->RelocateLeaf(n);
+		/* Up to the next right child that is not copied yet	*/ 
+		while(o->parent&&(o==o->parent->childs[1]))
+		{
+			o=o->parent;
+			p=p->parent;
+		}
+		if(!o->parent) break;
+		o=o->parent->childs[1];
+	}
+	btAssert(next==count);
+	for(int i=0;i<m_blocks.size();++i)
+	{
+		if(m_blocks[i]==m_layoutblock)
+		{
+			m_spareblock=m_layoutblock;
+			m_sparesize=m_layoutsize;
+		}
+		else btAlignedFree(m_blocks[i]);
+	}
+	m_blocks.resize(0);
+	m_blocks.push_back(block);
+	m_layoutblock	=	block;
+	m_layoutsize	=	size;
+	m_poolsize		=	size;
+	m_free			=	0;
+	for(int j=size-1;j>=count;--j) deletenode(this,&block[j]);
+	++m_revision;
+	return(true);
+}
+
 //
 btDbvtNode*	btDbvt::insert(const btDbvtVolume& volume,void* data)
 {
 	btDbvtNode*	leaf=createnode(this,0,volume,data);
 	insertleaf(this,m_root,leaf);
 	++m_leaves;
+	++m_leafrevision;
 	return(leaf);
 }
 
+//
+void			btDbvt::insertBatch(const btDbvtVolume* volumes,void* const* data,int count,btDbvtNode** leaves)
+{
+	if(count<=0) return;
+	tNodeArray	all;
+	all.reserve(m_leaves+count);
+	if(m_root) fetchleaves(this,m_root,all);
+	m_root=0;
+	for(int i=0;i<count;++i)
+	{
+		leaves[i]=createnode(this,0,volumes[i],data[i]);
+		all.push_back(leaves[i]);
+	}
+	btDbvtBuilder	builder;
+	builder.prepare(this,&all[0],all.size());
+	for(int j=0;j<builder.getNumJobs();++j)
+	{
+		builder.buildJob(j);
+	}
+	builder.commit();
+	m_leaves+=count;
+	++m_leafrevision;
+}
+
 //
 void			btDbvt::update(btDbvtNode* leaf,int lookahead)
 {
@@ -515,6 +703,7 @@ void			btDbvt::update(btDbvtNode* leaf,btDbvtVolume& volume)
 	}
 	leaf->volume=volume;
 	insertleaf(this,root,leaf);
+	++m_leafrevision;
 }
 
 //
@@ -551,6 +740,7 @@ void			btDbvt::remove(btDbvtNode* leaf)
 	removeleaf(this,leaf);
 	deletenode(this,leaf);
 	--m_leaves;
+	++m_leafrevision;
 }
 
 //
@@ -1287,3 +1477,238 @@ void			btDbvt::benchmark()
 	printf("\r\n\r\n");
 }
 #endif
+
+//
+// btDbvtBuilder
+//
+
+//
+btDbvtBuilder::btDbvtBuilder()
+{
+	m_tree		=	0;
+	m_leafrevision	=	0;
+	m_root		=	0;
+}
+
+//
+btDbvtBuilder::~btDbvtBuilder()
+{
+	discard();
+}
+
+//
+void			btDbvtBuilder::prepare(btDbvt* tree,int maxJobLeaves)
+{
+	discard();
+	m_leaves.reserve(tree->m_leaves);
+	if(tree->m_root) collectleaves(tree->m_root,m_leaves);
+	start(tree,maxJobLeaves);
+}
+
+//
+void			btDbvtBuilder::prepare(btDbvt* tree,btDbvtNode* const* leaves,int count,int maxJobLeaves)
+{
+	discard();
+	m_leaves.resize(count);
+	for(int i=0;i<count;++i)
+	{
+		m_leaves[i]=leaves[i];
+	}
+	start(tree,maxJobLeaves);
+}
+
+//
+void			btDbvtBuilder::start(btDbvt* tree,int maxJobLeaves)
+{
+	const int	n=m_leaves.size();
+	int			i;
+	m_tree		=	tree;
+	m_leafrevision	=	tree->m_leafrevision;
+	m_volumes.resize(n);
+	m_centers.resize(n);
+	for(i=0;i<n;++i)
+	{
+		m_volumes[i]=m_leaves[i]->volume;
+		m_centers[i]=m_volumes[i].Center();
+	}
+	m_nodes.resize(btMax(n-1,0));
+	for(i=0;i<m_nodes.size();++i)
+	{
+		m_nodes[i]=createnode(tree,0,0);
+	}
+	++tree->m_pending;
+	if(n>0) buildTop(0,n,0,0,btMax(maxJobLeaves,1));
+}
+
+//
+void			btDbvtBuilder::buildJob(int job)
+{
+	const sJob&	j=m_jobs[job];
+	link(build(j.begin,j.end),j.begin,j.end,j.parent,j.child);
+}
+
+//
+bool			btDbvtBuilder::commit()
+{
+	if(!m_tree) return(false);
+	/* Incremental optimization may have changed the structure meanwhile, the internals are rebuilt anyway	*/ 
+	if(m_tree->m_leafrevision!=m_leafrevision)
+	{
+		discard();
+		return(false);
+	}
+	if(m_tree->m_root) deleteinternals(m_tree,m_tree->m_root);
+	/* Leaves are linked last, the jobs never write to them	*/ 
+	for(int i=0;i<m_nodes.size();++i)
+	{
+		btDbvtNode*	node=m_nodes[i];
+		node->childs[0]->parent=node;
+		node->childs[1]->parent=node;
+	}
+	if(m_root) m_root->parent=0;
+	m_tree->m_root=m_root;
+	++m_tree->m_revision;
+	--m_tree->m_pending;
+	m_nodes.resize(0);
+	m_tree=0;
+	discard();
+	return(true);
+}
+
+//
+void			btDbvtBuilder::discard()
+{
+	if(m_tree)
+	{
+		for(int i=0;i<m_nodes.size();++i)
+		{
+			deletenode(m_tree,m_nodes[i]);
+		}
+		--m_tree->m_pending;
+	}
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_volumes.resize(0);
+	m_centers.resize(0);
+	m_jobs.resize(0);
+	m_tree		=	0;
+	m_root		=	0;
+}
+
+//
+int				btDbvtBuilder::split(int begin,int end,btDbvtVolume& volume)
+{
+	int	i;
+	volume=m_volumes[begin];
+	btVector3	cmin=m_centers[begin];
+	btVector3	cmax=cmin;
+	for(i=begin+1;i<end;++i)
+	{
+		Merge(volume,m_volumes[i],volume);
+		cmin.setMin(m_centers[i]);
+		cmax.setMax(m_centers[i]);
+	}
+	const int	count=end-begin;
+	if(count==2) return(begin+1);
+	const btVector3	extent=cmax-cmin;
+	const int		axis=extent.maxAxis();
+	if(!(extent[axis]>0)) return(begin+count/2);
+	/* Bin the centers along the longest axis					*/ 
+	const btScalar	offset=cmin[axis];
+	const btScalar	scale=(NUM_BINS*(1-SIMD_EPSILON))/extent[axis];
+	int				counts[NUM_BINS];
+	btDbvtVolume	bounds[NUM_BINS];
+	for(i=0;i<NUM_BINS;++i) counts[i]=0;
+	for(i=begin;i<end;++i)
+	{
+		const int	b=btMin<int>(NUM_BINS-1,(int)((m_centers[i][axis]-offset)*scale));
+		if(counts[b]++) Merge(bounds[b],m_volumes[i],bounds[b]); else bounds[b]=m_volumes[i];
+	}
+	/* Cost of splitting after bin i is n(left)*A(left)+n(right)*A(right)	*/ 
+	btScalar		costs[NUM_BINS-1];
+	btDbvtVolume	acc;
+	int				n=0;
+	for(i=0;i<NUM_BINS-1;++i)
+	{
+		if(counts[i]) { if(n) Merge(acc,bounds[i],acc); else acc=bounds[i]; }
+		n+=counts[i];
+		costs[i]=n?n*halfsurface(acc):SIMD_INFINITY;
+	}
+	n=0;
+	for(i=NUM_BINS-1;i>0;--i)
+	{
+		if(counts[i]) { if(n) Merge(acc,bounds[i],acc); else acc=bounds[i]; }
+		n+=counts[i];
+		costs[i-1]=n?costs[i-1]+n*halfsurface(acc):SIMD_INFINITY;
+	}
+	int			best=0;
+	for(i=1;i<NUM_BINS-1;++i)
+	{
+		if(costs[i]<costs[best]) best=i;
+	}
+	/* Partition the leaves and volumes in place				*/ 
+	int	j=end-1;
+	i=begin;
+	while(i<=j)
+	{
+		const int	b=btMin<int>(NUM_BINS-1,(int)((m_centers[i][axis]-offset)*scale));
+		if(b<=best)
+		{
+			++i;
+		}
+		else
+		{
+			m_leaves.swap(i,j);
+			m_volumes.swap(i,j);
+			m_centers.swap(i,j);
+			--j;
+		}
+	}
+	if((i==begin)||(i==end)) return(begin+count/2);
+	return(i);
+}
+
+//
+btDbvtNode*		btDbvtBuilder::build(int begin,int end)
+{
+	if((end-begin)==1) return(m_leaves[begin]);
+	btDbvtVolume	volume;
+	const int		mid=split(begin,end,volume);
+	btDbvtNode*		node=m_nodes[mid-1];
+	node->volume=volume;
+	link(build(begin,mid),begin,mid,node,0);
+	link(build(mid,end),mid,end,node,1);
+	return(node);
+}
+
+//
+void			btDbvtBuilder::buildTop(int begin,int end,btDbvtNode* parent,int child,int maxJobLeaves)
+{
+	if((end-begin)<=maxJobLeaves)
+	{
+		sJob	j;
+		j.begin		=	begin;
+		j.end		=	end;
+		j.parent	=	parent;
+		j.child		=	child;
+		m_jobs.push_back(j);
+	}
+	else
+	{
+		btDbvtVolume	volume;
+		const int		mid=split(begin,end,volume);
+		btDbvtNode*		node=m_nodes[mid-1];
+		node->volume=volume;
+		link(node,begin,end,parent,child);
+		buildTop(begin,mid,node,0,maxJobLeaves);
+		buildTop(mid,end,node,1,maxJobLeaves);
+	}
+}
+
+//
+void			btDbvtBuilder::link(btDbvtNode* node,int begin,int end,btDbvtNode* parent,int child)
+{
+	if(parent) parent->childs[child]=node; else m_root=node;
+	/* Leaves may still be used by the tree, they get their parent in commit	*/ 
+	if((end-begin)>1) node->parent=parent;
+}
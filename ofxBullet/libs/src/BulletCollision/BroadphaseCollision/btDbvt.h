@@ -186,6 +186,36 @@ struct	btDbvtNode
 	};
 };
 
+///btDbvtRayPacket holds up to MAX_RAYS rays for btDbvt::rayTestPacket. The rays are stored as structure of arrays,
+///so the slab tests of all rays against a node run in one loop.
+struct	btDbvtRayPacket
+{
+	enum
+	{
+		MAX_RAYS = 16
+	};
+
+	btScalar	m_rayFrom[3][MAX_RAYS];
+	btScalar	m_rayDirectionInverse[3][MAX_RAYS];
+	btScalar	m_lambdaMax[MAX_RAYS];
+	int			m_numRays;
+
+	btDbvtRayPacket() : m_numRays(0) {}
+
+	///rayDirectionInverse and lambdaMax belong to the normalized ray direction, see btBroadphaseRayCallback
+	void	addRay(const btVector3& rayFrom,const btVector3& rayDirectionInverse,btScalar lambdaMax)
+	{
+		btAssert(m_numRays<MAX_RAYS);
+		for (int k=0;k<3;k++)
+		{
+			m_rayFrom[k][m_numRays] = rayFrom[k];
+			m_rayDirectionInverse[k][m_numRays] = rayDirectionInverse[k];
+		}
+		m_lambdaMax[m_numRays] = lambdaMax;
+		m_numRays++;
+	}
+};
+
 ///The btDbvt class implements a fast dynamic bounding volume tree based on axis aligned bounding boxes (aabb tree).
 ///This btDbvt is used for soft body collision detection and for the btDbvtBroadphase. It has a fast insert, remove and update of nodes.
 ///Unlike the btQuantizedBvh, nodes can be dynamically moved around, which allows for change in topology of the underlying data structure.
@@ -203,6 +233,7 @@ struct	btDbvt
 	{
 		const btDbvtNode*	node;
 		int			mask;
+		sStkNP() {}
 		sStkNP(const btDbvtNode* n,unsigned m) : node(n),mask(m) {}
 	};
 	struct	sStkNPS
@@ -219,6 +250,28 @@ struct	btDbvt
 		btDbvtNode*		parent;
 		sStkCLN(const btDbvtNode* n,btDbvtNode* p) : node(n),parent(p) {}
 	};
+	/* Query stack on the call stack, only trees deeper than N spill to the heap	*/ 
+	template <typename T,int N>
+	struct	sStkLocal
+	{
+		T						local[N];
+		btAlignedObjectArray<T>	heap;
+		T*						data;
+		int						capacity;
+		sStkLocal() : data(local),capacity(N) {}
+		T&		operator[](int i)		{ return(data[i]); }
+		void	grow(int depth)
+		{
+			if(data==local)
+			{
+				heap.resize(N*2);
+				for(int i=0;i<depth;++i) heap[i]=local[i];
+			}
+			else heap.resize(capacity*2);
+			data=&heap[0];
+			capacity=heap.size();
+		}
+	};
 	// Policies/Interfaces
 
 	/* ICollide	*/ 
@@ -230,6 +283,8 @@ struct	btDbvt
 		DBVT_VIRTUAL void	Process(const btDbvtNode* n,btScalar)			{ Process(n); }
 		DBVT_VIRTUAL bool	Descent(const btDbvtNode*)					{ return(true); }
 		DBVT_VIRTUAL bool	AllLeaves(const btDbvtNode*)					{ return(true); }
+		///leaf of rayTestPacket, bit i of rayMask is set when ray i of the packet hits the leaf volume
+		DBVT_VIRTUAL void	ProcessRays(const btDbvtNode*,unsigned int)		{}
 	};
 	/* IWriter	*/ 
 	struct	IWriter
@@ -245,19 +300,43 @@ struct	btDbvt
 		virtual ~IClone()	{}
 		virtual void		CloneLeaf(btDbvtNode*) {}
 	};
+	/* IRelocate	*/ 
+	struct	IRelocate
+	{
+		virtual ~IRelocate()	{}
+		/* Called with the new location of a leaf moved by optimizeLayout	*/ 
+		virtual void		RelocateLeaf(btDbvtNode* leaf)=0;
+	};
 
 	// Constants
 	enum	{
 		SIMPLE_STACKSIZE	=	64,
-		DOUBLE_STACKSIZE	=	SIMPLE_STACKSIZE*2
+		DOUBLE_STACKSIZE	=	SIMPLE_STACKSIZE*2,
+		MIN_BLOCKSIZE		=	64,
+		MAX_BLOCKSIZE		=	4096
 	};
 
 	// Fields
 	btDbvtNode*		m_root;
+	/* Nodes are allocated in blocks, free nodes are linked through parent	*/ 
 	btDbvtNode*		m_free;
+	btAlignedObjectArray<btDbvtNode*>	m_blocks;
+	int				m_poolsize;
+	/* Block of the last layout pass, it becomes the spare of the next one	*/ 
+	btDbvtNode*		m_layoutblock;
+	int				m_layoutsize;
+	/* Reused by the next layout pass, so passes don't allocate once the tree size is stable	*/ 
+	btDbvtNode*		m_spareblock;
+	int				m_sparesize;
+	/* Number of btDbvtBuilder holding nodes of the pool	*/ 
+	int				m_pending;
 	int				m_lkhd;
 	int				m_leaves;
 	unsigned		m_opath;
+	/* Incremented by every change of the tree structure, including incremental optimization	*/ 
+	unsigned		m_revision;
+	/* Incremented when leaves are inserted, removed or change their volume, see btDbvtBuilder	*/ 
+	unsigned		m_leafrevision;
 
 	
 	btAlignedObjectArray<sStkNN>	m_stkStack;
@@ -270,8 +349,17 @@ struct	btDbvt
 	bool			empty() const { return(0==m_root); }
 	void			optimizeBottomUp();
 	void			optimizeTopDown(int bu_treshold=128);
+	/* Rebuilds the tree with btDbvtBuilder on the calling thread	*/ 
+	void			optimizeSAH();
 	void			optimizeIncremental(int passes);
+	/* Moves all nodes into one block in depth-first order and releases the other blocks.	*/ 
+	/* The block of the previous pass is kept for the next one, with some free nodes for inserts	*/ 
+	/* The shape of the tree is kept, but optimizeIncremental rotates nodes by their address, so later passes differ	*/ 
+	/* Returns false without doing anything while a btDbvtBuilder holds nodes of the pool	*/ 
+	bool			optimizeLayout(IRelocate* irelocate);
 	btDbvtNode*		insert(const btDbvtVolume& box,void* data);
+	/* Creates count leaves and rebuilds the tree with btDbvtBuilder over all leaves at once	*/ 
+	void			insertBatch(const btDbvtVolume* volumes,void* const* data,int count,btDbvtNode** leaves);
 	void			update(btDbvtNode* leaf,int lookahead=-1);
 	void			update(btDbvtNode* leaf,btDbvtVolume& volume);
 	bool			update(btDbvtNode* leaf,btDbvtVolume& volume,const btVector3& velocity,btScalar margin);
@@ -321,21 +409,34 @@ struct	btDbvt
 		const btDbvtVolume& volume,
 		DBVT_IPOLICY);
 	///rayTest is a re-entrant ray test, and can be called in parallel as long as the btAlignedAlloc is thread-safe (uses locking etc)
-	///rayTest is slower than rayTestInternal, because it builds a local stack, using memory allocations, and it recomputes signs/rayDirectionInverses each time
+	///rayTest is slower than rayTestInternal, because it recomputes signs/rayDirectionInverses each time
 	DBVT_PREFIX
 		static void		rayTest(	const btDbvtNode* root,
 		const btVector3& rayFrom,
 		const btVector3& rayTo,
 		DBVT_IPOLICY);
-	///rayTestInternal is faster than rayTest, because it uses a persistent stack (to reduce dynamic memory allocations to a minimum) and it uses precomputed signs/rayInverseDirections
+	///rayTestInternal is faster than rayTest, because it uses precomputed signs/rayInverseDirections
+	///The queries keep their stack on the call stack (see sStkLocal), they only allocate memory for trees deeper than DOUBLE_STACKSIZE/2
 	///rayTestInternal is used by btDbvtBroadphase to accelerate world ray casts
+	///lambda_max is read again for every node, so the policy can shrink the ray to the closest hit found so far and the
+	///subtrees beyond it are culled. The child nearer to rayFrom is visited first, so the ray shrinks early.
 	DBVT_PREFIX
 		void		rayTestInternal(	const btDbvtNode* root,
 								const btVector3& rayFrom,
 								const btVector3& rayTo,
 								const btVector3& rayDirectionInverse,
 								unsigned int signs[3],
-								btScalar lambda_max,
+								const btScalar& lambda_max,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								DBVT_IPOLICY) const;
+	///rayTestPacket traverses the tree once for a packet of coherent rays and reports the leaves through ICollide::ProcessRays.
+	///While the rays share their direction signs, a node is culled for the whole packet with an interval arithmetic slab
+	///test, rays that miss a node are dropped below it. The policy may lower packet.m_lambdaMax of a ray in ProcessRays,
+	///like lambda_max of rayTestInternal.
+	DBVT_PREFIX
+		void		rayTestPacket(	const btDbvtNode* root,
+								btDbvtRayPacket& packet,
 								const btVector3& aabbMin,
 								const btVector3& aabbMax,
 								DBVT_IPOLICY) const;
@@ -384,6 +485,56 @@ private:
 	btDbvt(const btDbvt&)	{}	
 };
 
+///btDbvtBuilder rebuilds the internal nodes of a btDbvt over its leaves, top-down with a binned surface area heuristic (SAH).
+///The leaves, and so the proxies and soft body nodes pointing to them, are kept.
+///prepare takes a snapshot of the leaf volumes, builds the top of the tree and splits the rest into jobs. buildJob works only on
+///the snapshot and the new nodes: jobs can run in parallel on any thread (see btParallelDbvtBuilder in BulletMultiThreaded), and
+///the tree can still be used meanwhile, optimizeIncremental included. commit then swaps in the new nodes on the thread that owns
+///the tree, or discards them when leaves were inserted, removed or updated since prepare.
+struct	btDbvtBuilder
+{
+	enum	{
+		NUM_BINS	=	16
+	};
+	/* Subtree over the leaves [begin,end), linked to childs[child] of parent or to the root	*/ 
+	struct	sJob
+	{
+		int			begin;
+		int			end;
+		btDbvtNode*	parent;
+		int			child;
+	};
+
+	btDbvtBuilder();
+	~btDbvtBuilder();
+	/* maxJobLeaves is the size of the largest job, the top of the tree is built until all jobs fit	*/ 
+	void			prepare(btDbvt* tree,int maxJobLeaves=0x7fffffff);
+	/* Builds over leaves fetched from the tree, which has no root meanwhile	*/ 
+	void			prepare(btDbvt* tree,btDbvtNode* const* leaves,int count,int maxJobLeaves=0x7fffffff);
+	int				getNumJobs() const { return(m_jobs.size()); }
+	void			buildJob(int job);
+	/* Returns false and leaves the tree untouched when its leaves were changed since prepare	*/ 
+	bool			commit();
+	void			discard();
+private:
+	void			start(btDbvt* tree,int maxJobLeaves);
+	int				split(int begin,int end,btDbvtVolume& volume);
+	btDbvtNode*		build(int begin,int end);
+	void			buildTop(int begin,int end,btDbvtNode* parent,int child,int maxJobLeaves);
+	void			link(btDbvtNode* node,int begin,int end,btDbvtNode* parent,int child);
+
+	btDbvt*								m_tree;
+	unsigned							m_leafrevision;
+	btDbvtNode*							m_root;
+	/* Leaves and snapshot of their volumes, reordered by the build	*/ 
+	btAlignedObjectArray<btDbvtNode*>	m_leaves;
+	btAlignedObjectArray<btDbvtVolume>	m_volumes;
+	btAlignedObjectArray<btVector3>		m_centers;
+	/* Internal nodes, a subtree over [begin,end) uses the nodes [begin,end-1)	*/ 
+	btAlignedObjectArray<btDbvtNode*>	m_nodes;
+	btAlignedObjectArray<sJob>			m_jobs;
+};
+
 //
 // Inline's
 //
@@ -927,26 +1078,25 @@ inline void		btDbvt::collideTV(	const btDbvtNode* root,
 		if(root)
 		{
 			ATTRIBUTE_ALIGNED16(btDbvtVolume)		volume(vol);
-			btAlignedObjectArray<const btDbvtNode*>	stack;
-			stack.resize(0);
-			stack.reserve(SIMPLE_STACKSIZE);
-			stack.push_back(root);
+			sStkLocal<const btDbvtNode*,SIMPLE_STACKSIZE>	stack;
+			int										depth=1;
+			stack[0]=root;
 			do	{
-				const btDbvtNode*	n=stack[stack.size()-1];
-				stack.pop_back();
+				const btDbvtNode*	n=stack[--depth];
 				if(Intersect(n->volume,volume))
 				{
 					if(n->isinternal())
 					{
-						stack.push_back(n->childs[0]);
-						stack.push_back(n->childs[1]);
+						if(depth+2>stack.capacity) stack.grow(depth);
+						stack[depth++]=n->childs[0];
+						stack[depth++]=n->childs[1];
 					}
 					else
 					{
 						policy.Process(n);
 					}
 				}
-			} while(stack.size()>0);
+			} while(depth>0);
 		}
 }
 
@@ -956,7 +1106,7 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 								const btVector3& rayTo,
 								const btVector3& rayDirectionInverse,
 								unsigned int signs[3],
-								btScalar lambda_max,
+								const btScalar& lambda_max,
 								const btVector3& aabbMin,
 								const btVector3& aabbMax,
 								DBVT_IPOLICY) const
@@ -965,11 +1115,11 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 	if(root)
 	{
 		btVector3 resultNormal;
+		const btVector3 rayDir = rayTo-rayFrom;
 
 		int								depth=1;
 		int								treshold=DOUBLE_STACKSIZE-2;
-		btAlignedObjectArray<const btDbvtNode*>	stack;
-		stack.resize(DOUBLE_STACKSIZE);
+		sStkLocal<const btDbvtNode*,DOUBLE_STACKSIZE>	stack;
 		stack[0]=root;
 		btVector3 bounds[2];
 		do	
@@ -986,11 +1136,13 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 				{
 					if(depth>treshold)
 					{
-						stack.resize(stack.size()*2);
-						treshold=stack.size()-2;
+						stack.grow(depth);
+						treshold=stack.capacity-2;
 					}
-					stack[depth++]=node->childs[0];
-					stack[depth++]=node->childs[1];
+					//push the far child first, so the near child is popped next
+					const bool child1Nearer = rayDir.dot(node->childs[1]->volume.Center()-node->childs[0]->volume.Center()) < btScalar(0.);
+					stack[depth++]=node->childs[child1Nearer?0:1];
+					stack[depth++]=node->childs[child1Nearer?1:0];
 				}
 				else
 				{
@@ -1001,6 +1153,118 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 	}
 }
 
+//
+DBVT_PREFIX
+inline void		btDbvt::rayTestPacket(	const btDbvtNode* root,
+								btDbvtRayPacket& packet,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	const int numRays = packet.m_numRays;
+	if(root && numRays)
+	{
+		//bounds of the origins and inverse directions of the packet, for the interval test
+		btScalar	fromMin[3],fromMax[3],invMin[3],invMax[3];
+		btScalar	lambdaMax = packet.m_lambdaMax[0];
+		bool		sameSigns = true;
+		int			i,k;
+		for (k=0;k<3;k++)
+		{
+			fromMin[k] = fromMax[k] = packet.m_rayFrom[k][0];
+			invMin[k] = invMax[k] = packet.m_rayDirectionInverse[k][0];
+			for (i=1;i<numRays;i++)
+			{
+				fromMin[k] = btMin(fromMin[k],packet.m_rayFrom[k][i]);
+				fromMax[k] = btMax(fromMax[k],packet.m_rayFrom[k][i]);
+				invMin[k] = btMin(invMin[k],packet.m_rayDirectionInverse[k][i]);
+				invMax[k] = btMax(invMax[k],packet.m_rayDirectionInverse[k][i]);
+			}
+			sameSigns = sameSigns && ((invMin[k] < btScalar(0.)) == (invMax[k] < btScalar(0.)));
+		}
+		for (i=1;i<numRays;i++)
+		{
+			lambdaMax = btMax(lambdaMax,packet.m_lambdaMax[i]);
+		}
+
+		int								depth=1;
+		int								treshold=DOUBLE_STACKSIZE-2;
+		sStkLocal<sStkNP,DOUBLE_STACKSIZE>	stack;
+		stack[0]=sStkNP(root,(1u<<numRays)-1);
+		do	
+		{
+			const sStkNP	current=stack[--depth];
+			const btVector3	mins = current.node->volume.Mins()+aabbMin;
+			const btVector3	maxs = current.node->volume.Maxs()+aabbMax;
+
+			if (sameSigns)
+			{
+				//smallest entry and largest exit parameter of any ray of the packet, the products are rounded
+				//the same way as in the per ray test below, so this never culls a node that one of the rays hits
+				btScalar tNear = -SIMD_INFINITY;
+				btScalar tFar = SIMD_INFINITY;
+				for (k=0;k<3;k++)
+				{
+					const bool negative = invMin[k] < btScalar(0.);
+					const btScalar nearPlane = negative ? maxs[k] : mins[k];
+					const btScalar farPlane = negative ? mins[k] : maxs[k];
+					const btScalar n0 = (nearPlane-fromMin[k])*invMin[k];
+					const btScalar n1 = (nearPlane-fromMin[k])*invMax[k];
+					const btScalar n2 = (nearPlane-fromMax[k])*invMin[k];
+					const btScalar n3 = (nearPlane-fromMax[k])*invMax[k];
+					const btScalar f0 = (farPlane-fromMin[k])*invMin[k];
+					const btScalar f1 = (farPlane-fromMin[k])*invMax[k];
+					const btScalar f2 = (farPlane-fromMax[k])*invMin[k];
+					const btScalar f3 = (farPlane-fromMax[k])*invMax[k];
+					tNear = btMax(tNear,btMin(btMin(n0,n1),btMin(n2,n3)));
+					tFar = btMin(tFar,btMax(btMax(f0,f1),btMax(f2,f3)));
+				}
+				if ((tNear > tFar) || (tNear >= lambdaMax) || (tFar <= btScalar(0.)))
+					continue;
+			}
+
+			//slab test of all rays, same result as btRayAabb2
+			unsigned int	hits = 0;
+			for (i=0;i<numRays;i++)
+			{
+				const btScalar tx0 = (mins.getX()-packet.m_rayFrom[0][i])*packet.m_rayDirectionInverse[0][i];
+				const btScalar tx1 = (maxs.getX()-packet.m_rayFrom[0][i])*packet.m_rayDirectionInverse[0][i];
+				const btScalar ty0 = (mins.getY()-packet.m_rayFrom[1][i])*packet.m_rayDirectionInverse[1][i];
+				const btScalar ty1 = (maxs.getY()-packet.m_rayFrom[1][i])*packet.m_rayDirectionInverse[1][i];
+				const btScalar tz0 = (mins.getZ()-packet.m_rayFrom[2][i])*packet.m_rayDirectionInverse[2][i];
+				const btScalar tz1 = (maxs.getZ()-packet.m_rayFrom[2][i])*packet.m_rayDirectionInverse[2][i];
+				const btScalar tmin = btMax(btMax(btMin(tx0,tx1),btMin(ty0,ty1)),btMin(tz0,tz1));
+				const btScalar tmax = btMin(btMin(btMax(tx0,tx1),btMax(ty0,ty1)),btMax(tz0,tz1));
+				hits |= (unsigned int)((tmin <= tmax) && (tmin < packet.m_lambdaMax[i]) && (tmax > btScalar(0.))) << i;
+			}
+			hits &= current.mask;
+			if (!hits)
+				continue;
+
+			if(current.node->isinternal())
+			{
+				if(depth>treshold)
+				{
+					stack.grow(depth);
+					treshold=stack.capacity-2;
+				}
+				stack[depth++]=sStkNP(current.node->childs[0],hits);
+				stack[depth++]=sStkNP(current.node->childs[1],hits);
+			}
+			else
+			{
+				policy.ProcessRays(current.node,hits);
+				lambdaMax = packet.m_lambdaMax[0];
+				for (i=1;i<numRays;i++)
+				{
+					lambdaMax = btMax(lambdaMax,packet.m_lambdaMax[i]);
+				}
+			}
+		} while(depth);
+	}
+}
+
 //
 DBVT_PREFIX
 inline void		btDbvt::rayTest(	const btDbvtNode* root,
@@ -1025,12 +1289,11 @@ inline void		btDbvt::rayTest(	const btDbvtNode* root,
 
 			btVector3 resultNormal;
 
-			btAlignedObjectArray<const btDbvtNode*>	stack;
+			sStkLocal<const btDbvtNode*,DOUBLE_STACKSIZE>	stack;
 
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-2;
 
-			stack.resize(DOUBLE_STACKSIZE);
 			stack[0]=root;
 			btVector3 bounds[2];
 			do	{
@@ -1054,8 +1317,8 @@ inline void		btDbvt::rayTest(	const btDbvtNode* root,
 					{
 						if(depth>treshold)
 						{
-							stack.resize(stack.size()*2);
-							treshold=stack.size()-2;
+							stack.grow(depth);
+							treshold=stack.capacity-2;
 						}
 						stack[depth++]=node->childs[0];
 						stack[depth++]=node->childs[1];
@@ -48,6 +48,32 @@ struct	ProfileScope
 // Helpers
 //
 
+/* Leaves moved by btDbvt::optimizeLayout	*/ 
+struct	btDbvtLeafRelocator : btDbvt::IRelocate
+{
+	void	RelocateLeaf(btDbvtNode* leaf)
+	{
+		((btDbvtProxy*)leaf->data)->leaf=leaf;
+	}
+};
+
+/* Runs passes optimization passes until the clock reaches limit, returns the number done	*/ 
+static int			optimizeBudgeted(btDbvt& set,int passes,btClock& clock,unsigned long limit)
+{
+	if(!limit)
+	{
+		set.optimizeIncremental(passes);
+		return(passes);
+	}
+	int	done=0;
+	do	{
+		const int	n=btMin<int>(passes-done,DBVT_BP_BUDGETGRANULARITY);
+		set.optimizeIncremental(n);
+		done+=n;
+	} while((done<passes)&&(clock.getTimeMicroseconds()<limit));
+	return(done);
+}
+
 //
 template <typename T>
 static inline void	listappend(T* item,T*& list)
@@ -79,7 +105,7 @@ static inline int	listcount(T* root)
 template <typename T>
 static inline void	clear(T& value)
 {
-	static const struct ZeroDummy : T {} zerodummy;
+	static const struct ZeroDummy : T {} zerodummy=ZeroDummy();
 	value=zerodummy;
 }
 
@@ -125,6 +151,12 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	m_prediction		=	1/(btScalar)2;
 	m_stageCurrent		=	0;
 	m_fixedleft			=	0;
+	m_layoutperiod		=	DBVT_BP_LAYOUTPERIOD;
+	m_layoutrevision[0]	=	m_sets[0].m_leafrevision;
+	m_layoutrevision[1]	=	m_sets[1].m_leafrevision;
+	m_layouttime		=	1;							/* Until measured, assume 8 nodes per microsecond	*/ 
+	m_layoutnodes		=	8;
+	m_budget			=	0;
 	m_fupdates			=	1;
 	m_dupdates			=	0;
 	m_cupdates			=	10;
@@ -142,6 +174,7 @@ paircache	:
 	{
 		m_stageRoots[i]=0;
 	}
+	clear(m_maintenance);
 #if DBVT_BP_PROFILE
 	clear(m_profiling);
 #endif
@@ -203,6 +236,107 @@ void							btDbvtBroadphase::destroyProxy(	btBroadphaseProxy* absproxy,
 	m_needcleanup=true;
 }
 
+//
+void							btDbvtBroadphase::createProxies(int numProxies,
+																const btVector3* aabbMin,
+																const btVector3* aabbMax,
+																const int* /*shapeTypes*/,
+																void* const* userPtrs,
+																const short int* collisionFilterGroups,
+																const short int* collisionFilterMasks,
+																btDispatcher* /*dispatcher*/,
+																btBroadphaseProxy** proxies)
+{
+	/* Incremental insertion degrades the tree, rebuild it when the batch dominates	*/ 
+	const bool	rebuild=(numProxies>64)&&(numProxies*2>=m_sets[0].m_leaves);
+	int i;
+	for(i=0;i<numProxies;++i)
+	{
+		btDbvtProxy*		proxy=new(btAlignedAlloc(sizeof(btDbvtProxy),16)) btDbvtProxy(	aabbMin[i],aabbMax[i],userPtrs[i],
+			collisionFilterGroups[i],
+			collisionFilterMasks[i]);
+		proxy->stage		=	m_stageCurrent;
+		proxy->m_uniqueId	=	++m_gid;
+		proxy->leaf			=	rebuild?0:m_sets[0].insert(btDbvtVolume::FromMM(aabbMin[i],aabbMax[i]),proxy);
+		listappend(proxy,m_stageRoots[m_stageCurrent]);
+		proxies[i]=proxy;
+	}
+	if(rebuild)
+	{
+		btAlignedObjectArray<btDbvtVolume>	volumes;
+		btAlignedObjectArray<btDbvtNode*>	leaves;
+		volumes.resize(numProxies);
+		leaves.resize(numProxies);
+		for(i=0;i<numProxies;++i)
+		{
+			volumes[i]=btDbvtVolume::FromMM(aabbMin[i],aabbMax[i]);
+		}
+		m_sets[0].insertBatch(&volumes[0],(void* const*)proxies,numProxies,&leaves[0]);
+		for(i=0;i<numProxies;++i)
+		{
+			((btDbvtProxy*)proxies[i])->leaf=leaves[i];
+		}
+	}
+	if(!m_deferedcollide)
+	{
+		btDbvtTreeCollider	collider(this);
+		if(rebuild)
+		{
+			/* Most of the dynamic set is new, collide the trees once	*/ 
+			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[1].m_root,collider);
+			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[0].m_root,collider);
+		}
+		else
+		{
+			for(i=0;i<numProxies;++i)
+			{
+				btDbvtProxy*	proxy=(btDbvtProxy*)proxies[i];
+				collider.proxy=proxy;
+				m_sets[0].collideTV(m_sets[0].m_root,proxy->leaf->volume,collider);
+				m_sets[1].collideTV(m_sets[1].m_root,proxy->leaf->volume,collider);
+			}
+		}
+	}
+}
+
+//
+void							btDbvtBroadphase::destroyProxies(btBroadphaseProxy* const* proxies,
+																 int numProxies,
+																 btDispatcher* dispatcher)
+{
+	/* Proxies being destroyed are tagged with an out of range stage		*/ 
+	struct	btDbvtRemovePairs : btOverlapCallback
+	{
+		bool	processOverlap(btBroadphasePair& pair)
+		{
+			return(	(((btDbvtProxy*)pair.m_pProxy0)->stage==STAGECOUNT+1)||
+					(((btDbvtProxy*)pair.m_pProxy1)->stage==STAGECOUNT+1));
+		}
+	};
+	int i;
+	for(i=0;i<numProxies;++i)
+	{
+		btDbvtProxy*	proxy=(btDbvtProxy*)proxies[i];
+		if(proxy->stage==STAGECOUNT)
+			m_sets[1].remove(proxy->leaf);
+		else
+			m_sets[0].remove(proxy->leaf);
+		listremove(proxy,m_stageRoots[proxy->stage]);
+		proxy->leaf		=	0;
+		proxy->stage	=	STAGECOUNT+1;
+	}
+	if(numProxies>0)
+	{
+		btDbvtRemovePairs	removePairs;
+		m_paircache->processAllOverlappingPairs(&removePairs,dispatcher);
+	}
+	for(i=0;i<numProxies;++i)
+	{
+		btAlignedFree(proxies[i]);
+	}
+	m_needcleanup=true;
+}
+
 void	btDbvtBroadphase::getAabb(btBroadphaseProxy* absproxy,btVector3& aabbMin, btVector3& aabbMax ) const
 {
 	btDbvtProxy*						proxy=(btDbvtProxy*)absproxy;
@@ -251,6 +385,48 @@ void	btDbvtBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,
 
 }
 
+void	btDbvtBroadphase::rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo,int numRays, btBroadphaseRayCallback** rayCallbacks,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	(void)rayTo;
+
+	struct	BroadphasePacketTester : btDbvt::ICollide
+	{
+		btBroadphaseRayCallback**	m_rayCallbacks;
+		btDbvtRayPacket&			m_packet;
+		BroadphasePacketTester(btBroadphaseRayCallback** rayCallbacks,btDbvtRayPacket& packet)
+			:m_rayCallbacks(rayCallbacks),m_packet(packet)
+		{
+		}
+		void					ProcessRays(const btDbvtNode* leaf,unsigned int rayMask)
+		{
+			btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+			for (int i=0;rayMask;i++,rayMask>>=1)
+			{
+				if (rayMask&1)
+				{
+					m_rayCallbacks[i]->process(proxy);
+					m_packet.m_lambdaMax[i] = m_rayCallbacks[i]->m_lambda_max;
+				}
+			}
+		}
+	};
+
+	for (int first=0;first<numRays;first+=btDbvtRayPacket::MAX_RAYS)
+	{
+		btDbvtRayPacket packet;
+		const int numPacketRays = btMin(numRays-first,int(btDbvtRayPacket::MAX_RAYS));
+		for (int i=0;i<numPacketRays;i++)
+		{
+			const btBroadphaseRayCallback& rayCallback = *rayCallbacks[first+i];
+			packet.addRay(rayFrom[first+i],rayCallback.m_rayDirectionInverse,rayCallback.m_lambda_max);
+		}
+
+		BroadphasePacketTester callback(rayCallbacks+first,packet);
+		m_sets[0].rayTestPacket(m_sets[0].m_root,packet,aabbMin,aabbMax,callback);
+		m_sets[1].rayTestPacket(m_sets[1].m_root,packet,aabbMin,aabbMax,callback);
+	}
+}
+
 //
 void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 														  const btVector3& aabbMin,
@@ -347,14 +523,50 @@ void							btDbvtBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 {
 	SPC(m_profiling.m_total);
+	/* optimization and layout get half of the budget, cleanup the rest	*/ 
+	m_budgetclock.reset();
+	const unsigned long	olimit=m_budget?btMax<unsigned long>(1,m_budget/2):0;
 	/* optimize				*/ 
-	m_sets[0].optimizeIncremental(1+(m_sets[0].m_leaves*m_dupdates)/100);
+	const int	dpasses=1+(m_sets[0].m_leaves*m_dupdates)/100+m_maintenance.m_ddeferred;
+	m_maintenance.m_dpasses		=	optimizeBudgeted(m_sets[0],dpasses,m_budgetclock,olimit);
+	m_maintenance.m_ddeferred	=	btMin<int>(dpasses-m_maintenance.m_dpasses,m_sets[0].m_leaves);
+	const int	fdeferred=m_maintenance.m_fdeferred;
+	m_maintenance.m_fpasses		=	0;
+	m_maintenance.m_fdeferred	=	0;
 	if(m_fixedleft)
 	{
-		const int count=1+(m_sets[1].m_leaves*m_fupdates)/100;
-		m_sets[1].optimizeIncremental(1+(m_sets[1].m_leaves*m_fupdates)/100);
-		m_fixedleft=btMax<int>(0,m_fixedleft-count);
+		const int	fpasses=1+(m_sets[1].m_leaves*m_fupdates)/100+fdeferred;
+		m_maintenance.m_fpasses		=	optimizeBudgeted(m_sets[1],fpasses,m_budgetclock,olimit);
+		m_fixedleft=btMax<int>(0,m_fixedleft-m_maintenance.m_fpasses);
+		m_maintenance.m_fdeferred	=	btMin<int>(fpasses-m_maintenance.m_fpasses,m_fixedleft);
+	}
+	/* depth-first layout of sets whose leaves changed, deferred while its estimated cost exceeds the budget	*/ 
+	if((m_layoutperiod>0)&&(m_maintenance.m_ldeferred||(0==(m_pid%m_layoutperiod))))
+	{
+		btDbvtLeafRelocator	relocator;
+		m_maintenance.m_ldeferred=false;
+		for(int i=0;i<2;++i)
+		{
+			if(m_layoutrevision[i]==m_sets[i].m_leafrevision) continue;
+			const int			nodes=btMax<int>(0,m_sets[i].m_leaves*2-1);
+			const unsigned long	base=m_budgetclock.getTimeMicroseconds();
+			if(olimit&&(m_layoutnodes>0))
+			{
+				const btScalar	estimate=m_layouttime*(nodes/(btScalar)m_layoutnodes);
+				if(base+estimate>olimit) { m_maintenance.m_ldeferred=true;continue; }
+			}
+			if(m_sets[i].optimizeLayout(&relocator))
+			{
+				m_layoutrevision[i]	=	m_sets[i].m_leafrevision;
+				if(nodes>=256)
+				{
+					m_layouttime	=	m_budgetclock.getTimeMicroseconds()-base;
+					m_layoutnodes	=	nodes;
+				}
+			}
+		}
 	}
+	unsigned long	used=m_budgetclock.getTimeMicroseconds();
 	/* dynamic -> fixed set	*/ 
 	m_stageCurrent=(m_stageCurrent+1)%STAGECOUNT;
 	btDbvtProxy*	current=m_stageRoots[m_stageCurrent];
@@ -395,16 +607,28 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		}
 	}
 	/* clean up				*/ 
-	if(m_needcleanup)
+	m_maintenance.m_cpairs=0;
+	if(m_needcleanup||(m_maintenance.m_cdeferred>0))
 	{
 		SPC(m_profiling.m_cleanup);
+		const unsigned long		base=m_budgetclock.getTimeMicroseconds();
+		const unsigned long		climit=m_budget?base+btMax<unsigned long>(1,m_budget>used?m_budget-used:0):0;
 		btBroadphasePairArray&	pairs=m_paircache->getOverlappingPairArray();
+		const int				cdeferred=m_maintenance.m_cdeferred;
+		m_maintenance.m_cdeferred=0;
 		if(pairs.size()>0)
 		{
 			const int	ci=pairs.size();
-			int			ni=btMin(ci,btMax<int>(m_newpairs,(ci*m_cupdates)/100));
-			for(int i=0;i<ni;++i)
+			int			ni=btMin(ci,btMax<int>(m_newpairs,(ci*m_cupdates)/100)+cdeferred);
+			int			i=0;
+			for(;i<ni;++i)
 			{
+				if(	climit&&(m_maintenance.m_cpairs>0)&&(0==(m_maintenance.m_cpairs%DBVT_BP_BUDGETGRANULARITY))&&
+					(m_budgetclock.getTimeMicroseconds()>=climit))
+				{
+					break;
+				}
+				++m_maintenance.m_cpairs;
 				btBroadphasePair&	p=pairs[(m_cid+i)%ci];
 				btDbvtProxy*		pa=(btDbvtProxy*)p.m_pProxy0;
 				btDbvtProxy*		pb=(btDbvtProxy*)p.m_pProxy1;
@@ -417,8 +641,19 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 					--ni;--i;
 				}
 			}
-			if(pairs.size()>0) m_cid=(m_cid+ni)%pairs.size(); else m_cid=0;
+			m_maintenance.m_cdeferred=ni-i;
+			if(pairs.size()>0) m_cid=(m_cid+i)%pairs.size(); else m_cid=0;
 		}
+		used+=m_budgetclock.getTimeMicroseconds()-base;
+	}
+	/* maintenance statistics	*/ 
+	m_maintenance.m_time	=	used;
+	m_maintenance.m_maxtime	=	btMax(m_maintenance.m_maxtime,used);
+	++m_maintenance.m_calls;
+	if(	(m_maintenance.m_ddeferred>0)||(m_maintenance.m_fdeferred>0)||
+		(m_maintenance.m_cdeferred>0)||m_maintenance.m_ldeferred)
+	{
+		++m_maintenance.m_overbudget;
 	}
 	++m_pid;
 	m_newpairs=1;
@@ -434,8 +669,13 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 //
 void							btDbvtBroadphase::optimize()
 {
-	m_sets[0].optimizeTopDown();
-	m_sets[1].optimizeTopDown();
+	btDbvtLeafRelocator	relocator;
+	for(int i=0;i<2;++i)
+	{
+		m_sets[i].optimizeSAH();
+		if(m_sets[i].optimizeLayout(&relocator))
+			m_layoutrevision[i]=m_sets[i].m_leafrevision;
+	}
 }
 
 //
@@ -472,6 +712,14 @@ void							btDbvtBroadphase::getBroadphaseAabb(btVector3& aabbMin,btVector3& aab
 void							btDbvtBroadphase::printStats()
 {}
 
+//
+void							btDbvtBroadphase::resetMaintenanceStats()
+{
+	m_maintenance.m_maxtime		=	0;
+	m_maintenance.m_calls		=	0;
+	m_maintenance.m_overbudget	=	0;
+}
+
 //
 #if DBVT_BP_ENABLE_BENCHMARK
 
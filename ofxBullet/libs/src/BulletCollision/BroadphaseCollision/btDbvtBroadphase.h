@@ -29,11 +29,13 @@ subject to the following restrictions:
 #define DBVT_BP_ACCURATESLEEPING		0
 #define DBVT_BP_ENABLE_BENCHMARK		0
 #define DBVT_BP_MARGIN					(btScalar)0.05
+#define DBVT_BP_LAYOUTPERIOD			0
+#define DBVT_BP_BUDGETGRANULARITY		16
 
 #if DBVT_BP_PROFILE
 #define	DBVT_BP_PROFILING_RATE	256
-#include "LinearMath/btQuickprof.h"
 #endif
+#include "LinearMath/btQuickprof.h"
 
 //
 // btDbvtProxy
@@ -58,6 +60,9 @@ typedef btAlignedObjectArray<btDbvtProxy*>	btDbvtProxyArray;
 ///The btDbvtBroadphase implements a broadphase using two dynamic AABB bounding volume hierarchies/trees (see btDbvt).
 ///One tree is used for static/non-moving objects, and another tree is used for dynamic objects. Objects can move from one tree to the other.
 ///This is a very fast broadphase, especially for very dynamic worlds where many objects are moving. Its insert/add and remove of objects is generally faster than the sweep and prune broadphases btAxisSweep3 and bt32BitAxisSweep3.
+///Set m_budget to bound the time each collide call spends on tree optimization, node layout and pair cleanup. Optimization and layout
+///use up to half of it, cleanup the rest. Work that doesn't fit is carried over to the next calls and reported in m_maintenance.
+///A layout pass can't be split, it waits until its estimated cost fits. Call optimize() while loading instead.
 struct	btDbvtBroadphase : btBroadphaseInterface
 {
 	/* Config		*/ 
@@ -75,8 +80,13 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	int						m_fupdates;					// % of fixed updates per frame
 	int						m_dupdates;					// % of dynamic updates per frame
 	int						m_cupdates;					// % of cleanup updates per frame
+	unsigned long			m_budget;					// Maintenance time per collide call in microseconds, 0 for unlimited
 	int						m_newpairs;					// Number of pairs created
 	int						m_fixedleft;				// Fixed optimization left
+	int						m_layoutperiod;				// Collide calls between node layout passes, 0 (the default) disables them
+	unsigned				m_layoutrevision[2];		// Set leaf revisions after the last layout pass
+	unsigned long			m_layouttime;				// Duration of the last layout pass in microseconds
+	int						m_layoutnodes;				// Nodes moved by the last layout pass
 	unsigned				m_updates_call;				// Number of updates call
 	unsigned				m_updates_done;				// Number of updates done
 	btScalar				m_updates_ratio;			// m_updates_done/m_updates_call
@@ -86,6 +96,21 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	bool					m_releasepaircache;			// Release pair cache on delete
 	bool					m_deferedcollide;			// Defere dynamic/static collision to collide call
 	bool					m_needcleanup;				// Need to run cleanup?
+	btClock					m_budgetclock;				// Maintenance clock
+	/* Maintenance done by the last collide call, work over m_budget is carried over to the next call	*/ 
+	struct	{
+		unsigned long		m_time;						// Time spent in optimization, layout and cleanup
+		unsigned long		m_maxtime;					// Largest m_time since the last reset
+		int					m_dpasses;					// Dynamic set optimization passes done
+		int					m_fpasses;					// Fixed set optimization passes done
+		int					m_cpairs;					// Pairs checked by the cleanup
+		int					m_ddeferred;				// Dynamic set passes deferred
+		int					m_fdeferred;				// Fixed set passes deferred
+		int					m_cdeferred;				// Cleanup pairs deferred
+		bool				m_ldeferred;				// Layout pass deferred
+		unsigned			m_calls;					// Collide calls since the last reset
+		unsigned			m_overbudget;				// Calls since the last reset that deferred work
+	}						m_maintenance;
 #if DBVT_BP_PROFILE
 	btClock					m_clock;
 	struct	{
@@ -100,12 +125,20 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	btDbvtBroadphase(btOverlappingPairCache* paircache=0);
 	~btDbvtBroadphase();
 	void							collide(btDispatcher* dispatcher);
+	/* Rebuilds both trees, see btDbvtBuilder	*/ 
 	void							optimize();
 	/* btBroadphaseInterface Implementation	*/ 
 	btBroadphaseProxy*				createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr,short int collisionFilterGroup,short int collisionFilterMask,btDispatcher* dispatcher,void* multiSapProxy);
 	void							destroyProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+	///inserts all leaves first and rebuilds the dynamic tree once when the batch is large compared to the tree
+	virtual void					createProxies(int numProxies,const btVector3* aabbMin,const btVector3* aabbMax,const int* shapeTypes,void* const* userPtrs,
+												  const short int* collisionFilterGroups,const short int* collisionFilterMasks,btDispatcher* dispatcher,btBroadphaseProxy** proxies);
+	///removes the pairs of all proxies in a single pass over the pair cache
+	virtual void					destroyProxies(btBroadphaseProxy* const* proxies,int numProxies,btDispatcher* dispatcher);
 	void							setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
+	///traverses both trees once for each packet of up to btDbvtRayPacket::MAX_RAYS rays, see btDbvt::rayTestPacket
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo,int numRays, btBroadphaseRayCallback** rayCallbacks, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 
 	virtual void	getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	void							calculateOverlappingPairs(btDispatcher* dispatcher);
@@ -113,6 +146,8 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	const btOverlappingPairCache*	getOverlappingPairCache() const;
 	void							getBroadphaseAabb(btVector3& aabbMin,btVector3& aabbMax) const;
 	void							printStats();
+	/* Resets the m_maintenance totals, deferred work is kept	*/ 
+	void							resetMaintenanceStats();
 	static void						benchmark(btBroadphaseInterface*);
 };
 
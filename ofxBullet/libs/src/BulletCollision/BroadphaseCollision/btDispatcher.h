@@ -28,6 +28,17 @@ class btOverlappingPairCache;
 class btPersistentManifold;
 class btStackAlloc;
 
+///btManifoldListener is told when a dispatcher creates or releases a contact manifold, see btDispatcher::setManifoldListener
+class btManifoldListener
+{
+public:
+	virtual ~btManifoldListener() {}
+
+	virtual void	manifoldCreated(btPersistentManifold* manifold) = 0;
+
+	virtual void	manifoldReleased(btPersistentManifold* manifold) = 0;
+};
+
 struct btDispatcherInfo
 {
 	enum DispatchFunc
@@ -100,6 +111,19 @@ public:
 
 	virtual	void freeCollisionAlgorithm(void* ptr) = 0;
 
+	///registers a single listener for manifold creation and release, 0 removes it.
+	///Returns false if the dispatcher doesn't support listeners.
+	virtual bool	setManifoldListener(btManifoldListener* listener)
+	{
+		(void)listener;
+		return false;
+	}
+
+	virtual btManifoldListener*	getManifoldListener()
+	{
+		return 0;
+	}
+
 };
 
 
@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "btCollisionAlgorithm.h"
 
 #include <stdio.h>
+#include <string.h>
 
 int	gOverlappingPairs = 0;
 
@@ -394,6 +395,405 @@ void	btHashedOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback*
 
 
 
+///bit i is set when slot i of the bucket holds the key
+static SIMD_FORCE_INLINE int	matchPairKeys(const btOpenHashedOverlappingPairCache::btPairBucket& bucket,unsigned int proxyId1,unsigned int proxyId2)
+{
+#ifdef BT_USE_SSE
+	const __m128i	key = _mm_set_epi32((int)proxyId2,(int)proxyId1,(int)proxyId2,(int)proxyId1);
+	__m128i	lo = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&bucket.m_keys[0]),key);
+	__m128i	hi = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&bucket.m_keys[4]),key);
+	//both 32 bit halves of a 64 bit key must match
+	lo = _mm_and_si128(lo,_mm_shuffle_epi32(lo,_MM_SHUFFLE(2,3,0,1)));
+	hi = _mm_and_si128(hi,_mm_shuffle_epi32(hi,_MM_SHUFFLE(2,3,0,1)));
+	return _mm_movemask_pd(_mm_castsi128_pd(lo)) | (_mm_movemask_pd(_mm_castsi128_pd(hi)) << 2);
+#else
+	int mask = 0;
+	for (int i=0;i<btOpenHashedOverlappingPairCache::BUCKET_SIZE;i++)
+	{
+		if ((bucket.m_keys[i*2] == proxyId1) && (bucket.m_keys[i*2+1] == proxyId2))
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
+///lowest set bit of a slot mask, without the branches that mispredict on random slots
+static SIMD_FORCE_INLINE int	firstPairSlot(int mask)
+{
+	static const signed char firstSlot[16] = {-1,0,1,0,2,0,1,0,3,0,1,0,2,0,1,0};
+	return firstSlot[mask];
+}
+
+static void	initPairTable(btOpenHashedOverlappingPairCache::btPairTable& table,int numBuckets)
+{
+	table.m_buckets = (btOpenHashedOverlappingPairCache::btPairBucket*)btAlignedAlloc(sizeof(btOpenHashedOverlappingPairCache::btPairBucket)*numBuckets,64);
+	table.m_mask = numBuckets-1;
+	table.m_size = 0;
+	memset(table.m_buckets,0,sizeof(btOpenHashedOverlappingPairCache::btPairBucket)*numBuckets);
+	for (int i=0;i<numBuckets;i++)
+	{
+		for (int j=0;j<btOpenHashedOverlappingPairCache::BUCKET_SIZE*2;j++)
+		{
+			table.m_buckets[i].m_keys[j] = BT_EMPTY_PAIR_KEY;
+		}
+	}
+}
+
+static void	freePairTable(btOpenHashedOverlappingPairCache::btPairTable& table)
+{
+	if (table.m_buckets)
+	{
+		btAlignedFree(table.m_buckets);
+	}
+	table.m_buckets = 0;
+	table.m_mask = 0;
+	table.m_size = 0;
+}
+
+
+
+btOpenHashedOverlappingPairCache::btOpenHashedOverlappingPairCache():
+	m_overlapFilterCallback(0),
+	m_ghostPairCallback(0),
+	m_current(0),
+	m_migrated(0)
+{
+	int initialAllocatedSize= 2;
+	m_overlappingPairArray.reserve(initialAllocatedSize);
+	m_tables[1].m_buckets = 0;
+	m_tables[1].m_mask = 0;
+	m_tables[1].m_size = 0;
+	initPairTable(m_tables[0],MIN_BUCKETS);
+}
+
+
+
+btOpenHashedOverlappingPairCache::~btOpenHashedOverlappingPairCache()
+{
+	freePairTable(m_tables[0]);
+	freePairTable(m_tables[1]);
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm)
+	{
+		pair.m_algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+		pair.m_algorithm=0;
+	}
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+
+	class	CleanPairCallback : public btOverlapCallback
+	{
+		btBroadphaseProxy* m_cleanProxy;
+		btOverlappingPairCache*	m_pairCache;
+		btDispatcher* m_dispatcher;
+
+	public:
+		CleanPairCallback(btBroadphaseProxy* cleanProxy,btOverlappingPairCache* pairCache,btDispatcher* dispatcher)
+			:m_cleanProxy(cleanProxy),
+			m_pairCache(pairCache),
+			m_dispatcher(dispatcher)
+		{
+		}
+		virtual	bool	processOverlap(btBroadphasePair& pair)
+		{
+			if ((pair.m_pProxy0 == m_cleanProxy) ||
+				(pair.m_pProxy1 == m_cleanProxy))
+			{
+				m_pairCache->cleanOverlappingPair(pair,m_dispatcher);
+			}
+			return false;
+		}
+
+	};
+
+	CleanPairCallback cleanPairs(proxy,this,dispatcher);
+
+	processAllOverlappingPairs(&cleanPairs,dispatcher);
+
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+
+	class	RemovePairCallback : public btOverlapCallback
+	{
+		btBroadphaseProxy* m_obsoleteProxy;
+
+	public:
+		RemovePairCallback(btBroadphaseProxy* obsoleteProxy)
+			:m_obsoleteProxy(obsoleteProxy)
+		{
+		}
+		virtual	bool	processOverlap(btBroadphasePair& pair)
+		{
+			return ((pair.m_pProxy0 == m_obsoleteProxy) ||
+				(pair.m_pProxy1 == m_obsoleteProxy));
+		}
+
+	};
+
+	RemovePairCallback removeCallback(proxy);
+
+	processAllOverlappingPairs(&removeCallback,dispatcher);
+}
+
+
+
+int	btOpenHashedOverlappingPairCache::findSlot(unsigned int proxyId1,unsigned int proxyId2,unsigned int hash,int& table) const
+{
+	for (int i=0;i<2;i++)
+	{
+		table = m_current^i;
+		const btPairTable& pairTable = m_tables[table];
+		if (!pairTable.m_buckets)
+			continue;
+		int bucket = static_cast<int>(hash & pairTable.m_mask);
+		for (;;)
+		{
+			const btPairBucket& pairBucket = pairTable.m_buckets[bucket];
+			const int mask = matchPairKeys(pairBucket,proxyId1,proxyId2);
+			if (mask)
+			{
+				return bucket*BUCKET_SIZE + firstPairSlot(mask);
+			}
+			if (!pairBucket.m_overflow)
+				break;
+			bucket = (bucket+1) & pairTable.m_mask;
+		}
+	}
+	return -1;
+}
+
+
+
+int	btOpenHashedOverlappingPairCache::insertKey(btPairTable& table,unsigned int proxyId1,unsigned int proxyId2,unsigned int hash,int pairIndex)
+{
+	int bucket = static_cast<int>(hash & table.m_mask);
+	for (;;)
+	{
+		btPairBucket& pairBucket = table.m_buckets[bucket];
+		const int mask = matchPairKeys(pairBucket,BT_EMPTY_PAIR_KEY,BT_EMPTY_PAIR_KEY);
+		if (mask)
+		{
+			const int slot = firstPairSlot(mask);
+			pairBucket.m_keys[slot*2] = proxyId1;
+			pairBucket.m_keys[slot*2+1] = proxyId2;
+			pairBucket.m_pairs[slot] = pairIndex;
+			table.m_size++;
+			return bucket*BUCKET_SIZE + slot;
+		}
+		pairBucket.m_overflow++;
+		bucket = (bucket+1) & table.m_mask;
+	}
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::eraseSlot(btPairTable& table,int slot,unsigned int hash)
+{
+	const int last = slot/BUCKET_SIZE;
+	for (int bucket = static_cast<int>(hash & table.m_mask);bucket != last;bucket = (bucket+1) & table.m_mask)
+	{
+		btAssert(table.m_buckets[bucket].m_overflow > 0);
+		table.m_buckets[bucket].m_overflow--;
+	}
+	btPairBucket& pairBucket = table.m_buckets[last];
+	pairBucket.m_keys[(slot%BUCKET_SIZE)*2] = BT_EMPTY_PAIR_KEY;
+	pairBucket.m_keys[(slot%BUCKET_SIZE)*2+1] = BT_EMPTY_PAIR_KEY;
+	table.m_size--;
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::growTables()
+{
+	btPairTable& oldTable = m_tables[m_current^1];
+	if (oldTable.m_buckets)
+	{
+		migrateBuckets(oldTable.m_mask+1);
+	}
+	initPairTable(oldTable,(m_tables[m_current].m_mask+1)*2);
+	m_current ^= 1;
+	m_migrated = 0;
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::migrateBuckets(int count)
+{
+	btPairTable& oldTable = m_tables[m_current^1];
+	while (oldTable.m_buckets && (count-- > 0))
+	{
+		if (oldTable.m_size > 0)
+		{
+			btPairBucket& pairBucket = oldTable.m_buckets[m_migrated];
+			for (int i=0;i<BUCKET_SIZE;i++)
+			{
+				const unsigned int proxyId1 = pairBucket.m_keys[i*2];
+				const unsigned int proxyId2 = pairBucket.m_keys[i*2+1];
+				if ((proxyId1 == BT_EMPTY_PAIR_KEY) && (proxyId2 == BT_EMPTY_PAIR_KEY))
+					continue;
+				const unsigned int hash = getHash(proxyId1,proxyId2);
+				const int pairIndex = pairBucket.m_pairs[i];
+				eraseSlot(oldTable,m_migrated*BUCKET_SIZE+i,hash);
+				m_pairSlots[pairIndex] = insertKey(m_tables[m_current],proxyId1,proxyId2,hash,pairIndex)*2 + m_current;
+			}
+		}
+		if ((++m_migrated > oldTable.m_mask) || (oldTable.m_size == 0))
+		{
+			freePairTable(oldTable);
+		}
+	}
+}
+
+
+
+btBroadphasePair* btOpenHashedOverlappingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	gFindPairs++;
+	if(proxy0>proxy1) btSwap(proxy0,proxy1);
+	const unsigned int proxyId1 = static_cast<unsigned int>(proxy0->getUid());
+	const unsigned int proxyId2 = static_cast<unsigned int>(proxy1->getUid());
+
+	int table;
+	const int slot = findSlot(proxyId1,proxyId2,getHash(proxyId1,proxyId2),table);
+	if (slot < 0)
+	{
+		return NULL;
+	}
+
+	const int pairIndex = m_tables[table].m_buckets[slot/BUCKET_SIZE].m_pairs[slot%BUCKET_SIZE];
+	btAssert(pairIndex < m_overlappingPairArray.size());
+
+	return &m_overlappingPairArray[pairIndex];
+}
+
+
+
+btBroadphasePair* btOpenHashedOverlappingPairCache::internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if(proxy0>proxy1) btSwap(proxy0,proxy1);
+	const unsigned int proxyId1 = static_cast<unsigned int>(proxy0->getUid());
+	const unsigned int proxyId2 = static_cast<unsigned int>(proxy1->getUid());
+	const unsigned int hash = getHash(proxyId1,proxyId2);
+
+	int table;
+	const int slot = findSlot(proxyId1,proxyId2,hash,table);
+	if (slot >= 0)
+	{
+		return &m_overlappingPairArray[m_tables[table].m_buckets[slot/BUCKET_SIZE].m_pairs[slot%BUCKET_SIZE]];
+	}
+
+	migrateBuckets(MIGRATION_RATE);
+
+	//keep the load of the new table under 3/4, counting the keys not migrated yet
+	const int numKeys = m_tables[0].m_size + m_tables[1].m_size + 1;
+	if (numKeys*4 > (m_tables[m_current].m_mask+1)*BUCKET_SIZE*3)
+	{
+		growTables();
+	}
+
+	int count = m_overlappingPairArray.size();
+	void* mem = &m_overlappingPairArray.expand();
+
+	//this is where we add an actual pair, so also call the 'ghost'
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->addOverlappingPair(proxy0,proxy1);
+
+	btBroadphasePair* pair = new (mem) btBroadphasePair(*proxy0,*proxy1);
+	pair->m_algorithm = 0;
+	pair->m_internalTmpValue = 0;
+
+	m_pairSlots.push_back(insertKey(m_tables[m_current],proxyId1,proxyId2,hash,count)*2 + m_current);
+
+	return pair;
+}
+
+
+
+void* btOpenHashedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1,btDispatcher* dispatcher)
+{
+	gRemovePairs++;
+	if(proxy0>proxy1) btSwap(proxy0,proxy1);
+	const unsigned int proxyId1 = static_cast<unsigned int>(proxy0->getUid());
+	const unsigned int proxyId2 = static_cast<unsigned int>(proxy1->getUid());
+	const unsigned int hash = getHash(proxyId1,proxyId2);
+
+	migrateBuckets(MIGRATION_RATE);
+
+	int table;
+	const int slot = findSlot(proxyId1,proxyId2,hash,table);
+	if (slot < 0)
+	{
+		return 0;
+	}
+
+	const int pairIndex = m_tables[table].m_buckets[slot/BUCKET_SIZE].m_pairs[slot%BUCKET_SIZE];
+	btAssert(pairIndex < m_overlappingPairArray.size());
+
+	btBroadphasePair& pair = m_overlappingPairArray[pairIndex];
+	cleanOverlappingPair(pair,dispatcher);
+
+	void* userData = pair.m_internalInfo1;
+
+	eraseSlot(m_tables[table],slot,hash);
+
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0, proxy1,dispatcher);
+
+	// Move the last pair into the spot of the removed one and point its key at the new index.
+	int lastPairIndex = m_overlappingPairArray.size() - 1;
+	if (lastPairIndex != pairIndex)
+	{
+		const int lastSlot = m_pairSlots[lastPairIndex];
+		m_tables[lastSlot&1].m_buckets[(lastSlot>>1)/BUCKET_SIZE].m_pairs[(lastSlot>>1)%BUCKET_SIZE] = pairIndex;
+		m_pairSlots[pairIndex] = lastSlot;
+		m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
+	}
+
+	m_overlappingPairArray.pop_back();
+	m_pairSlots.pop_back();
+
+	return userData;
+}
+
+
+
+void	btOpenHashedOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback,btDispatcher* dispatcher)
+{
+
+	int i;
+
+	for (i=0;i<m_overlappingPairArray.size();)
+	{
+
+		btBroadphasePair* pair = &m_overlappingPairArray[i];
+		if (callback->processOverlap(*pair))
+		{
+			removeOverlappingPair(pair->m_pProxy0,pair->m_pProxy1,dispatcher);
+
+			gOverlappingPairs--;
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+
+
 void*	btSortedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1, btDispatcher* dispatcher )
 {
 	if (!hasDeferredRemoval())
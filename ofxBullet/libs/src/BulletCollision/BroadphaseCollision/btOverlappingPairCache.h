@@ -54,9 +54,10 @@ extern int gAddedPairs;
 extern int gFindPairs;
 
 const int BT_NULL_PAIR=0xffffffff;
+const unsigned int BT_EMPTY_PAIR_KEY=0xffffffff;
 
 ///The btOverlappingPairCache provides an interface for overlapping pair management (add, remove, storage), used by the btBroadphaseInterface broadphases.
-///The btHashedOverlappingPairCache and btSortedOverlappingPairCache classes are two implementations.
+///The btHashedOverlappingPairCache, btOpenHashedOverlappingPairCache and btSortedOverlappingPairCache classes implement it.
 class btOverlappingPairCache : public btOverlappingPairCallback
 {
 public:
@@ -270,6 +271,173 @@ public:
 
 
 
+///btOpenHashedOverlappingPairCache is an alternative to btHashedOverlappingPairCache for scenes that add and remove many pairs per step.
+///It uses open addressing: each key packs the two proxy uids into 64 bits, and keys are stored in 64 byte buckets of BUCKET_SIZE.
+///A probe compares a whole bucket at once (with SSE2 when BT_USE_SSE is defined), and a lookup stops at the first bucket
+///that no other key probed past. Removal therefore needs no tombstones.
+///When the table grows, the previous table is kept and MIGRATION_RATE of its buckets are moved on each add or remove,
+///so no single call rehashes all pairs. Pairs are kept in one array like btHashedOverlappingPairCache: removing a pair moves the last one into its place.
+class btOpenHashedOverlappingPairCache : public btOverlappingPairCache
+{
+public:
+
+	enum
+	{
+		BUCKET_SIZE		=	4,
+		MIN_BUCKETS		=	16,
+		MIGRATION_RATE	=	2
+	};
+
+	struct	btPairBucket
+	{
+		unsigned int	m_keys[BUCKET_SIZE*2];	// (uid0,uid1) per slot, BT_EMPTY_PAIR_KEY in both halves when free
+		int				m_pairs[BUCKET_SIZE];	// index in the pair array
+		int				m_overflow;				// keys stored past this bucket in their probe sequence
+		int				m_padding[3];
+	};
+
+	struct	btPairTable
+	{
+		btPairBucket*	m_buckets;
+		int				m_mask;
+		int				m_size;
+	};
+
+private:
+
+	btBroadphasePairArray		m_overlappingPairArray;
+	btOverlapFilterCallback*	m_overlapFilterCallback;
+	btOverlappingPairCallback*	m_ghostPairCallback;
+	///m_tables[m_current] receives new keys, the other table is being migrated while its m_buckets is set
+	btPairTable					m_tables[2];
+	int							m_current;
+	///table and slot of each pair as slot*2+table, so moving a pair in the array doesn't need a lookup
+	btAlignedObjectArray<int>	m_pairSlots;
+	int							m_migrated;
+
+public:
+
+	btOpenHashedOverlappingPairCache();
+	virtual ~btOpenHashedOverlappingPairCache();
+
+	void	removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual void*	removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher);
+
+	SIMD_FORCE_INLINE bool needsBroadphaseCollision(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0,proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	// Add a pair and return the new pair. If the pair already exists,
+	// no new pair is created and the old one is returned.
+	virtual btBroadphasePair* 	addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+	{
+		gAddedPairs++;
+
+		if (!needsBroadphaseCollision(proxy0,proxy1))
+			return 0;
+
+		return internalAddPair(proxy0,proxy1);
+	}
+
+	void	cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual void	processAllOverlappingPairs(btOverlapCallback*,btDispatcher* dispatcher);
+
+	virtual btBroadphasePair*	getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	const btBroadphasePair*	getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	btBroadphasePairArray&	getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray&	getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	void	cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher);
+
+	btBroadphasePair* findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	void setOverlapFilterCallback(btOverlapFilterCallback* callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	int	getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	///true while a previous table is still being migrated
+	bool	isGrowing() const
+	{
+		return m_tables[m_current^1].m_buckets != 0;
+	}
+
+	virtual bool	hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual	void	setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+
+private:
+
+	btBroadphasePair* 	internalAddPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+
+	///returns the slot of the key as bucket*BUCKET_SIZE+lane and the table that holds it, or -1
+	int		findSlot(unsigned int proxyId1,unsigned int proxyId2,unsigned int hash,int& table) const;
+
+	///returns the slot the key was stored in
+	int		insertKey(btPairTable& table,unsigned int proxyId1,unsigned int proxyId2,unsigned int hash,int pairIndex);
+
+	void	eraseSlot(btPairTable& table,int slot,unsigned int hash);
+
+	///starts the migration to a table twice as large, finishing a previous migration first
+	void	growTables();
+
+	void	migrateBuckets(int count);
+
+	// Thomas Wang's 32 bit mix of both uids, unlike btHashedOverlappingPairCache::getHash it doesn't assume 16 bit uids
+	static SIMD_FORCE_INLINE unsigned int getHash(unsigned int proxyId1, unsigned int proxyId2)
+	{
+		unsigned int key = proxyId1 ^ (proxyId2 * 0x9e3779b9u);
+		key = ~key + (key << 15);
+		key = key ^ (key >> 12);
+		key = key + (key << 2);
+		key = key ^ (key >> 4);
+		key = key * 2057;
+		key = key ^ (key >> 16);
+		return key;
+	}
+};
+
+
 ///btSortedOverlappingPairCache maintains the objects with overlapping AABB
 ///Typically managed by the Broadphase, Axis3Sweep or btSimpleBroadphase
 class	btSortedOverlappingPairCache : public btOverlappingPairCache
@@ -21,7 +21,7 @@ subject to the following restrictions:
 #define RAYAABB2
 
 btQuantizedBvh::btQuantizedBvh() : 
-					m_bulletVersion(BT_BULLET_VERSION),
+					m_bulletVersion(BT_QUANTIZED_BVH_SERIALIZE_VERSION),
 					m_useQuantization(false), 
 					//m_traversalMode(TRAVERSAL_STACKLESS_CACHE_FRIENDLY)
 					m_traversalMode(TRAVERSAL_STACKLESS)
@@ -321,6 +321,12 @@ void	btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallb
 		quantizeWithClamp(quantizedQueryAabbMin,aabbMin,0);
 		quantizeWithClamp(quantizedQueryAabbMax,aabbMax,1);
 
+		if (hasQuadTree())
+		{
+			walkQuadTreeAgainstQuantizedAabb(nodeCallback,quantizedQueryAabbMin,quantizedQueryAabbMax);
+			return;
+		}
+
 		switch (m_traversalMode)
 		{
 		case TRAVERSAL_STACKLESS:
@@ -472,7 +478,8 @@ void	btQuantizedBvh::walkStacklessTreeAgainstRay(btNodeOverlapCallback* nodeCall
 	btVector3 rayFrom = raySource;
 	btVector3 rayDir = (rayTarget-raySource);
 	rayDir.normalize ();
-	lambda_max = rayDir.dot(rayTarget-raySource);
+	const btScalar rayLength = rayDir.dot(rayTarget-raySource);
+	lambda_max = rayLength*nodeCallback->getClosestHitFraction();
 	///what about division by zero? --> just set rayDirection[i] to 1.0
 	btVector3 rayDirectionInverse;
 	rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDir[0];
@@ -517,6 +524,10 @@ void	btQuantizedBvh::walkStacklessTreeAgainstRay(btNodeOverlapCallback* nodeCall
 		if (isLeafNode && (rayBoxOverlap != 0))
 		{
 			nodeCallback->processNode(rootNode->m_subPart,rootNode->m_triangleIndex);
+#ifdef RAYAABB2
+			//skip the nodes beyond the closest hit
+			lambda_max = rayLength*nodeCallback->getClosestHitFraction();
+#endif
 		} 
 		
 		//PCK: unsigned instead of bool
@@ -561,7 +572,8 @@ void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback*
 	btVector3 rayFrom = raySource;
 	btVector3 rayDirection = (rayTarget-raySource);
 	rayDirection.normalize ();
-	lambda_max = rayDirection.dot(rayTarget-raySource);
+	const btScalar rayLength = rayDirection.dot(rayTarget-raySource);
+	lambda_max = rayLength*nodeCallback->getClosestHitFraction();
 	///what about division by zero? --> just set rayDirection[i] to 1.0
 	rayDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDirection[0];
 	rayDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDirection[1];
@@ -646,6 +658,10 @@ void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback*
 		if (isLeafNode && rayBoxOverlap)
 		{
 			nodeCallback->processNode(rootNode->getPartId(),rootNode->getTriangleIndex());
+#ifdef RAYAABB2
+			//skip the nodes beyond the closest hit
+			lambda_max = rayLength*nodeCallback->getClosestHitFraction();
+#endif
 		}
 		
 		//PCK: unsigned instead of bool
@@ -754,6 +770,323 @@ void	btQuantizedBvh::walkStacklessQuantizedTreeCacheFriendly(btNodeOverlapCallba
 }
 
 
+int	btQuantizedBvh::getQuadCandidates(int nodeIndex,int* candidates) const
+{
+	//start with the children of the node, then replace the largest internal candidate by its two children
+	//until there are four candidates. The candidates stay in tree order.
+	int numCandidates = 0;
+	const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+	if (node.isLeafNode())
+	{
+		candidates[numCandidates++] = nodeIndex;
+	} else
+	{
+		const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[nodeIndex+1];
+		candidates[numCandidates++] = nodeIndex+1;
+		candidates[numCandidates++] = leftChildNode.isLeafNode() ? nodeIndex+2 : nodeIndex+1+leftChildNode.getEscapeIndex();
+	}
+
+	int i;
+	while (numCandidates<4)
+	{
+		int largest = -1;
+		int largestSize = 1;
+		for (i=0;i<numCandidates;i++)
+		{
+			const btQuantizedBvhNode& candidate = m_quantizedContiguousNodes[candidates[i]];
+			if (!candidate.isLeafNode() && candidate.getEscapeIndex() > largestSize)
+			{
+				largest = i;
+				largestSize = candidate.getEscapeIndex();
+			}
+		}
+		if (largest<0)
+			break;
+
+		const int expandIndex = candidates[largest];
+		const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[expandIndex+1];
+		for (i=numCandidates;i>largest+1;i--)
+		{
+			candidates[i] = candidates[i-1];
+		}
+		candidates[largest] = expandIndex+1;
+		candidates[largest+1] = leftChildNode.isLeafNode() ? expandIndex+2 : expandIndex+1+leftChildNode.getEscapeIndex();
+		numCandidates++;
+	}
+	return numCandidates;
+}
+
+int	btQuantizedBvh::buildQuadNode(int nodeIndex)
+{
+	int candidates[4];
+	const int numCandidates = getQuadCandidates(nodeIndex,candidates);
+
+	int i;
+	//the children are built after their parent, so don't keep a reference into m_quantizedQuadNodes
+	const int quadIndex = m_quantizedQuadNodes.size();
+	m_quantizedQuadNodes.expand();
+	for (i=0;i<4;i++)
+	{
+		int child = btQuantizedBvhNode4::UNUSED_CHILD;
+		if (i<numCandidates)
+		{
+			const btQuantizedBvhNode& childNode = m_quantizedContiguousNodes[candidates[i]];
+			for (int k=0;k<3;k++)
+			{
+				m_quantizedQuadNodes[quadIndex].m_quantizedAabbMin[k][i] = childNode.m_quantizedAabbMin[k];
+				m_quantizedQuadNodes[quadIndex].m_quantizedAabbMax[k][i] = childNode.m_quantizedAabbMax[k];
+			}
+			child = childNode.isLeafNode() ? ~childNode.m_escapeIndexOrTriangleIndex : buildQuadNode(candidates[i]);
+		} else
+		{
+			//an inverted box, that no ray hits
+			for (int k=0;k<3;k++)
+			{
+				m_quantizedQuadNodes[quadIndex].m_quantizedAabbMin[k][i] = 0xffff;
+				m_quantizedQuadNodes[quadIndex].m_quantizedAabbMax[k][i] = 0;
+			}
+		}
+		m_quantizedQuadNodes[quadIndex].m_children[i] = child;
+	}
+	return quadIndex;
+}
+
+void	btQuantizedBvh::buildQuadTree()
+{
+	btAssert(m_useQuantization);
+
+	m_quantizedQuadNodes.clear();
+	if (!m_useQuantization || !m_curNodeIndex)
+		return;
+
+	//each quad node replaces at least one internal binary node
+	m_quantizedQuadNodes.reserve(m_curNodeIndex/2+1);
+	buildQuadNode(0);
+}
+
+void	btQuantizedBvh::refitQuadNode(int quadIndex,int nodeIndex,int firstNode,int endNode)
+{
+	//refit keeps the escape indices, so the candidates are the same as when the quad node was built
+	int candidates[4];
+	const int numCandidates = getQuadCandidates(nodeIndex,candidates);
+	btQuantizedBvhNode4& quadNode = m_quantizedQuadNodes[quadIndex];
+	for (int i=0;i<numCandidates;i++)
+	{
+		const btQuantizedBvhNode& childNode = m_quantizedContiguousNodes[candidates[i]];
+		const int childEnd = childNode.isLeafNode() ? candidates[i]+1 : candidates[i]+childNode.getEscapeIndex();
+		if (childEnd <= firstNode || candidates[i] >= endNode)
+			continue;
+		for (int k=0;k<3;k++)
+		{
+			quadNode.m_quantizedAabbMin[k][i] = childNode.m_quantizedAabbMin[k];
+			quadNode.m_quantizedAabbMax[k][i] = childNode.m_quantizedAabbMax[k];
+		}
+		if (!childNode.isLeafNode())
+		{
+			refitQuadNode(quadNode.m_children[i],candidates[i],firstNode,endNode);
+		}
+	}
+}
+
+void	btQuantizedBvh::refitQuadTree(int firstNode,int endNode)
+{
+	if (hasQuadTree())
+	{
+		refitQuadNode(0,0,firstNode,endNode);
+	}
+}
+
+///each level of the 4-wide tree adds at most three entries to the traversal stack, the balanced build keeps the depth far below 64
+#define QUAD_TREE_STACK_SIZE (3*64+1)
+
+struct btQuadRayStackEntry
+{
+	int			m_child;
+	btScalar	m_tNear;
+};
+
+void	btQuantizedBvh::walkQuadTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const
+{
+	btAssert(m_useQuantization && hasQuadTree());
+
+	btVector3 rayDirection = (rayTarget-raySource);
+	rayDirection.normalize ();
+	const btScalar rayLength = rayDirection.dot(rayTarget-raySource);
+	btScalar lambda_max = rayLength*nodeCallback->getClosestHitFraction();
+	///what about division by zero? --> just set rayDirection[i] to 1e30
+	rayDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDirection[0];
+	rayDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDirection[1];
+	rayDirection[2] = rayDirection[2] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDirection[2];
+	const unsigned int sign[3] = { rayDirection[0] < 0.0, rayDirection[1] < 0.0, rayDirection[2] < 0.0};
+
+#ifdef BT_USE_SSE
+	const __m128i zero = _mm_setzero_si128();
+	__m128 quantization[3],bvhAabbMin[3],castMin[3],castMax[3],from[3],inverseDirection[3];
+	for (int k=0;k<3;k++)
+	{
+		quantization[k] = _mm_set1_ps(m_bvhQuantization[k]);
+		bvhAabbMin[k] = _mm_set1_ps(m_bvhAabbMin[k]);
+		castMin[k] = _mm_set1_ps(aabbMin[k]);
+		castMax[k] = _mm_set1_ps(aabbMax[k]);
+		from[k] = _mm_set1_ps(raySource[k]);
+		inverseDirection[k] = _mm_set1_ps(rayDirection[k]);
+	}
+#endif //BT_USE_SSE
+
+	btQuadRayStackEntry stack[QUAD_TREE_STACK_SIZE];
+	int depth = 0;
+	stack[depth].m_child = 0;
+	stack[depth].m_tNear = btScalar(0.);
+	depth++;
+
+	while (depth)
+	{
+		const btQuadRayStackEntry current = stack[--depth];
+		//the ray may have been shortened by a hit after this entry was pushed
+		if (current.m_tNear >= lambda_max)
+			continue;
+
+		if (current.m_child < 0)
+		{
+			const int leaf = ~current.m_child;
+			nodeCallback->processNode(leaf>>(31-MAX_NUM_PARTS_IN_BITS),leaf&~((~0)<<(31-MAX_NUM_PARTS_IN_BITS)));
+			lambda_max = rayLength*nodeCallback->getClosestHitFraction();
+			continue;
+		}
+
+		const btQuantizedBvhNode4& node = m_quantizedQuadNodes[current.m_child];
+
+		//the child boxes are unquantized like unQuantize and then extended by the box cast extents, the slab test
+		//gives the same result as btRayAabb2 in walkStacklessQuantizedTreeAgainstRay
+		ATTRIBUTE_ALIGNED16(btScalar tNear[4]);
+		int hitMask;
+#ifdef BT_USE_SSE
+		__m128 tmin = _mm_set1_ps(-SIMD_INFINITY);
+		__m128 tmax = _mm_set1_ps(SIMD_INFINITY);
+		for (int k=0;k<3;k++)
+		{
+			const __m128i qmin = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)node.m_quantizedAabbMin[k]),zero);
+			const __m128i qmax = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)node.m_quantizedAabbMax[k]),zero);
+			const __m128 boundsMin = _mm_add_ps(_mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(qmin),quantization[k]),bvhAabbMin[k]),castMin[k]);
+			const __m128 boundsMax = _mm_add_ps(_mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(qmax),quantization[k]),bvhAabbMin[k]),castMax[k]);
+			const __m128 nearPlane = sign[k] ? boundsMax : boundsMin;
+			const __m128 farPlane = sign[k] ? boundsMin : boundsMax;
+			tmin = _mm_max_ps(tmin,_mm_mul_ps(_mm_sub_ps(nearPlane,from[k]),inverseDirection[k]));
+			tmax = _mm_min_ps(tmax,_mm_mul_ps(_mm_sub_ps(farPlane,from[k]),inverseDirection[k]));
+		}
+		const __m128 hits = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(tmin,tmax),_mm_cmplt_ps(tmin,_mm_set1_ps(lambda_max))),_mm_cmpgt_ps(tmax,_mm_setzero_ps()));
+		hitMask = _mm_movemask_ps(hits);
+		_mm_store_ps(tNear,tmin);
+#else
+		hitMask = 0;
+		for (int i=0;i<4;i++)
+		{
+			btScalar tmin = -SIMD_INFINITY;
+			btScalar tmax = SIMD_INFINITY;
+			for (int k=0;k<3;k++)
+			{
+				const btScalar boundsMin = ((btScalar)(node.m_quantizedAabbMin[k][i]) / m_bvhQuantization[k] + m_bvhAabbMin[k]) + aabbMin[k];
+				const btScalar boundsMax = ((btScalar)(node.m_quantizedAabbMax[k][i]) / m_bvhQuantization[k] + m_bvhAabbMin[k]) + aabbMax[k];
+				const btScalar nearPlane = sign[k] ? boundsMax : boundsMin;
+				const btScalar farPlane = sign[k] ? boundsMin : boundsMax;
+				tmin = btMax(tmin,(nearPlane-raySource[k])*rayDirection[k]);
+				tmax = btMin(tmax,(farPlane-raySource[k])*rayDirection[k]);
+			}
+			tNear[i] = tmin;
+			if ((tmin <= tmax) && (tmin < lambda_max) && (tmax > btScalar(0.)))
+				hitMask |= 1<<i;
+		}
+#endif //BT_USE_SSE
+
+		//push the hit children far to near, so the nearest one is visited next
+		int order[4];
+		int numHits = 0;
+		for (int i=0;i<4;i++)
+		{
+			if ((hitMask & (1<<i)) && node.isUsedChild(i))
+			{
+				int j = numHits++;
+				for (;j>0 && tNear[order[j-1]] < tNear[i];j--)
+				{
+					order[j] = order[j-1];
+				}
+				order[j] = i;
+			}
+		}
+		btAssert(depth+numHits <= QUAD_TREE_STACK_SIZE);
+		for (int i=0;i<numHits;i++)
+		{
+			stack[depth].m_child = node.m_children[order[i]];
+			stack[depth].m_tNear = tNear[order[i]];
+			depth++;
+		}
+	}
+}
+
+void	btQuantizedBvh::walkQuadTreeAgainstQuantizedAabb(btNodeOverlapCallback* nodeCallback,const unsigned short int* quantizedQueryAabbMin,const unsigned short int* quantizedQueryAabbMax) const
+{
+	btAssert(m_useQuantization && hasQuadTree());
+
+#ifdef BT_USE_SSE
+	//SSE2 has no unsigned 16 bit compare, flip the sign bits and compare signed
+	const __m128i signFlip = _mm_set1_epi16((short)0x8000);
+	const __m128i queryMinXY = _mm_xor_si128(_mm_unpacklo_epi64(_mm_set1_epi16((short)quantizedQueryAabbMin[0]),_mm_set1_epi16((short)quantizedQueryAabbMin[1])),signFlip);
+	const __m128i queryMaxXY = _mm_xor_si128(_mm_unpacklo_epi64(_mm_set1_epi16((short)quantizedQueryAabbMax[0]),_mm_set1_epi16((short)quantizedQueryAabbMax[1])),signFlip);
+	const __m128i queryMinZ = _mm_xor_si128(_mm_set1_epi16((short)quantizedQueryAabbMin[2]),signFlip);
+	const __m128i queryMaxZ = _mm_xor_si128(_mm_set1_epi16((short)quantizedQueryAabbMax[2]),signFlip);
+#endif //BT_USE_SSE
+
+	int stack[QUAD_TREE_STACK_SIZE];
+	int depth = 0;
+	stack[depth++] = 0;
+
+	while (depth)
+	{
+		const btQuantizedBvhNode4& node = m_quantizedQuadNodes[stack[--depth]];
+
+		int overlapMask = 0;
+#ifdef BT_USE_SSE
+		const __m128i nodeMinXY = _mm_xor_si128(_mm_load_si128((const __m128i*)node.m_quantizedAabbMin[0]),signFlip);
+		const __m128i nodeMaxXY = _mm_xor_si128(_mm_loadu_si128((const __m128i*)node.m_quantizedAabbMax[0]),signFlip);
+		const __m128i nodeMinZ = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)node.m_quantizedAabbMin[2]),signFlip);
+		const __m128i nodeMaxZ = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)node.m_quantizedAabbMax[2]),signFlip);
+		const __m128i separatedXY = _mm_or_si128(_mm_cmpgt_epi16(nodeMinXY,queryMaxXY),_mm_cmpgt_epi16(queryMinXY,nodeMaxXY));
+		const __m128i separatedZ = _mm_or_si128(_mm_cmpgt_epi16(nodeMinZ,queryMaxZ),_mm_cmpgt_epi16(queryMinZ,nodeMaxZ));
+		const __m128i separated = _mm_or_si128(_mm_or_si128(separatedXY,_mm_srli_si128(separatedXY,8)),separatedZ);
+		//two mask bits per 16 bit lane, keep one for each of the four children
+		const int separatedMask = _mm_movemask_epi8(separated);
+		for (int i=0;i<4;i++)
+		{
+			if (!(separatedMask & (1<<(2*i))))
+				overlapMask |= 1<<i;
+		}
+#else
+		for (int i=0;i<4;i++)
+		{
+			if ((quantizedQueryAabbMin[0] <= node.m_quantizedAabbMax[0][i]) & (quantizedQueryAabbMax[0] >= node.m_quantizedAabbMin[0][i])
+				& (quantizedQueryAabbMin[1] <= node.m_quantizedAabbMax[1][i]) & (quantizedQueryAabbMax[1] >= node.m_quantizedAabbMin[1][i])
+				& (quantizedQueryAabbMin[2] <= node.m_quantizedAabbMax[2][i]) & (quantizedQueryAabbMax[2] >= node.m_quantizedAabbMin[2][i]))
+				overlapMask |= 1<<i;
+		}
+#endif //BT_USE_SSE
+
+		for (int i=0;i<4;i++)
+		{
+			if (!(overlapMask & (1<<i)) || !node.isUsedChild(i))
+				continue;
+			if (node.isLeafChild(i))
+			{
+				nodeCallback->processNode(node.getPartId(i),node.getTriangleIndex(i));
+			} else
+			{
+				btAssert(depth < QUAD_TREE_STACK_SIZE);
+				stack[depth++] = node.m_children[i];
+			}
+		}
+	}
+}
+
+
 void	btQuantizedBvh::reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const
 {
 	reportBoxCastOverlappingNodex(nodeCallback,raySource,rayTarget,btVector3(0,0,0),btVector3(0,0,0));
@@ -764,7 +1097,11 @@ void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCa
 {
 	//always use stackless
 
-	if (m_useQuantization)
+	if (m_useQuantization && hasQuadTree())
+	{
+		walkQuadTreeAgainstRay(nodeCallback, raySource, rayTarget, aabbMin, aabbMax);
+	}
+	else if (m_useQuantization)
 	{
 		walkStacklessQuantizedTreeAgainstRay(nodeCallback, raySource, rayTarget, aabbMin, aabbMax, 0, m_curNodeIndex);
 	}
@@ -872,6 +1209,7 @@ bool btQuantizedBvh::serialize(void *o_alignedDataBuffer, unsigned /*i_dataBuffe
 
 		targetBvh->m_traversalMode = (btTraversalMode)btSwapEndian(m_traversalMode);
 		targetBvh->m_subtreeHeaderCount = static_cast<int>(btSwapEndian(m_subtreeHeaderCount));
+		targetBvh->m_bulletVersion = static_cast<int>(btSwapEndian(m_bulletVersion));
 	}
 	else
 	{
@@ -1035,10 +1373,22 @@ btQuantizedBvh *btQuantizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, un
 	{
 		return NULL;
 	}
+	if (i_dataBufferSize < sizeof(btQuantizedBvh))
+	{
+		return NULL;
+	}
 	btQuantizedBvh *bvh = (btQuantizedBvh *)i_alignedDataBuffer;
 
+	// images written with an older layout can't be used in place, check before the buffer is modified
+	int version = i_swapEndian ? static_cast<int>(btSwapEndian(bvh->m_bulletVersion)) : bvh->m_bulletVersion;
+	if (version != BT_QUANTIZED_BVH_SERIALIZE_VERSION)
+	{
+		return NULL;
+	}
+
 	if (i_swapEndian)
 	{
+		bvh->m_bulletVersion = version;
 		bvh->m_curNodeIndex = static_cast<int>(btSwapEndian(bvh->m_curNodeIndex));
 
 		btUnSwapVector3Endian(bvh->m_bvhAabbMin);
@@ -1134,12 +1484,88 @@ btQuantizedBvh *btQuantizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, un
 	return bvh;
 }
 
+bool btQuantizedBvh::deSerializeReadOnly(const void *i_alignedDataBuffer, unsigned int i_dataBufferSize)
+{
+	if (i_alignedDataBuffer == NULL || (((size_t)i_alignedDataBuffer) & BVH_ALIGNMENT_MASK) != 0)
+	{
+		return false;
+	}
+	if (i_dataBufferSize < sizeof(btQuantizedBvh))
+	{
+		return false;
+	}
+
+	// the buffer starts with the image of the serialized btQuantizedBvh, only its plain data members are used
+	const btQuantizedBvh *image = (const btQuantizedBvh *)i_alignedDataBuffer;
+
+	if (image->m_bulletVersion != BT_QUANTIZED_BVH_SERIALIZE_VERSION)
+	{
+		// a byte swapped version number means the buffer was written on a machine with the other byte order
+		return false;
+	}
+
+	int nodeCount = image->m_curNodeIndex;
+	int subtreeHeaderCount = image->m_subtreeHeaderCount;
+	if (nodeCount < 0 || subtreeHeaderCount < 0)
+	{
+		return false;
+	}
+
+	size_t nodeSize = image->m_useQuantization ? sizeof(btQuantizedBvhNode) : sizeof(btOptimizedBvhNode);
+	size_t calculatedBufSize = sizeof(btQuantizedBvh) + getAlignmentSerializationPadding() + nodeSize * nodeCount + sizeof(btBvhSubtreeInfo) * subtreeHeaderCount;
+	if (calculatedBufSize > i_dataBufferSize)
+	{
+		return false;
+	}
+
+	unsigned char *nodeData = (unsigned char *)i_alignedDataBuffer;
+	nodeData += sizeof(btQuantizedBvh);
+
+	const btBvhSubtreeInfo *subtreeHeaders = (const btBvhSubtreeInfo *)(nodeData + nodeSize * nodeCount);
+	for (int i = 0; i < subtreeHeaderCount; i++)
+	{
+		// the traversal trusts the subtree ranges, so reject headers that point outside the node array
+		if (subtreeHeaders[i].m_rootNodeIndex < 0 || subtreeHeaders[i].m_subtreeSize < 0 ||
+			subtreeHeaders[i].m_rootNodeIndex > nodeCount - subtreeHeaders[i].m_subtreeSize)
+		{
+			return false;
+		}
+	}
+
+	m_bvhAabbMin = image->m_bvhAabbMin;
+	m_bvhAabbMax = image->m_bvhAabbMax;
+	m_bvhQuantization = image->m_bvhQuantization;
+	m_bulletVersion = image->m_bulletVersion;
+	m_curNodeIndex = nodeCount;
+	m_useQuantization = image->m_useQuantization;
+	m_traversalMode = image->m_traversalMode;
+	m_subtreeHeaderCount = subtreeHeaderCount;
+
+	// initializeFromBuffer doesn't take ownership, the arrays never write to the buffer unless they are modified
+	m_leafNodes.clear();
+	m_quantizedLeafNodes.clear();
+	m_quantizedQuadNodes.clear();
+	if (m_useQuantization)
+	{
+		m_contiguousNodes.clear();
+		m_quantizedContiguousNodes.initializeFromBuffer(nodeData, nodeCount, nodeCount);
+	}
+	else
+	{
+		m_quantizedContiguousNodes.clear();
+		m_contiguousNodes.initializeFromBuffer(nodeData, nodeCount, nodeCount);
+	}
+	m_SubtreeHeaders.initializeFromBuffer((void*)subtreeHeaders, subtreeHeaderCount, subtreeHeaderCount);
+
+	return true;
+}
+
 // Constructor that prevents btVector3's default constructor from being called
 btQuantizedBvh::btQuantizedBvh(btQuantizedBvh &self, bool /* ownsMemory */) :
 m_bvhAabbMin(self.m_bvhAabbMin),
 m_bvhAabbMax(self.m_bvhAabbMax),
 m_bvhQuantization(self.m_bvhQuantization),
-m_bulletVersion(BT_BULLET_VERSION)
+m_bulletVersion(BT_QUANTIZED_BVH_SERIALIZE_VERSION)
 {
 
 }
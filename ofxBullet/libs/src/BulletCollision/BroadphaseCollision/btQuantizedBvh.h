@@ -29,6 +29,10 @@ subject to the following restrictions:
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btAlignedAllocator.h"
 
+///serialized btQuantizedBvh images store this in m_bulletVersion. It is bumped whenever the layout of btQuantizedBvh changes,
+///the quad node array added after Bullet 2.73 grew the class, so images written by serialize in 2.73 (version 273) are rejected.
+#define BT_QUANTIZED_BVH_SERIALIZE_VERSION 274
+
 
 //http://msdn.microsoft.com/library/default.asp?url=/library/en-us/vclang/html/vclrf__m128.asp
 
@@ -77,6 +81,45 @@ ATTRIBUTE_ALIGNED16	(struct) btQuantizedBvhNode
 }
 ;
 
+///btQuantizedBvhNode4 is a node of the 4-wide quantized tree built by btQuantizedBvh::buildQuadTree, 64 bytes (one cache line).
+///The child boxes are stored per axis, so the four boxes are tested at once. A child is another btQuantizedBvhNode4
+///(index >= 0), a leaf (~ the part/triangle index of the btQuantizedBvhNode leaf) or an unused slot.
+ATTRIBUTE_ALIGNED16	(struct) btQuantizedBvhNode4
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	enum
+	{
+		UNUSED_CHILD = 0x7fffffff
+	};
+
+	//48 bytes
+	unsigned short int	m_quantizedAabbMin[3][4];
+	unsigned short int	m_quantizedAabbMax[3][4];
+	//16 bytes
+	int	m_children[4];
+
+	bool isUsedChild(int i) const
+	{
+		return m_children[i] != UNUSED_CHILD;
+	}
+	bool isLeafChild(int i) const
+	{
+		return m_children[i] < 0;
+	}
+	int	getTriangleIndex(int i) const
+	{
+		btAssert(isLeafChild(i));
+		return ((~m_children[i])&~((~0)<<(31-MAX_NUM_PARTS_IN_BITS)));
+	}
+	int	getPartId(int i) const
+	{
+		btAssert(isLeafChild(i));
+		return ((~m_children[i])>>(31-MAX_NUM_PARTS_IN_BITS));
+	}
+}
+;
+
 /// btOptimizedBvhNode contains both internal and leaf node information.
 /// Total node size is 44 bytes / node. You can use the compressed version of 16 bytes.
 ATTRIBUTE_ALIGNED16 (struct) btOptimizedBvhNode
@@ -140,6 +183,13 @@ public:
 	virtual ~btNodeOverlapCallback() {};
 
 	virtual void processNode(int subPart, int triangleIndex) = 0;
+
+	///ray and box cast queries skip the nodes that start beyond this fraction of the ray, override it to return the
+	///closest hit found so far. Nodes closer than the closest hit can still be reported afterwards.
+	virtual btScalar getClosestHitFraction() const
+	{
+		return btScalar(1.);
+	}
 };
 
 #include "LinearMath/btAlignedAllocator.h"
@@ -151,6 +201,7 @@ public:
 typedef btAlignedObjectArray<btOptimizedBvhNode>	NodeArray;
 typedef btAlignedObjectArray<btQuantizedBvhNode>	QuantizedNodeArray;
 typedef btAlignedObjectArray<btBvhSubtreeInfo>		BvhSubtreeInfoArray;
+typedef btAlignedObjectArray<btQuantizedBvhNode4>	QuantizedNode4Array;
 
 
 ///The btQuantizedBvh class stores an AABB tree that can be quickly traversed on CPU and Cell SPU.
@@ -189,6 +240,9 @@ protected:
 	btTraversalMode	m_traversalMode;
 	BvhSubtreeInfoArray		m_SubtreeHeaders;
 
+	///optional 4-wide copy of m_quantizedContiguousNodes, see buildQuadTree. It is not serialized.
+	QuantizedNode4Array	m_quantizedQuadNodes;
+
 	//This is only used for serialization so we don't have to add serialization directly to btAlignedObjectArray
 	int m_subtreeHeaderCount;
 
@@ -314,6 +368,20 @@ protected:
 
 	void	updateSubtreeHeaders(int leftChildNodexIndex,int rightChildNodexIndex);
 
+	///picks the up to four binary nodes below nodeIndex that become the children of its btQuantizedBvhNode4, in tree order
+	int		getQuadCandidates(int nodeIndex,int* candidates) const;
+
+	///collapses the binary subtree at nodeIndex into a btQuantizedBvhNode4 and returns its index
+	int		buildQuadNode(int nodeIndex);
+
+	///copies the boxes of the binary nodes in [firstNode,endNode) into the quad node built from nodeIndex and its descendants
+	void	refitQuadNode(int quadIndex,int nodeIndex,int firstNode,int endNode);
+
+	///4-wide traversal, children are visited nearest first and skipped once they start beyond the closest hit
+	void	walkQuadTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax) const;
+
+	void	walkQuadTreeAgainstQuantizedAabb(btNodeOverlapCallback* nodeCallback,const unsigned short int* quantizedQueryAabbMin,const unsigned short int* quantizedQueryAabbMax) const;
+
 public:
 	
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -334,6 +402,25 @@ public:
 	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///buildQuadTree builds a 4-wide copy (QBVH) of a quantized tree, that is used by all ray, box cast and aabb queries
+	///afterwards. It tests four child boxes at once (with SSE when available) and visits ray hits nearest first.
+	///It needs 64 bytes per four children in addition to the 16 byte nodes, refit and refitPartial update it.
+	void	buildQuadTree();
+
+	///refitQuadTree copies the boxes of the binary nodes in [firstNode,endNode) into the quad tree, after they were refit.
+	///It only visits the quad nodes above and inside that range, the shape of the tree stays the same.
+	void	refitQuadTree(int firstNode,int endNode);
+
+	void	clearQuadTree()
+	{
+		m_quantizedQuadNodes.clear();
+	}
+
+	bool	hasQuadTree() const
+	{
+		return m_quantizedQuadNodes.size() > 0;
+	}
+
 		SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point,int isMax) const
 	{
 
@@ -451,8 +538,15 @@ public:
 	virtual bool serialize(void *o_alignedDataBuffer, unsigned i_dataBufferSize, bool i_swapEndian);
 
 	///deSerializeInPlace loads and initializes a BVH from a buffer in memory 'in place'
+	///Returns NULL if the buffer is too small or was written with another BT_QUANTIZED_BVH_SERIALIZE_VERSION.
 	static btQuantizedBvh *deSerializeInPlace(void *i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian);
 
+	///deSerializeReadOnly initializes this BVH from a buffer written by serialize (without endian swap) and doesn't write to the buffer,
+	///so it can live in read-only memory, such as a file mapped by btMappedBvhFile. The node arrays point into the buffer:
+	///it must stay valid while the BVH is used, and the BVH must not be refit.
+	///Returns false if the buffer is misaligned or too small, or if it was written with another serialize version or for the other byte order.
+	bool	deSerializeReadOnly(const void *i_alignedDataBuffer, unsigned int i_dataBufferSize);
+
 	static unsigned int getAlignmentSerializationPadding();
 
 	SIMD_FORCE_INLINE bool isQuantized()
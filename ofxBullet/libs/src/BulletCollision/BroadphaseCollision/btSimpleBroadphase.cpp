@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btTransform.h"
 #include "LinearMath/btMatrix3x3.h"
+#include "LinearMath/btAabbUtil2.h"
 #include <new>
 
 extern int gOverlappingPairs;
@@ -206,6 +207,20 @@ void	btSimpleBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 				continue;
 			}
 			new_largest_index = i;
+
+			//test proxy0 against all remaining handles at once, the boxes are read in place from the handle pool
+			int numOthers = m_LastHandleIndex - i;
+			if (numOthers <= 0)
+			{
+				continue;
+			}
+			if (m_overlapFlags.size() < numOthers)
+			{
+				m_overlapFlags.resize(numOthers);
+			}
+			btAabbOverlapArray(proxy0->m_aabbMin,proxy0->m_aabbMax,&m_pHandles[i+1].m_aabbMin,&m_pHandles[i+1].m_aabbMax,
+				sizeof(btSimpleBroadphaseProxy),numOthers,&m_overlapFlags[0]);
+
 			for (j=i+1; j <= m_LastHandleIndex; j++)
 			{
 				btSimpleBroadphaseProxy* proxy1 = &m_pHandles[j];
@@ -215,10 +230,7 @@ void	btSimpleBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 					continue;
 				}
 
-				btSimpleBroadphaseProxy* p0 = getSimpleProxyFromProxy(proxy0);
-				btSimpleBroadphaseProxy* p1 = getSimpleProxyFromProxy(proxy1);
-
-				if (aabbOverlap(p0,p1))
+				if (m_overlapFlags[j-i-1])
 				{
 					if ( !m_pairCache->findPair(proxy0,proxy1))
 					{
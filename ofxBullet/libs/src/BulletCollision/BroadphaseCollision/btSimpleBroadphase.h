@@ -94,6 +94,9 @@ protected:
 
 	int	m_invalidPair;
 
+	///scratch results of btAabbOverlapArray in calculateOverlappingPairs, one entry per handle
+	btAlignedObjectArray<unsigned char>	m_overlapFlags;
+
 	
 	
 	inline btSimpleBroadphaseProxy*	getSimpleProxyFromProxy(btBroadphaseProxy* proxy)
@@ -37,6 +37,7 @@ btCollisionDispatcher::btCollisionDispatcher (btCollisionConfiguration* collisio
 	m_count(0),
 	m_useIslands(true),
 	m_staticWarningReported(false),
+	m_manifoldListener(0),
 	m_collisionConfiguration(collisionConfiguration)
 {
 	int i;
@@ -81,20 +82,19 @@ btPersistentManifold*	btCollisionDispatcher::getNewManifold(void* b0,void* b1)
 
 	btScalar contactBreakingThreshold = btMin(gContactBreakingThreshold,btMin(body0->getCollisionShape()->getContactBreakingThreshold(),body1->getCollisionShape()->getContactBreakingThreshold()));
 	
-	void* mem = 0;
-	
-	if (m_persistentManifoldPoolAllocator->getFreeCount())
-	{
-		mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
-	} else
+	//the pool grows if configured to, otherwise it counts the fallback
+	void* mem = m_persistentManifoldPoolAllocator->allocate(sizeof(btPersistentManifold));
+	if (!mem)
 	{
 		mem = btAlignedAlloc(sizeof(btPersistentManifold),16);
-
 	}
 	btPersistentManifold* manifold = new(mem) btPersistentManifold (body0,body1,0,contactBreakingThreshold);
 	manifold->m_index1a = m_manifoldsPtr.size();
 	m_manifoldsPtr.push_back(manifold);
 
+	if (m_manifoldListener)
+		m_manifoldListener->manifoldCreated(manifold);
+
 	return manifold;
 }
 
@@ -110,6 +110,9 @@ void btCollisionDispatcher::releaseManifold(btPersistentManifold* manifold)
 	gNumManifold--;
 
 	//printf("releaseManifold: gNumManifold %d\n",gNumManifold);
+	if (m_manifoldListener)
+		m_manifoldListener->manifoldReleased(manifold);
+
 	clearManifold(manifold);
 
 	int findIndex = manifold->m_index1a;
@@ -279,12 +282,13 @@ void btCollisionDispatcher::defaultNearCallback(btBroadphasePair& collisionPair,
 
 void* btCollisionDispatcher::allocateCollisionAlgorithm(int size)
 {
-	if (m_collisionAlgorithmPoolAllocator->getFreeCount())
+	void* mem = m_collisionAlgorithmPoolAllocator->allocate(size);
+	if (mem)
 	{
-		return m_collisionAlgorithmPoolAllocator->allocate(size);
+		return mem;
 	}
 	
-	//warn user for overflow?
+	//pool full and not growing, see btPoolAllocator::getNumFallbacks
 	return	btAlignedAlloc(static_cast<size_t>(size), 16);
 }
 
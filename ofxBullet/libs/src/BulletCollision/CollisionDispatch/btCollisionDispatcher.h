@@ -58,6 +58,8 @@ class btCollisionDispatcher : public btDispatcher
 
 	btPoolAllocator*	m_persistentManifoldPoolAllocator;
 
+	btManifoldListener*	m_manifoldListener;
+
 	btCollisionAlgorithmCreateFunc* m_doubleDispatch[MAX_BROADPHASE_COLLISION_TYPES][MAX_BROADPHASE_COLLISION_TYPES];
 	
 
@@ -100,6 +102,17 @@ public:
 
 	virtual void clearManifold(btPersistentManifold* manifold);
 
+	virtual bool	setManifoldListener(btManifoldListener* listener)
+	{
+		m_manifoldListener = listener;
+		return true;
+	}
+
+	virtual btManifoldListener*	getManifoldListener()
+	{
+		return m_manifoldListener;
+	}
+
 			
 	btCollisionAlgorithm* findAlgorithm(btCollisionObject* body0,btCollisionObject* body1,btPersistentManifold* sharedManifold = 0);
 		
@@ -64,6 +64,10 @@ protected:
 
 	int				m_islandTag1;
 	int				m_companionId;
+	///persistent node of the object in btIncrementalIslandManager, -1 when it has none
+	int				m_islandNode;
+	///index of the object in btCollisionWorld::getCollisionObjectArray, -1 when it is not in a world
+	int				m_worldArrayIndex;
 
 	int				m_activationState1;
 	btScalar			m_deactivationTime;
@@ -315,6 +319,26 @@ public:
 		m_companionId = id;
 	}
 
+	SIMD_FORCE_INLINE int getIslandNode() const
+	{
+		return	m_islandNode;
+	}
+
+	void	setIslandNode(int node)
+	{
+		m_islandNode = node;
+	}
+
+	SIMD_FORCE_INLINE int getWorldArrayIndex() const
+	{
+		return	m_worldArrayIndex;
+	}
+
+	void	setWorldArrayIndex(int index)
+	{
+		m_worldArrayIndex = index;
+	}
+
 	SIMD_FORCE_INLINE btScalar			getHitFraction() const
 	{
 		return m_hitFraction; 
@@ -31,6 +31,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btStackAlloc.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 //#define USE_BRUTEFORCE_RAYBROADPHASE 1
 //RECALCULATE_AABB is slower, but benefit is that you don't need to call 'stepSimulation'  or 'updateAabbs' before using a rayTest
@@ -57,6 +58,7 @@ btCollisionWorld::~btCollisionWorld()
 
 	//clean up remaining objects
 	int i;
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
 	for (i=0;i<m_collisionObjects.size();i++)
 	{
 		btCollisionObject* collisionObject= m_collisionObjects[i];
@@ -64,12 +66,17 @@ btCollisionWorld::~btCollisionWorld()
 		btBroadphaseProxy* bp = collisionObject->getBroadphaseHandle();
 		if (bp)
 		{
-			//
-			// only clear the cached algorithms
-			//
-			getBroadphase()->getOverlappingPairCache()->cleanProxyFromPairs(bp,m_dispatcher1);
-			getBroadphase()->destroyProxy(bp,m_dispatcher1);
+			proxies.push_back(bp);
+			collisionObject->setBroadphaseHandle(0);
 		}
+		collisionObject->setWorldArrayIndex(-1);
+	}
+	if (proxies.size())
+	{
+		//
+		// clears the cached algorithms
+		//
+		getBroadphase()->destroyProxies(&proxies[0],proxies.size(),m_dispatcher1);
 	}
 
 
@@ -90,6 +97,7 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject,sho
 	//check that the object isn't already added
 		btAssert( m_collisionObjects.findLinearSearch(collisionObject)  == m_collisionObjects.size());
 
+		collisionObject->setWorldArrayIndex(m_collisionObjects.size());
 		m_collisionObjects.push_back(collisionObject);
 
 		//calculate new AABB
@@ -100,6 +108,7 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject,sho
 		collisionObject->getCollisionShape()->getAabb(trans,minAabb,maxAabb);
 
 		int type = collisionObject->getCollisionShape()->getShapeType();
+		BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
 		collisionObject->setBroadphaseHandle( getBroadphase()->createProxy(
 			minAabb,
 			maxAabb,
@@ -118,11 +127,46 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject,sho
 
 
 
+void	btCollisionWorld::computeContactAabb(const btCollisionObject* colObj,btVector3& minAabb,btVector3& maxAabb) const
+{
+	colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb,maxAabb);
+	//need to increase the aabb for contact thresholds
+	btVector3 contactThreshold(gContactBreakingThreshold,gContactBreakingThreshold,gContactBreakingThreshold);
+	minAabb -= contactThreshold;
+	maxAabb += contactThreshold;
+}
+
+void	btCollisionWorld::setBroadphaseAabb(btCollisionObject* colObj,const btVector3& minAabb,const btVector3& maxAabb)
+{
+	btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
+
+	//moving objects should be moderately sized, probably something wrong if not
+	if ( colObj->isStaticObject() || ((maxAabb-minAabb).length2() < btScalar(1e12)))
+	{
+		bp->setAabb(colObj->getBroadphaseHandle(),minAabb,maxAabb, m_dispatcher1);
+	} else
+	{
+		//something went wrong, investigate
+		//this assert is unwanted in 3D modelers (danger of loosing work)
+		colObj->setActivationState(DISABLE_SIMULATION);
+
+		static bool reportMe = true;
+		if (reportMe && m_debugDrawer)
+		{
+			reportMe = false;
+			m_debugDrawer->reportErrorWarning("Overflow in AABB, object removed from simulation");
+			m_debugDrawer->reportErrorWarning("If you can reproduce this, please email bugs@continuousphysics.com\n");
+			m_debugDrawer->reportErrorWarning("Please include above information, your Platform, version of OS.\n");
+			m_debugDrawer->reportErrorWarning("Thanks.\n");
+		}
+	}
+}
+
 void	btCollisionWorld::updateAabbs()
 {
 	BT_PROFILE("updateAabbs");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
 
-	btTransform predictedTrans;
 	for ( int i=0;i<m_collisionObjects.size();i++)
 	{
 		btCollisionObject* colObj = m_collisionObjects[i];
@@ -131,34 +175,8 @@ void	btCollisionWorld::updateAabbs()
 		if (colObj->isActive())
 		{
 			btVector3 minAabb,maxAabb;
-			colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb,maxAabb);
-			//need to increase the aabb for contact thresholds
-			btVector3 contactThreshold(gContactBreakingThreshold,gContactBreakingThreshold,gContactBreakingThreshold);
-			minAabb -= contactThreshold;
-			maxAabb += contactThreshold;
-
-			btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
-
-			//moving objects should be moderately sized, probably something wrong if not
-			if ( colObj->isStaticObject() || ((maxAabb-minAabb).length2() < btScalar(1e12)))
-			{
-				bp->setAabb(colObj->getBroadphaseHandle(),minAabb,maxAabb, m_dispatcher1);
-			} else
-			{
-				//something went wrong, investigate
-				//this assert is unwanted in 3D modelers (danger of loosing work)
-				colObj->setActivationState(DISABLE_SIMULATION);
-
-				static bool reportMe = true;
-				if (reportMe && m_debugDrawer)
-				{
-					reportMe = false;
-					m_debugDrawer->reportErrorWarning("Overflow in AABB, object removed from simulation");
-					m_debugDrawer->reportErrorWarning("If you can reproduce this, please email bugs@continuousphysics.com\n");
-					m_debugDrawer->reportErrorWarning("Please include above information, your Platform, version of OS.\n");
-					m_debugDrawer->reportErrorWarning("Thanks.\n");
-				}
-			}
+			computeContactAabb(colObj,minAabb,maxAabb);
+			setBroadphaseAabb(colObj,minAabb,maxAabb);
 		}
 	}
 
@@ -176,6 +194,7 @@ void	btCollisionWorld::performDiscreteCollisionDetection()
 
 	{
 		BT_PROFILE("calculateOverlappingPairs");
+		BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
 		m_broadphasePairCache->calculateOverlappingPairs(m_dispatcher1);
 	}
 
@@ -183,6 +202,7 @@ void	btCollisionWorld::performDiscreteCollisionDetection()
 	btDispatcher* dispatcher = getDispatcher();
 	{
 		BT_PROFILE("dispatchAllCollisionPairs");
+		BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_NARROWPHASE);
 		if (dispatcher)
 			dispatcher->dispatchAllCollisionPairs(m_broadphasePairCache->getOverlappingPairCache(),dispatchInfo,m_dispatcher1);
 	}
@@ -213,10 +233,106 @@ void	btCollisionWorld::removeCollisionObject(btCollisionObject* collisionObject)
 
 
 	//swapremove
-	m_collisionObjects.remove(collisionObject);
+	removeFromCollisionObjectArray(collisionObject);
 
 }
 
+void	btCollisionWorld::removeFromCollisionObjectArray(btCollisionObject* collisionObject)
+{
+	int index = collisionObject->getWorldArrayIndex();
+	if ((index<0) || (index>=m_collisionObjects.size()) || (m_collisionObjects[index]!=collisionObject))
+	{
+		//the array was reordered by the user, fall back to a linear search
+		index = m_collisionObjects.findLinearSearch(collisionObject);
+		if (index==m_collisionObjects.size())
+			return;
+	}
+	int last = m_collisionObjects.size()-1;
+	if (index<last)
+	{
+		m_collisionObjects.swap(index,last);
+		m_collisionObjects[index]->setWorldArrayIndex(index);
+	}
+	m_collisionObjects.pop_back();
+	collisionObject->setWorldArrayIndex(-1);
+}
+
+void	btCollisionWorld::addCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects,short int collisionFilterGroup,short int collisionFilterMask)
+{
+	btAlignedObjectArray<short int> groups;
+	btAlignedObjectArray<short int> masks;
+	groups.resize(numObjects,collisionFilterGroup);
+	masks.resize(numObjects,collisionFilterMask);
+	if (numObjects>0)
+		addCollisionObjects(collisionObjects,numObjects,&groups[0],&masks[0]);
+}
+
+void	btCollisionWorld::addCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects,const short int* collisionFilterGroups,const short int* collisionFilterMasks)
+{
+	BT_PROFILE("addCollisionObjects");
+	if (numObjects<=0)
+		return;
+
+	btAlignedObjectArray<btVector3>	minAabbs;
+	btAlignedObjectArray<btVector3>	maxAabbs;
+	btAlignedObjectArray<int>	types;
+	btAlignedObjectArray<btBroadphaseProxy*>	proxies;
+	minAabbs.resize(numObjects);
+	maxAabbs.resize(numObjects);
+	types.resize(numObjects);
+	proxies.resize(numObjects);
+
+	m_collisionObjects.reserve(m_collisionObjects.size()+numObjects);
+	int i;
+	for (i=0;i<numObjects;i++)
+	{
+		btCollisionObject* collisionObject = collisionObjects[i];
+		//check that the object isn't already added
+		btAssert(collisionObject->getWorldArrayIndex()<0);
+
+		collisionObject->setWorldArrayIndex(m_collisionObjects.size());
+		m_collisionObjects.push_back(collisionObject);
+
+		collisionObject->getCollisionShape()->getAabb(collisionObject->getWorldTransform(),minAabbs[i],maxAabbs[i]);
+		types[i] = collisionObject->getCollisionShape()->getShapeType();
+	}
+
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
+	getBroadphase()->createProxies(numObjects,&minAabbs[0],&maxAabbs[0],&types[0],(void* const*)collisionObjects,
+		collisionFilterGroups,collisionFilterMasks,m_dispatcher1,&proxies[0]);
+
+	for (i=0;i<numObjects;i++)
+	{
+		collisionObjects[i]->setBroadphaseHandle(proxies[i]);
+	}
+}
+
+void	btCollisionWorld::removeCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects)
+{
+	BT_PROFILE("removeCollisionObjects");
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
+	proxies.reserve(numObjects);
+	int i;
+	for (i=0;i<numObjects;i++)
+	{
+		btBroadphaseProxy* bp = collisionObjects[i]->getBroadphaseHandle();
+		if (bp)
+		{
+			proxies.push_back(bp);
+			collisionObjects[i]->setBroadphaseHandle(0);
+		}
+	}
+	if (proxies.size())
+	{
+		getBroadphase()->destroyProxies(&proxies[0],proxies.size(),m_dispatcher1);
+	}
+
+	for (i=0;i<numObjects;i++)
+	{
+		removeFromCollisionObjectArray(collisionObjects[i]);
+	}
+}
+
 
 
 void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans,
@@ -321,7 +437,7 @@ void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTra
 
 				BridgeTriangleRaycastCallback rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObject,triangleMesh);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
-				triangleMesh->performRaycast(&rcb,rayFromLocal,rayToLocal);
+				triangleMesh->performRaycast(&rcb,rayFromLocal,rayToLocal,&rcb.m_hitFraction);
 			} else
 			{
 				//generic (slower) case
@@ -516,7 +632,7 @@ void	btCollisionWorld::objectQuerySingle(const btConvexShape* castShape,const bt
 				tccb.m_hitFraction = resultCallback.m_closestHitFraction;
 				btVector3 boxMinLocal, boxMaxLocal;
 				castShape->getAabb(rotationXform, boxMinLocal, boxMaxLocal);
-				triangleMesh->performConvexcast(&tccb,convexFromLocal,convexToLocal,boxMinLocal, boxMaxLocal);
+				triangleMesh->performConvexcast(&tccb,convexFromLocal,convexToLocal,boxMinLocal, boxMaxLocal,&tccb.m_hitFraction);
 			} else
 			{
 				//BT_PROFILE("convexSweepConcave");
@@ -618,6 +734,8 @@ struct btSingleRayCallback : public btBroadphaseRayCallback
 	btTransform	m_rayFromTrans;
 	btTransform	m_rayToTrans;
 	btVector3	m_hitNormal;
+	///m_lambda_max of the full ray, m_lambda_max shrinks with the closest hit fraction
+	btScalar	m_rayLength;
 
 	const btCollisionWorld*	m_world;
 	btCollisionWorld::RayResultCallback&	m_resultCallback;
@@ -644,7 +762,8 @@ struct btSingleRayCallback : public btBroadphaseRayCallback
 		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
 		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
 
-		m_lambda_max = rayDir.dot(m_rayToWorld-m_rayFromWorld);
+		m_rayLength = rayDir.dot(m_rayToWorld-m_rayFromWorld);
+		m_lambda_max = m_rayLength*m_resultCallback.m_closestHitFraction;
 
 	}
 
@@ -681,6 +800,8 @@ struct btSingleRayCallback : public btBroadphaseRayCallback
 						collisionObject->getCollisionShape(),
 						collisionObject->getWorldTransform(),
 						m_resultCallback);
+				//let the broadphase cull everything beyond the closest hit
+				m_lambda_max = m_rayLength*m_resultCallback.m_closestHitFraction;
 			}
 		}
 		return true;
@@ -705,6 +826,169 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 
 }
 
+///keeps the closest hit of one ray of rayTestBatch
+struct btBatchRayResultCallback : public btCollisionWorld::RayResultCallback
+{
+	btVector3			m_hitNormalWorld;
+	int					m_triangleIndex;
+	///world transform of the shape that is tested, the child transform for children of compound shapes
+	const btTransform*	m_shapeWorldTransform;
+
+	void	reset()
+	{
+		m_closestHitFraction = btScalar(1.);
+		m_collisionObject = 0;
+		m_triangleIndex = -1;
+	}
+
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalRayResult& rayResult,bool normalInWorldSpace)
+	{
+		btAssert(rayResult.m_hitFraction <= m_closestHitFraction);
+
+		m_closestHitFraction = rayResult.m_hitFraction;
+		m_collisionObject = rayResult.m_collisionObject;
+		m_hitNormalWorld = normalInWorldSpace ? rayResult.m_hitNormalLocal : m_shapeWorldTransform->getBasis()*rayResult.m_hitNormalLocal;
+		//triangle meshes report the unnormalized face normal
+		m_hitNormalWorld.normalize();
+		m_triangleIndex = rayResult.m_localShapeInfo ? rayResult.m_localShapeInfo->m_triangleIndex : -1;
+		return rayResult.m_hitFraction;
+	}
+};
+
+///walks compound shapes without replacing the collision shape of the object, so other threads can test the same object
+static void	rayTestBatchSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans,
+					  btCollisionObject* collisionObject,
+					  const btCollisionShape* collisionShape,
+					  const btTransform& colObjWorldTransform,
+					  btBatchRayResultCallback& resultCallback)
+{
+	if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			rayTestBatchSingle(rayFromTrans,rayToTrans,collisionObject,compoundShape->getChildShape(i),childWorldTrans,resultCallback);
+		}
+		return;
+	}
+
+	resultCallback.m_shapeWorldTransform = &colObjWorldTransform;
+	btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,collisionObject,collisionShape,colObjWorldTransform,resultCallback);
+}
+
+///one ray of a rayTestBatch packet, it owns the result callback so a packet of them can live on the stack
+struct btBatchRayCallback : public btBroadphaseRayCallback
+{
+	btVector3	m_rayFromWorld;
+	btVector3	m_rayToWorld;
+	btTransform	m_rayFromTrans;
+	btTransform	m_rayToTrans;
+	btScalar	m_rayLength;
+
+	btBatchRayResultCallback	m_resultCallback;
+
+	///same setup as btSingleRayCallback
+	void	setRay(const btVector3& rayFromWorld,const btVector3& rayToWorld)
+	{
+		m_rayFromWorld = rayFromWorld;
+		m_rayToWorld = rayToWorld;
+		m_rayFromTrans.setIdentity();
+		m_rayFromTrans.setOrigin(m_rayFromWorld);
+		m_rayToTrans.setIdentity();
+		m_rayToTrans.setOrigin(m_rayToWorld);
+
+		btVector3 rayDir = (rayToWorld-rayFromWorld);
+
+		rayDir.normalize ();
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(1e30) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+
+		m_lambda_max = rayDir.dot(m_rayToWorld-m_rayFromWorld);
+		m_rayLength = m_lambda_max;
+
+		m_resultCallback.reset();
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		///terminate further ray tests, once the closestHitFraction reached zero
+		if (m_resultCallback.m_closestHitFraction == btScalar(0.f))
+			return false;
+
+		btCollisionObject*	collisionObject = (btCollisionObject*)proxy->m_clientObject;
+
+		//only perform raycast if filterMask matches
+		if(m_resultCallback.needsCollision(collisionObject->getBroadphaseHandle())) 
+		{
+			rayTestBatchSingle(m_rayFromTrans,m_rayToTrans,
+				collisionObject,
+				collisionObject->getCollisionShape(),
+				collisionObject->getWorldTransform(),
+				m_resultCallback);
+			m_lambda_max = m_rayLength*m_resultCallback.m_closestHitFraction;
+		}
+		return true;
+	}
+};
+
+///number of consecutive rays of rayTestBatch that share one broadphase traversal
+#define BATCH_RAY_PACKET_SIZE 16
+
+void	btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchResults& results, short int collisionFilterGroup, short int collisionFilterMask) const
+{
+	btBatchRayCallback			rayCallbacks[BATCH_RAY_PACKET_SIZE];
+	btBroadphaseRayCallback*	rayCallbackPtrs[BATCH_RAY_PACKET_SIZE];
+	int i;
+	for (i=0;i<BATCH_RAY_PACKET_SIZE;i++)
+	{
+		rayCallbacks[i].m_resultCallback.m_collisionFilterGroup = collisionFilterGroup;
+		rayCallbacks[i].m_resultCallback.m_collisionFilterMask = collisionFilterMask;
+		rayCallbackPtrs[i] = &rayCallbacks[i];
+	}
+
+	for (int first=0;first<numRays;first+=BATCH_RAY_PACKET_SIZE)
+	{
+		const int numPacketRays = btMin(numRays-first,int(BATCH_RAY_PACKET_SIZE));
+		for (i=0;i<numPacketRays;i++)
+		{
+			rayCallbacks[i].setRay(rayFromWorld[first+i],rayToWorld[first+i]);
+		}
+
+#ifndef USE_BRUTEFORCE_RAYBROADPHASE
+		m_broadphasePairCache->rayTestPacket(rayFromWorld+first,rayToWorld+first,numPacketRays,rayCallbackPtrs);
+#else
+		for (i=0;i<numPacketRays;i++)
+		{
+			for (int j=0;j<this->getNumCollisionObjects();j++)
+			{
+				rayCallbacks[i].process(m_collisionObjects[j]->getBroadphaseHandle());
+			}
+		}
+#endif //USE_BRUTEFORCE_RAYBROADPHASE
+
+		for (i=0;i<numPacketRays;i++)
+		{
+			const btBatchRayResultCallback& resultCallback = rayCallbacks[i].m_resultCallback;
+			const int ray = first+i;
+			results.m_hitFraction[ray] = resultCallback.m_closestHitFraction;
+			results.m_collisionObject[ray] = resultCallback.m_collisionObject;
+			if (results.m_hitNormalWorld)
+			{
+				results.m_hitNormalWorld[ray] = resultCallback.hasHit() ? resultCallback.m_hitNormalWorld : btVector3(btScalar(0.),btScalar(0.),btScalar(0.));
+			}
+			if (results.m_triangleIndex)
+			{
+				results.m_triangleIndex[ray] = resultCallback.m_triangleIndex;
+			}
+		}
+	}
+}
+
 
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
@@ -716,6 +1000,7 @@ struct btSingleSweepCallback : public btBroadphaseRayCallback
 	btCollisionWorld::ConvexResultCallback&	m_resultCallback;
 	btScalar	m_allowedCcdPenetration;
 	const btConvexShape* m_castShape;
+	btScalar	m_castLength;
 
 
 	btSingleSweepCallback(const btConvexShape* castShape, const btTransform& convexFromTrans,const btTransform& convexToTrans,const btCollisionWorld* world,btCollisionWorld::ConvexResultCallback& resultCallback,btScalar allowedPenetration)
@@ -736,7 +1021,8 @@ struct btSingleSweepCallback : public btBroadphaseRayCallback
 		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
 		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
 
-		m_lambda_max = rayDir.dot(unnormalizedRayDir);
+		m_castLength = rayDir.dot(unnormalizedRayDir);
+		m_lambda_max = m_castLength*m_resultCallback.m_closestHitFraction;
 
 	}
 
@@ -757,6 +1043,8 @@ struct btSingleSweepCallback : public btBroadphaseRayCallback
 						collisionObject->getWorldTransform(),
 						m_resultCallback,
 						m_allowedCcdPenetration);
+			//the cast shape aabb is added to the proxy aabbs, so this culls everything beyond the closest hit
+			m_lambda_max = m_castLength*m_resultCallback.m_closestHitFraction;
 		}
 		
 		return true;
@@ -94,6 +94,8 @@ protected:
 
 	btIDebugDraw*	m_debugDrawer;
 
+	///swap-removes the object from m_collisionObjects using its world array index
+	void	removeFromCollisionObjectArray(btCollisionObject* collisionObject);
 	
 public:
 
@@ -135,6 +137,13 @@ public:
 
 	virtual void	updateAabbs();
 
+	///computes the world space aabb of an object, enlarged by the contact breaking threshold. It only reads the object,
+	///so the aabbs of several objects can be computed in parallel.
+	void	computeContactAabb(const btCollisionObject* colObj,btVector3& minAabb,btVector3& maxAabb) const;
+
+	///passes an aabb computed by computeContactAabb to the broadphase. Objects with an overflowing aabb are removed from the simulation.
+	void	setBroadphaseAabb(btCollisionObject* colObj,const btVector3& minAabb,const btVector3& maxAabb);
+
 	
 	virtual void	setDebugDrawer(btIDebugDraw*	debugDrawer)
 	{
@@ -247,6 +256,25 @@ public:
 		}
 	};
 
+	///RayBatchResults receives the closest hit of each ray of rayTestBatch, as separate arrays with one entry per ray.
+	///Rays without a hit get a hit fraction of 1 and a null object. m_hitNormalWorld and m_triangleIndex are optional,
+	///the normals have unit length.
+	struct	RayBatchResults
+	{
+		RayBatchResults()
+			:m_hitFraction(0),
+			m_hitNormalWorld(0),
+			m_collisionObject(0),
+			m_triangleIndex(0)
+		{
+		}
+
+		btScalar*				m_hitFraction;
+		btVector3*				m_hitNormalWorld;
+		btCollisionObject**		m_collisionObject;
+		///triangle index for triangle meshes, -1 for other shapes
+		int*					m_triangleIndex;
+	};
 
 	struct LocalConvexResult
 	{
@@ -351,6 +379,14 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	void	rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestBatch finds the closest hit of each ray rayFromWorld[i]-rayToWorld[i] and stores it in the results.
+	/// It has no per ray callback or profile sample, and compound shapes are not modified during the test, so
+	/// disjoint ranges of rays can be tested on several threads at once, see btParallelRayBatch in BulletMultiThreaded.
+	/// Consecutive rays are sent to the broadphase in packets of 16, see btBroadphaseInterface::rayTestPacket, so coherent
+	/// rays (neighbouring pixels, a fan of sensor rays) share the tree traversal.
+	void	rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchResults& results,
+						 short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter, short int collisionFilterMask=btBroadphaseProxy::AllFilter) const;
+
 	// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
@@ -374,6 +410,12 @@ public:
 
 	void	addCollisionObject(btCollisionObject* collisionObject,short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter,short int collisionFilterMask=btBroadphaseProxy::AllFilter);
 
+	///addCollisionObjects adds numObjects objects with the same filter group and mask, the broadphase creates all proxies in one batch.
+	void	addCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects,short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter,short int collisionFilterMask=btBroadphaseProxy::AllFilter);
+
+	///addCollisionObjects with a filter group and mask per object
+	void	addCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects,const short int* collisionFilterGroups,const short int* collisionFilterMasks);
+
 	btCollisionObjectArray& getCollisionObjectArray()
 	{
 		return m_collisionObjects;
@@ -387,6 +429,10 @@ public:
 
 	void	removeCollisionObject(btCollisionObject* collisionObject);
 
+	///removeCollisionObjects removes numObjects objects, the broadphase destroys all proxies and their pairs in one batch.
+	///The collision object array ends up in the same order as after removing the objects one by one.
+	void	removeCollisionObjects(btCollisionObject* const* collisionObjects,int numObjects);
+
 	virtual void	performDiscreteCollisionDetection();
 
 	btDispatcherInfo& getDispatchInfo()
@@ -399,6 +445,12 @@ public:
 		return m_dispatchInfo;
 	}
 
+	///the scratch memory arena of the collision configuration, see btStackAlloc::getPeakUsage
+	btStackAlloc*	getStackAllocator()
+	{
+		return m_stackAlloc;
+	}
+
 };
 
 
@@ -27,6 +27,8 @@ m_isSwapped(isSwapped),
 m_sharedManifold(ci.m_manifold)
 {
 	m_ownsManifold = false;
+	m_childCollisionAlgorithms.initializeFromBuffer(m_childAlgorithmBuffer,0,INLINE_CHILD_ALGORITHMS);
+	m_manifoldArray.initializeFromBuffer(m_manifoldBuffer,0,INLINE_MANIFOLDS);
 
 	btCollisionObject* colObj = m_isSwapped? body1 : body0;
 	btCollisionObject* otherObj = m_isSwapped? body0 : body1;
@@ -181,22 +183,21 @@ void btCompoundCollisionAlgorithm::processCollision (btCollisionObject* body0,bt
 	{
 		int numChildren = m_childCollisionAlgorithms.size();
 		int i;
-		btManifoldArray manifoldArray;
 		for (i=0;i<m_childCollisionAlgorithms.size();i++)
 		{
 			if (m_childCollisionAlgorithms[i])
 			{
-				m_childCollisionAlgorithms[i]->getAllContactManifolds(manifoldArray);
-				for (int m=0;m<manifoldArray.size();m++)
+				m_childCollisionAlgorithms[i]->getAllContactManifolds(m_manifoldArray);
+				for (int m=0;m<m_manifoldArray.size();m++)
 				{
-					if (manifoldArray[m]->getNumContacts())
+					if (m_manifoldArray[m]->getNumContacts())
 					{
-						resultOut->setPersistentManifold(manifoldArray[m]);
+						resultOut->setPersistentManifold(m_manifoldArray[m]);
 						resultOut->refreshContactPoints();
 						resultOut->setPersistentManifold(0);//??necessary?
 					}
 				}
-				manifoldArray.clear();
+				m_manifoldArray.resize(0);
 			}
 		}
 	}
@@ -30,11 +30,22 @@ class btDispatcher;
 /// btCompoundCollisionAlgorithm  supports collision between CompoundCollisionShapes and other collision shapes
 class btCompoundCollisionAlgorithm  : public btActivatingCollisionAlgorithm
 {
+	enum
+	{
+		INLINE_CHILD_ALGORITHMS = 4,
+		INLINE_MANIFOLDS = 2
+	};
+
 	btAlignedObjectArray<btCollisionAlgorithm*> m_childCollisionAlgorithms;
 	bool m_isSwapped;
 
 	class btPersistentManifold*	m_sharedManifold;
 	bool					m_ownsManifold;
+	///reused by processCollision to gather the child manifolds without allocating memory every call
+	btManifoldArray			m_manifoldArray;
+	///storage of both arrays for small compounds, so creating the algorithm doesn't allocate memory besides the dispatcher pool
+	btCollisionAlgorithm*	m_childAlgorithmBuffer[INLINE_CHILD_ALGORITHMS];
+	btPersistentManifold*	m_manifoldBuffer[INLINE_MANIFOLDS];
 	
 public:
 
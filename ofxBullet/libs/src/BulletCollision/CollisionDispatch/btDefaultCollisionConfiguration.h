@@ -27,6 +27,10 @@ struct	btDefaultCollisionConstructionInfo
 	btPoolAllocator*	m_collisionAlgorithmPool;
 	int					m_defaultMaxPersistentManifoldPoolSize;
 	int					m_defaultMaxCollisionAlgorithmPoolSize;
+	///elements added when a default pool runs out, 0 keeps the pool size fixed and falls back to btAlignedAlloc
+	int					m_defaultPersistentManifoldPoolGrowSize;
+	int					m_defaultCollisionAlgorithmPoolGrowSize;
+	///chunk size of the default btStackAlloc, which grows by chunks. 0 uses BT_STACK_ALLOC_DEFAULT_CHUNKSIZE and allocates the first chunk on first use
 	int					m_defaultStackAllocatorSize;
 
 	btDefaultCollisionConstructionInfo()
@@ -35,6 +39,8 @@ struct	btDefaultCollisionConstructionInfo
 		m_collisionAlgorithmPool(0),
 		m_defaultMaxPersistentManifoldPoolSize(4096),
 		m_defaultMaxCollisionAlgorithmPoolSize(4096),
+		m_defaultPersistentManifoldPoolGrowSize(1024),
+		m_defaultCollisionAlgorithmPoolGrowSize(1024),
 		m_defaultStackAllocatorSize(0)
 	{
 	}
@@ -84,6 +90,12 @@ protected:
 	btCollisionAlgorithmCreateFunc*	m_triangleSphereCF;
 	btCollisionAlgorithmCreateFunc*	m_planeConvexCF;
 	btCollisionAlgorithmCreateFunc*	m_convexPlaneCF;
+
+	///rounds the element size of the collision algorithm pool up to keep the elements 16 byte aligned, the algorithms hold SIMD vectors
+	static int	alignCollisionAlgorithmElementSize(int elementSize)
+	{
+		return (elementSize+15)&~15;
+	}
 	
 public:
 
@@ -0,0 +1,482 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btIncrementalIslandManager.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "LinearMath/btQuickprof.h"
+
+
+btIncrementalIslandManager::btIncrementalIslandManager()
+:m_firstFreeNode(-1),
+m_firstFreeEdge(-1),
+m_numLiveNodes(0),
+m_numKeptNodes(0),
+m_stamp(0),
+m_dispatcher(0),
+m_listening(false)
+{
+}
+
+btIncrementalIslandManager::~btIncrementalIslandManager()
+{
+	if (m_dispatcher && m_dispatcher->getManifoldListener() == this)
+	{
+		m_dispatcher->setManifoldListener(0);
+	}
+}
+
+int	btIncrementalIslandManager::allocateNode(btCollisionObject* colObj)
+{
+	int node = m_firstFreeNode;
+	if (node >= 0)
+	{
+		m_firstFreeNode = m_nodes[node].m_firstEdge;
+	} else
+	{
+		node = m_nodes.size();
+		m_nodes.expand();
+	}
+	btIslandNode& islandNode = m_nodes[node];
+	islandNode.m_object = colObj;
+	islandNode.m_firstEdge = -1;
+	islandNode.m_numEdges = 0;
+	islandNode.m_visitStamp = 0;
+	islandNode.m_seenStamp = m_stamp;
+
+	colObj->setIslandNode(node);
+	m_numLiveNodes++;
+	m_dirtyNodes.push_back(node);
+	return node;
+}
+
+int	btIncrementalIslandManager::findOrCreateNode(btCollisionObject* colObj)
+{
+	int node = colObj->getIslandNode();
+	//the object might have left the world and its node might belong to another object by now
+	if (node >= 0 && node < m_nodes.size() && m_nodes[node].m_object == colObj)
+		return node;
+	return allocateNode(colObj);
+}
+
+void	btIncrementalIslandManager::freeNode(int node)
+{
+	//don't touch the object, it might be deleted already
+	while (m_nodes[node].m_firstEdge >= 0)
+	{
+		const btIslandEdge& edge = m_edges[m_nodes[node].m_firstEdge];
+		m_dirtyNodes.push_back(edge.m_node[0] == node ? edge.m_node[1] : edge.m_node[0]);
+		unlinkEdge(m_nodes[node].m_firstEdge);
+	}
+	m_nodes[node].m_object = 0;
+	m_nodes[node].m_firstEdge = m_firstFreeNode;
+	m_firstFreeNode = node;
+	m_numLiveNodes--;
+}
+
+void	btIncrementalIslandManager::addEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* key,bool isManifold)
+{
+	if (colObj0 == colObj1)
+		return;
+
+	int nodes[2];
+	nodes[0] = findOrCreateNode(colObj0);
+	nodes[1] = findOrCreateNode(colObj1);
+
+	int edgeIndex = m_firstFreeEdge;
+	if (edgeIndex >= 0)
+	{
+		m_firstFreeEdge = m_edges[edgeIndex].m_next[0];
+	} else
+	{
+		edgeIndex = m_edges.size();
+		m_edges.expand();
+	}
+
+	btIslandEdge& edge = m_edges[edgeIndex];
+	edge.m_key = key;
+	edge.m_isManifold = isManifold;
+	for (int side=0;side<2;side++)
+	{
+		btIslandNode& node = m_nodes[nodes[side]];
+		edge.m_node[side] = nodes[side];
+		edge.m_prev[side] = -1;
+		edge.m_next[side] = node.m_firstEdge;
+		if (node.m_firstEdge >= 0)
+		{
+			btIslandEdge& next = m_edges[node.m_firstEdge];
+			next.m_prev[next.m_node[0] == nodes[side] ? 0 : 1] = edgeIndex;
+		}
+		node.m_firstEdge = edgeIndex;
+		node.m_numEdges++;
+		m_dirtyNodes.push_back(nodes[side]);
+	}
+}
+
+void	btIncrementalIslandManager::unlinkEdge(int edgeIndex)
+{
+	btIslandEdge& edge = m_edges[edgeIndex];
+	for (int side=0;side<2;side++)
+	{
+		int node = edge.m_node[side];
+		int prev = edge.m_prev[side];
+		int next = edge.m_next[side];
+		if (prev >= 0)
+		{
+			m_edges[prev].m_next[m_edges[prev].m_node[0] == node ? 0 : 1] = next;
+		} else
+		{
+			m_nodes[node].m_firstEdge = next;
+		}
+		if (next >= 0)
+		{
+			m_edges[next].m_prev[m_edges[next].m_node[0] == node ? 0 : 1] = prev;
+		}
+		m_nodes[node].m_numEdges--;
+	}
+	edge.m_node[0] = -1;
+	edge.m_next[0] = m_firstFreeEdge;
+	m_firstFreeEdge = edgeIndex;
+}
+
+void	btIncrementalIslandManager::removeEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* key)
+{
+	int node0 = colObj0->getIslandNode();
+	int node1 = colObj1->getIslandNode();
+	if (node0 < 0 || node0 >= m_nodes.size() || m_nodes[node0].m_object != colObj0)
+		return;
+	if (node1 < 0 || node1 >= m_nodes.size() || m_nodes[node1].m_object != colObj1)
+		return;
+
+	//static objects can have many edges, search the shorter list
+	int node = m_nodes[node0].m_numEdges <= m_nodes[node1].m_numEdges ? node0 : node1;
+	for (int e = m_nodes[node].m_firstEdge; e >= 0; e = m_edges[e].m_next[m_edges[e].m_node[0] == node ? 0 : 1])
+	{
+		if (m_edges[e].m_key == key)
+		{
+			unlinkEdge(e);
+			m_dirtyNodes.push_back(node0);
+			m_dirtyNodes.push_back(node1);
+			return;
+		}
+	}
+}
+
+void	btIncrementalIslandManager::removeManifoldEdges()
+{
+	for (int e=0;e<m_edges.size();e++)
+	{
+		if (m_edges[e].m_node[0] >= 0 && m_edges[e].m_isManifold)
+		{
+			m_dirtyNodes.push_back(m_edges[e].m_node[0]);
+			m_dirtyNodes.push_back(m_edges[e].m_node[1]);
+			unlinkEdge(e);
+		}
+	}
+}
+
+void	btIncrementalIslandManager::setDispatcher(btDispatcher* dispatcher)
+{
+	if (dispatcher == m_dispatcher)
+		return;
+
+	if (m_dispatcher && m_dispatcher->getManifoldListener() == this)
+	{
+		m_dispatcher->setManifoldListener(0);
+	}
+	removeManifoldEdges();
+
+	m_dispatcher = dispatcher;
+	m_listening = dispatcher && dispatcher->setManifoldListener(this);
+	if (m_listening)
+	{
+		for (int i=0;i<dispatcher->getNumManifolds();i++)
+		{
+			manifoldCreated(dispatcher->getManifoldByIndexInternal(i));
+		}
+	}
+}
+
+void	btIncrementalIslandManager::manifoldCreated(btPersistentManifold* manifold)
+{
+	addEdge((btCollisionObject*)manifold->getBody0(),(btCollisionObject*)manifold->getBody1(),manifold,true);
+}
+
+void	btIncrementalIslandManager::manifoldReleased(btPersistentManifold* manifold)
+{
+	removeEdge((btCollisionObject*)manifold->getBody0(),(btCollisionObject*)manifold->getBody1(),manifold);
+}
+
+void	btIncrementalIslandManager::addConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint)
+{
+	addEdge(colObj0,colObj1,constraint,false);
+}
+
+void	btIncrementalIslandManager::removeConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint)
+{
+	removeEdge(colObj0,colObj1,constraint);
+}
+
+bool	btIncrementalIslandManager::isTraversable(const btIslandEdge& edge,int node,int otherNode) const
+{
+	const btIslandNode& other = m_nodes[otherNode];
+	if (other.m_seenStamp != m_stamp)
+		return false;
+
+	const btCollisionObject* colObj0 = m_nodes[node].m_object;
+	const btCollisionObject* colObj1 = other.m_object;
+	//same rules as btSimulationIslandManager::findUnions and btDiscreteDynamicsWorld::calculateSimulationIslands
+	if (edge.m_isManifold)
+		return colObj0->mergesSimulationIslands() && colObj1->mergesSimulationIslands();
+	return !colObj0->isStaticOrKinematicObject() && !colObj1->isStaticOrKinematicObject();
+}
+
+void	btIncrementalIslandManager::floodIsland(int seed)
+{
+	btIsland island;
+	island.m_islandId = seed;
+	island.m_firstNode = m_islandNodes.size();
+
+	m_nodes[seed].m_visitStamp = m_stamp;
+	m_stack.push_back(seed);
+	while (m_stack.size())
+	{
+		int node = m_stack[m_stack.size()-1];
+		m_stack.pop_back();
+		m_islandNodes.push_back(node);
+		if (node < island.m_islandId)
+			island.m_islandId = node;
+
+		for (int e = m_nodes[node].m_firstEdge; e >= 0; )
+		{
+			const btIslandEdge& edge = m_edges[e];
+			int side = edge.m_node[0] == node ? 0 : 1;
+			int otherNode = edge.m_node[1-side];
+			if (m_nodes[otherNode].m_visitStamp != m_stamp && isTraversable(edge,node,otherNode))
+			{
+				m_nodes[otherNode].m_visitStamp = m_stamp;
+				m_stack.push_back(otherNode);
+			}
+			e = edge.m_next[side];
+		}
+	}
+
+	island.m_numNodes = m_islandNodes.size() - island.m_firstNode;
+	for (int i=island.m_firstNode;i<m_islandNodes.size();i++)
+	{
+		btCollisionObject* colObj = m_nodes[m_islandNodes[i]].m_object;
+		colObj->setIslandTag(island.m_islandId);
+		colObj->setCompanionId(-1);
+		colObj->setHitFraction(btScalar(1.));
+	}
+	m_islands.push_back(island);
+}
+
+void	btIncrementalIslandManager::updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher)
+{
+	BT_PROFILE("updateIncrementalIslands");
+
+	setDispatcher(dispatcher);
+	if (!m_listening && dispatcher)
+	{
+		//without manifold events the contact edges are rebuilt every step
+		removeManifoldEdges();
+		for (int i=0;i<dispatcher->getNumManifolds();i++)
+		{
+			manifoldCreated(dispatcher->getManifoldByIndexInternal(i));
+		}
+	}
+
+	m_stamp++;
+	m_seedNodes.resize(0);
+	m_kinematicNodes.resize(0);
+
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+	int i;
+	for (i=0;i<collisionObjects.size();i++)
+	{
+		btCollisionObject* colObj = collisionObjects[i];
+		int node = findOrCreateNode(colObj);
+		m_nodes[node].m_seenStamp = m_stamp;
+		if (colObj->isStaticOrKinematicObject())
+		{
+			colObj->setIslandTag(-1);
+			colObj->setCompanionId(-2);
+			if (colObj->isKinematicObject() && colObj->getActivationState() != ISLAND_SLEEPING)
+				m_kinematicNodes.push_back(node);
+		} else if (colObj->getActivationState() != ISLAND_SLEEPING)
+		{
+			m_seedNodes.push_back(node);
+		}
+	}
+
+	//free the nodes of objects that left the world, unless a constraint still refers to them
+	if (m_numLiveNodes - collisionObjects.size() > m_numKeptNodes)
+	{
+		m_numKeptNodes = 0;
+		for (i=0;i<m_nodes.size();i++)
+		{
+			if (m_nodes[i].m_object && m_nodes[i].m_seenStamp != m_stamp)
+			{
+				if (m_nodes[i].m_numEdges)
+				{
+					m_numKeptNodes++;
+				} else
+				{
+					freeNode(i);
+				}
+			}
+		}
+	}
+
+	m_islands.resize(0);
+	m_islandNodes.resize(0);
+	for (int pass=0;pass<2;pass++)
+	{
+		const btAlignedObjectArray<int>& seeds = pass ? m_seedNodes : m_dirtyNodes;
+		for (i=0;i<seeds.size();i++)
+		{
+			int node = seeds[i];
+			const btIslandNode& islandNode = m_nodes[node];
+			if (islandNode.m_object && islandNode.m_seenStamp == m_stamp && islandNode.m_visitStamp != m_stamp &&
+				!islandNode.m_object->isStaticOrKinematicObject())
+			{
+				floodIsland(node);
+			}
+		}
+	}
+	m_dirtyNodes.resize(0);
+}
+
+void	btIncrementalIslandManager::storeIslandActivationState(btCollisionWorld* world)
+{
+	(void)world;
+}
+
+class btIslandSortPredicate
+{
+	public:
+
+		template <class T>
+		SIMD_FORCE_INLINE bool operator() ( const T& lhs, const T& rhs )
+		{
+			return lhs.m_islandId < rhs.m_islandId;
+		}
+};
+
+void	btIncrementalIslandManager::buildAndProcessIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld, IslandCallback* callback)
+{
+	(void)collisionWorld;
+	int i;
+
+	{
+		BT_PROFILE("buildIncrementalIslands");
+
+		//update the sleeping state for bodies, if all are sleeping
+		for (i=0;i<m_islands.size();i++)
+		{
+			const btIsland& island = m_islands[i];
+			const int* nodes = &m_islandNodes[island.m_firstNode];
+			bool allSleeping = true;
+			int n;
+			for (n=0;n<island.m_numNodes;n++)
+			{
+				int state = m_nodes[nodes[n]].m_object->getActivationState();
+				if (state == ACTIVE_TAG || state == DISABLE_DEACTIVATION)
+				{
+					allSleeping = false;
+					break;
+				}
+			}
+
+			for (n=0;n<island.m_numNodes;n++)
+			{
+				btCollisionObject* colObj = m_nodes[nodes[n]].m_object;
+				if (allSleeping)
+				{
+					colObj->setActivationState( ISLAND_SLEEPING );
+				} else if (colObj->getActivationState() == ISLAND_SLEEPING)
+				{
+					colObj->setActivationState( WANTS_DEACTIVATION);
+					colObj->setDeactivationTime(0.f);
+				}
+			}
+		}
+
+		//kinematic objects don't merge islands, but wake up all connected objects
+		for (i=0;i<m_kinematicNodes.size();i++)
+		{
+			int node = m_kinematicNodes[i];
+			for (int e = m_nodes[node].m_firstEdge; e >= 0; )
+			{
+				const btIslandEdge& edge = m_edges[e];
+				int side = edge.m_node[0] == node ? 0 : 1;
+				if (edge.m_isManifold)
+				{
+					m_nodes[edge.m_node[1-side]].m_object->activate();
+				}
+				e = edge.m_next[side];
+			}
+		}
+
+		m_islands.quickSort(btIslandSortPredicate());
+	}
+
+	BT_PROFILE("processIslands");
+
+	//the manifolds of each island are gathered from its edge lists, so they don't need to be sorted
+	for (i=0;i<m_islands.size();i++)
+	{
+		const btIsland& island = m_islands[i];
+		const int* nodes = &m_islandNodes[island.m_firstNode];
+
+		m_islandObjects.resize(0);
+		m_islandManifolds.resize(0);
+		bool islandSleeping = false;
+		for (int n=0;n<island.m_numNodes;n++)
+		{
+			int node = nodes[n];
+			btCollisionObject* colObj = m_nodes[node].m_object;
+			m_islandObjects.push_back(colObj);
+			if (!colObj->isActive())
+			{
+				islandSleeping = true;
+				break;
+			}
+
+			for (int e = m_nodes[node].m_firstEdge; e >= 0; )
+			{
+				const btIslandEdge& edge = m_edges[e];
+				int side = edge.m_node[0] == node ? 0 : 1;
+				const btIslandNode& other = m_nodes[edge.m_node[1-side]];
+				//manifolds inside the island are visited from both ends, take them from their first node
+				bool inIsland = other.m_visitStamp == m_stamp && other.m_object->mergesSimulationIslands() && colObj->mergesSimulationIslands();
+				if (edge.m_isManifold && (side == 0 || !inIsland))
+				{
+					btPersistentManifold* manifold = (btPersistentManifold*)edge.m_key;
+					if (dispatcher->needsResponse(colObj,other.m_object))
+						m_islandManifolds.push_back(manifold);
+				}
+				e = edge.m_next[side];
+			}
+		}
+
+		if (!islandSleeping)
+		{
+			callback->ProcessIsland(&m_islandObjects[0],m_islandObjects.size(),m_islandManifolds.size() ? &m_islandManifolds[0] : 0,m_islandManifolds.size(),island.m_islandId);
+		}
+	}
+}
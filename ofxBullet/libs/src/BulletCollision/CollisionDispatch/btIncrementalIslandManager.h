@@ -0,0 +1,143 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef INCREMENTAL_ISLAND_MANAGER_H
+#define INCREMENTAL_ISLAND_MANAGER_H
+
+#include "btSimulationIslandManager.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+///btIncrementalIslandManager keeps the contact graph between steps, instead of rebuilding a union find over all objects
+///every step. Contact manifolds enter and leave the graph through btDispatcher::setManifoldListener, constraints through
+///addConstraintEdge/removeConstraintEdge. Each step only the islands of awake objects and of objects that gained or lost
+///an edge are flooded, sleeping islands keep their island tags and are not visited.
+///The island id is the smallest node index of the island, so ids stay stable while an island doesn't change.
+///Usage: btDiscreteDynamicsWorld::setSimulationIslandManager. Only change the collision flags of an object while it is
+///not in the world, and destroy the manager before its dispatcher.
+class btIncrementalIslandManager : public btSimulationIslandManager, public btManifoldListener
+{
+	struct btIslandNode
+	{
+		btCollisionObject*	m_object;
+		int		m_firstEdge;
+		int		m_numEdges;
+		///m_stamp of the last step that flooded the node
+		int		m_visitStamp;
+		///m_stamp of the last step that found the object in the world
+		int		m_seenStamp;
+	};
+
+	///a manifold or constraint, linked into the edge lists of both nodes. Free edges have m_node[0] == -1.
+	struct btIslandEdge
+	{
+		const void*	m_key;
+		int		m_node[2];
+		int		m_next[2];
+		int		m_prev[2];
+		bool	m_isManifold;
+	};
+
+	struct btIsland
+	{
+		int		m_islandId;
+		int		m_firstNode;
+		int		m_numNodes;
+	};
+
+	btAlignedObjectArray<btIslandNode>	m_nodes;
+	btAlignedObjectArray<btIslandEdge>	m_edges;
+	int		m_firstFreeNode;
+	int		m_firstFreeEdge;
+	int		m_numLiveNodes;
+	///unseen nodes that were kept by the last sweep, because a constraint still refers to them
+	int		m_numKeptNodes;
+	int		m_stamp;
+
+	///endpoints of edges that were added or removed since the last step
+	btAlignedObjectArray<int>	m_dirtyNodes;
+	///awake dynamic objects found by the last step
+	btAlignedObjectArray<int>	m_seedNodes;
+	btAlignedObjectArray<int>	m_kinematicNodes;
+	btAlignedObjectArray<int>	m_stack;
+
+	///flooded islands, their nodes are stored consecutively in m_islandNodes
+	btAlignedObjectArray<btIsland>	m_islands;
+	btAlignedObjectArray<int>	m_islandNodes;
+	btAlignedObjectArray<btCollisionObject*>	m_islandObjects;
+	btAlignedObjectArray<btPersistentManifold*>	m_islandManifolds;
+
+	btDispatcher*	m_dispatcher;
+	bool	m_listening;
+
+	int		findOrCreateNode(btCollisionObject* colObj);
+
+	int		allocateNode(btCollisionObject* colObj);
+
+	void	freeNode(int node);
+
+	void	addEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* key,bool isManifold);
+
+	void	removeEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* key);
+
+	void	unlinkEdge(int edge);
+
+	void	removeManifoldEdges();
+
+	void	setDispatcher(btDispatcher* dispatcher);
+
+	void	floodIsland(int seed);
+
+	bool	isTraversable(const btIslandEdge& edge,int node,int otherNode) const;
+
+public:
+
+	btIncrementalIslandManager();
+
+	virtual ~btIncrementalIslandManager();
+
+	virtual	void	updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher);
+
+	///the island tags are stored by updateActivationState
+	virtual	void	storeIslandActivationState(btCollisionWorld* world);
+
+	virtual	void	buildAndProcessIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld, IslandCallback* callback);
+
+	virtual	bool	isIncremental() const
+	{
+		return true;
+	}
+
+	virtual	void	addConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint);
+
+	virtual	void	removeConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint);
+
+	virtual void	manifoldCreated(btPersistentManifold* manifold);
+
+	virtual void	manifoldReleased(btPersistentManifold* manifold);
+
+	///number of objects flooded by the last step
+	int		getNumVisitedObjects() const
+	{
+		return m_islandNodes.size();
+	}
+
+	int		getNumIslandNodes() const
+	{
+		return m_numLiveNodes;
+	}
+};
+
+#endif //INCREMENTAL_ISLAND_MANAGER_H
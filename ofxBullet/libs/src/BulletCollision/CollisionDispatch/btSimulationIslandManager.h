@@ -61,7 +61,29 @@ public:
 		virtual	void	ProcessIsland(btCollisionObject** bodies,int numBodies,class btPersistentManifold**	manifolds,int numManifolds, int islandId) = 0;
 	};
 
-	void	buildAndProcessIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld, IslandCallback* callback);
+	virtual	void	buildAndProcessIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld, IslandCallback* callback);
+
+	///returns true when the manager keeps the constraint edges between steps, see addConstraintEdge.
+	///Otherwise btDiscreteDynamicsWorld unites the islands of constrained bodies every step.
+	virtual	bool	isIncremental() const
+	{
+		return false;
+	}
+
+	///called by btDiscreteDynamicsWorld when a constraint between two objects is added or removed
+	virtual	void	addConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint)
+	{
+		(void)colObj0;
+		(void)colObj1;
+		(void)constraint;
+	}
+
+	virtual	void	removeConstraintEdge(btCollisionObject* colObj0,btCollisionObject* colObj1,const void* constraint)
+	{
+		(void)colObj0;
+		(void)colObj1;
+		(void)constraint;
+	}
 
 	void buildIslands(btDispatcher* dispatcher,btCollisionWorld* colWorld);
 
@@ -17,6 +17,7 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 ///Bvh Concave triangle mesh is a static-triangle mesh shape with Bounding Volume Hierarchy optimization.
 ///Uses an interface to access the triangles to allow for sharing graphics/physics triangles.
@@ -26,6 +27,7 @@ m_bvh(0),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
 #ifndef DISABLE_BVH
@@ -58,6 +60,7 @@ m_bvh(0),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
 #ifndef DISABLE_BVH
@@ -100,17 +103,24 @@ btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 	}
 }
 
-void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget)
+void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
 	{
 		btStridingMeshInterface*	m_meshInterface;
 		btTriangleCallback* m_callback;
+		const btScalar*	m_closestHitFraction;
 
-		MyNodeOverlapCallback(btTriangleCallback* callback,btStridingMeshInterface* meshInterface)
+		MyNodeOverlapCallback(btTriangleCallback* callback,btStridingMeshInterface* meshInterface,const btScalar* closestHitFraction)
 			:m_meshInterface(meshInterface),
-			m_callback(callback)
+			m_callback(callback),
+			m_closestHitFraction(closestHitFraction)
+		{
+		}
+
+		virtual btScalar getClosestHitFraction() const
 		{
+			return m_closestHitFraction ? *m_closestHitFraction : btScalar(1.);
 		}
 				
 		virtual void processNode(int nodeSubPart, int nodeTriangleIndex)
@@ -164,22 +174,29 @@ void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const
 		}
 	};
 
-	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
+	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface,closestHitFraction);
 
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget);
 }
 
-void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
+void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, const btScalar* closestHitFraction)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
 	{
 		btStridingMeshInterface*	m_meshInterface;
 		btTriangleCallback* m_callback;
+		const btScalar*	m_closestHitFraction;
 
-		MyNodeOverlapCallback(btTriangleCallback* callback,btStridingMeshInterface* meshInterface)
+		MyNodeOverlapCallback(btTriangleCallback* callback,btStridingMeshInterface* meshInterface,const btScalar* closestHitFraction)
 			:m_meshInterface(meshInterface),
-			m_callback(callback)
+			m_callback(callback),
+			m_closestHitFraction(closestHitFraction)
+		{
+		}
+
+		virtual btScalar getClosestHitFraction() const
 		{
+			return m_closestHitFraction ? *m_closestHitFraction : btScalar(1.);
 		}
 				
 		virtual void processNode(int nodeSubPart, int nodeTriangleIndex)
@@ -233,7 +250,7 @@ void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, co
 		}
 	};
 
-	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
+	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface,closestHitFraction);
 
 	m_bvh->reportBoxCastOverlappingNodex (&myNodeCallback, raySource, rayTarget, aabbMin, aabbMax);
 }
@@ -340,6 +357,7 @@ void	btBvhTriangleMeshShape::processAllTriangles(btTriangleCallback* callback,co
 
 void   btBvhTriangleMeshShape::setLocalScaling(const btVector3& scaling)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
    if ((getLocalScaling() -scaling).length2() > SIMD_EPSILON)
    {
       btTriangleMeshShape::setLocalScaling(scaling);
@@ -52,8 +52,10 @@ public:
 
 
 	
-	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget);
-	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
+	///closestHitFraction optionally points to the hit fraction that the callback lowers with each hit, for example
+	///btTriangleRaycastCallback::m_hitFraction. Nodes beyond it are skipped.
+	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction=0);
+	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax, const btScalar* closestHitFraction=0);
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
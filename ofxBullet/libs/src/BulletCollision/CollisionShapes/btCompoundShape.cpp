@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btCompoundShape.h"
 #include "btCollisionShape.h"
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 btCompoundShape::btCompoundShape(bool enableDynamicAabbTree)
 : m_localAabbMin(btScalar(1e30),btScalar(1e30),btScalar(1e30)),
@@ -24,6 +25,7 @@ m_collisionMargin(btScalar(0.)),
 m_localScaling(btScalar(1.),btScalar(1.),btScalar(1.)),
 m_dynamicAabbTree(0)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_shapeType = COMPOUND_SHAPE_PROXYTYPE;
 
 	if (enableDynamicAabbTree)
@@ -46,6 +48,7 @@ btCompoundShape::~btCompoundShape()
 
 void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisionShape* shape)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	//m_childTransforms.push_back(localTransform);
 	//m_childShapes.push_back(shape);
 	btCompoundShapeChild child;
@@ -53,6 +56,7 @@ void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisio
 	child.m_childShape = shape;
 	child.m_childShapeType = shape->getShapeType();
 	child.m_childMargin = shape->getMargin();
+	child.m_node = 0;
 
 	m_children.push_back(child);
 
@@ -75,7 +79,7 @@ void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisio
 	{
 		const btDbvtVolume	bounds=btDbvtVolume::FromMM(localAabbMin,localAabbMax);
 		int index = m_children.size()-1;
-		child.m_node = m_dynamicAabbTree->insert(bounds,(void*)index);
+		m_children[index].m_node = m_dynamicAabbTree->insert(bounds,(void*)index);
 	}
 
 }
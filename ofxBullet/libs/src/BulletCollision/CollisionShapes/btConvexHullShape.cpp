@@ -16,11 +16,13 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btCollisionMargin.h"
 
 #include "LinearMath/btQuaternion.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 
 
 btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int stride) : btPolyhedralConvexShape ()
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_shapeType = CONVEX_HULL_SHAPE_PROXYTYPE;
 	m_unscaledPoints.resize(numPoints);
 
@@ -28,8 +30,9 @@ btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int
 
 	for (int i=0;i<numPoints;i++)
 	{
-		btVector3* point = (btVector3*)(pointsBaseAddress + i*stride);
-		m_unscaledPoints[i] = point[0];
+		//the points may be packed or strided, so read the components instead of copying an aligned btVector3
+		btScalar* point = (btScalar*)(pointsBaseAddress + i*stride);
+		m_unscaledPoints[i] = btVector3(point[0], point[1], point[2]);
 	}
 
 	recalcLocalAabb();
@@ -46,6 +49,7 @@ void btConvexHullShape::setLocalScaling(const btVector3& scaling)
 
 void btConvexHullShape::addPoint(const btVector3& point)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_unscaledPoints.push_back(point);
 	recalcLocalAabb();
 
@@ -54,8 +58,6 @@ void btConvexHullShape::addPoint(const btVector3& point)
 btVector3	btConvexHullShape::localGetSupportingVertexWithoutMargin(const btVector3& vec0)const
 {
 	btVector3 supVec(btScalar(0.),btScalar(0.),btScalar(0.));
-	btScalar newDot,maxDot = btScalar(-1e30);
-
 	btVector3 vec = vec0;
 	btScalar lenSqr = vec.length2();
 	if (lenSqr < btScalar(0.0001))
@@ -68,15 +70,15 @@ btVector3	btConvexHullShape::localGetSupportingVertexWithoutMargin(const btVecto
 	}
 
 
-	for (int i=0;i<m_unscaledPoints.size();i++)
+	if (m_unscaledPoints.size() > 0)
 	{
-		btVector3 vtx = m_unscaledPoints[i] * m_localScaling;
-
-		newDot = vec.dot(vtx);
-		if (newDot > maxDot)
+		//search the unscaled points along the scaled direction, this uses the dispatched SIMD kernel
+		btVector3 scaledVec = vec * m_localScaling;
+		btScalar maxDot;
+		long ptIndex = scaledVec.maxDot(&m_unscaledPoints[0], m_unscaledPoints.size(), maxDot);
+		if (ptIndex >= 0)
 		{
-			maxDot = newDot;
-			supVec = vtx;
+			supVec = m_unscaledPoints[ptIndex] * m_localScaling;
 		}
 	}
 	return supVec;
@@ -84,34 +86,31 @@ btVector3	btConvexHullShape::localGetSupportingVertexWithoutMargin(const btVecto
 
 void	btConvexHullShape::batchedUnitVectorGetSupportingVertexWithoutMargin(const btVector3* vectors,btVector3* supportVerticesOut,int numVectors) const
 {
-	btScalar newDot;
-	//use 'w' component of supportVerticesOut?
+	if (m_unscaledPoints.size() <= 0)
 	{
-		for (int i=0;i<numVectors;i++)
+		for (int j=0;j<numVectors;j++)
 		{
-			supportVerticesOut[i][3] = btScalar(-1e30);
+			supportVerticesOut[j].setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+			supportVerticesOut[j][3] = btScalar(-1e30);
 		}
+		return;
 	}
-	for (int i=0;i<m_unscaledPoints.size();i++)
+	for (int j=0;j<numVectors;j++)
 	{
-		btVector3 vtx = getScaledPoint(i);
-
-		for (int j=0;j<numVectors;j++)
+		btVector3 scaledVec = vectors[j] * m_localScaling;
+		btScalar maxDot;
+		long ptIndex = scaledVec.maxDot(&m_unscaledPoints[0], m_unscaledPoints.size(), maxDot);
+		if (ptIndex >= 0)
 		{
-			const btVector3& vec = vectors[j];
-			
-			newDot = vec.dot(vtx);
-			if (newDot > supportVerticesOut[j][3])
-			{
-				//WARNING: don't swap next lines, the w component would get overwritten!
-				supportVerticesOut[j] = vtx;
-				supportVerticesOut[j][3] = newDot;
-			}
+			//WARNING: don't swap next lines, the w component would get overwritten!
+			supportVerticesOut[j] = m_unscaledPoints[ptIndex] * m_localScaling;
+			supportVerticesOut[j][3] = maxDot;
+		} else
+		{
+			supportVerticesOut[j].setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+			supportVerticesOut[j][3] = btScalar(-1e30);
 		}
 	}
-
-
-
 }
 	
 
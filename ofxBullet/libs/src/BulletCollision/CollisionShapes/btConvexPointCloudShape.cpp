@@ -27,8 +27,6 @@ void btConvexPointCloudShape::setLocalScaling(const btVector3& scaling)
 btVector3	btConvexPointCloudShape::localGetSupportingVertexWithoutMargin(const btVector3& vec0)const
 {
 	btVector3 supVec(btScalar(0.),btScalar(0.),btScalar(0.));
-	btScalar newDot,maxDot = btScalar(-1e30);
-
 	btVector3 vec = vec0;
 	btScalar lenSqr = vec.length2();
 	if (lenSqr < btScalar(0.0001))
@@ -41,15 +39,15 @@ btVector3	btConvexPointCloudShape::localGetSupportingVertexWithoutMargin(const b
 	}
 
 
-	for (int i=0;i<m_numPoints;i++)
+	if (m_numPoints > 0)
 	{
-		btVector3 vtx = getScaledPoint(i);
-
-		newDot = vec.dot(vtx);
-		if (newDot > maxDot)
+		//search the unscaled points along the scaled direction, this uses the dispatched SIMD kernel
+		btVector3 scaledVec = vec * m_localScaling;
+		btScalar maxDot;
+		long ptIndex = scaledVec.maxDot(m_unscaledPoints, m_numPoints, maxDot);
+		if (ptIndex >= 0)
 		{
-			maxDot = newDot;
-			supVec = vtx;
+			supVec = m_unscaledPoints[ptIndex] * m_localScaling;
 		}
 	}
 	return supVec;
@@ -57,34 +55,31 @@ btVector3	btConvexPointCloudShape::localGetSupportingVertexWithoutMargin(const b
 
 void	btConvexPointCloudShape::batchedUnitVectorGetSupportingVertexWithoutMargin(const btVector3* vectors,btVector3* supportVerticesOut,int numVectors) const
 {
-	btScalar newDot;
-	//use 'w' component of supportVerticesOut?
+	if (m_numPoints <= 0)
 	{
-		for (int i=0;i<numVectors;i++)
+		for (int j=0;j<numVectors;j++)
 		{
-			supportVerticesOut[i][3] = btScalar(-1e30);
+			supportVerticesOut[j].setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+			supportVerticesOut[j][3] = btScalar(-1e30);
 		}
+		return;
 	}
-	for (int i=0;i<m_numPoints;i++)
+	for (int j=0;j<numVectors;j++)
 	{
-		btVector3 vtx = getScaledPoint(i);
-
-		for (int j=0;j<numVectors;j++)
+		btVector3 scaledVec = vectors[j] * m_localScaling;
+		btScalar maxDot;
+		long ptIndex = scaledVec.maxDot(m_unscaledPoints, m_numPoints, maxDot);
+		if (ptIndex >= 0)
 		{
-			const btVector3& vec = vectors[j];
-			
-			newDot = vec.dot(vtx);
-			if (newDot > supportVerticesOut[j][3])
-			{
-				//WARNING: don't swap next lines, the w component would get overwritten!
-				supportVerticesOut[j] = vtx;
-				supportVerticesOut[j][3] = newDot;
-			}
+			//WARNING: don't swap next lines, the w component would get overwritten!
+			supportVerticesOut[j] = m_unscaledPoints[ptIndex] * m_localScaling;
+			supportVerticesOut[j][3] = maxDot;
+		} else
+		{
+			supportVerticesOut[j].setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+			supportVerticesOut[j][3] = btScalar(-1e30);
 		}
 	}
-
-
-
 }
 	
 
@@ -0,0 +1,410 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMappedBvhFile.h"
+#include "btOptimizedBvh.h"
+#include "btTriangleIndexVertexArray.h"
+#include "LinearMath/btAlignedAllocator.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char			MAPPED_BVH_MAGIC[8] = {'B','T','B','V','H','M','A','P'};
+static const int			MAPPED_BVH_ENDIAN_TAG = 0x01020304;
+static const int			MAPPED_BVH_SWAPPED_ENDIAN_TAG = 0x04030201;
+static const unsigned int	MAPPED_BVH_ALIGNMENT_MASK = 15;
+
+
+///reserves count*elementSize bytes at the next aligned offset, fails if the file would exceed 4GB
+static bool	btReserveMappedSection(unsigned int& fileSize, unsigned int count, unsigned int elementSize, unsigned int& sectionOffset)
+{
+	unsigned int offset = (fileSize + MAPPED_BVH_ALIGNMENT_MASK) & ~MAPPED_BVH_ALIGNMENT_MASK;
+	if (offset < fileSize)
+		return false;
+	if (elementSize && count > (0xffffffffu - offset) / elementSize)
+		return false;
+	sectionOffset = offset;
+	fileSize = offset + count * elementSize;
+	return true;
+}
+
+static bool	btMappedSectionInFile(unsigned int offset, int count, unsigned int elementSize, unsigned int fileSize)
+{
+	if (count < 0 || offset > fileSize || (offset & MAPPED_BVH_ALIGNMENT_MASK))
+		return false;
+	return !elementSize || (unsigned int)count <= (fileSize - offset) / elementSize;
+}
+
+static bool	btWriteMappedPadding(FILE* file, unsigned int& position, unsigned int offset)
+{
+	static const unsigned char zeros[16] = {0};
+	btAssert(offset >= position && offset - position <= sizeof(zeros));
+	if (offset > position && fwrite(zeros, 1, offset - position, file) != offset - position)
+		return false;
+	position = offset;
+	return true;
+}
+
+static int	btMappedIndexSize(PHY_ScalarType indexType)
+{
+	switch (indexType)
+	{
+	case PHY_INTEGER:
+		return sizeof(int);
+	case PHY_SHORT:
+		return sizeof(unsigned short);
+	default:
+		return 0;
+	}
+}
+
+
+
+btMappedBvhFile::btMappedBvhFile()
+:m_data(0),
+m_size(0),
+m_optimizedBvh(0),
+m_meshInterface(0)
+{
+}
+
+btMappedBvhFile::~btMappedBvhFile()
+{
+	close();
+}
+
+bool	btMappedBvhFile::writeFile(const char* fileName, btOptimizedBvh* bvh, const btTriangleIndexVertexArray* meshInterface)
+{
+	btAssert(bvh && meshInterface);
+
+	int numParts = meshInterface->getNumSubParts();
+
+	btMappedBvhFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.m_magic, MAPPED_BVH_MAGIC, sizeof(MAPPED_BVH_MAGIC));
+	header.m_endianTag = MAPPED_BVH_ENDIAN_TAG;
+	header.m_bulletVersion = BT_BULLET_VERSION;
+	header.m_headerSize = sizeof(btMappedBvhFileHeader);
+	header.m_partSize = sizeof(btMappedBvhFilePart);
+	header.m_bvhObjectSize = sizeof(btQuantizedBvh);
+	header.m_scalarSize = sizeof(btScalar);
+	header.m_numParts = numParts;
+
+	btAlignedObjectArray<btMappedBvhFilePart> parts;
+	parts.resize(numParts);
+
+	unsigned int fileSize = sizeof(btMappedBvhFileHeader) + numParts * sizeof(btMappedBvhFilePart);
+
+	btVector3 meshScaling = meshInterface->getScaling();
+	btVector3 aabbMin(btScalar(1e30),btScalar(1e30),btScalar(1e30));
+	btVector3 aabbMax(btScalar(-1e30),btScalar(-1e30),btScalar(-1e30));
+
+	int i;
+	for (i=0;i<numParts;i++)
+	{
+		const unsigned char* vertexBase;
+		const unsigned char* indexBase;
+		int numVertices,vertexStride,indexStride,numTriangles;
+		PHY_ScalarType vertexType,indexType;
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexBase,numVertices,vertexType,vertexStride,&indexBase,indexStride,numTriangles,indexType,i);
+
+		btMappedBvhFilePart& part = parts[i];
+		memset(&part, 0, sizeof(part));
+		int indexSize = btMappedIndexSize(indexType);
+		part.m_numTriangles = numTriangles;
+		part.m_indexType = indexType;
+		part.m_triangleIndexStride = 3*indexSize;
+		part.m_numVertices = numVertices;
+		part.m_vertexStride = 3*sizeof(btScalar);
+
+		bool ok = indexSize && (vertexType == PHY_FLOAT || vertexType == PHY_DOUBLE) &&
+			btReserveMappedSection(fileSize, numTriangles, part.m_triangleIndexStride, part.m_indexOffset) &&
+			btReserveMappedSection(fileSize, numVertices, part.m_vertexStride, part.m_vertexOffset);
+
+		if (ok && !meshInterface->hasPremadeAabb())
+		{
+			for (int v=0;v<numVertices;v++)
+			{
+				btVector3 vertex;
+				if (vertexType == PHY_FLOAT)
+				{
+					const float* graphicsbase = (const float*)(vertexBase+v*vertexStride);
+					vertex.setValue(graphicsbase[0],graphicsbase[1],graphicsbase[2]);
+				} else
+				{
+					const double* graphicsbase = (const double*)(vertexBase+v*vertexStride);
+					vertex.setValue(btScalar(graphicsbase[0]),btScalar(graphicsbase[1]),btScalar(graphicsbase[2]));
+				}
+				vertex *= meshScaling;
+				aabbMin.setMin(vertex);
+				aabbMax.setMax(vertex);
+			}
+		}
+		meshInterface->unLockReadOnlyVertexBase(i);
+		if (!ok)
+			return false;
+	}
+
+	if (meshInterface->hasPremadeAabb())
+	{
+		meshInterface->getPremadeAabb(&aabbMin,&aabbMax);
+	}
+	for (i=0;i<3;i++)
+	{
+		header.m_meshScaling[i] = meshScaling[i];
+		header.m_meshAabbMin[i] = aabbMin[i];
+		header.m_meshAabbMax[i] = aabbMax[i];
+	}
+
+	header.m_bvhSize = bvh->calculateSerializeBufferSize();
+	if (!btReserveMappedSection(fileSize, header.m_bvhSize, 1, header.m_bvhOffset))
+		return false;
+	header.m_fileSize = fileSize;
+
+	void* bvhBuffer = btAlignedAlloc(header.m_bvhSize,16);
+	bvh->serialize(bvhBuffer,header.m_bvhSize,false);
+
+	FILE* file = fopen(fileName,"wb");
+	bool ok = file != 0;
+	unsigned int position = sizeof(btMappedBvhFileHeader) + numParts * sizeof(btMappedBvhFilePart);
+	if (ok)
+	{
+		ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			(!numParts || fwrite(&parts[0], sizeof(btMappedBvhFilePart), numParts, file) == (size_t)numParts);
+	}
+
+	// indices and vertices are written packed, with btScalar vertices, so the loader can point the btIndexedMesh into the file
+	for (i=0;ok && i<numParts;i++)
+	{
+		const unsigned char* vertexBase;
+		const unsigned char* indexBase;
+		int numVertices,vertexStride,indexStride,numTriangles;
+		PHY_ScalarType vertexType,indexType;
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexBase,numVertices,vertexType,vertexStride,&indexBase,indexStride,numTriangles,indexType,i);
+
+		const btMappedBvhFilePart& part = parts[i];
+		ok = btWriteMappedPadding(file, position, part.m_indexOffset);
+		for (int t=0;ok && t<numTriangles;t++)
+		{
+			ok = fwrite(indexBase+t*indexStride, part.m_triangleIndexStride, 1, file) == 1;
+		}
+		position += numTriangles * part.m_triangleIndexStride;
+
+		ok = ok && btWriteMappedPadding(file, position, part.m_vertexOffset);
+		for (int v=0;ok && v<numVertices;v++)
+		{
+			btScalar vertex[3];
+			if (vertexType == PHY_FLOAT)
+			{
+				const float* graphicsbase = (const float*)(vertexBase+v*vertexStride);
+				vertex[0] = graphicsbase[0];
+				vertex[1] = graphicsbase[1];
+				vertex[2] = graphicsbase[2];
+			} else
+			{
+				const double* graphicsbase = (const double*)(vertexBase+v*vertexStride);
+				vertex[0] = btScalar(graphicsbase[0]);
+				vertex[1] = btScalar(graphicsbase[1]);
+				vertex[2] = btScalar(graphicsbase[2]);
+			}
+			ok = fwrite(vertex, sizeof(vertex), 1, file) == 1;
+		}
+		position += numVertices * part.m_vertexStride;
+
+		meshInterface->unLockReadOnlyVertexBase(i);
+	}
+
+	ok = ok && btWriteMappedPadding(file, position, header.m_bvhOffset) &&
+		fwrite(bvhBuffer, header.m_bvhSize, 1, file) == 1;
+
+	if (file && fclose(file) != 0)
+		ok = false;
+	btAlignedFree(bvhBuffer);
+	return ok;
+}
+
+btMappedBvhFile::btMappedBvhStatus	btMappedBvhFile::validateHeader() const
+{
+	if (m_size < sizeof(btMappedBvhFileHeader))
+		return MAPPED_BVH_TRUNCATED;
+
+	const btMappedBvhFileHeader* header = (const btMappedBvhFileHeader*)m_data;
+	if (memcmp(header->m_magic, MAPPED_BVH_MAGIC, sizeof(MAPPED_BVH_MAGIC)) != 0)
+		return MAPPED_BVH_BAD_HEADER;
+	if (header->m_endianTag == MAPPED_BVH_SWAPPED_ENDIAN_TAG)
+		return MAPPED_BVH_WRONG_ENDIAN;
+	if (header->m_endianTag != MAPPED_BVH_ENDIAN_TAG)
+		return MAPPED_BVH_BAD_HEADER;
+	if (header->m_bulletVersion != BT_BULLET_VERSION)
+		return MAPPED_BVH_WRONG_VERSION;
+	if (header->m_headerSize != sizeof(btMappedBvhFileHeader) ||
+		header->m_partSize != sizeof(btMappedBvhFilePart) ||
+		header->m_bvhObjectSize != sizeof(btQuantizedBvh) ||
+		header->m_scalarSize != sizeof(btScalar))
+		return MAPPED_BVH_WRONG_LAYOUT;
+	// the part count bound below subtracts the header size, a file size smaller than the header would wrap around
+	if (header->m_fileSize < sizeof(btMappedBvhFileHeader) || header->m_fileSize > m_size)
+		return MAPPED_BVH_TRUNCATED;
+
+	unsigned int fileSize = header->m_fileSize;
+	if (header->m_numParts < 0 || (unsigned int)header->m_numParts > (fileSize - sizeof(btMappedBvhFileHeader)) / sizeof(btMappedBvhFilePart))
+		return MAPPED_BVH_TRUNCATED;
+
+	const btMappedBvhFilePart* parts = (const btMappedBvhFilePart*)(header+1);
+	for (int i=0;i<header->m_numParts;i++)
+	{
+		const btMappedBvhFilePart& part = parts[i];
+		int indexSize = btMappedIndexSize(PHY_ScalarType(part.m_indexType));
+		if (!indexSize || part.m_triangleIndexStride != 3*indexSize || part.m_vertexStride != int(3*sizeof(btScalar)))
+			return MAPPED_BVH_BAD_HEADER;
+		if (!btMappedSectionInFile(part.m_indexOffset, part.m_numTriangles, part.m_triangleIndexStride, fileSize) ||
+			!btMappedSectionInFile(part.m_vertexOffset, part.m_numVertices, part.m_vertexStride, fileSize))
+			return MAPPED_BVH_TRUNCATED;
+	}
+
+	if (header->m_bvhSize > 0x7fffffffu || !btMappedSectionInFile(header->m_bvhOffset, int(header->m_bvhSize), 1, fileSize))
+		return MAPPED_BVH_TRUNCATED;
+
+	return MAPPED_BVH_OK;
+}
+
+btMappedBvhFile::btMappedBvhStatus	btMappedBvhFile::open(const char* fileName)
+{
+	close();
+
+#if defined(WIN32) || defined(_WIN32)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return MAPPED_BVH_CANNOT_OPEN;
+	DWORD sizeHigh = 0;
+	DWORD size = GetFileSize(file, &sizeHigh);
+	if (size == INVALID_FILE_SIZE || sizeHigh != 0 || size < sizeof(btMappedBvhFileHeader))
+	{
+		CloseHandle(file);
+		return (size == INVALID_FILE_SIZE || sizeHigh != 0) ? MAPPED_BVH_CANNOT_OPEN : MAPPED_BVH_TRUNCATED;
+	}
+	// the view keeps the mapping and the file alive, both handles can be closed right away
+	HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+	if (!mapping)
+		return MAPPED_BVH_CANNOT_OPEN;
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data)
+		return MAPPED_BVH_CANNOT_OPEN;
+#else
+	int file = ::open(fileName, O_RDONLY);
+	if (file < 0)
+		return MAPPED_BVH_CANNOT_OPEN;
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || (unsigned long long)fileStat.st_size > 0xffffffffull)
+	{
+		::close(file);
+		return MAPPED_BVH_CANNOT_OPEN;
+	}
+	unsigned int size = (unsigned int)fileStat.st_size;
+	if (size < sizeof(btMappedBvhFileHeader))
+	{
+		::close(file);
+		return MAPPED_BVH_TRUNCATED;
+	}
+	// a shared read-only mapping is backed by the page cache, other processes mapping the file use the same pages
+	void* data = mmap(0, size, PROT_READ, MAP_SHARED, file, 0);
+	::close(file);
+	if (data == MAP_FAILED)
+		return MAPPED_BVH_CANNOT_OPEN;
+#endif
+
+	m_data = (const unsigned char*)data;
+	m_size = size;
+
+	btMappedBvhStatus status = validateHeader();
+	if (status != MAPPED_BVH_OK)
+	{
+		close();
+		return status;
+	}
+
+	const btMappedBvhFileHeader* header = (const btMappedBvhFileHeader*)m_data;
+
+	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
+	m_optimizedBvh = new (mem) btOptimizedBvh();
+	if (!m_optimizedBvh->deSerializeReadOnly(m_data + header->m_bvhOffset, header->m_bvhSize))
+	{
+		close();
+		return MAPPED_BVH_WRONG_LAYOUT;
+	}
+
+	mem = btAlignedAlloc(sizeof(btTriangleIndexVertexArray),16);
+	m_meshInterface = new (mem) btTriangleIndexVertexArray();
+
+	const btMappedBvhFilePart* parts = (const btMappedBvhFilePart*)(header+1);
+	for (int i=0;i<header->m_numParts;i++)
+	{
+		const btMappedBvhFilePart& part = parts[i];
+		btIndexedMesh mesh;
+		mesh.m_numTriangles = part.m_numTriangles;
+		mesh.m_triangleIndexBase = m_data + part.m_indexOffset;
+		mesh.m_triangleIndexStride = part.m_triangleIndexStride;
+		mesh.m_numVertices = part.m_numVertices;
+		mesh.m_vertexBase = m_data + part.m_vertexOffset;
+		mesh.m_vertexStride = part.m_vertexStride;
+		m_meshInterface->addIndexedMesh(mesh,PHY_ScalarType(part.m_indexType));
+	}
+	m_meshInterface->setScaling(btVector3(header->m_meshScaling[0],header->m_meshScaling[1],header->m_meshScaling[2]));
+	m_meshInterface->setPremadeAabb(btVector3(header->m_meshAabbMin[0],header->m_meshAabbMin[1],header->m_meshAabbMin[2]),
+		btVector3(header->m_meshAabbMax[0],header->m_meshAabbMax[1],header->m_meshAabbMax[2]));
+
+	return MAPPED_BVH_OK;
+}
+
+void	btMappedBvhFile::close()
+{
+	if (m_meshInterface)
+	{
+		m_meshInterface->~btTriangleIndexVertexArray();
+		btAlignedFree(m_meshInterface);
+		m_meshInterface = 0;
+	}
+	if (m_optimizedBvh)
+	{
+		m_optimizedBvh->~btOptimizedBvh();
+		btAlignedFree(m_optimizedBvh);
+		m_optimizedBvh = 0;
+	}
+	if (m_data)
+	{
+#if defined(WIN32) || defined(_WIN32)
+		UnmapViewOfFile(m_data);
+#else
+		munmap((void*)m_data, m_size);
+#endif
+		m_data = 0;
+		m_size = 0;
+	}
+}
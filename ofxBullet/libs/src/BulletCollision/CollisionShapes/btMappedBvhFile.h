@@ -0,0 +1,139 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef MAPPED_BVH_FILE_H
+#define MAPPED_BVH_FILE_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btVector3.h"
+
+class btOptimizedBvh;
+class btTriangleIndexVertexArray;
+
+///file header of a btMappedBvhFile, followed by m_numParts btMappedBvhFilePart entries.
+///All offsets are relative to the start of the file and aligned to 16 bytes.
+struct btMappedBvhFileHeader
+{
+	char			m_magic[8];
+	///MAPPED_BVH_ENDIAN_TAG in the byte order of the writer
+	int				m_endianTag;
+	int				m_bulletVersion;
+	///sizes of the serialized objects, to detect files written by a build with a different layout
+	int				m_headerSize;
+	int				m_partSize;
+	int				m_bvhObjectSize;
+	int				m_scalarSize;
+	int				m_numParts;
+	unsigned int	m_bvhOffset;
+	unsigned int	m_bvhSize;
+	unsigned int	m_fileSize;
+	int				m_padding[2];
+	btScalar		m_meshScaling[4];
+	btScalar		m_meshAabbMin[4];
+	btScalar		m_meshAabbMax[4];
+};
+
+///one btIndexedMesh of the btTriangleIndexVertexArray. Indices are stored packed, 3 per triangle,
+///vertices as 3 packed btScalar.
+struct btMappedBvhFilePart
+{
+	int				m_numTriangles;
+	int				m_indexType;
+	int				m_triangleIndexStride;
+	unsigned int	m_indexOffset;
+	int				m_numVertices;
+	int				m_vertexStride;
+	unsigned int	m_vertexOffset;
+	int				m_padding;
+};
+
+///btMappedBvhFile stores a btOptimizedBvh together with the vertex and index arrays of its btTriangleIndexVertexArray in one file,
+///and maps such a file read-only into memory. The bvh and mesh returned by getOptimizedBvh and getMeshInterface point directly
+///into the mapped pages: loading doesn't copy or touch the data, and all processes that map the same file share one physical copy.
+///Files are written in the native byte order and layout, open rejects files from another Bullet version, byte order or scalar precision.
+///Usage:
+///	btMappedBvhFile file;
+///	if (file.open("level.bvh") == btMappedBvhFile::MAPPED_BVH_OK)
+///	{
+///		btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(file.getMeshInterface(),true,false);
+///		shape->setOptimizedBvh(file.getOptimizedBvh(),file.getMeshInterface()->getScaling());
+///	}
+///The file must stay open while the shape is used. The mapped mesh and bvh are read-only, don't refit them.
+///open checks the header and that all arrays lie inside the file, but not the triangle indices themselves: only map trusted files.
+class btMappedBvhFile
+{
+public:
+
+	enum btMappedBvhStatus
+	{
+		MAPPED_BVH_OK=0,
+		MAPPED_BVH_CANNOT_OPEN,
+		MAPPED_BVH_BAD_HEADER,
+		MAPPED_BVH_WRONG_ENDIAN,
+		MAPPED_BVH_WRONG_VERSION,
+		MAPPED_BVH_WRONG_LAYOUT,
+		MAPPED_BVH_TRUNCATED
+	};
+
+	btMappedBvhFile();
+
+	virtual ~btMappedBvhFile();
+
+	///writeFile stores the bvh and the mesh it was built from. Returns false if the file can't be written
+	///or doesn't fit in 4GB.
+	static bool	writeFile(const char* fileName, btOptimizedBvh* bvh, const btTriangleIndexVertexArray* meshInterface);
+
+	///open maps the file read-only and validates the header, a previously opened file is closed first.
+	btMappedBvhStatus	open(const char* fileName);
+
+	void	close();
+
+	bool	isOpen() const
+	{
+		return m_optimizedBvh != 0;
+	}
+
+	///the bvh and mesh are owned by the btMappedBvhFile and destroyed by close
+	btOptimizedBvh*	getOptimizedBvh()
+	{
+		return m_optimizedBvh;
+	}
+
+	btTriangleIndexVertexArray*	getMeshInterface()
+	{
+		return m_meshInterface;
+	}
+
+	const unsigned char*	getMappedData() const
+	{
+		return m_data;
+	}
+
+	unsigned int	getMappedSize() const
+	{
+		return m_size;
+	}
+
+private:
+
+	btMappedBvhStatus	validateHeader() const;
+
+	const unsigned char*		m_data;
+	unsigned int				m_size;
+	btOptimizedBvh*				m_optimizedBvh;
+	btTriangleIndexVertexArray*	m_meshInterface;
+};
+
+#endif //MAPPED_BVH_FILE_H
@@ -28,7 +28,7 @@ btOptimizedBvh::~btOptimizedBvh()
 }
 
 
-void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax)
+void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, bool useQuadTree)
 {
 	m_useQuantization = useQuantizedAabbCompression;
 
@@ -197,6 +197,14 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 	//PCK: clear m_quantizedLeafNodes and m_leafNodes, they are temporary
 	m_quantizedLeafNodes.clear();
 	m_leafNodes.clear();
+
+	if (useQuadTree && m_useQuantization)
+	{
+		buildQuadTree();
+	} else
+	{
+		clearQuadTree();
+	}
 }
 
 
@@ -220,6 +228,8 @@ void	btOptimizedBvh::refit(btStridingMeshInterface* meshInterface,const btVector
 			subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
 		}
 
+		refitQuadTree(0,m_curNodeIndex);
+
 	} else
 	{
 
@@ -263,6 +273,9 @@ void	btOptimizedBvh::refitPartial(btStridingMeshInterface* meshInterface,const b
 			updateBvhNodes(meshInterface,subtree.m_rootNodeIndex,subtree.m_rootNodeIndex+subtree.m_subtreeSize,i);
 
 			subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
+
+			//the quad tree copies the node boxes, only the quad nodes over this subtree are updated
+			refitQuadTree(subtree.m_rootNodeIndex,subtree.m_rootNodeIndex+subtree.m_subtreeSize);
 		}
 	}
 	
@@ -14,6 +14,7 @@ subject to the following restrictions:
 */
 
 #include "btTriangleMesh.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 
 
@@ -22,6 +23,7 @@ btTriangleMesh::btTriangleMesh (bool use32bitIndices,bool use4componentVertices)
 m_use4componentVertices(use4componentVertices),
 m_weldingThreshold(0.0)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	btIndexedMesh meshIndex;
 	meshIndex.m_numTriangles = 0;
 	meshIndex.m_numVertices = 0;
@@ -123,6 +125,7 @@ int	btTriangleMesh::findOrAddVertex(const btVector3& vertex, bool removeDuplicat
 		
 void	btTriangleMesh::addTriangle(const btVector3& vertex0,const btVector3& vertex1,const btVector3& vertex2,bool removeDuplicateVertices)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SHAPES);
 	m_indexedMeshes[0].m_numTriangles++;
 	addIndex(findOrAddVertex(vertex0,removeDuplicateVertices));
 	addIndex(findOrAddVertex(vertex1,removeDuplicateVertices));
@@ -130,7 +130,8 @@ void	btConeTwistConstraint::buildJacobian()
 			}
 		}
 
-		btVector3 b1Axis1,b1Axis2,b1Axis3;
+		//the swing axes stay zero when their span is too small to be limited
+		btVector3 b1Axis1,b1Axis2(btScalar(0.),btScalar(0.),btScalar(0.)),b1Axis3(btScalar(0.),btScalar(0.),btScalar(0.));
 		btVector3 b2Axis1,b2Axis2;
 
 		b1Axis1 = getRigidBodyA().getCenterOfMassTransform().getBasis() * this->m_rbAFrame.getBasis().getColumn(0);
@@ -23,8 +23,9 @@ enum	btSolverMode
 	SOLVER_USE_WARMSTARTING = 4,
 	SOLVER_USE_FRICTION_WARMSTARTING = 8,
 	SOLVER_CACHE_FRIENDLY = 16,
-	SOLVER_SIMD = 32,//enabled for Windows, the solver innerloop is branchless SIMD, 40% faster than FPU/scalar version
-	SOLVER_CUDA = 64 //will be open sourced during Game Developers Conference 2009. Much faster.
+	SOLVER_SIMD = 32,//enabled when BT_USE_SSE is defined, the solver innerloop is branchless SIMD, 40% faster than FPU/scalar version
+	SOLVER_CUDA = 64, //will be open sourced during Game Developers Conference 2009. Much faster.
+	SOLVER_SIMD_BATCHED = 128 //solves independent rows in 8 wide structure-of-arrays batches, see btSolverRowBatch.h. Ignores SOLVER_RANDMIZE_ORDER
 };
 
 struct btContactSolverInfoData
@@ -49,6 +50,7 @@ struct btContactSolverInfoData
 
 	int			m_solverMode;
 	int	m_restingContactRestitutionThreshold;
+	int			m_minimumSolverBatchSize;//with SOLVER_SIMD_BATCHED, islands are collected until they have this many manifolds and constraints
 
 
 };
@@ -76,6 +78,7 @@ struct btContactSolverInfo : public btContactSolverInfoData
 		m_warmstartingFactor=btScalar(0.85);
 		m_solverMode = SOLVER_USE_WARMSTARTING | SOLVER_SIMD;//SOLVER_RANDMIZE_ORDER
 		m_restingContactRestitutionThreshold = 2;//resting contact lifetime threshold to disable restitution
+		m_minimumSolverBatchSize = 128;
 	}
 };
 
@@ -29,21 +29,12 @@ subject to the following restrictions:
 #include <new>
 #include "LinearMath/btStackAlloc.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 #include "btSolverBody.h"
 #include "btSolverConstraint.h"
 #include "LinearMath/btAlignedObjectArray.h"
 #include <string.h> //for memset
 
-btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
-:m_btSeed2(0)
-{
-
-}
-
-btSequentialImpulseConstraintSolver::~btSequentialImpulseConstraintSolver()
-{
-}
-
 #ifdef USE_SIMD
 #include <emmintrin.h>
 #define vec_splat(x, e) _mm_shuffle_ps(x, x, _MM_SHUFFLE(e,e,e,e))
@@ -54,42 +45,23 @@ static inline __m128 _vmathVfDot3( __m128 vec0, __m128 vec1 )
 }
 #endif//USE_SIMD
 
-// Project Gauss Seidel or the equivalent Sequential Impulse
-SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowGenericSIMD(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+///resize of btAlignedObjectArray reserves the exact size, so a pool that grows by a few rows per step would be reallocated
+///every step. The capacity of the pools doubles instead, like with expand.
+template <typename T>
+static SIMD_FORCE_INLINE void	btResizePool(btAlignedObjectArray<T>& pool,int newsize)
 {
-#ifdef USE_SIMD
-	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
-	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
-	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
-	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
-	__m128 deltaVel1Dotn	=	_mm_add_ps(_vmathVfDot3(c.m_contactNormal.mVec128,body1.m_deltaLinearVelocity.mVec128), _vmathVfDot3(c.m_relpos1CrossNormal.mVec128,body1.m_deltaAngularVelocity.mVec128));
-	__m128 deltaVel2Dotn	=	_mm_add_ps(_vmathVfDot3((-c.m_contactNormal).mVec128,body2.m_deltaLinearVelocity.mVec128) ,_vmathVfDot3(c.m_relpos2CrossNormal.mVec128,body2.m_deltaAngularVelocity.mVec128));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
-	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
-	btSimdScalar sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
-	btSimdScalar resultLowerLess,resultUpperLess;
-	resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
-	resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
-	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
-	deltaImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowMinApplied), _mm_andnot_ps(resultLowerLess, deltaImpulse) );
-	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) );
-	__m128 upperMinApplied = _mm_sub_ps(upperLimit1,cpAppliedImp);
-	deltaImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, deltaImpulse), _mm_andnot_ps(resultUpperLess, upperMinApplied) );
-	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, c.m_appliedImpulse), _mm_andnot_ps(resultUpperLess, upperLimit1) );
-	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass));
-	__m128	linearComponentB = _mm_mul_ps((-c.m_contactNormal).mVec128,_mm_set1_ps(body2.m_invMass));
-	__m128 impulseMagnitude = deltaImpulse;
-	body1.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body1.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
-	body1.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body1.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
-	body2.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body2.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
-	body2.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body2.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
-#else
-	resolveSingleConstraintRowGeneric(body1,body2,c);
-#endif
+	if (newsize > pool.capacity())
+	{
+		pool.reserve(btMax(newsize,pool.capacity()*2));
+	}
+	pool.resize(newsize);
 }
 
+///The row kernels are free functions, so the constructor can pick the best variant for the host with btCpuFeatureUtility.
+///The SSE2 and SSE4.1 variants give identical results, the AVX2 variant uses FMA and can differ in the last bit.
+
 // Project Gauss Seidel or the equivalent Sequential Impulse
-SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowGeneric(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+static void	gResolveSingleConstraintRowGeneric_scalar_reference(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
 {
 	btScalar deltaImpulse = c.m_rhs-btScalar(c.m_appliedImpulse)*c.m_cfm;
 	const btScalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.m_deltaLinearVelocity) 	+ c.m_relpos1CrossNormal.dot(body1.m_deltaAngularVelocity);
@@ -120,10 +92,35 @@ SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstra
 		body2.applyImpulse(-c.m_contactNormal*body2.m_invMass,c.m_angularComponentB,deltaImpulse);
 }
 
-
-SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowLowerLimitSIMD(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+// Project Gauss Seidel or the equivalent Sequential Impulse
+static void	gResolveSingleConstraintRowLowerLimit_scalar_reference(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
 {
+	btScalar deltaImpulse = c.m_rhs-btScalar(c.m_appliedImpulse)*c.m_cfm;
+	const btScalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.m_deltaLinearVelocity) 	+ c.m_relpos1CrossNormal.dot(body1.m_deltaAngularVelocity);
+	const btScalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.m_deltaLinearVelocity) + c.m_relpos2CrossNormal.dot(body2.m_deltaAngularVelocity);
+	
+	deltaImpulse	-=	deltaVel1Dotn*c.m_jacDiagABInv;
+	deltaImpulse	-=	deltaVel2Dotn*c.m_jacDiagABInv;
+	const btScalar sum = btScalar(c.m_appliedImpulse) + deltaImpulse;
+	if (sum < c.m_lowerLimit)
+	{
+		deltaImpulse = c.m_lowerLimit-c.m_appliedImpulse;
+		c.m_appliedImpulse = c.m_lowerLimit;
+	}
+	else
+	{
+		c.m_appliedImpulse = sum;
+	}
+	if (body1.m_invMass)
+		body1.applyImpulse(c.m_contactNormal*body1.m_invMass,c.m_angularComponentA,deltaImpulse);
+	if (body2.m_invMass)
+		body2.applyImpulse(-c.m_contactNormal*body2.m_invMass,c.m_angularComponentB,deltaImpulse);
+}
+
 #ifdef USE_SIMD
+// Project Gauss Seidel or the equivalent Sequential Impulse
+static void	gResolveSingleConstraintRowGeneric_sse2(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
 	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
 	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
@@ -133,6 +130,34 @@ SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstra
 	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
 	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
 	btSimdScalar sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
+	btSimdScalar resultLowerLess,resultUpperLess;
+	resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
+	resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
+	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
+	deltaImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowMinApplied), _mm_andnot_ps(resultLowerLess, deltaImpulse) );
+	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultLowerLess, lowerLimit1), _mm_andnot_ps(resultLowerLess, sum) );
+	__m128 upperMinApplied = _mm_sub_ps(upperLimit1,cpAppliedImp);
+	deltaImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, deltaImpulse), _mm_andnot_ps(resultUpperLess, upperMinApplied) );
+	c.m_appliedImpulse = _mm_or_ps( _mm_and_ps(resultUpperLess, c.m_appliedImpulse), _mm_andnot_ps(resultUpperLess, upperLimit1) );
+	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass));
+	__m128	linearComponentB = _mm_mul_ps((-c.m_contactNormal).mVec128,_mm_set1_ps(body2.m_invMass));
+	__m128 impulseMagnitude = deltaImpulse;
+	body1.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body1.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
+	body1.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body1.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
+	body2.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body2.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
+	body2.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body2.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+}
+
+static void	gResolveSingleConstraintRowLowerLimit_sse2(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
+	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
+	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
+	__m128 deltaVel1Dotn	=	_mm_add_ps(_vmathVfDot3(c.m_contactNormal.mVec128,body1.m_deltaLinearVelocity.mVec128), _vmathVfDot3(c.m_relpos1CrossNormal.mVec128,body1.m_deltaAngularVelocity.mVec128));
+	__m128 deltaVel2Dotn	=	_mm_add_ps(_vmathVfDot3((-c.m_contactNormal).mVec128,body2.m_deltaLinearVelocity.mVec128) ,_vmathVfDot3(c.m_relpos2CrossNormal.mVec128,body2.m_deltaAngularVelocity.mVec128));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	btSimdScalar sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
 	btSimdScalar resultLowerLess;
 	resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
 	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
@@ -145,34 +170,216 @@ SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstra
 	body1.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body1.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
 	body2.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body2.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
 	body2.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body2.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
-#else
-	resolveSingleConstraintRowLowerLimit(body1,body2,c);
+}
+
+#ifdef BT_ALLOW_AVX2
+///same arithmetic as the SSE2 rows, blendv replaces the and/andnot/or selects
+BT_TARGET_SSE4_1 static void	gResolveSingleConstraintRowGeneric_sse4_1(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
+	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
+	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
+	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
+	__m128 deltaVel1Dotn	=	_mm_add_ps(_vmathVfDot3(c.m_contactNormal.mVec128,body1.m_deltaLinearVelocity.mVec128), _vmathVfDot3(c.m_relpos1CrossNormal.mVec128,body1.m_deltaAngularVelocity.mVec128));
+	__m128 deltaVel2Dotn	=	_mm_add_ps(_vmathVfDot3((-c.m_contactNormal).mVec128,body2.m_deltaLinearVelocity.mVec128) ,_vmathVfDot3(c.m_relpos2CrossNormal.mVec128,body2.m_deltaAngularVelocity.mVec128));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	__m128 sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
+	__m128 resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
+	__m128 resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
+	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
+	deltaImpulse = _mm_blendv_ps(deltaImpulse, lowMinApplied, resultLowerLess);
+	__m128 appliedImpulse = _mm_blendv_ps(sum, lowerLimit1, resultLowerLess);
+	__m128 upperMinApplied = _mm_sub_ps(upperLimit1,cpAppliedImp);
+	deltaImpulse = _mm_blendv_ps(upperMinApplied, deltaImpulse, resultUpperLess);
+	c.m_appliedImpulse = _mm_blendv_ps(upperLimit1, appliedImpulse, resultUpperLess);
+	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass));
+	__m128	linearComponentB = _mm_mul_ps((-c.m_contactNormal).mVec128,_mm_set1_ps(body2.m_invMass));
+	__m128 impulseMagnitude = deltaImpulse;
+	body1.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body1.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
+	body1.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body1.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
+	body2.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body2.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
+	body2.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body2.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+}
+
+BT_TARGET_SSE4_1 static void	gResolveSingleConstraintRowLowerLimit_sse4_1(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
+	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
+	__m128 deltaImpulse = _mm_sub_ps(_mm_set1_ps(c.m_rhs), _mm_mul_ps(_mm_set1_ps(c.m_appliedImpulse),_mm_set1_ps(c.m_cfm)));
+	__m128 deltaVel1Dotn	=	_mm_add_ps(_vmathVfDot3(c.m_contactNormal.mVec128,body1.m_deltaLinearVelocity.mVec128), _vmathVfDot3(c.m_relpos1CrossNormal.mVec128,body1.m_deltaAngularVelocity.mVec128));
+	__m128 deltaVel2Dotn	=	_mm_add_ps(_vmathVfDot3((-c.m_contactNormal).mVec128,body2.m_deltaLinearVelocity.mVec128) ,_vmathVfDot3(c.m_relpos2CrossNormal.mVec128,body2.m_deltaAngularVelocity.mVec128));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel1Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	deltaImpulse	=	_mm_sub_ps(deltaImpulse,_mm_mul_ps(deltaVel2Dotn,_mm_set1_ps(c.m_jacDiagABInv)));
+	__m128 sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
+	__m128 resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
+	__m128 lowMinApplied = _mm_sub_ps(lowerLimit1,cpAppliedImp);
+	deltaImpulse = _mm_blendv_ps(deltaImpulse, lowMinApplied, resultLowerLess);
+	c.m_appliedImpulse = _mm_blendv_ps(sum, lowerLimit1, resultLowerLess);
+	__m128	linearComponentA = _mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass));
+	__m128	linearComponentB = _mm_mul_ps((-c.m_contactNormal).mVec128,_mm_set1_ps(body2.m_invMass));
+	__m128 impulseMagnitude = deltaImpulse;
+	body1.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body1.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentA,impulseMagnitude));
+	body1.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body1.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentA.mVec128,impulseMagnitude));
+	body2.m_deltaLinearVelocity.mVec128 = _mm_add_ps(body2.m_deltaLinearVelocity.mVec128,_mm_mul_ps(linearComponentB,impulseMagnitude));
+	body2.m_deltaAngularVelocity.mVec128 = _mm_add_ps(body2.m_deltaAngularVelocity.mVec128 ,_mm_mul_ps(c.m_angularComponentB.mVec128,impulseMagnitude));
+}
+
+///returns dot3(a.lo,b.lo) + dot3(a.hi,b.hi) in all lanes, the linear and angular halves of a row are dotted at once
+BT_TARGET_AVX2 static inline __m128	btDot3Pair256(__m256 a, __m256 b)
+{
+	__m256 product = _mm256_mul_ps(a, b);
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(product), _mm256_extractf128_ps(product, 1));
+	return _mm_add_ps(_mm_add_ps(bt_splat_ps(s, 0), bt_splat_ps(s, 1)), bt_splat_ps(s, 2));
+}
+
+BT_TARGET_AVX2 static inline __m256	btPair256(__m128 lo, __m128 hi)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+///m_deltaLinearVelocity and m_deltaAngularVelocity are adjacent, so each body is loaded and stored as one 256 bit register
+BT_TARGET_AVX2 static void	gResolveSingleConstraintRowGeneric_avx2(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
+	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
+	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
+	__m128	jacDiagABInv = _mm_set1_ps(c.m_jacDiagABInv);
+	__m128 negNormal = _mm_xor_ps(c.m_contactNormal.mVec128, btvSignMaskf);
+	__m256 vel1 = _mm256_loadu_ps(&body1.m_deltaLinearVelocity[0]);
+	__m256 vel2 = _mm256_loadu_ps(&body2.m_deltaLinearVelocity[0]);
+	__m128 deltaImpulse = _mm_fnmadd_ps(_mm_set1_ps(c.m_appliedImpulse), _mm_set1_ps(c.m_cfm), _mm_set1_ps(c.m_rhs));
+	__m128 deltaVel1Dotn = btDot3Pair256(btPair256(c.m_contactNormal.mVec128, c.m_relpos1CrossNormal.mVec128), vel1);
+	__m128 deltaVel2Dotn = btDot3Pair256(btPair256(negNormal, c.m_relpos2CrossNormal.mVec128), vel2);
+	deltaImpulse = _mm_fnmadd_ps(deltaVel1Dotn, jacDiagABInv, deltaImpulse);
+	deltaImpulse = _mm_fnmadd_ps(deltaVel2Dotn, jacDiagABInv, deltaImpulse);
+	__m128 sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
+	__m128 resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
+	__m128 resultUpperLess = _mm_cmplt_ps(sum,upperLimit1);
+	deltaImpulse = _mm_blendv_ps(deltaImpulse, _mm_sub_ps(lowerLimit1,cpAppliedImp), resultLowerLess);
+	__m128 appliedImpulse = _mm_blendv_ps(sum, lowerLimit1, resultLowerLess);
+	deltaImpulse = _mm_blendv_ps(_mm_sub_ps(upperLimit1,cpAppliedImp), deltaImpulse, resultUpperLess);
+	c.m_appliedImpulse = _mm_blendv_ps(upperLimit1, appliedImpulse, resultUpperLess);
+	__m256 impulseMagnitude = btPair256(deltaImpulse, deltaImpulse);
+	__m256 component1 = btPair256(_mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass)), c.m_angularComponentA.mVec128);
+	__m256 component2 = btPair256(_mm_mul_ps(negNormal,_mm_set1_ps(body2.m_invMass)), c.m_angularComponentB.mVec128);
+	_mm256_storeu_ps(&body1.m_deltaLinearVelocity[0], _mm256_fmadd_ps(component1, impulseMagnitude, vel1));
+	//body1 and body2 can be the same solver body, so reload before the update
+	vel2 = _mm256_loadu_ps(&body2.m_deltaLinearVelocity[0]);
+	_mm256_storeu_ps(&body2.m_deltaLinearVelocity[0], _mm256_fmadd_ps(component2, impulseMagnitude, vel2));
+	_mm256_zeroupper();
+}
+
+BT_TARGET_AVX2 static void	gResolveSingleConstraintRowLowerLimit_avx2(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedImpulse);
+	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
+	__m128	jacDiagABInv = _mm_set1_ps(c.m_jacDiagABInv);
+	__m128 negNormal = _mm_xor_ps(c.m_contactNormal.mVec128, btvSignMaskf);
+	__m256 vel1 = _mm256_loadu_ps(&body1.m_deltaLinearVelocity[0]);
+	__m256 vel2 = _mm256_loadu_ps(&body2.m_deltaLinearVelocity[0]);
+	__m128 deltaImpulse = _mm_fnmadd_ps(_mm_set1_ps(c.m_appliedImpulse), _mm_set1_ps(c.m_cfm), _mm_set1_ps(c.m_rhs));
+	__m128 deltaVel1Dotn = btDot3Pair256(btPair256(c.m_contactNormal.mVec128, c.m_relpos1CrossNormal.mVec128), vel1);
+	__m128 deltaVel2Dotn = btDot3Pair256(btPair256(negNormal, c.m_relpos2CrossNormal.mVec128), vel2);
+	deltaImpulse = _mm_fnmadd_ps(deltaVel1Dotn, jacDiagABInv, deltaImpulse);
+	deltaImpulse = _mm_fnmadd_ps(deltaVel2Dotn, jacDiagABInv, deltaImpulse);
+	__m128 sum = _mm_add_ps(cpAppliedImp,deltaImpulse);
+	__m128 resultLowerLess = _mm_cmplt_ps(sum,lowerLimit1);
+	deltaImpulse = _mm_blendv_ps(deltaImpulse, _mm_sub_ps(lowerLimit1,cpAppliedImp), resultLowerLess);
+	c.m_appliedImpulse = _mm_blendv_ps(sum, lowerLimit1, resultLowerLess);
+	__m256 impulseMagnitude = btPair256(deltaImpulse, deltaImpulse);
+	__m256 component1 = btPair256(_mm_mul_ps(c.m_contactNormal.mVec128,_mm_set1_ps(body1.m_invMass)), c.m_angularComponentA.mVec128);
+	__m256 component2 = btPair256(_mm_mul_ps(negNormal,_mm_set1_ps(body2.m_invMass)), c.m_angularComponentB.mVec128);
+	_mm256_storeu_ps(&body1.m_deltaLinearVelocity[0], _mm256_fmadd_ps(component1, impulseMagnitude, vel1));
+	//body1 and body2 can be the same solver body, so reload before the update
+	vel2 = _mm256_loadu_ps(&body2.m_deltaLinearVelocity[0]);
+	_mm256_storeu_ps(&body2.m_deltaLinearVelocity[0], _mm256_fmadd_ps(component2, impulseMagnitude, vel2));
+	_mm256_zeroupper();
+}
+#endif //BT_ALLOW_AVX2
+#endif //USE_SIMD
+
+btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
+:m_btSeed2(0)
+{
+	setRowSolverVariant(btCpuFeatureUtility::getSimdVariant());
+}
+
+btSequentialImpulseConstraintSolver::~btSequentialImpulseConstraintSolver()
+{
+}
+
+void	btSequentialImpulseConstraintSolver::setRowSolverVariant(btCpuFeatureUtility::btSimdVariant maxVariant)
+{
+	int available = 1 << btCpuFeatureUtility::BT_SIMD_SCALAR;
+#ifdef USE_SIMD
+	available |= 1 << btCpuFeatureUtility::BT_SIMD_SSE2;
+#ifdef BT_ALLOW_AVX2
+	available |= (1 << btCpuFeatureUtility::BT_SIMD_SSE4_1) | (1 << btCpuFeatureUtility::BT_SIMD_AVX2);
 #endif
+#endif //USE_SIMD
+	//only keep the variants up to maxVariant, selectSimdVariant also limits them to what the host supports
+	available &= (2 << maxVariant) - 1;
+	m_rowSolverVariant = btCpuFeatureUtility::selectSimdVariant(available);
+
+	switch (m_rowSolverVariant)
+	{
+#ifdef USE_SIMD
+	case btCpuFeatureUtility::BT_SIMD_SSE2:
+		m_resolveSingleConstraintRowGeneric = gResolveSingleConstraintRowGeneric_sse2;
+		m_resolveSingleConstraintRowLowerLimit = gResolveSingleConstraintRowLowerLimit_sse2;
+		break;
+#ifdef BT_ALLOW_AVX2
+	case btCpuFeatureUtility::BT_SIMD_SSE4_1:
+		m_resolveSingleConstraintRowGeneric = gResolveSingleConstraintRowGeneric_sse4_1;
+		m_resolveSingleConstraintRowLowerLimit = gResolveSingleConstraintRowLowerLimit_sse4_1;
+		break;
+	case btCpuFeatureUtility::BT_SIMD_AVX2:
+		m_resolveSingleConstraintRowGeneric = gResolveSingleConstraintRowGeneric_avx2;
+		m_resolveSingleConstraintRowLowerLimit = gResolveSingleConstraintRowLowerLimit_avx2;
+		break;
+#endif //BT_ALLOW_AVX2
+#endif //USE_SIMD
+	default:
+		m_rowSolverVariant = btCpuFeatureUtility::BT_SIMD_SCALAR;
+		m_resolveSingleConstraintRowGeneric = gResolveSingleConstraintRowGeneric_scalar_reference;
+		m_resolveSingleConstraintRowLowerLimit = gResolveSingleConstraintRowLowerLimit_scalar_reference;
+		break;
+	};
+}
+
+btSingleConstraintRowSolver	btSequentialImpulseConstraintSolver::getRowSolverGeneric(int solverMode) const
+{
+	if (solverMode & SOLVER_SIMD)
+		return m_resolveSingleConstraintRowGeneric;
+	return gResolveSingleConstraintRowGeneric_scalar_reference;
+}
+
+btSingleConstraintRowSolver	btSequentialImpulseConstraintSolver::getRowSolverLowerLimit(int solverMode) const
+{
+	if (solverMode & SOLVER_SIMD)
+		return m_resolveSingleConstraintRowLowerLimit;
+	return gResolveSingleConstraintRowLowerLimit_scalar_reference;
+}
+
+SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowGenericSIMD(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	m_resolveSingleConstraintRowGeneric(body1,body2,c);
+}
+
+SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowGeneric(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	gResolveSingleConstraintRowGeneric_scalar_reference(body1,body2,c);
+}
+
+SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowLowerLimitSIMD(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
+{
+	m_resolveSingleConstraintRowLowerLimit(body1,body2,c);
 }
 
-// Project Gauss Seidel or the equivalent Sequential Impulse
 SIMD_FORCE_INLINE void btSequentialImpulseConstraintSolver::resolveSingleConstraintRowLowerLimit(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& c)
 {
-	btScalar deltaImpulse = c.m_rhs-btScalar(c.m_appliedImpulse)*c.m_cfm;
-	const btScalar deltaVel1Dotn	=	c.m_contactNormal.dot(body1.m_deltaLinearVelocity) 	+ c.m_relpos1CrossNormal.dot(body1.m_deltaAngularVelocity);
-	const btScalar deltaVel2Dotn	=	-c.m_contactNormal.dot(body2.m_deltaLinearVelocity) + c.m_relpos2CrossNormal.dot(body2.m_deltaAngularVelocity);
-	
-	deltaImpulse	-=	deltaVel1Dotn*c.m_jacDiagABInv;
-	deltaImpulse	-=	deltaVel2Dotn*c.m_jacDiagABInv;
-	const btScalar sum = btScalar(c.m_appliedImpulse) + deltaImpulse;
-	if (sum < c.m_lowerLimit)
-	{
-		deltaImpulse = c.m_lowerLimit-c.m_appliedImpulse;
-		c.m_appliedImpulse = c.m_lowerLimit;
-	}
-	else
-	{
-		c.m_appliedImpulse = sum;
-	}
-	if (body1.m_invMass)
-		body1.applyImpulse(c.m_contactNormal*body1.m_invMass,c.m_angularComponentA,deltaImpulse);
-	if (body2.m_invMass)
-		body2.applyImpulse(-c.m_contactNormal*body2.m_invMass,c.m_angularComponentB,deltaImpulse);
+	gResolveSingleConstraintRowLowerLimit_scalar_reference(body1,body2,c);
 }
 
 
@@ -406,7 +613,7 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 				constraints[i]->getInfo1(&info1);
 				totalNumRows += info1.m_numConstraintRows;
 			}
-			m_tmpSolverNonContactConstraintPool.resize(totalNumRows);
+			btResizePool(m_tmpSolverNonContactConstraintPool,totalNumRows);
 
 			btTypedConstraint::btConstraintInfo1 info1;
 			info1.m_numConstraintRows = 0;
@@ -781,8 +988,8 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
 
 	///@todo: use stack allocator for such temporarily memory, same for solver bodies/constraints
-	m_orderTmpConstraintPool.resize(numConstraintPool);
-	m_orderFrictionConstraintPool.resize(numFrictionPool);
+	btResizePool(m_orderTmpConstraintPool,numConstraintPool);
+	btResizePool(m_orderFrictionConstraintPool,numFrictionPool);
 	{
 		int i;
 		for (i=0;i<numConstraintPool;i++)
@@ -803,6 +1010,12 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 {
 	BT_PROFILE("solveGroupCacheFriendlyIterations");
 
+	if (infoGlobal.m_solverMode & SOLVER_SIMD_BATCHED)
+	{
+		solveGroupBatchedIterations(constraints,numConstraints,infoGlobal);
+		return 0.f;
+	}
+
 	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
 	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
 
@@ -926,20 +1139,57 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 
 
 
+///Each body sees its rows in the same order as in solveGroupCacheFriendlyIterations, so the results match the SSE2 row kernels.
+void	btSequentialImpulseConstraintSolver::solveGroupBatchedIterations(btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal)
+{
+	BT_PROFILE("solveGroupBatchedIterations");
+
+	m_nonContactBatches.build(m_tmpSolverNonContactConstraintPool,m_tmpSolverBodyPool,0);
+	m_contactBatches.build(m_tmpSolverContactConstraintPool,m_tmpSolverBodyPool,0);
+	m_frictionBatches.build(m_tmpSolverContactFrictionConstraintPool,m_tmpSolverBodyPool,&m_contactBatches);
+
+	for (int iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
+	{
+		m_nonContactBatches.solve(btSolverRowBatchPool::BT_ROW_GENERIC,m_tmpSolverBodyPool,0,m_rowSolverVariant);
+
+		for (int j=0;j<numConstraints;j++)
+		{
+			int bodyAid = getOrInitSolverBody(constraints[j]->getRigidBodyA());
+			int bodyBid = getOrInitSolverBody(constraints[j]->getRigidBodyB());
+			btSolverBody& bodyA = m_tmpSolverBodyPool[bodyAid];
+			btSolverBody& bodyB = m_tmpSolverBodyPool[bodyBid];
+			constraints[j]->solveConstraintObsolete(bodyA,bodyB,infoGlobal.m_timeStep);
+		}
+
+		m_contactBatches.solve(btSolverRowBatchPool::BT_ROW_LOWER_LIMIT,m_tmpSolverBodyPool,0,m_rowSolverVariant);
+		m_frictionBatches.solve(btSolverRowBatchPool::BT_ROW_FRICTION,m_tmpSolverBodyPool,&m_contactBatches,m_rowSolverVariant);
+	}
+
+	m_nonContactBatches.writeback(m_tmpSolverNonContactConstraintPool);
+	m_contactBatches.writeback(m_tmpSolverContactConstraintPool);
+	m_frictionBatches.writeback(m_tmpSolverContactFrictionConstraintPool);
+}
+
 /// btSequentialImpulseConstraintSolver Sequentially applies impulses
 btScalar btSequentialImpulseConstraintSolver::solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer,btStackAlloc* stackAlloc,btDispatcher* /*dispatcher*/)
 {
 	BT_PROFILE("solveGroup");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOLVER);
 	//we only implement SOLVER_CACHE_FRIENDLY now
 	//you need to provide at least some bodies
 	btAssert(bodies);
 	btAssert(numBodies);
 
-	int i;
-
 	solveGroupCacheFriendlySetup( bodies, numBodies, manifoldPtr,  numManifolds,constraints, numConstraints,infoGlobal,debugDrawer, stackAlloc);
 	solveGroupCacheFriendlyIterations(bodies, numBodies, manifoldPtr,  numManifolds,constraints, numConstraints,infoGlobal,debugDrawer, stackAlloc);
+	solveGroupCacheFriendlyFinish(infoGlobal);
 
+	return 0.f;
+}
+
+void	btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyFinish(const btContactSolverInfo& infoGlobal)
+{
+	int i;
 	int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
 	int j;
 
@@ -978,8 +1228,6 @@ btScalar btSequentialImpulseConstraintSolver::solveGroup(btCollisionObject** bod
 	m_tmpSolverContactConstraintPool.resize(0);
 	m_tmpSolverNonContactConstraintPool.resize(0);
 	m_tmpSolverContactFrictionConstraintPool.resize(0);
-
-	return 0.f;
 }
 
 
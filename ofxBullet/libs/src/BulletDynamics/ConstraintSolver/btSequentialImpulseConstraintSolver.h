@@ -21,6 +21,10 @@ class btIDebugDraw;
 #include "btContactConstraint.h"
 #include "btSolverBody.h"
 #include "btSolverConstraint.h"
+#include "btSolverRowBatch.h"
+#include "LinearMath/btCpuFeatureUtility.h"
+
+typedef void (*btSingleConstraintRowSolver)(btSolverBody&, btSolverBody&, const btSolverConstraint&);
 
 
 
@@ -30,6 +34,7 @@ class btIDebugDraw;
 ///Applies impulses for combined restitution and penetration recovery and to simulate friction
 class btSequentialImpulseConstraintSolver : public btConstraintSolver
 {
+protected:
 
 	btAlignedObjectArray<btSolverBody>	m_tmpSolverBodyPool;
 	btConstraintArray			m_tmpSolverContactConstraintPool;
@@ -38,12 +43,21 @@ class btSequentialImpulseConstraintSolver : public btConstraintSolver
 	btAlignedObjectArray<int>	m_orderTmpConstraintPool;
 	btAlignedObjectArray<int>	m_orderFrictionConstraintPool;
 
-protected:
+	///rows packed into SIMD batches, used with SOLVER_SIMD_BATCHED
+	btSolverRowBatchPool		m_nonContactBatches;
+	btSolverRowBatchPool		m_contactBatches;
+	btSolverRowBatchPool		m_frictionBatches;
+
 	btSolverConstraint&	addFrictionConstraint(const btVector3& normalAxis,int solverBodyIdA,int solverBodyIdB,int frictionIndex,btManifoldPoint& cp,const btVector3& rel_pos1,const btVector3& rel_pos2,btCollisionObject* colObj0,btCollisionObject* colObj1, btScalar relaxation);
 	
 	///m_btSeed2 is used for re-arranging the constraint rows. improves convergence/quality of friction
 	unsigned long	m_btSeed2;
 
+	///row kernels used by the SOLVER_SIMD path, selected at construction for the host CPU
+	btSingleConstraintRowSolver	m_resolveSingleConstraintRowGeneric;
+	btSingleConstraintRowSolver	m_resolveSingleConstraintRowLowerLimit;
+	btCpuFeatureUtility::btSimdVariant	m_rowSolverVariant;
+
 	void	initSolverBody(btSolverBody* solverBody, btCollisionObject* collisionObject);
 	btScalar restitutionCurve(btScalar rel_vel, btScalar restitution);
 
@@ -56,6 +70,15 @@ protected:
 	//internal method
 	int	getOrInitSolverBody(btCollisionObject& body);
 
+	void	solveGroupBatchedIterations(btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal);
+
+	///copies the applied impulses back into the contact points and the velocities into the bodies, then clears the pools
+	void	solveGroupCacheFriendlyFinish(const btContactSolverInfo& infoGlobal);
+
+	///returns the row kernel that solveGroupCacheFriendlyIterations uses for the given solver mode
+	btSingleConstraintRowSolver	getRowSolverGeneric(int solverMode) const;
+	btSingleConstraintRowSolver	getRowSolverLowerLimit(int solverMode) const;
+
 	void	resolveSingleConstraintRowGeneric(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& contactConstraint);
 
 	void	resolveSingleConstraintRowGenericSIMD(btSolverBody& body1,btSolverBody& body2,const btSolverConstraint& contactConstraint);
@@ -91,6 +114,16 @@ public:
 		return m_btSeed2;
 	}
 
+	///selects the best row kernels up to maxVariant that the host supports. The AVX2 kernels use FMA,
+	///use BT_SIMD_SSE4_1 or lower to get identical results on every host.
+	void	setRowSolverVariant(btCpuFeatureUtility::btSimdVariant maxVariant);
+
+	///returns the kernel variant used by the SOLVER_SIMD path, see btCpuFeatureUtility::getSimdVariantName
+	btCpuFeatureUtility::btSimdVariant	getRowSolverVariant() const
+	{
+		return m_rowSolverVariant;
+	}
+
 };
 
 #ifndef BT_PREFER_SIMD
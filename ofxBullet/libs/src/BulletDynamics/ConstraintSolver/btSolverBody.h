@@ -23,7 +23,7 @@ class	btRigidBody;
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btTransformUtil.h"
 
-///Until we get other contributions, only use SIMD on Windows, when using Visual Studio 2008 or later, and not double precision
+///Use SIMD when btScalar.h enabled SSE (Visual Studio 2008 or later, or GCC/Clang with SSE2), and not double precision
 #ifdef BT_USE_SSE
 #define USE_SIMD 1
 #endif //
@@ -0,0 +1,460 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btSolverRowBatch.h"
+#include <string.h> //for memset
+
+///All batch kernels round like the SSE2 row kernels of btSequentialImpulseConstraintSolver:
+///dot products are x + (y + z), and the body update for bodyB subtracts the linear component.
+///Inactive lanes are computed but never stored.
+typedef void (*btSolverRowBatchKernel)(btSolverRowBatch& batch, btSolverBody** bodyA, btSolverBody** bodyB, int activeMask, bool clampUpper);
+
+static void	btSolveRowBatchScalar(btSolverRowBatch& batch, btSolverBody** bodyA, btSolverBody** bodyB, int activeMask, bool clampUpper)
+{
+	for (int l=0;l<BT_SOLVER_BATCH_WIDTH;l++)
+	{
+		if (!(activeMask & (1<<l)))
+			continue;
+		btVector3& lin1 = bodyA[l]->m_deltaLinearVelocity;
+		btVector3& ang1 = bodyA[l]->m_deltaAngularVelocity;
+		btVector3& lin2 = bodyB[l]->m_deltaLinearVelocity;
+		btVector3& ang2 = bodyB[l]->m_deltaAngularVelocity;
+		const btScalar nx = batch.m_contactNormal[0][l], ny = batch.m_contactNormal[1][l], nz = batch.m_contactNormal[2][l];
+		const btScalar applied = batch.m_appliedImpulse[l];
+		const btScalar lower = batch.m_lowerLimit[l];
+		const btScalar upper = batch.m_upperLimit[l];
+
+		btScalar deltaImpulse = batch.m_rhs[l] - applied*batch.m_cfm[l];
+		const btScalar dotN1 = nx*lin1[0] + (ny*lin1[1] + nz*lin1[2]);
+		const btScalar dotR1 = batch.m_relpos1CrossNormal[0][l]*ang1[0] + (batch.m_relpos1CrossNormal[1][l]*ang1[1] + batch.m_relpos1CrossNormal[2][l]*ang1[2]);
+		const btScalar dotN2 = nx*lin2[0] + (ny*lin2[1] + nz*lin2[2]);
+		const btScalar dotR2 = batch.m_relpos2CrossNormal[0][l]*ang2[0] + (batch.m_relpos2CrossNormal[1][l]*ang2[1] + batch.m_relpos2CrossNormal[2][l]*ang2[2]);
+		const btScalar deltaVel1Dotn = dotN1 + dotR1;
+		const btScalar deltaVel2Dotn = dotR2 - dotN2;
+		deltaImpulse = deltaImpulse - deltaVel1Dotn*batch.m_jacDiagABInv[l];
+		deltaImpulse = deltaImpulse - deltaVel2Dotn*batch.m_jacDiagABInv[l];
+		const btScalar sum = applied + deltaImpulse;
+		btScalar newApplied = sum;
+		if (sum < lower)
+		{
+			deltaImpulse = lower - applied;
+			newApplied = lower;
+		}
+		if (clampUpper && !(sum < upper))
+		{
+			deltaImpulse = upper - applied;
+			newApplied = upper;
+		}
+		batch.m_appliedImpulse[l] = newApplied;
+
+		const btScalar invMassA = batch.m_invMassA[l];
+		const btScalar invMassB = batch.m_invMassB[l];
+		lin1.setValue(lin1[0] + (nx*invMassA)*deltaImpulse, lin1[1] + (ny*invMassA)*deltaImpulse, lin1[2] + (nz*invMassA)*deltaImpulse);
+		ang1.setValue(ang1[0] + batch.m_angularComponentA[0][l]*deltaImpulse, ang1[1] + batch.m_angularComponentA[1][l]*deltaImpulse, ang1[2] + batch.m_angularComponentA[2][l]*deltaImpulse);
+		lin2.setValue(lin2[0] - (nx*invMassB)*deltaImpulse, lin2[1] - (ny*invMassB)*deltaImpulse, lin2[2] - (nz*invMassB)*deltaImpulse);
+		ang2.setValue(ang2[0] + batch.m_angularComponentB[0][l]*deltaImpulse, ang2[1] + batch.m_angularComponentB[1][l]*deltaImpulse, ang2[2] + batch.m_angularComponentB[2][l]*deltaImpulse);
+	}
+}
+
+#ifdef USE_SIMD
+
+SIMD_FORCE_INLINE void	btLoadTransposed4(btVector3* v0, btVector3* v1, btVector3* v2, btVector3* v3, __m128& x, __m128& y, __m128& z, __m128& w)
+{
+	__m128 r0 = v0->get128(), r1 = v1->get128(), r2 = v2->get128(), r3 = v3->get128();
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	x = r0; y = r1; z = r2; w = r3;
+}
+
+SIMD_FORCE_INLINE void	btStoreTransposed4(btVector3* v0, btVector3* v1, btVector3* v2, btVector3* v3, __m128 x, __m128 y, __m128 z, __m128 w, int laneMask)
+{
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+	if (laneMask & 1)
+		v0->set128(x);
+	if (laneMask & 2)
+		v1->set128(y);
+	if (laneMask & 4)
+		v2->set128(z);
+	if (laneMask & 8)
+		v3->set128(w);
+}
+
+SIMD_FORCE_INLINE __m128	btDot3Lanes(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+{
+	return _mm_add_ps(_mm_mul_ps(ax, bx), _mm_add_ps(_mm_mul_ps(ay, by), _mm_mul_ps(az, bz)));
+}
+
+SIMD_FORCE_INLINE __m128	btSelectLanes(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+///solves the batch as two groups of 4 lanes
+static void	btSolveRowBatchSSE2(btSolverRowBatch& batch, btSolverBody** bodyA, btSolverBody** bodyB, int activeMask, bool clampUpper)
+{
+	const __m128i laneBits = _mm_set_epi32(8,4,2,1);
+	for (int h=0;h<BT_SOLVER_BATCH_WIDTH;h+=4)
+	{
+		const int laneMask = (activeMask >> h) & 0xf;
+		if (!laneMask)
+			continue;
+		btSolverBody** bA = bodyA+h;
+		btSolverBody** bB = bodyB+h;
+		__m128 lin1x,lin1y,lin1z,lin1w, ang1x,ang1y,ang1z,ang1w, lin2x,lin2y,lin2z,lin2w, ang2x,ang2y,ang2z,ang2w;
+		btLoadTransposed4(&bA[0]->m_deltaLinearVelocity, &bA[1]->m_deltaLinearVelocity, &bA[2]->m_deltaLinearVelocity, &bA[3]->m_deltaLinearVelocity, lin1x, lin1y, lin1z, lin1w);
+		btLoadTransposed4(&bA[0]->m_deltaAngularVelocity, &bA[1]->m_deltaAngularVelocity, &bA[2]->m_deltaAngularVelocity, &bA[3]->m_deltaAngularVelocity, ang1x, ang1y, ang1z, ang1w);
+		btLoadTransposed4(&bB[0]->m_deltaLinearVelocity, &bB[1]->m_deltaLinearVelocity, &bB[2]->m_deltaLinearVelocity, &bB[3]->m_deltaLinearVelocity, lin2x, lin2y, lin2z, lin2w);
+		btLoadTransposed4(&bB[0]->m_deltaAngularVelocity, &bB[1]->m_deltaAngularVelocity, &bB[2]->m_deltaAngularVelocity, &bB[3]->m_deltaAngularVelocity, ang2x, ang2y, ang2z, ang2w);
+
+		const __m128 nx = _mm_load_ps(&batch.m_contactNormal[0][h]);
+		const __m128 ny = _mm_load_ps(&batch.m_contactNormal[1][h]);
+		const __m128 nz = _mm_load_ps(&batch.m_contactNormal[2][h]);
+		const __m128 applied = _mm_load_ps(&batch.m_appliedImpulse[h]);
+		const __m128 lower = _mm_load_ps(&batch.m_lowerLimit[h]);
+		const __m128 upper = _mm_load_ps(&batch.m_upperLimit[h]);
+		const __m128 jacDiagABInv = _mm_load_ps(&batch.m_jacDiagABInv[h]);
+
+		__m128 deltaImpulse = _mm_sub_ps(_mm_load_ps(&batch.m_rhs[h]), _mm_mul_ps(applied, _mm_load_ps(&batch.m_cfm[h])));
+		__m128 dotN1 = btDot3Lanes(nx, ny, nz, lin1x, lin1y, lin1z);
+		__m128 dotR1 = btDot3Lanes(_mm_load_ps(&batch.m_relpos1CrossNormal[0][h]), _mm_load_ps(&batch.m_relpos1CrossNormal[1][h]), _mm_load_ps(&batch.m_relpos1CrossNormal[2][h]), ang1x, ang1y, ang1z);
+		__m128 dotN2 = btDot3Lanes(nx, ny, nz, lin2x, lin2y, lin2z);
+		__m128 dotR2 = btDot3Lanes(_mm_load_ps(&batch.m_relpos2CrossNormal[0][h]), _mm_load_ps(&batch.m_relpos2CrossNormal[1][h]), _mm_load_ps(&batch.m_relpos2CrossNormal[2][h]), ang2x, ang2y, ang2z);
+		deltaImpulse = _mm_sub_ps(deltaImpulse, _mm_mul_ps(_mm_add_ps(dotN1, dotR1), jacDiagABInv));
+		deltaImpulse = _mm_sub_ps(deltaImpulse, _mm_mul_ps(_mm_sub_ps(dotR2, dotN2), jacDiagABInv));
+		const __m128 sum = _mm_add_ps(applied, deltaImpulse);
+		const __m128 lowerLess = _mm_cmplt_ps(sum, lower);
+		deltaImpulse = btSelectLanes(lowerLess, _mm_sub_ps(lower, applied), deltaImpulse);
+		__m128 newApplied = btSelectLanes(lowerLess, lower, sum);
+		if (clampUpper)
+		{
+			const __m128 upperLess = _mm_cmplt_ps(sum, upper);
+			deltaImpulse = btSelectLanes(upperLess, deltaImpulse, _mm_sub_ps(upper, applied));
+			newApplied = btSelectLanes(upperLess, newApplied, upper);
+		}
+		const __m128 active = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(laneMask), laneBits), laneBits));
+		_mm_store_ps(&batch.m_appliedImpulse[h], btSelectLanes(active, newApplied, applied));
+
+		const __m128 invMassA = _mm_load_ps(&batch.m_invMassA[h]);
+		const __m128 invMassB = _mm_load_ps(&batch.m_invMassB[h]);
+		lin1x = _mm_add_ps(lin1x, _mm_mul_ps(_mm_mul_ps(nx, invMassA), deltaImpulse));
+		lin1y = _mm_add_ps(lin1y, _mm_mul_ps(_mm_mul_ps(ny, invMassA), deltaImpulse));
+		lin1z = _mm_add_ps(lin1z, _mm_mul_ps(_mm_mul_ps(nz, invMassA), deltaImpulse));
+		ang1x = _mm_add_ps(ang1x, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentA[0][h]), deltaImpulse));
+		ang1y = _mm_add_ps(ang1y, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentA[1][h]), deltaImpulse));
+		ang1z = _mm_add_ps(ang1z, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentA[2][h]), deltaImpulse));
+		lin2x = _mm_sub_ps(lin2x, _mm_mul_ps(_mm_mul_ps(nx, invMassB), deltaImpulse));
+		lin2y = _mm_sub_ps(lin2y, _mm_mul_ps(_mm_mul_ps(ny, invMassB), deltaImpulse));
+		lin2z = _mm_sub_ps(lin2z, _mm_mul_ps(_mm_mul_ps(nz, invMassB), deltaImpulse));
+		ang2x = _mm_add_ps(ang2x, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentB[0][h]), deltaImpulse));
+		ang2y = _mm_add_ps(ang2y, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentB[1][h]), deltaImpulse));
+		ang2z = _mm_add_ps(ang2z, _mm_mul_ps(_mm_load_ps(&batch.m_angularComponentB[2][h]), deltaImpulse));
+
+		btStoreTransposed4(&bA[0]->m_deltaLinearVelocity, &bA[1]->m_deltaLinearVelocity, &bA[2]->m_deltaLinearVelocity, &bA[3]->m_deltaLinearVelocity, lin1x, lin1y, lin1z, lin1w, laneMask);
+		btStoreTransposed4(&bA[0]->m_deltaAngularVelocity, &bA[1]->m_deltaAngularVelocity, &bA[2]->m_deltaAngularVelocity, &bA[3]->m_deltaAngularVelocity, ang1x, ang1y, ang1z, ang1w, laneMask);
+		btStoreTransposed4(&bB[0]->m_deltaLinearVelocity, &bB[1]->m_deltaLinearVelocity, &bB[2]->m_deltaLinearVelocity, &bB[3]->m_deltaLinearVelocity, lin2x, lin2y, lin2z, lin2w, laneMask);
+		btStoreTransposed4(&bB[0]->m_deltaAngularVelocity, &bB[1]->m_deltaAngularVelocity, &bB[2]->m_deltaAngularVelocity, &bB[3]->m_deltaAngularVelocity, ang2x, ang2y, ang2z, ang2w, laneMask);
+	}
+}
+
+#ifdef BT_ALLOW_AVX2
+
+///loads lane l of x,y,z,w from v[l], for 8 lanes
+BT_TARGET_AVX2_NO_FMA static inline void	btLoadTransposed8(btVector3* const* v, __m256& x, __m256& y, __m256& z, __m256& w)
+{
+	__m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(v[0]->get128()), v[4]->get128(), 1);
+	__m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(v[1]->get128()), v[5]->get128(), 1);
+	__m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(v[2]->get128()), v[6]->get128(), 1);
+	__m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(v[3]->get128()), v[7]->get128(), 1);
+	__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+	x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+	y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+	z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+	w = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+}
+
+BT_TARGET_AVX2_NO_FMA static inline void	btStoreTransposed8(btVector3* const* v, __m256 x, __m256 y, __m256 z, __m256 w, int laneMask)
+{
+	__m256 t0 = _mm256_unpacklo_ps(x, y);
+	__m256 t1 = _mm256_unpackhi_ps(x, y);
+	__m256 t2 = _mm256_unpacklo_ps(z, w);
+	__m256 t3 = _mm256_unpackhi_ps(z, w);
+	__m256 r[4];
+	r[0] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+	r[1] = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+	r[2] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+	r[3] = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3,2,3,2));
+	for (int l=0;l<4;l++)
+	{
+		if (laneMask & (1<<l))
+			v[l]->set128(_mm256_castps256_ps128(r[l]));
+		if (laneMask & (16<<l))
+			v[l+4]->set128(_mm256_extractf128_ps(r[l], 1));
+	}
+}
+
+BT_TARGET_AVX2_NO_FMA static inline __m256	btDot3Lanes8(__m256 ax, __m256 ay, __m256 az, __m256 bx, __m256 by, __m256 bz)
+{
+	return _mm256_add_ps(_mm256_mul_ps(ax, bx), _mm256_add_ps(_mm256_mul_ps(ay, by), _mm256_mul_ps(az, bz)));
+}
+
+///solves all 8 lanes at once, without FMA so the results match the SSE2 kernel
+BT_TARGET_AVX2_NO_FMA static void	btSolveRowBatchAVX2(btSolverRowBatch& batch, btSolverBody** bodyA, btSolverBody** bodyB, int activeMask, bool clampUpper)
+{
+	btVector3* lin1[BT_SOLVER_BATCH_WIDTH];
+	btVector3* ang1[BT_SOLVER_BATCH_WIDTH];
+	btVector3* lin2[BT_SOLVER_BATCH_WIDTH];
+	btVector3* ang2[BT_SOLVER_BATCH_WIDTH];
+	for (int l=0;l<BT_SOLVER_BATCH_WIDTH;l++)
+	{
+		lin1[l] = &bodyA[l]->m_deltaLinearVelocity;
+		ang1[l] = &bodyA[l]->m_deltaAngularVelocity;
+		lin2[l] = &bodyB[l]->m_deltaLinearVelocity;
+		ang2[l] = &bodyB[l]->m_deltaAngularVelocity;
+	}
+	__m256 lin1x,lin1y,lin1z,lin1w, ang1x,ang1y,ang1z,ang1w, lin2x,lin2y,lin2z,lin2w, ang2x,ang2y,ang2z,ang2w;
+	btLoadTransposed8(lin1, lin1x, lin1y, lin1z, lin1w);
+	btLoadTransposed8(ang1, ang1x, ang1y, ang1z, ang1w);
+	btLoadTransposed8(lin2, lin2x, lin2y, lin2z, lin2w);
+	btLoadTransposed8(ang2, ang2x, ang2y, ang2z, ang2w);
+
+	const __m256 nx = _mm256_loadu_ps(batch.m_contactNormal[0]);
+	const __m256 ny = _mm256_loadu_ps(batch.m_contactNormal[1]);
+	const __m256 nz = _mm256_loadu_ps(batch.m_contactNormal[2]);
+	const __m256 applied = _mm256_loadu_ps(batch.m_appliedImpulse);
+	const __m256 lower = _mm256_loadu_ps(batch.m_lowerLimit);
+	const __m256 upper = _mm256_loadu_ps(batch.m_upperLimit);
+	const __m256 jacDiagABInv = _mm256_loadu_ps(batch.m_jacDiagABInv);
+
+	__m256 deltaImpulse = _mm256_sub_ps(_mm256_loadu_ps(batch.m_rhs), _mm256_mul_ps(applied, _mm256_loadu_ps(batch.m_cfm)));
+	__m256 dotN1 = btDot3Lanes8(nx, ny, nz, lin1x, lin1y, lin1z);
+	__m256 dotR1 = btDot3Lanes8(_mm256_loadu_ps(batch.m_relpos1CrossNormal[0]), _mm256_loadu_ps(batch.m_relpos1CrossNormal[1]), _mm256_loadu_ps(batch.m_relpos1CrossNormal[2]), ang1x, ang1y, ang1z);
+	__m256 dotN2 = btDot3Lanes8(nx, ny, nz, lin2x, lin2y, lin2z);
+	__m256 dotR2 = btDot3Lanes8(_mm256_loadu_ps(batch.m_relpos2CrossNormal[0]), _mm256_loadu_ps(batch.m_relpos2CrossNormal[1]), _mm256_loadu_ps(batch.m_relpos2CrossNormal[2]), ang2x, ang2y, ang2z);
+	deltaImpulse = _mm256_sub_ps(deltaImpulse, _mm256_mul_ps(_mm256_add_ps(dotN1, dotR1), jacDiagABInv));
+	deltaImpulse = _mm256_sub_ps(deltaImpulse, _mm256_mul_ps(_mm256_sub_ps(dotR2, dotN2), jacDiagABInv));
+	const __m256 sum = _mm256_add_ps(applied, deltaImpulse);
+	const __m256 lowerLess = _mm256_cmp_ps(sum, lower, _CMP_LT_OQ);
+	deltaImpulse = _mm256_blendv_ps(deltaImpulse, _mm256_sub_ps(lower, applied), lowerLess);
+	__m256 newApplied = _mm256_blendv_ps(sum, lower, lowerLess);
+	if (clampUpper)
+	{
+		const __m256 upperLess = _mm256_cmp_ps(sum, upper, _CMP_LT_OQ);
+		deltaImpulse = _mm256_blendv_ps(_mm256_sub_ps(upper, applied), deltaImpulse, upperLess);
+		newApplied = _mm256_blendv_ps(upper, newApplied, upperLess);
+	}
+	const __m256i laneBits = _mm256_set_epi32(128,64,32,16,8,4,2,1);
+	const __m256 active = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(activeMask), laneBits), laneBits));
+	_mm256_storeu_ps(batch.m_appliedImpulse, _mm256_blendv_ps(applied, newApplied, active));
+
+	const __m256 invMassA = _mm256_loadu_ps(batch.m_invMassA);
+	const __m256 invMassB = _mm256_loadu_ps(batch.m_invMassB);
+	lin1x = _mm256_add_ps(lin1x, _mm256_mul_ps(_mm256_mul_ps(nx, invMassA), deltaImpulse));
+	lin1y = _mm256_add_ps(lin1y, _mm256_mul_ps(_mm256_mul_ps(ny, invMassA), deltaImpulse));
+	lin1z = _mm256_add_ps(lin1z, _mm256_mul_ps(_mm256_mul_ps(nz, invMassA), deltaImpulse));
+	ang1x = _mm256_add_ps(ang1x, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentA[0]), deltaImpulse));
+	ang1y = _mm256_add_ps(ang1y, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentA[1]), deltaImpulse));
+	ang1z = _mm256_add_ps(ang1z, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentA[2]), deltaImpulse));
+	lin2x = _mm256_sub_ps(lin2x, _mm256_mul_ps(_mm256_mul_ps(nx, invMassB), deltaImpulse));
+	lin2y = _mm256_sub_ps(lin2y, _mm256_mul_ps(_mm256_mul_ps(ny, invMassB), deltaImpulse));
+	lin2z = _mm256_sub_ps(lin2z, _mm256_mul_ps(_mm256_mul_ps(nz, invMassB), deltaImpulse));
+	ang2x = _mm256_add_ps(ang2x, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentB[0]), deltaImpulse));
+	ang2y = _mm256_add_ps(ang2y, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentB[1]), deltaImpulse));
+	ang2z = _mm256_add_ps(ang2z, _mm256_mul_ps(_mm256_loadu_ps(batch.m_angularComponentB[2]), deltaImpulse));
+
+	btStoreTransposed8(lin1, lin1x, lin1y, lin1z, lin1w, activeMask);
+	btStoreTransposed8(ang1, ang1x, ang1y, ang1z, ang1w, activeMask);
+	btStoreTransposed8(lin2, lin2x, lin2y, lin2z, lin2w, activeMask);
+	btStoreTransposed8(ang2, ang2x, ang2y, ang2z, ang2w, activeMask);
+	_mm256_zeroupper();
+}
+#endif //BT_ALLOW_AVX2
+
+#endif //USE_SIMD
+
+static btSolverRowBatchKernel	btSelectRowBatchKernel(btCpuFeatureUtility::btSimdVariant variant)
+{
+#ifdef USE_SIMD
+#ifdef BT_ALLOW_AVX2
+	if (variant >= btCpuFeatureUtility::BT_SIMD_AVX2)
+		return btSolveRowBatchAVX2;
+#endif
+	if (variant >= btCpuFeatureUtility::BT_SIMD_SSE2)
+		return btSolveRowBatchSSE2;
+#endif //USE_SIMD
+	(void)variant;
+	return btSolveRowBatchScalar;
+}
+
+int	btSolverRowBatchPool::findOpenBatch(int batch)
+{
+	int root = batch;
+	while ((root < m_batches.size()) && (m_nextOpen[root] != root))
+	{
+		root = m_nextOpen[root];
+	}
+	if (root == m_batches.size())
+	{
+		btSolverRowBatch& newBatch = m_batches.expand();
+		memset(&newBatch, 0, sizeof(btSolverRowBatch));
+		for (int l=0;l<BT_SOLVER_BATCH_WIDTH;l++)
+		{
+			newBatch.m_rowIndex[l] = -1;
+		}
+		m_nextOpen.push_back(root);
+		m_numLanes.push_back(0);
+	}
+	//path compression, so packing stays close to linear in the number of rows
+	while (batch != root)
+	{
+		int next = m_nextOpen[batch];
+		m_nextOpen[batch] = root;
+		batch = next;
+	}
+	return root;
+}
+
+void	btSolverRowBatchPool::build(const btConstraintArray& rows, const btAlignedObjectArray<btSolverBody>& bodies, const btSolverRowBatchPool* contactPool)
+{
+	m_batches.resize(0);
+	m_nextOpen.resize(0);
+	m_numLanes.resize(0);
+	m_rowSlot.resize(rows.size());
+	m_lastBatch.resize(bodies.size());
+	int i;
+	for (i=0;i<bodies.size();i++)
+	{
+		m_lastBatch[i] = -1;
+	}
+
+	for (i=0;i<rows.size();i++)
+	{
+		const btSolverConstraint& row = rows[i];
+		const int bodyIdA = row.m_solverBodyIdA;
+		const int bodyIdB = row.m_solverBodyIdB;
+		//bodies without mass never change velocity, so they can be shared by the lanes of a batch
+		const bool dynamicA = bodies[bodyIdA].m_invMass != btScalar(0.);
+		const bool dynamicB = bodies[bodyIdB].m_invMass != btScalar(0.);
+
+		//the row has to come after the previous rows of both bodies
+		int batchIndex = 0;
+		if (dynamicA)
+			batchIndex = btMax(batchIndex, m_lastBatch[bodyIdA]+1);
+		if (dynamicB)
+			batchIndex = btMax(batchIndex, m_lastBatch[bodyIdB]+1);
+		batchIndex = findOpenBatch(batchIndex);
+
+		btSolverRowBatch& batch = m_batches[batchIndex];
+		const int lane = m_numLanes[batchIndex]++;
+		if (m_numLanes[batchIndex] == BT_SOLVER_BATCH_WIDTH)
+		{
+			m_nextOpen[batchIndex] = batchIndex+1;
+		}
+		for (int k=0;k<3;k++)
+		{
+			batch.m_contactNormal[k][lane] = row.m_contactNormal[k];
+			batch.m_relpos1CrossNormal[k][lane] = row.m_relpos1CrossNormal[k];
+			batch.m_relpos2CrossNormal[k][lane] = row.m_relpos2CrossNormal[k];
+			batch.m_angularComponentA[k][lane] = row.m_angularComponentA[k];
+			batch.m_angularComponentB[k][lane] = row.m_angularComponentB[k];
+		}
+		batch.m_rhs[lane] = row.m_rhs;
+		batch.m_cfm[lane] = row.m_cfm;
+		batch.m_jacDiagABInv[lane] = row.m_jacDiagABInv;
+		batch.m_lowerLimit[lane] = row.m_lowerLimit;
+		batch.m_upperLimit[lane] = row.m_upperLimit;
+		batch.m_friction[lane] = row.m_friction;
+		batch.m_appliedImpulse[lane] = row.m_appliedImpulse;
+		batch.m_invMassA[lane] = bodies[bodyIdA].m_invMass;
+		batch.m_invMassB[lane] = bodies[bodyIdB].m_invMass;
+		batch.m_solverBodyIdA[lane] = bodyIdA;
+		batch.m_solverBodyIdB[lane] = bodyIdB;
+		batch.m_rowIndex[lane] = i;
+		batch.m_laneMask |= 1<<lane;
+		batch.m_contactSlot[lane] = contactPool ? contactPool->m_rowSlot[row.m_frictionIndex] : 0;
+		m_rowSlot[i] = batchIndex*BT_SOLVER_BATCH_WIDTH+lane;
+
+		if (dynamicA)
+			m_lastBatch[bodyIdA] = batchIndex;
+		if (dynamicB)
+			m_lastBatch[bodyIdB] = batchIndex;
+	}
+}
+
+void	btSolverRowBatchPool::solve(btRowType rowType, btAlignedObjectArray<btSolverBody>& bodies, const btSolverRowBatchPool* contactPool, btCpuFeatureUtility::btSimdVariant variant)
+{
+	btSolverRowBatchKernel kernel = btSelectRowBatchKernel(variant);
+	btSolverBody* bodyA[BT_SOLVER_BATCH_WIDTH];
+	btSolverBody* bodyB[BT_SOLVER_BATCH_WIDTH];
+	const bool clampUpper = (rowType != BT_ROW_LOWER_LIMIT);
+
+	if (!m_batches.size())
+		return;
+	btSolverBody* bodyBase = &bodies[0];
+
+	for (int b=0;b<m_batches.size();b++)
+	{
+		btSolverRowBatch& batch = m_batches[b];
+		int activeMask = batch.m_laneMask;
+		for (int l=0;l<BT_SOLVER_BATCH_WIDTH;l++)
+		{
+			bodyA[l] = bodyBase + batch.m_solverBodyIdA[l];
+			bodyB[l] = bodyBase + batch.m_solverBodyIdB[l];
+		}
+		if (rowType == BT_ROW_FRICTION)
+		{
+			const btSolverRowBatch* contactBatches = &contactPool->m_batches[0];
+			for (int l=0;l<BT_SOLVER_BATCH_WIDTH;l++)
+			{
+				if (!(activeMask & (1<<l)))
+					continue;
+				const unsigned int slot = batch.m_contactSlot[l];
+				btScalar totalImpulse = contactBatches[slot/BT_SOLVER_BATCH_WIDTH].m_appliedImpulse[slot%BT_SOLVER_BATCH_WIDTH];
+				if (totalImpulse>btScalar(0))
+				{
+					batch.m_lowerLimit[l] = -(batch.m_friction[l]*totalImpulse);
+					batch.m_upperLimit[l] = batch.m_friction[l]*totalImpulse;
+				} else
+				{
+					activeMask &= ~(1<<l);
+				}
+			}
+		}
+		if (activeMask)
+		{
+			kernel(batch, bodyA, bodyB, activeMask, clampUpper);
+		}
+	}
+}
+
+void	btSolverRowBatchPool::writeback(btConstraintArray& rows) const
+{
+	for (int i=0;i<rows.size();i++)
+	{
+		const int slot = m_rowSlot[i];
+		const btSolverRowBatch& batch = m_batches[slot/BT_SOLVER_BATCH_WIDTH];
+		rows[i].m_appliedImpulse = batch.m_appliedImpulse[slot%BT_SOLVER_BATCH_WIDTH];
+		rows[i].m_lowerLimit = batch.m_lowerLimit[slot%BT_SOLVER_BATCH_WIDTH];
+		rows[i].m_upperLimit = batch.m_upperLimit[slot%BT_SOLVER_BATCH_WIDTH];
+	}
+}
+
+btScalar	btSolverRowBatchPool::getAverageBatchSize() const
+{
+	if (!m_batches.size())
+		return btScalar(0.);
+	return btScalar(m_rowSlot.size()) / btScalar(m_batches.size());
+}
@@ -0,0 +1,99 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOLVER_ROW_BATCH_H
+#define BT_SOLVER_ROW_BATCH_H
+
+#include "btSolverConstraint.h"
+#include "btSolverBody.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btCpuFeatureUtility.h"
+
+#define BT_SOLVER_BATCH_WIDTH 8
+
+///btSolverRowBatch holds up to BT_SOLVER_BATCH_WIDTH constraint rows in structure-of-arrays layout.
+///The rows in a batch never share a dynamic solver body, so they can be solved with one set of SIMD instructions.
+ATTRIBUTE_ALIGNED16 (struct)	btSolverRowBatch
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btScalar	m_contactNormal[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_relpos1CrossNormal[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_relpos2CrossNormal[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_angularComponentA[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_angularComponentB[3][BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_rhs[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_cfm[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_jacDiagABInv[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_lowerLimit[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_upperLimit[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_friction[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_appliedImpulse[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_invMassA[BT_SOLVER_BATCH_WIDTH];
+	btScalar	m_invMassB[BT_SOLVER_BATCH_WIDTH];
+
+	///solver body indices, empty lanes point to the fixed body 0
+	int			m_solverBodyIdA[BT_SOLVER_BATCH_WIDTH];
+	int			m_solverBodyIdB[BT_SOLVER_BATCH_WIDTH];
+	///index of the row in its constraint pool, -1 for empty lanes
+	int			m_rowIndex[BT_SOLVER_BATCH_WIDTH];
+	///friction rows only: batch*BT_SOLVER_BATCH_WIDTH+lane of the contact row that limits this row
+	int			m_contactSlot[BT_SOLVER_BATCH_WIDTH];
+	///one bit for each lane that holds a row
+	int			m_laneMask;
+};
+
+///btSolverRowBatchPool packs one constraint pool into batches, keeping the order in which each body sees its rows.
+///Solving the batches in order is then equivalent to solving the rows one by one with the SSE2 row kernels.
+class btSolverRowBatchPool
+{
+public:
+	enum btRowType
+	{
+		BT_ROW_GENERIC = 0,	///clamped to m_lowerLimit and m_upperLimit, used for joint rows
+		BT_ROW_LOWER_LIMIT,	///only clamped to m_lowerLimit, used for contact rows
+		BT_ROW_FRICTION		///limits follow the applied impulse of the contact row, rows without contact impulse are skipped
+	};
+
+	btAlignedObjectArray<btSolverRowBatch>	m_batches;
+	///batch*BT_SOLVER_BATCH_WIDTH+lane for each row of the pool
+	btAlignedObjectArray<int>	m_rowSlot;
+
+	///packs the rows. Friction rows need the pool of contact rows to be packed first, to find their contact slots.
+	void	build(const btConstraintArray& rows, const btAlignedObjectArray<btSolverBody>& bodies, const btSolverRowBatchPool* contactPool);
+
+	///solves every batch once. contactPool provides the contact impulses for BT_ROW_FRICTION.
+	void	solve(btRowType rowType, btAlignedObjectArray<btSolverBody>& bodies, const btSolverRowBatchPool* contactPool, btCpuFeatureUtility::btSimdVariant variant);
+
+	///copies the applied impulses back into the rows
+	void	writeback(btConstraintArray& rows) const;
+
+	int		getNumBatches() const
+	{
+		return m_batches.size();
+	}
+
+	///average number of rows per batch, between 1 and BT_SOLVER_BATCH_WIDTH
+	btScalar	getAverageBatchSize() const;
+
+protected:
+	btAlignedObjectArray<int>	m_lastBatch;
+	btAlignedObjectArray<int>	m_nextOpen;
+	btAlignedObjectArray<int>	m_numLanes;
+
+	int		findOpenBatch(int batch);
+};
+
+#endif //BT_SOLVER_ROW_BATCH_H
@@ -23,6 +23,8 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 #include "LinearMath/btTransformUtil.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btStackAlloc.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 //rigidbody & constraints
 #include "BulletDynamics/Dynamics/btRigidBody.h"
@@ -67,7 +69,9 @@ btDiscreteDynamicsWorld::btDiscreteDynamicsWorld(btDispatcher* dispatcher,btBroa
 m_constraintSolver(constraintSolver),
 m_gravity(0,-10,0),
 m_localTime(btScalar(1.)/btScalar(60.)),
-m_profileTimings(0)
+m_profileTimings(0),
+m_trackStepAllocations(false),
+m_numStepAllocations(-1)
 {
 	if (!m_constraintSolver)
 	{
@@ -304,6 +308,13 @@ void	btDiscreteDynamicsWorld::synchronizeMotionStates()
 
 int	btDiscreteDynamicsWorld::stepSimulation( btScalar timeStep,int maxSubSteps, btScalar fixedTimeStep)
 {
+	int numAllocsBefore = 0;
+	if (m_trackStepAllocations)
+	{
+		btAlignedAllocBeginTracking();
+		numAllocsBefore = btAlignedAllocGetNumTrackedAllocs();
+	}
+
 	startProfiling(timeStep);
 
 	BT_PROFILE("stepSimulation");
@@ -362,9 +373,19 @@ int	btDiscreteDynamicsWorld::stepSimulation( btScalar timeStep,int maxSubSteps,
 
 	clearForces();
 
+	///all scratch memory of this step is released at once
+	if (m_stackAlloc)
+		m_stackAlloc->reset();
+
 #ifndef BT_NO_PROFILE
 	CProfileManager::Increment_Frame_Counter();
 #endif //BT_NO_PROFILE
+
+	if (m_trackStepAllocations)
+	{
+		btAlignedAllocEndTracking();
+		m_numStepAllocations = btAlignedAllocGetNumTrackedAllocs()-numAllocsBefore;
+	}
 	
 	return numSimulationSubSteps;
 }
@@ -469,6 +490,53 @@ void	btDiscreteDynamicsWorld::addRigidBody(btRigidBody* body, short group, short
 }
 
 
+void	btDiscreteDynamicsWorld::addRigidBodies(btRigidBody* const* bodies,int numBodies)
+{
+	btAlignedObjectArray<btCollisionObject*> objects;
+	btAlignedObjectArray<short> groups;
+	btAlignedObjectArray<short> masks;
+	objects.reserve(numBodies);
+	groups.reserve(numBodies);
+	masks.reserve(numBodies);
+
+	for (int i=0;i<numBodies;i++)
+	{
+		btRigidBody* body = bodies[i];
+		if (!body->isStaticOrKinematicObject())
+		{
+			body->setGravity(m_gravity);
+		}
+
+		if (body->getCollisionShape())
+		{
+			bool isDynamic = !(body->isStaticObject() || body->isKinematicObject());
+			objects.push_back(body);
+			groups.push_back(isDynamic? short(btBroadphaseProxy::DefaultFilter) : short(btBroadphaseProxy::StaticFilter));
+			masks.push_back(isDynamic? 	short(btBroadphaseProxy::AllFilter) : 	short(btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter));
+		}
+	}
+
+	if (objects.size())
+	{
+		addCollisionObjects(&objects[0],objects.size(),&groups[0],&masks[0]);
+	}
+}
+
+void	btDiscreteDynamicsWorld::removeRigidBodies(btRigidBody* const* bodies,int numBodies)
+{
+	btAlignedObjectArray<btCollisionObject*> objects;
+	objects.resize(numBodies);
+	for (int i=0;i<numBodies;i++)
+	{
+		objects[i] = bodies[i];
+	}
+	if (numBodies>0)
+	{
+		removeCollisionObjects(&objects[0],numBodies);
+	}
+}
+
+
 void	btDiscreteDynamicsWorld::updateVehicles(btScalar timeStep)
 {
 	BT_PROFILE("updateVehicles");
@@ -534,6 +602,7 @@ void	btDiscreteDynamicsWorld::updateActivationState(btScalar timeStep)
 void	btDiscreteDynamicsWorld::addConstraint(btTypedConstraint* constraint,bool disableCollisionsBetweenLinkedBodies)
 {
 	m_constraints.push_back(constraint);
+	m_islandManager->addConstraintEdge(&constraint->getRigidBodyA(),&constraint->getRigidBodyB(),constraint);
 	if (disableCollisionsBetweenLinkedBodies)
 	{
 		constraint->getRigidBodyA().addConstraintRef(constraint);
@@ -544,6 +613,7 @@ void	btDiscreteDynamicsWorld::addConstraint(btTypedConstraint* constraint,bool d
 void	btDiscreteDynamicsWorld::removeConstraint(btTypedConstraint* constraint)
 {
 	m_constraints.remove(constraint);
+	m_islandManager->removeConstraintEdge(&constraint->getRigidBodyA(),&constraint->getRigidBodyB(),constraint);
 	constraint->getRigidBodyA().removeConstraintRef(constraint);
 	constraint->getRigidBodyB().removeConstraintRef(constraint);
 }
@@ -600,6 +670,7 @@ class btSortConstraintOnIslandPredicate
 void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	BT_PROFILE("solveConstraints");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOLVER);
 	
 	struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCallback
 	{
@@ -612,6 +683,11 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 		btStackAlloc*			m_stackAlloc;
 		btDispatcher*			m_dispatcher;
 
+		///islands collected for one solveGroup call, used with SOLVER_SIMD_BATCHED so the solver can fill its batches
+		btAlignedObjectArray<btCollisionObject*>& m_bodies;
+		btAlignedObjectArray<btPersistentManifold*>& m_manifolds;
+		btAlignedObjectArray<btTypedConstraint*>& m_constraints;
+
 		InplaceSolverIslandCallback(
 			btContactSolverInfo& solverInfo,
 			btConstraintSolver*	solver,
@@ -619,16 +695,24 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 			int	numConstraints,
 			btIDebugDraw*	debugDrawer,
 			btStackAlloc*			stackAlloc,
-			btDispatcher* dispatcher)
+			btDispatcher* dispatcher,
+			btAlignedObjectArray<btCollisionObject*>& bodies,
+			btAlignedObjectArray<btPersistentManifold*>& manifolds,
+			btAlignedObjectArray<btTypedConstraint*>& constraints)
 			:m_solverInfo(solverInfo),
 			m_solver(solver),
 			m_sortedConstraints(sortedConstraints),
 			m_numConstraints(numConstraints),
 			m_debugDrawer(debugDrawer),
 			m_stackAlloc(stackAlloc),
-			m_dispatcher(dispatcher)
+			m_dispatcher(dispatcher),
+			m_bodies(bodies),
+			m_manifolds(manifolds),
+			m_constraints(constraints)
 		{
-
+			m_bodies.resize(0);
+			m_manifolds.resize(0);
+			m_constraints.resize(0);
 		}
 
 		InplaceSolverIslandCallback& operator=(InplaceSolverIslandCallback& other)
@@ -668,6 +752,20 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 					}
 				}
 
+				if (m_solverInfo.m_solverMode & SOLVER_SIMD_BATCHED)
+				{
+					//islands share no dynamic bodies, so solving several islands together gives the same result
+					for (i=0;i<numBodies;i++)
+						m_bodies.push_back(bodies[i]);
+					for (i=0;i<numManifolds;i++)
+						m_manifolds.push_back(manifolds[i]);
+					for (i=0;i<numCurConstraints;i++)
+						m_constraints.push_back(startConstraint[i]);
+					if ((m_manifolds.size()+m_constraints.size()) > m_solverInfo.m_minimumSolverBatchSize)
+					{
+						processConstraints();
+					}
+				} else
 				///only call solveGroup if there is some work: avoid virtual function call, its overhead can be excessive
 				if (numManifolds + numCurConstraints)
 				{
@@ -677,32 +775,49 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 			}
 		}
 
+		///solves the collected islands
+		void	processConstraints()
+		{
+			if (m_manifolds.size() + m_constraints.size())
+			{
+				btCollisionObject** bodies = m_bodies.size()? &m_bodies[0]:0;
+				btPersistentManifold** manifolds = m_manifolds.size()?&m_manifolds[0]:0;
+				btTypedConstraint** constraints = m_constraints.size()?&m_constraints[0]:0;
+				m_solver->solveGroup( bodies,m_bodies.size(),manifolds, m_manifolds.size(),constraints, m_constraints.size(),m_solverInfo,m_debugDrawer,m_stackAlloc,m_dispatcher);
+			}
+			m_bodies.resize(0);
+			m_manifolds.resize(0);
+			m_constraints.resize(0);
+		}
+
 	};
 
 	//sorted version of all btTypedConstraint, based on islandId
-	btAlignedObjectArray<btTypedConstraint*>	sortedConstraints;
-	sortedConstraints.resize( m_constraints.size());
+	m_sortedConstraints.resize( m_constraints.size());
 	int i; 
 	for (i=0;i<getNumConstraints();i++)
 	{
-		sortedConstraints[i] = m_constraints[i];
+		m_sortedConstraints[i] = m_constraints[i];
 	}
 
 //	assert(0);
 		
 	
 
-	sortedConstraints.quickSort(btSortConstraintOnIslandPredicate());
+	m_sortedConstraints.quickSort(btSortConstraintOnIslandPredicate());
 	
-	btTypedConstraint** constraintsPtr = getNumConstraints() ? &sortedConstraints[0] : 0;
+	btTypedConstraint** constraintsPtr = getNumConstraints() ? &m_sortedConstraints[0] : 0;
 	
-	InplaceSolverIslandCallback	solverCallback(	solverInfo,	m_constraintSolver, constraintsPtr,sortedConstraints.size(),	m_debugDrawer,m_stackAlloc,m_dispatcher1);
+	InplaceSolverIslandCallback	solverCallback(	solverInfo,	m_constraintSolver, constraintsPtr,m_sortedConstraints.size(),	m_debugDrawer,m_stackAlloc,m_dispatcher1,
+		m_batchedBodies,m_batchedManifolds,m_batchedConstraints);
 	
 	m_constraintSolver->prepareSolve(getCollisionWorld()->getNumCollisionObjects(), getCollisionWorld()->getDispatcher()->getNumManifolds());
 	
 	/// solve all the constraints for this island
 	m_islandManager->buildAndProcessIslands(getCollisionWorld()->getDispatcher(),getCollisionWorld(),&solverCallback);
 
+	solverCallback.processConstraints();
+
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer, m_stackAlloc);
 }
 
@@ -712,9 +827,12 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 void	btDiscreteDynamicsWorld::calculateSimulationIslands()
 {
 	BT_PROFILE("calculateSimulationIslands");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOLVER);
 
 	getSimulationIslandManager()->updateActivationState(getCollisionWorld(),getCollisionWorld()->getDispatcher());
 
+	//an incremental island manager keeps its own constraint edges
+	if (!getSimulationIslandManager()->isIncremental())
 	{
 		int i;
 		int numConstraints = int(m_constraints.size());
@@ -795,7 +913,10 @@ public:
 			return false;
 
 		///don't do CCD when there are already contact points (touching contact/penetration)
-		btAlignedObjectArray<btPersistentManifold*> manifoldArray;
+		///the manifolds are gathered on the stack, clampCcdMotion may run on several threads
+		btPersistentManifold* manifoldBuffer[4];
+		btManifoldArray manifoldArray;
+		manifoldArray.initializeFromBuffer(manifoldBuffer,0,4);
 		btBroadphasePair* collisionPair = m_pairCache->findPair(m_me->getBroadphaseHandle(),proxy0);
 		if (collisionPair)
 		{
@@ -820,6 +941,24 @@ public:
 ///internal debugging variable. this value shouldn't be too high
 int gNumClampedCcdMotions=0;
 
+void	btDiscreteDynamicsWorld::clampCcdMotion(btRigidBody* body,btScalar timeStep,btTransform& predictedTrans) const
+{
+	btClosestNotMeConvexResultCallback sweepResults(body,body->getWorldTransform().getOrigin(),predictedTrans.getOrigin(),m_broadphasePairCache->getOverlappingPairCache());
+	btSphereShape tmpSphere(body->getCcdSweptSphereRadius());//btConvexShape* convexShape = static_cast<btConvexShape*>(body->getCollisionShape());
+
+	sweepResults.m_collisionFilterGroup = body->getBroadphaseProxy()->m_collisionFilterGroup;
+	sweepResults.m_collisionFilterMask  = body->getBroadphaseProxy()->m_collisionFilterMask;
+
+	convexSweepTest(&tmpSphere,body->getWorldTransform(),predictedTrans,sweepResults);
+	if (sweepResults.hasHit() && (sweepResults.m_closestHitFraction < 1.f))
+	{
+		body->setHitFraction(sweepResults.m_closestHitFraction);
+		body->predictIntegratedTransform(timeStep*body->getHitFraction(), predictedTrans);
+		body->setHitFraction(0.f);
+//		printf("clamped integration to hit fraction = %f\n",fraction);
+	}
+}
+
 //#include "stdio.h"
 void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 {
@@ -844,22 +983,7 @@ void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 					if (body->getCollisionShape()->isConvex())
 					{
 						gNumClampedCcdMotions++;
-						
-						btClosestNotMeConvexResultCallback sweepResults(body,body->getWorldTransform().getOrigin(),predictedTrans.getOrigin(),getBroadphase()->getOverlappingPairCache());
-						btConvexShape* convexShape = static_cast<btConvexShape*>(body->getCollisionShape());
-						btSphereShape tmpSphere(body->getCcdSweptSphereRadius());//btConvexShape* convexShape = static_cast<btConvexShape*>(body->getCollisionShape());
-
-						sweepResults.m_collisionFilterGroup = body->getBroadphaseProxy()->m_collisionFilterGroup;
-						sweepResults.m_collisionFilterMask  = body->getBroadphaseProxy()->m_collisionFilterMask;
-
-						convexSweepTest(&tmpSphere,body->getWorldTransform(),predictedTrans,sweepResults);
-						if (sweepResults.hasHit() && (sweepResults.m_closestHitFraction < 1.f))
-						{
-							body->setHitFraction(sweepResults.m_closestHitFraction);
-							body->predictIntegratedTransform(timeStep*body->getHitFraction(), predictedTrans);
-							body->setHitFraction(0.f);
-//							printf("clamped integration to hit fraction = %f\n",fraction);
-						}
+						clampCcdMotion(body,timeStep,predictedTrans);
 					}
 				}
 				
@@ -1196,6 +1320,28 @@ void	btDiscreteDynamicsWorld::setConstraintSolver(btConstraintSolver* solver)
 	m_constraintSolver = solver;
 }
 
+void	btDiscreteDynamicsWorld::setSimulationIslandManager(btSimulationIslandManager* islandManager)
+{
+	int i;
+	for (i=0;i<m_constraints.size();i++)
+	{
+		btTypedConstraint* constraint = m_constraints[i];
+		m_islandManager->removeConstraintEdge(&constraint->getRigidBodyA(),&constraint->getRigidBodyB(),constraint);
+	}
+	if (m_ownsIslandManager)
+	{
+		m_islandManager->~btSimulationIslandManager();
+		btAlignedFree( m_islandManager);
+	}
+	m_ownsIslandManager = false;
+	m_islandManager = islandManager;
+	for (i=0;i<m_constraints.size();i++)
+	{
+		btTypedConstraint* constraint = m_constraints[i];
+		m_islandManager->addConstraintEdge(&constraint->getRigidBodyA(),&constraint->getRigidBodyB(),constraint);
+	}
+}
+
 btConstraintSolver* btDiscreteDynamicsWorld::getConstraintSolver()
 {
 	return m_constraintSolver;
@@ -28,6 +28,8 @@ class btTypedConstraint;
 class btRaycastVehicle;
 class btCharacterControllerInterface;
 class btIDebugDraw;
+class btRigidBody;
+class btPersistentManifold;
 #include "LinearMath/btAlignedObjectArray.h"
 
 
@@ -43,6 +45,14 @@ protected:
 
 	btAlignedObjectArray<btTypedConstraint*> m_constraints;
 
+	///all constraints sorted on island id, kept between steps so solveConstraints doesn't allocate memory
+	btAlignedObjectArray<btTypedConstraint*> m_sortedConstraints;
+
+	///islands collected by solveConstraints for SOLVER_SIMD_BATCHED, kept between steps like m_sortedConstraints
+	btAlignedObjectArray<btCollisionObject*> m_batchedBodies;
+	btAlignedObjectArray<btPersistentManifold*> m_batchedManifolds;
+	btAlignedObjectArray<btTypedConstraint*> m_batchedConstraints;
+
 	btVector3	m_gravity;
 
 	//for variable timesteps
@@ -60,6 +70,9 @@ protected:
 
 	int	m_profileTimings;
 
+	bool	m_trackStepAllocations;
+	int		m_numStepAllocations;
+
 	virtual void	predictUnconstraintMotion(btScalar timeStep);
 	
 	virtual void	integrateTransforms(btScalar timeStep);
@@ -124,6 +137,9 @@ public:
 		return m_islandManager;
 	}
 
+	///replaces the island manager, for example by a btIncrementalIslandManager. The world doesn't own the new manager.
+	void	setSimulationIslandManager(btSimulationIslandManager* islandManager);
+
 	btCollisionWorld*	getCollisionWorld()
 	{
 		return this;
@@ -138,6 +154,11 @@ public:
 
 	virtual void	removeRigidBody(btRigidBody* body);
 
+	///addRigidBodies adds the bodies like addRigidBody, using btCollisionWorld::addCollisionObjects to create the broadphase proxies in one batch
+	virtual void	addRigidBodies(btRigidBody* const* bodies,int numBodies);
+
+	virtual void	removeRigidBodies(btRigidBody* const* bodies,int numBodies);
+
 	void	debugDrawObject(const btTransform& worldTransform, const btCollisionShape* shape, const btVector3& color);
 
 	virtual void	debugDrawWorld();
@@ -164,6 +185,30 @@ public:
 	///apply gravity, call this once per timestep
 	virtual void	applyGravity();
 
+	///clamps the predicted transform of a fast moving convex body to its first time of impact, as done by integrateTransforms.
+	///It only reads the world and the broadphase, so several bodies can be clamped in parallel as long as no transform is updated meanwhile.
+	void	clampCcdMotion(btRigidBody* body,btScalar timeStep,btTransform& predictedTrans) const;
+
+	///setTrackStepAllocations(true) counts the btAlignedAlloc calls made by each stepSimulation. A stable scene, with no new
+	///objects, pairs or contacts, should not allocate at all once the arrays reached their size. The call sites of the last
+	///step are kept by the tracker, see btAlignedAllocGetTrackedRecord and btAlignedAllocPrintTracked.
+	void	setTrackStepAllocations(bool track)
+	{
+		m_trackStepAllocations = track;
+		m_numStepAllocations = -1;
+	}
+
+	bool	getTrackStepAllocations() const
+	{
+		return m_trackStepAllocations;
+	}
+
+	///number of btAlignedAlloc calls in the last stepSimulation, -1 if it wasn't tracked
+	int		getNumStepAllocations() const
+	{
+		return m_numStepAllocations;
+	}
+
 	virtual void	setNumTasks(int numTasks)
 	{
         (void) numTasks;
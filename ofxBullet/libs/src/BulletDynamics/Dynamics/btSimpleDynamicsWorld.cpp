@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 #include "BulletDynamics/ConstraintSolver/btContactSolverInfo.h"
+#include "LinearMath/btStackAlloc.h"
 
 
 /*
@@ -91,6 +92,9 @@ int		btSimpleDynamicsWorld::stepSimulation( btScalar timeStep,int maxSubSteps, b
 
 	clearForces();
 
+	if (m_stackAlloc)
+		m_stackAlloc->reset();
+
 	return 1;
 
 }
@@ -21,6 +21,7 @@ subject to the following restrictions:
 
 #include "SpuCollisionTaskProcess.h"
 #include "SpuNarrowPhaseCollisionTask/SpuGatheringCollisionTask.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 #define checkPThreadFunction(returnValue) \
     if(0 != returnValue) { \
@@ -47,13 +48,10 @@ PosixThreadSupport::~PosixThreadSupport()
 #define NAMED_SEMAPHORES
 #endif
 
-// this semaphore will signal, if and how many threads are finished with their work
-static sem_t* mainSemaphore;
-
 static sem_t* createSem(const char* baseName)
 {
-	static int semCount = 0;
 #ifdef NAMED_SEMAPHORES
+	static int semCount = 0;
         /// Named semaphore begin
         char name[32];
         snprintf(name, 32, "/%s-%d-%4.4d", baseName, getpid(), semCount++); 
@@ -100,14 +98,18 @@ static void *threadFunction(void *argument)
 		if (userPtr)
 		{
 			btAssert(status->m_status);
-			status->m_userThreadFunc(userPtr,status->m_lsMemory);
+			{
+				BT_ALLOC_TAG_SCOPE(status->m_allocTag);
+				status->m_userThreadFunc(userPtr,status->m_lsMemory);
+			}
 			status->m_status = 2;
-			checkPThreadFunction(sem_post(mainSemaphore));
+			checkPThreadFunction(sem_post(status->m_mainSemaphore));
 	                status->threadUsed++;
 		} else {
 			//exit Thread
+			btThreadCachingAllocator::releaseThreadCache();
 			status->m_status = 3;
-			checkPThreadFunction(sem_post(mainSemaphore));
+			checkPThreadFunction(sem_post(status->m_mainSemaphore));
 			printf("Thread with taskId %i exiting\n",status->m_taskId);
 			break;
 		}
@@ -139,6 +141,7 @@ void PosixThreadSupport::sendRequest(uint32_t uiCommand, ppu_address_t uiArgumen
 			spuStatus.m_commandId = uiCommand;
 			spuStatus.m_status = 1;
 			spuStatus.m_userPtr = (void*)uiArgument0;
+			spuStatus.m_allocTag = btThreadCachingAllocator::getThreadTag();
 
 			// fire event to start new task
 			checkPThreadFunction(sem_post(spuStatus.startSemaphore));
@@ -167,12 +170,29 @@ void PosixThreadSupport::waitForResponse(unsigned int *puiArgument0, unsigned in
 	btAssert(m_activeSpuStatus.size());
 
         // wait for any of the threads to finish
-	checkPThreadFunction(sem_wait(mainSemaphore));
-        
+	checkPThreadFunction(sem_wait(m_mainSemaphore));
+
+	collectFinishedTask(puiArgument0, puiArgument1);
+}
+
+bool PosixThreadSupport::isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
+	btAssert(m_activeSpuStatus.size());
+	if (sem_trywait(m_mainSemaphore) != 0)
+	{
+		return false;
+	}
+	collectFinishedTask(puiArgument0, puiArgument1);
+	return true;
+}
+
+///the main semaphore was decremented, report the task that posted it
+void PosixThreadSupport::collectFinishedTask(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
 	// get at least one thread which has finished
-        size_t last = -1;
+        int last = -1;
         
-        for(size_t t=0; t < m_activeSpuStatus.size(); ++t) {
+        for(int t=0; t < m_activeSpuStatus.size(); ++t) {
             if(2 == m_activeSpuStatus[t].m_status) {
                 last = t;
                 break;
@@ -198,7 +218,7 @@ void PosixThreadSupport::startThreads(ThreadConstructionInfo& threadConstruction
         printf("%s creating %i threads.\n", __FUNCTION__, threadConstructionInfo.m_numThreads);
 	m_activeSpuStatus.resize(threadConstructionInfo.m_numThreads);
         
-	mainSemaphore = createSem("main");                
+	m_mainSemaphore = createSem("main");
         
 	for (int i=0;i < threadConstructionInfo.m_numThreads;i++)
 	{
@@ -207,6 +227,7 @@ void PosixThreadSupport::startThreads(ThreadConstructionInfo& threadConstruction
 		btSpuStatus&	spuStatus = m_activeSpuStatus[i];
 
 		spuStatus.startSemaphore = createSem("threadLocal");                
+		spuStatus.m_mainSemaphore = m_mainSemaphore;
                 
                 checkPThreadFunction(pthread_create(&spuStatus.thread, NULL, &threadFunction, (void*)&spuStatus));
 
@@ -216,6 +237,7 @@ void PosixThreadSupport::startThreads(ThreadConstructionInfo& threadConstruction
 		spuStatus.m_commandId = 0;
 		spuStatus.m_status = 0;
 		spuStatus.m_lsMemory = threadConstructionInfo.m_lsMemoryFunc();
+		spuStatus.m_allocTag = BT_ALLOC_TAG_GENERAL;
 		spuStatus.m_userThreadFunc = threadConstructionInfo.m_userThreadFunc;
         spuStatus.threadUsed = 0;
 
@@ -233,14 +255,23 @@ void PosixThreadSupport::startSPU()
 ///tell the task scheduler we are done with the SPU tasks
 void PosixThreadSupport::stopSPU()
 {
-	for(size_t t=0; t < m_activeSpuStatus.size(); ++t) {
+	for(int t=0; t < m_activeSpuStatus.size(); ++t) {
             btSpuStatus&	spuStatus = m_activeSpuStatus[t];
             printf("%s: Thread %i used: %ld\n", __FUNCTION__, t, spuStatus.threadUsed);
-        
+
+            //a start request without user pointer makes the thread release its allocator cache and exit
+            spuStatus.m_userPtr = 0;
+            checkPThreadFunction(sem_post(spuStatus.startSemaphore));
+            checkPThreadFunction(pthread_join(spuStatus.thread, 0));
+
             destroySem(spuStatus.startSemaphore);
-            checkPThreadFunction(pthread_cancel(spuStatus.thread));
         }
-        destroySem(mainSemaphore);
+	//stopSPU can run more than once, from the user and from the destructor
+	if (m_mainSemaphore)
+	{
+		destroySem(m_mainSemaphore);
+		m_mainSemaphore = 0;
+	}
 
 	m_activeSpuStatus.clear();
 }
@@ -52,15 +52,23 @@ public:
 		PosixThreadFunc	m_userThreadFunc;
 		void*	m_userPtr; //for taskDesc etc
 		void*	m_lsMemory; //initialized using PosixLocalStoreMemorySetupFunc
+		///allocation tag of the thread that sent the request, the task runs with it
+		int		m_allocTag;
 
                 pthread_t thread;
                 sem_t* startSemaphore;
+		///signaled when the task finished, shared by all threads of the PosixThreadSupport
+		sem_t* m_mainSemaphore;
 
         unsigned long threadUsed;
 	};
 private:
 
 	btAlignedObjectArray<btSpuStatus>	m_activeSpuStatus;
+	// this semaphore will signal, if and how many threads are finished with their work
+	sem_t*	m_mainSemaphore;
+
+	void	collectFinishedTask(unsigned int *puiArgument0, unsigned int *puiArgument1);
 public:
 	///Setup and initialize SPU/CELL/Libspe2
 
@@ -105,6 +113,8 @@ public:
 ///check for messages from SPUs
 	virtual	void waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1);
 
+	virtual bool isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1);
+
 ///start the spus (can be called at the beginning of each frame, to make sure that the right SPU program is loaded)
 	virtual	void startSPU();
 
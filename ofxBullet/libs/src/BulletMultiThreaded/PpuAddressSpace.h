@@ -8,6 +8,13 @@
 #pragma warning (disable: 4312)
 #endif //WIN32
 
+//task descriptors are passed by address, so use 64 bit addresses wherever pointers are 64 bit
+#if defined (__LP64__) || defined (_WIN64)
+#ifndef USE_ADDR64
+#define USE_ADDR64 1
+#endif
+#endif
+
 #ifdef USE_ADDR64
 typedef uint64_t ppu_address_t;
 #else
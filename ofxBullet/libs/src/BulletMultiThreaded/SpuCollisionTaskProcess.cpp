@@ -34,7 +34,7 @@ m_maxNumOutstandingTasks(maxNumOutstandingTasks)
 	m_taskBusy.resize(m_maxNumOutstandingTasks);
 	m_spuGatherTaskDesc.resize(m_maxNumOutstandingTasks);
 
-	for (int i = 0; i < m_maxNumOutstandingTasks; i++)
+	for (unsigned int i = 0; i < m_maxNumOutstandingTasks; i++)
 	{
 		m_taskBusy[i] = false;
 	}
@@ -50,7 +50,7 @@ m_maxNumOutstandingTasks(maxNumOutstandingTasks)
 	m_threadInterface->startSPU();
 
 	//printf("sizeof vec_float4: %d\n", sizeof(vec_float4));
-	printf("sizeof SpuGatherAndProcessWorkUnitInput: %d\n", sizeof(SpuGatherAndProcessWorkUnitInput));
+	printf("sizeof SpuGatherAndProcessWorkUnitInput: %d\n", int(sizeof(SpuGatherAndProcessWorkUnitInput)));
 
 }
 
@@ -83,7 +83,7 @@ void SpuCollisionTaskProcess::initialize2(bool useEpa)
 	}
 
 	
-	for (int i = 0; i < m_maxNumOutstandingTasks; i++)
+	for (unsigned int i = 0; i < m_maxNumOutstandingTasks; i++)
 	{
 		m_taskBusy[i] = false;
 	}
@@ -139,7 +139,7 @@ void SpuCollisionTaskProcess::issueTask2()
 		unsigned int outputSize;
 
 		
-		for (int i=0;i<m_maxNumOutstandingTasks;i++)
+		for (unsigned int i=0;i<m_maxNumOutstandingTasks;i++)
 		  {
 			  if (m_taskBusy[i])
 			  {
@@ -273,7 +273,7 @@ SpuCollisionTaskProcess::flush2()
 	  unsigned int taskId=-1;
 	  unsigned int outputSize;
 	  
-	  for (int i=0;i<m_maxNumOutstandingTasks;i++)
+	  for (unsigned int i=0;i<m_maxNumOutstandingTasks;i++)
 	  {
 		  if (m_taskBusy[i])
 		  {
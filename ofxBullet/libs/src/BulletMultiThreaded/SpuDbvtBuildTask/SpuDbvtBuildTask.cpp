@@ -0,0 +1,46 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "SpuDbvtBuildTask.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+
+void* createDbvtBuildLocalStoreMemory()
+{
+	//the build jobs work on the snapshot and nodes owned by the btDbvtBuilder
+	return 0;
+}
+
+void	processDbvtBuildTask(void* userPtr, void* lsMemory)
+{
+	(void)lsMemory;
+	SpuDbvtBuildTaskDesc* taskDescPtr = (SpuDbvtBuildTaskDesc*)userPtr;
+
+	switch (taskDescPtr->m_command)
+	{
+	case CMD_DBVT_BUILD_JOBS:
+		{
+			btDbvtBuilder* builder = taskDescPtr->m_builder;
+			for (int job=taskDescPtr->m_firstJob;job<builder->getNumJobs();job+=taskDescPtr->m_jobStride)
+			{
+				builder->buildJob(job);
+			}
+			break;
+		}
+	default:
+		btAssert(0);
+		break;
+	};
+}
@@ -0,0 +1,48 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef SPU_DBVT_BUILD_TASK_H
+#define SPU_DBVT_BUILD_TASK_H
+
+#include "../PlatformDefinitions.h"
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedAllocator.h"
+
+struct btDbvtBuilder;
+
+enum
+{
+	///run the jobs m_firstJob, m_firstJob+m_jobStride, ... of the builder
+	CMD_DBVT_BUILD_JOBS = 1
+};
+
+ATTRIBUTE_ALIGNED16(struct) SpuDbvtBuildTaskDesc
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	uint32_t						m_command;
+	uint32_t						m_taskId;
+
+	///the jobs of one task write disjoint parts of the builder
+	btDbvtBuilder*					m_builder;
+	int								m_firstJob;
+	int								m_jobStride;
+};
+
+void	processDbvtBuildTask(void* userPtr, void* lsMemory);
+void*	createDbvtBuildLocalStoreMemory();
+
+#endif //SPU_DBVT_BUILD_TASK_H
@@ -0,0 +1,105 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SpuIntegrationTask.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+
+void* createIntegrationLocalStoreMemory()
+{
+	//the integration tasks work directly on the rigid bodies
+	return 0;
+}
+
+static void	predictMotion(const SpuIntegrationTaskDesc& taskDesc)
+{
+	const int lastObject = taskDesc.m_startObject+taskDesc.m_numObjects;
+	for (int i=taskDesc.m_startObject;i<lastObject;i++)
+	{
+		btRigidBody* body = taskDesc.m_bodies[i];
+		body->integrateVelocities(taskDesc.m_timeStep);
+		//damping
+		body->applyDamping(taskDesc.m_timeStep);
+
+		body->predictIntegratedTransform(taskDesc.m_timeStep,body->getInterpolationWorldTransform());
+	}
+}
+
+static int	predictTransforms(const SpuIntegrationTaskDesc& taskDesc)
+{
+	int numClampedCcdMotions = 0;
+	const int lastObject = taskDesc.m_startObject+taskDesc.m_numObjects;
+	for (int i=taskDesc.m_startObject;i<lastObject;i++)
+	{
+		btRigidBody* body = taskDesc.m_bodies[i];
+		btTransform& predictedTrans = taskDesc.m_predictedTransforms[i];
+		body->predictIntegratedTransform(taskDesc.m_timeStep, predictedTrans);
+		btScalar squareMotion = (predictedTrans.getOrigin()-body->getWorldTransform().getOrigin()).length2();
+
+		if (body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion)
+		{
+			if (body->getCollisionShape()->isConvex())
+			{
+				numClampedCcdMotions++;
+				taskDesc.m_world->clampCcdMotion(body,taskDesc.m_timeStep,predictedTrans);
+			}
+		}
+	}
+	return numClampedCcdMotions;
+}
+
+static void	proceedToTransforms(const SpuIntegrationTaskDesc& taskDesc)
+{
+	const int lastObject = taskDesc.m_startObject+taskDesc.m_numObjects;
+	for (int i=taskDesc.m_startObject;i<lastObject;i++)
+	{
+		taskDesc.m_bodies[i]->proceedToTransform(taskDesc.m_predictedTransforms[i]);
+	}
+}
+
+static void	computeAabbs(const SpuIntegrationTaskDesc& taskDesc)
+{
+	const int lastObject = taskDesc.m_startObject+taskDesc.m_numObjects;
+	for (int i=taskDesc.m_startObject;i<lastObject;i++)
+	{
+		taskDesc.m_world->computeContactAabb(taskDesc.m_collisionObjects[i],taskDesc.m_aabbs[i*2],taskDesc.m_aabbs[i*2+1]);
+	}
+}
+
+void	processIntegrationTask(void* userPtr, void* lsMemory)
+{
+	(void)lsMemory;
+	SpuIntegrationTaskDesc* taskDescPtr = (SpuIntegrationTaskDesc*)userPtr;
+
+	switch (taskDescPtr->m_command)
+	{
+	case CMD_INTEGRATION_PREDICT_MOTION:
+		predictMotion(*taskDescPtr);
+		break;
+	case CMD_INTEGRATION_PREDICT_TRANSFORMS:
+		taskDescPtr->m_numClampedCcdMotions = predictTransforms(*taskDescPtr);
+		break;
+	case CMD_INTEGRATION_PROCEED_TO_TRANSFORMS:
+		proceedToTransforms(*taskDescPtr);
+		break;
+	case CMD_INTEGRATION_COMPUTE_AABBS:
+		computeAabbs(*taskDescPtr);
+		break;
+	default:
+		btAssert(0);
+		break;
+	};
+}
@@ -0,0 +1,68 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef SPU_INTEGRATION_TASK_H
+#define SPU_INTEGRATION_TASK_H
+
+#include "../PlatformDefinitions.h"
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btTransform.h"
+
+class btRigidBody;
+class btCollisionObject;
+class btDiscreteDynamicsWorld;
+
+enum
+{
+	///integrate velocities, apply damping and predict the interpolation transform
+	CMD_INTEGRATION_PREDICT_MOTION = 1,
+	///predict the transforms of the step and clamp fast bodies with a CCD sweep, nothing in the world is moved yet
+	CMD_INTEGRATION_PREDICT_TRANSFORMS,
+	///move the bodies to the predicted transforms
+	CMD_INTEGRATION_PROCEED_TO_TRANSFORMS,
+	///compute the contact aabbs of collision objects, the broadphase is updated afterwards by the calling thread
+	CMD_INTEGRATION_COMPUTE_AABBS
+};
+
+ATTRIBUTE_ALIGNED16(struct) SpuIntegrationTaskDesc
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	uint32_t						m_command;
+	uint32_t						m_taskId;
+
+	btScalar						m_timeStep;
+	btRigidBody**					m_bodies;
+	///one transform per body, written by CMD_INTEGRATION_PREDICT_TRANSFORMS and read by CMD_INTEGRATION_PROCEED_TO_TRANSFORMS
+	btTransform*					m_predictedTransforms;
+	///objects and their aabbs for CMD_INTEGRATION_COMPUTE_AABBS, two vectors per object
+	btCollisionObject**				m_collisionObjects;
+	btVector3*						m_aabbs;
+	///range of bodies or collision objects of this task
+	int								m_startObject;
+	int								m_numObjects;
+
+	///the CCD sweeps and aabb computations query this world, it is not modified while the task runs
+	const btDiscreteDynamicsWorld*	m_world;
+
+	///number of bodies that needed a CCD sweep, the world adds it to gNumClampedCcdMotions
+	int								m_numClampedCcdMotions;
+};
+
+void	processIntegrationTask(void* userPtr, void* lsMemory);
+void*	createIntegrationLocalStoreMemory();
+
+#endif //SPU_INTEGRATION_TASK_H
@@ -84,11 +84,10 @@ bool ManifoldResultAddContactPoint(const btVector3& normalOnBInWorld,
 								   bool isSwapped)
 {
 	
-	float contactTreshold = manifoldPtr->getContactBreakingThreshold();
-
 	//spu_printf("SPU: add contactpoint, depth:%f, contactTreshold %f, manifoldPtr %llx\n",depth,contactTreshold,manifoldPtr);
 
 #ifdef DEBUG_SPU_COLLISION_DETECTION
+	float contactTreshold = manifoldPtr->getContactBreakingThreshold();
 	spu_printf("SPU: contactTreshold %f\n",contactTreshold);
 #endif //DEBUG_SPU_COLLISION_DETECTION
 	if (depth > manifoldPtr->getContactBreakingThreshold())
@@ -466,8 +466,8 @@ void	ProcessConvexConcaveSpuCollision(SpuCollisionPairInput* wuInput, CollisionT
 ///////////////////
 void	ProcessSpuConvexConvexCollision(SpuCollisionPairInput* wuInput, CollisionTask_LocalStoreMemory* lsMemPtr, SpuContactResult& spuContacts)
 {
-	register int dmaSize;
-	register ppu_address_t	dmaPpuAddress2;
+	int dmaSize;
+	ppu_address_t	dmaPpuAddress2;
 	
 #ifdef DEBUG_SPU_COLLISION_DETECTION
 	//spu_printf("SPU: ProcessSpuConvexConvexCollision\n");
@@ -592,16 +592,15 @@ void	ProcessSpuConvexConvexCollision(SpuCollisionPairInput* wuInput, CollisionTa
 
 template<typename T> void DoSwap(T& a, T& b)
 {
-	char tmp[sizeof(T)];
-	memcpy(tmp, &a, sizeof(T));
-	memcpy(&a, &b, sizeof(T));
-	memcpy(&b, tmp, sizeof(T));
+	T tmp = a;
+	a = b;
+	b = tmp;
 }
 
 SIMD_FORCE_INLINE void	dmaAndSetupCollisionObjects(SpuCollisionPairInput& collisionPairInput, CollisionTask_LocalStoreMemory& lsMem)
 {
-	register int dmaSize;
-	register ppu_address_t	dmaPpuAddress2;
+	int dmaSize;
+	ppu_address_t	dmaPpuAddress2;
 		
 	dmaSize = sizeof(btCollisionObject);//btTransform);
 	dmaPpuAddress2 = /*collisionPairInput.m_isSwapped ? (ppu_address_t)lsMem.gProxyPtr1->m_clientObject :*/ (ppu_address_t)lsMem.getlocalCollisionAlgorithm()->getCollisionObject0();
@@ -849,16 +848,16 @@ void	processCollisionTask(void* userPtr, void* lsMemPtr)
 	dmaInPtr += MIDPHASE_WORKUNIT_PAGE_SIZE;
 
 	
-	register unsigned char *inputPtr;
-	register unsigned int numOnPage;
-	register unsigned int j;
+	unsigned char *inputPtr;
+	unsigned int numOnPage;
+	unsigned int j;
 	SpuGatherAndProcessWorkUnitInput* wuInputs;	
-	register int dmaSize;
-	register ppu_address_t	dmaPpuAddress;
-	register ppu_address_t	dmaPpuAddress2;
+	int dmaSize;
+	ppu_address_t	dmaPpuAddress;
+	ppu_address_t	dmaPpuAddress2;
 
 	int numPairs;
-	register int p;
+	int p;
 	SpuCollisionPairInput collisionPairInput;
 	
 	for (unsigned int i = 0; btLikely(i < numPages); i++)
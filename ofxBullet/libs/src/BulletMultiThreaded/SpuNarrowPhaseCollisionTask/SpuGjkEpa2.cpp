@@ -258,6 +258,7 @@ eStatus::_			Evaluate(const tShape& shapearg,const btVector3& guess)
 		{
 		case	eStatus::Valid:		m_distance=m_ray.length();break;
 		case	eStatus::Inside:	m_distance=0;break;
+		default:				break;
 		}	
 	return(m_status);
 	}
@@ -378,7 +379,7 @@ static btScalar		projectorigin(	const btVector3& a,
 		{
 		btScalar	mindist=-1;
 		btScalar	subw[2] = { btScalar(0.0f), btScalar(0.0f) };
-		U			subm;
+		U			subm=0;
 		for(U i=0;i<3;++i)
 			{
 			if(dot(*vt[i],cross(dl[i],n))>0)
@@ -425,7 +426,7 @@ static btScalar		projectorigin(	const btVector3& a,
 		{
 		btScalar	mindist=-1;
 		btScalar	subw[3];
-		U			subm;
+		U			subm=0;
 		for(U i=0;i<3;++i)
 			{
 			const U			j=imd3[i];
@@ -828,6 +829,8 @@ switch(gjk_status)
 	case	GJK::eStatus::Failed:
 	results.status=sResults::GJK_Failed;
 	break;
+	default:
+	break;
 	}
 return(false);
 }
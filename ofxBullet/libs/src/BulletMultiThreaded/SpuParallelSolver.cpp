@@ -17,528 +17,330 @@ Written by: Marten Svanfeldt
 
 #include "SpuParallelSolver.h"
 
-//#include "SpuFakeDma.h"
-#include "SpuSync.h"
-
-#include "LinearMath/btVector3.h"
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 #include "BulletDynamics/ConstraintSolver/btContactSolverInfo.h"
-#include "LinearMath/btMinMax.h"
-#include "BulletCollision/CollisionShapes/btCollisionShape.h"
-#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+#include "LinearMath/btMinMax.h"
 #include "LinearMath/btQuickprof.h"
 
-#include "SpuSolverTask/SpuParallellSolverTask.h"
-
-#include <stdio.h>
-
 enum
 {
-	PARALLEL_SOLVER_BODIES_PER_TASK = 64,
-	PARALLEL_SOLVER_CELLS_PER_TASK = SPU_HASH_NUMCELLS >> 3
+	PARALLEL_SOLVER_MIN_ROWS_PER_TASK = 64,
+	///colors that can be tracked with a bit mask per body, more colors fall back to ordering by the last color of each body
+	PARALLEL_SOLVER_MASKED_COLORS = 32
 };
 
 
-//-- Hash handling
-static void recordDependency(SpuSolverHash* hash, unsigned int i, unsigned int j)
-{
-	hash->m_dependencyMatrix[i][j >> 5] |= (1 << (j & 31));
-	hash->m_dependencyMatrix[j][i >> 5] |= (1 << (i & 31));
-}
-
-
-// Clear the given hash
-static void clearHash (SpuSolverHash* hash)
-{
-	size_t hashSize = sizeof(SpuSolverHash);
-	memset(hash, 0, hashSize);
-	int i;
-
-	// Setup basic dependency
-	for ( i = 0; i < SPU_HASH_NUMCELLS; ++i)
-	{
-		hash->m_dependencyMatrix[i][i >> 5] |= (1 << (i & 31));
-	}
-
-	// Set some ones to "unused cells"
-	for ( i = SPU_HASH_WORDWIDTH-SPU_HASH_NUMUNUSEDBITS; i < SPU_HASH_WORDWIDTH; ++i)
-	{
-		hash->m_currentMask[0][SPU_HASH_NUMCELLDWORDS-1] |= (1 << i);
-	}
-}
-/*
-static bool getDependency(SpuSolverHash* hash, unsigned int i, unsigned int j)
-{
-	return (hash->m_dependencyMatrix[i][j >> 5] & (1 << (j & 31))) != 0;
-}
-*/
-
-
-static unsigned int getObjectIndex (btCollisionObject* object)
-{
-	btVector3 center = object->getWorldTransform().getOrigin();
-	int cx = (int)floorf(center.x() / SPU_HASH_PHYSSIZE);
-	int cy = (int)floorf(center.y() / SPU_HASH_PHYSSIZE);
-	int cz = (int)floorf(center.z() / SPU_HASH_PHYSSIZE);
-
-	return spuGetHashCellIndex(cx, cy, cz);
-}
-
-
-
-
-
 btParallelSequentialImpulseSolver::btParallelSequentialImpulseSolver (btThreadSupportInterface* threadIf, int maxOutstandingTasks)
-: m_numberOfContacts(0), m_taskScheduler (threadIf, maxOutstandingTasks)
+: m_minRowsPerTask(PARALLEL_SOLVER_MIN_ROWS_PER_TASK), m_taskScheduler (threadIf, maxOutstandingTasks)
 {
-	m_solverHash = new SpuSolverHash;
-	clearHash(m_solverHash);
 }
 
 btParallelSequentialImpulseSolver::~btParallelSequentialImpulseSolver ()
 {
-	delete m_solverHash;
 }
 
 
 void btParallelSequentialImpulseSolver::prepareSolve(int numBodies, int numManifolds)
 {
-	m_sortedManifolds.reserve(numManifolds);
-	m_allObjects.reserve(numBodies);
+	(void)numBodies;
+	m_allManifolds.reserve(numManifolds);
 }
 
 btScalar btParallelSequentialImpulseSolver::solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints, const btContactSolverInfo& info,class btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,btDispatcher* dispatcher)
 {
-	BT_PROFILE("parallel_solveGroup");
-
-	if (!numManifolds && !numConstraints)
-		return 0;
+	(void)bodies;
+	(void)numBodies;
+	(void)info;
+	(void)debugDrawer;
+	(void)stackAlloc;
+	(void)dispatcher;
+
+	//the islands are solved together in allSolved, the solver bodies are created from the manifolds and constraints
 	int i;
-
-///refresh contact points is not needed anymore, it has been moved into the processCollision detection part.
-#ifdef FORCE_REFESH_CONTACT_MANIFOLDS
-	for ( i = 0; i < numManifolds; ++i)
+	for (i=0;i<numManifolds;i++)
 	{
-		btPersistentManifold* currManifold = manifold[i];
-		btRigidBody* rb0 = (btRigidBody*)currManifold->getBody0();
-		btRigidBody* rb1 = (btRigidBody*)currManifold->getBody1();
-
-		currManifold->refreshContactPoints(rb0->getCenterOfMassTransform(),rb1->getCenterOfMassTransform());
+		m_allManifolds.push_back(manifold[i]);
 	}
-#endif //FORCE_REFESH_CONTACT_MANIFOLDS
-
-	// Record and mark the manifolds to the cells
-	for ( i = 0; i < numManifolds; ++i)
+	for (i=0;i<numConstraints;i++)
 	{
-		// Compute a hash cell for this manifold
-		btPersistentManifold* currManifold = manifold[i];
+		m_allConstraints.push_back(constraints[i]);
+	}
+	return 0;
+}
 
-		btCollisionObject *ownerObject, *otherObject;
+///Greedy coloring of the ranges in pool order: each range takes the lowest color that neither of its dynamic bodies uses yet.
+///The coloring only depends on the rows, never on the number of threads. The rows are then sorted by color,
+///so each color is solved from contiguous memory.
+void btParallelSequentialImpulseSolver::colorRows(btConstraintArray& rows, SpuSolverColoring& coloring, btAlignedObjectArray<int>& rowOrder)
+{
+	const int numBodies = m_tmpSolverBodyPool.size();
+	m_bodyColorMask.resize(numBodies);
+	m_bodyMaxColor.resize(numBodies);
+	int i;
+	for (i=0;i<numBodies;i++)
+	{
+		m_bodyColorMask[i] = 0;
+		m_bodyMaxColor[i] = -1;
+	}
 
-		btRigidBody* rb0 = (btRigidBody*)currManifold->getBody0();
-		btRigidBody* rb1 = (btRigidBody*)currManifold->getBody1();
+	m_unsortedRanges.resize(0);
+	m_rangeColor.resize(0);
+	int numColors = 0;
 
-		if (rb0->getIslandTag() >= 0)
-		{
-			ownerObject = rb0;
-			otherObject = rb1;
-		}
-		else
+	for (i=0;i<rows.size();)
+	{
+		const int bodyIdA = rows[i].m_solverBodyIdA;
+		const int bodyIdB = rows[i].m_solverBodyIdB;
+		int numRows = 1;
+		while ((i+numRows < rows.size()) && (rows[i+numRows].m_solverBodyIdA == bodyIdA) && (rows[i+numRows].m_solverBodyIdB == bodyIdB))
 		{
-			ownerObject = rb1;
-			otherObject = rb0;
+			numRows++;
 		}
 
-		// Save the cell
-		unsigned int ownerCellIdx = getObjectIndex(ownerObject);
-		ManifoldCellHolder holder = {ownerCellIdx, currManifold};
-		m_sortedManifolds.push_back(holder);
-		m_solverHash->m_Hash[ownerCellIdx].m_numManifolds++;
+		//bodies without inverse mass only ever receive zero impulses, so they don't constrain the coloring,
+		//the tasks apply those impulses to private copies (see solveSolverRowRanges)
+		const bool dynamicA = m_tmpSolverBodyPool[bodyIdA].m_invMass != btScalar(0.);
+		const bool dynamicB = m_tmpSolverBodyPool[bodyIdB].m_invMass != btScalar(0.);
 
-		// Record dependency
-		if (rb0->getIslandTag() >= 0 && rb1->getIslandTag() >= 0)
+		unsigned int usedColors = 0;
+		int maxColor = -1;
+		if (dynamicA)
 		{
-			unsigned int otherCellIdx = getObjectIndex(otherObject);
-			recordDependency(m_solverHash, ownerCellIdx, otherCellIdx);
+			usedColors |= m_bodyColorMask[bodyIdA];
+			maxColor = btMax(maxColor,m_bodyMaxColor[bodyIdA]);
+		}
+		if (dynamicB)
+		{
+			usedColors |= m_bodyColorMask[bodyIdB];
+			maxColor = btMax(maxColor,m_bodyMaxColor[bodyIdB]);
 		}
-		
-		// Save statistics
-		int numContacts = currManifold->getNumContacts();
-		m_solverHash->m_Hash[ownerCellIdx].m_numContacts += numContacts;
-		m_numberOfContacts += numContacts;
-	}
-
-	// Record and mark constraints to the cells
-	for ( i = 0; i < numConstraints; ++i)
-	{
-		// Compute a hash cell for this manifold
-		btTypedConstraint* currConstraint = constraints[i];
-
-		if (!constraintTypeSupported(currConstraint->getConstraintType()))
-			continue;
-
-		btCollisionObject *ownerObject, *otherObject;
-
-		btRigidBody* rb0 = &currConstraint->getRigidBodyA();
-		btRigidBody* rb1 = &currConstraint->getRigidBodyB();
 
-		if (rb0->getIslandTag() >= 0)
+		int color = 0;
+		while ((color < PARALLEL_SOLVER_MASKED_COLORS) && (usedColors & (1u<<color)))
 		{
-			ownerObject = rb0;
-			otherObject = rb1;
+			color++;
 		}
-		else
+		if (color == PARALLEL_SOLVER_MASKED_COLORS)
 		{
-			ownerObject = rb1;
-			otherObject = rb0;
+			color = btMax(int(PARALLEL_SOLVER_MASKED_COLORS),maxColor+1);
 		}
 
-		// Save the cell
-		unsigned int ownerCellIdx = getObjectIndex(ownerObject);
-		ConstraintCellHolder holder = {ownerCellIdx, currConstraint->getConstraintType(), currConstraint};
-		m_sortedConstraints.push_back(holder);
-		m_solverHash->m_Hash[ownerCellIdx].m_numConstraints++;
-
-		// Record dependency
-		if (rb0 && rb1 && rb0->getIslandTag() >= 0 && rb1->getIslandTag() >= 0)
+		const unsigned int colorBit = (color < PARALLEL_SOLVER_MASKED_COLORS) ? (1u<<color) : 0;
+		if (dynamicA)
+		{
+			m_bodyColorMask[bodyIdA] |= colorBit;
+			m_bodyMaxColor[bodyIdA] = btMax(m_bodyMaxColor[bodyIdA],color);
+		}
+		if (dynamicB)
 		{
-			unsigned int otherCellIdx = getObjectIndex(otherObject);
-			recordDependency(m_solverHash, ownerCellIdx, otherCellIdx);
+			m_bodyColorMask[bodyIdB] |= colorBit;
+			m_bodyMaxColor[bodyIdB] = btMax(m_bodyMaxColor[bodyIdB],color);
 		}
+
+		SpuSolverRowRange range;
+		range.m_firstRow = i;
+		range.m_numRows = numRows;
+		m_unsortedRanges.push_back(range);
+		m_rangeColor.push_back(color);
+		numColors = btMax(numColors,color+1);
+		i += numRows;
 	}
 
-	// Save all RBs
-	for ( i = 0; i < numBodies; ++i)
+	//counting sort by color, keeping pool order within a color
+	coloring.m_colorStart.resize(numColors+1);
+	coloring.m_colorRows.resize(numColors);
+	for (i=0;i<=numColors;i++)
 	{
-		btCollisionObject* obj = bodies[i];
-		//unsigned int cellIdx = getObjectIndex(obj);
-
-		btRigidBody* rb = btRigidBody::upcast(obj);
-		m_allObjects.push_back(rb);
+		coloring.m_colorStart[i] = 0;
 	}
-
-	return 0;
-}
-
-template<typename T>
-class CellHolderPredicate
-{
-public:
-	SIMD_FORCE_INLINE bool operator() ( const T& lhs, const T& rhs )
+	for (i=0;i<numColors;i++)
 	{
-		return lhs.m_hashCellIndex < rhs.m_hashCellIndex;
+		coloring.m_colorRows[i] = 0;
 	}
-};
-
+	for (i=0;i<m_unsortedRanges.size();i++)
+	{
+		coloring.m_colorStart[m_rangeColor[i]+1]++;
+		coloring.m_colorRows[m_rangeColor[i]] += m_unsortedRanges[i].m_numRows;
+	}
+	for (i=0;i<numColors;i++)
+	{
+		coloring.m_colorStart[i+1] += coloring.m_colorStart[i];
+	}
+	coloring.m_ranges.resize(m_unsortedRanges.size());
+	for (i=0;i<m_unsortedRanges.size();i++)
+	{
+		coloring.m_ranges[coloring.m_colorStart[m_rangeColor[i]]++] = m_unsortedRanges[i];
+	}
+	//the fill above advanced each start to the start of the next color
+	for (i=numColors;i>0;i--)
+	{
+		coloring.m_colorStart[i] = coloring.m_colorStart[i-1];
+	}
+	coloring.m_colorStart[0] = 0;
 
-/*static void printDependencyMatrix(SpuSolverHash* hash)
-{
-	for (int r = 0; r < SPU_HASH_NUMCELLS; ++r)
+	//move the rows into color order, following the cycles of the permutation so each row is copied about once
+	rowOrder.resize(rows.size());
+	int sortedRow = 0;
+	for (i=0;i<coloring.m_ranges.size();i++)
 	{
-		for (int c = 0; c < SPU_HASH_NUMCELLS; ++c)
+		SpuSolverRowRange& range = coloring.m_ranges[i];
+		for (int j=0;j<range.m_numRows;j++)
 		{
-			if (getDependency(hash, r, c))
-			{
-				printf("1");
-			}
-			else
-			{
-				printf("0");
-			}
+			rowOrder[range.m_firstRow+j] = sortedRow++;
 		}
-
-		printf("\n");
+		range.m_firstRow = sortedRow-range.m_numRows;
 	}
-	printf("\n");
-	fflush(stdout);
-}
-*/
-
-// Solver caches
-btAlignedObjectArray<btSolverBody> solverBodyPool_persist;
-btAlignedObjectArray<uint32_t> solverBodyOffsetList_persist;
-btAlignedObjectArray<btSolverConstraint> solverInternalConstraintPool_persist;
-btAlignedObjectArray<btSolverConstraint> solverConstraintPool_persist;
-
-
-void btParallelSequentialImpulseSolver::allSolved (const btContactSolverInfo& info,class btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc)
-{
-	BT_PROFILE("parallel_allSolved");
-
-	if (!m_numberOfContacts && !m_sortedConstraints.size())
+	m_rowVisited.resize(rows.size());
+	for (i=0;i<rows.size();i++)
 	{
-		m_sortedManifolds.clear();
-		m_sortedConstraints.clear();
-		m_allObjects.clear();
-		clearHash(m_solverHash);
-		return;
+		m_rowVisited[i] = (rowOrder[i] == i);
 	}
-
-
-	//printDependencyMatrix(m_solverHash);
-
-	// Sort the manifolds list
-	int numManifolds = m_sortedManifolds.size();
-	m_sortedManifolds.quickSort(CellHolderPredicate<ManifoldCellHolder>());
-
-	// Sort the constraint list
-	int numConstraints = m_sortedConstraints.size();
-	m_sortedConstraints.quickSort(CellHolderPredicate<ConstraintCellHolder>());
-
-
-	// Sort the body list
-	int numBodies = m_allObjects.size();
-	
-	// Reassign the hash offset
-	uint32_t emptyCellMask[SPU_HASH_NUMCELLDWORDS] = {0};
-	int numBodyOffsets = 0;
+	for (i=0;i<rows.size();i++)
 	{
-		int manifoldRunner = 0;
-		int bodyOffsetRunner = 0;
-		int internalConstraintRunner = 0;
-		int constraintRunner = 0;
-		
-		for (int i = 0; i < SPU_HASH_NUMCELLS; ++i)
+		if (m_rowVisited[i])
+			continue;
+		btSolverConstraint carried = rows[i];
+		int target = rowOrder[i];
+		while (target != i)
 		{
-			bool empty = true;
-
-			SpuSolverHashCell& hashCell = m_solverHash->m_Hash[i];
-			hashCell.m_solverBodyOffsetListOffset = bodyOffsetRunner;
-
-			if (hashCell.m_numManifolds)
-			{
-				hashCell.m_manifoldListOffset = manifoldRunner;
-				manifoldRunner += hashCell.m_numManifolds;
-				
-				bodyOffsetRunner += hashCell.m_numManifolds*2;
-			}			
-			if (hashCell.m_numContacts)
-			{
-				hashCell.m_internalConstraintListOffset = internalConstraintRunner*3;
-				internalConstraintRunner += hashCell.m_numContacts;
-				empty = false;
-			}
-
-			if (hashCell.m_numConstraints)
-			{
-				hashCell.m_constraintListOffset = constraintRunner;
-				constraintRunner += hashCell.m_numConstraints;
-
-				bodyOffsetRunner += hashCell.m_numConstraints*2;
-
-				empty = false;
-			}
-			
-
-			emptyCellMask[i >> 5] |= (empty ? (1 << (i&31)) : 0);
-			// Align the bodyOffsetRunner to a whole number of 4 for right alignment in the list
-			bodyOffsetRunner = (bodyOffsetRunner+3)&~0x3;
+			btSolverConstraint displaced = rows[target];
+			rows[target] = carried;
+			m_rowVisited[target] = true;
+			carried = displaced;
+			target = rowOrder[target];
 		}
-
-		numBodyOffsets = bodyOffsetRunner;
+		rows[i] = carried;
+		m_rowVisited[i] = true;
 	}
+}
 
-	// Setup rigid bodies
-	// Allocate temporary data
-	solverBodyPool_persist.resize(numBodies + numManifolds + numConstraints);
-	btSolverBody* solverBodyPool = &solverBodyPool_persist[0];
+void btParallelSequentialImpulseSolver::solveColors(const SpuSolverColoring& coloring, btConstraintArray& rows, int rowType, btSingleConstraintRowSolver rowSolver)
+{
+	if (!rows.size())
+		return;
 
-	solverBodyOffsetList_persist.resize(numBodyOffsets);
-	uint32_t* solverBodyOffsetList = &solverBodyOffsetList_persist[0];
+	SpuSolverTaskDesc desc;
+	desc.m_solverCommand = CMD_SOLVER_SOLVE_ROW_RANGES;
+	desc.m_taskId = 0;
+	desc.m_rowType = rowType;
+	desc.m_solverBodyPool = &m_tmpSolverBodyPool[0];
+	desc.m_rowPool = &rows[0];
+	desc.m_contactRowPool = m_tmpSolverContactConstraintPool.size() ? &m_tmpSolverContactConstraintPool[0] : 0;
+	desc.m_rowSolver = rowSolver;
+	desc.m_ranges = &coloring.m_ranges[0];
 
-	solverInternalConstraintPool_persist.resize(m_numberOfContacts*3);
-	btSolverConstraint* solverInternalConstraintPool = &solverInternalConstraintPool_persist[0];
-	
-	solverConstraintPool_persist.resize(numConstraints);
-	btSolverConstraint* solverConstraintPool = &solverConstraintPool_persist[0];
+	const int minRowsPerTask = btMax(m_minRowsPerTask,1);
 
-	// Setup all the moving rigid bodies
+	for (int color=0;color<coloring.getNumColors();color++)
 	{
-		BT_PROFILE("setup moving rigidbodies");
+		const int startRange = coloring.m_colorStart[color];
+		const int endRange = coloring.m_colorStart[color+1];
+		const int colorRows = coloring.m_colorRows[color];
+		const int numTasks = btMin(m_taskScheduler.getMaxOutstandingTasks(),colorRows/minRowsPerTask);
 
-		int bodiesPerTask = PARALLEL_SOLVER_BODIES_PER_TASK;
-		int bodiesToSchedule = numBodies;
-		int startBody = 0;
-
-		while (bodiesToSchedule > 0)
+		if (numTasks < 2)
 		{
-			// Schedule a bunch of hash cells
-			int numBodiesInTask = bodiesToSchedule > bodiesPerTask ? bodiesPerTask : bodiesToSchedule;
-
-			SpuSolverTaskDesc* desc = m_taskScheduler.getTask();
-
-			desc->m_solverCommand = CMD_SOLVER_SETUP_BODIES;
-			desc->m_solverData.m_solverHash = m_solverHash;
-			desc->m_solverData.m_solverBodyList = solverBodyPool;
-
-			desc->m_commandData.m_bodySetup.m_startBody = startBody;
-			desc->m_commandData.m_bodySetup.m_numBodies = numBodiesInTask;
-			desc->m_commandData.m_bodySetup.m_rbList = &m_allObjects[0];
-
-			m_taskScheduler.issueTask();
-			bodiesToSchedule -= numBodiesInTask;
-			startBody += numBodiesInTask;
+			desc.m_startRange = startRange;
+			desc.m_numRanges = endRange-startRange;
+			solveSolverRowRanges(desc);
+			continue;
 		}
-		
-		m_taskScheduler.flushTasks();
-	}
 
-	// Manifold setup
-	{
-		int cellsPerTask = PARALLEL_SOLVER_CELLS_PER_TASK;
-		int cellsToSchedule = SPU_HASH_NUMCELLS;
-		int startCell = 0;
-
-		while (cellsToSchedule > 0)
+		//split the ranges into tasks with about the same number of rows
+		int range = startRange;
+		int rowsIssued = 0;
+		for (int task=0;(task<numTasks) && (range<endRange);task++)
 		{
-			int numCellsInTask = cellsToSchedule > cellsPerTask ? cellsPerTask : cellsToSchedule;
-			
-			SpuSolverTaskDesc* desc = m_taskScheduler.getTask();
-
-			desc->m_solverCommand = CMD_SOLVER_MANIFOLD_SETUP;
-			desc->m_solverData.m_solverHash = m_solverHash;
-			desc->m_solverData.m_solverBodyList = solverBodyPool;
-			desc->m_solverData.m_solverBodyOffsetList = solverBodyOffsetList;
-			desc->m_solverData.m_solverInternalConstraintList = solverInternalConstraintPool;
-			desc->m_solverData.m_solverConstraintList = solverConstraintPool;
-
-			desc->m_commandData.m_manifoldSetup.m_startCell = startCell;
-			desc->m_commandData.m_manifoldSetup.m_numCells = numCellsInTask;
-			desc->m_commandData.m_manifoldSetup.m_numBodies = numBodies;
-			desc->m_commandData.m_manifoldSetup.m_numManifolds = numManifolds;
-			desc->m_commandData.m_manifoldSetup.m_manifoldHolders = &m_sortedManifolds[0];
-			desc->m_commandData.m_manifoldSetup.m_constraintHolders = &m_sortedConstraints[0];
-			desc->m_commandData.m_manifoldSetup.m_solverInfo = info;
-
+			const int rowsTarget = (task == numTasks-1) ? colorRows : (colorRows*(task+1))/numTasks;
+			SpuSolverTaskDesc* taskDesc = m_taskScheduler.getTask();
+			const uint32_t taskId = taskDesc->m_taskId;
+			*taskDesc = desc;
+			taskDesc->m_taskId = taskId;
+			taskDesc->m_startRange = range;
+			do
+			{
+				rowsIssued += coloring.m_ranges[range].m_numRows;
+				range++;
+			} while ((range<endRange) && (rowsIssued<rowsTarget));
+			taskDesc->m_numRanges = range-taskDesc->m_startRange;
 			m_taskScheduler.issueTask();
-			cellsToSchedule -= numCellsInTask;
-			startCell += numCellsInTask;
 		}
 		m_taskScheduler.flushTasks();
 	}
+}
 
-	{
-		BT_PROFILE("parallel_solve_iterations");
-
-		btSpinlock::SpinVariable* spinVar = (btSpinlock::SpinVariable*)btAlignedAlloc(sizeof(btSpinlock::SpinVariable), 128);
-		for (int iter = 0; iter < info.m_numIterations; ++iter)
-		{
-			btSpinlock lock (spinVar);
-			lock.Init();
-
-			// Clear the "processed cells" part of the hash
-			memcpy(m_solverHash->m_currentMask[0], emptyCellMask, sizeof(uint32_t)*SPU_HASH_NUMCELLDWORDS);
-
-			for (int task = 0; task < m_taskScheduler.getMaxOutstandingTasks(); ++task)
-			{
-				SpuSolverTaskDesc* desc = m_taskScheduler.getTask();
-				desc->m_solverCommand = CMD_SOLVER_SOLVE_ITERATE;
-
-				desc->m_solverData.m_solverHash = m_solverHash;
-				desc->m_solverData.m_solverBodyList = solverBodyPool;
-				desc->m_solverData.m_solverBodyOffsetList = solverBodyOffsetList;
-				desc->m_solverData.m_solverInternalConstraintList = solverInternalConstraintPool;
-				desc->m_solverData.m_solverConstraintList = solverConstraintPool;
+void btParallelSequentialImpulseSolver::allSolved (const btContactSolverInfo& info,class btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc)
+{
+	BT_PROFILE("parallel_allSolved");
 
-				desc->m_commandData.m_iterate.m_spinLockVar = spinVar;
+	const int numManifolds = m_allManifolds.size();
+	const int numConstraints = m_allConstraints.size();
+	if (!numManifolds && !numConstraints)
+	{
+		return;
+	}
 
-				m_taskScheduler.issueTask();
-			} 
-			m_taskScheduler.flushTasks();
+	btPersistentManifold** manifolds = numManifolds ? &m_allManifolds[0] : 0;
+	btTypedConstraint** constraints = numConstraints ? &m_allConstraints[0] : 0;
 
+	solveGroupCacheFriendlySetup(0,0,manifolds,numManifolds,constraints,numConstraints,info,debugDrawer,stackAlloc);
 
-		}
-		btAlignedFree((void*)spinVar);
-	}
-	
-	// Write back velocity
 	{
-		int bodiesPerTask = PARALLEL_SOLVER_BODIES_PER_TASK;
-		int bodiesToSchedule = numBodies;
-		int startBody = 0;
-
-		while (bodiesToSchedule > 0)
+		BT_PROFILE("parallel_color_rows");
+		colorRows(m_tmpSolverNonContactConstraintPool,m_nonContactColoring,m_nonContactRowOrder);
+		colorRows(m_tmpSolverContactConstraintPool,m_contactColoring,m_contactRowOrder);
+		colorRows(m_tmpSolverContactFrictionConstraintPool,m_frictionColoring,m_frictionRowOrder);
+
+		//contact and friction rows refer to each other by index. The friction rows of a contact act on the
+		//same bodies, so they stay next to each other in the same range and only the first index moves.
+		int i;
+		for (i=0;i<m_tmpSolverContactConstraintPool.size();i++)
 		{
-			// Schedule a bunch of hash cells
-			int numBodiesInTask = bodiesToSchedule > bodiesPerTask ? bodiesPerTask : bodiesToSchedule;
-
-			SpuSolverTaskDesc* desc = m_taskScheduler.getTask();
-
-			desc->m_solverCommand = CMD_SOLVER_COPYBACK_BODIES;
-			desc->m_solverData.m_solverHash = m_solverHash;
-			desc->m_solverData.m_solverBodyList = solverBodyPool;
-
-			desc->m_commandData.m_bodyCopyback.m_startBody = startBody;
-			desc->m_commandData.m_bodyCopyback.m_numBodies = numBodiesInTask;
-			desc->m_commandData.m_bodyCopyback.m_rbList = &m_allObjects[0];
-
-			m_taskScheduler.issueTask();
-			bodiesToSchedule -= numBodiesInTask;
-			startBody += numBodiesInTask;
+			btSolverConstraint& contactRow = m_tmpSolverContactConstraintPool[i];
+			contactRow.m_frictionIndex = m_frictionRowOrder[contactRow.m_frictionIndex];
+		}
+		for (i=0;i<m_tmpSolverContactFrictionConstraintPool.size();i++)
+		{
+			btSolverConstraint& frictionRow = m_tmpSolverContactFrictionConstraintPool[i];
+			frictionRow.m_frictionIndex = m_contactRowOrder[frictionRow.m_frictionIndex];
 		}
-
-		m_taskScheduler.flushTasks();
 	}
 
-
-
+	btSingleConstraintRowSolver rowSolverGeneric = getRowSolverGeneric(info.m_solverMode);
+	btSingleConstraintRowSolver rowSolverLowerLimit = getRowSolverLowerLimit(info.m_solverMode);
 
 	{
-		BT_PROFILE("warmstart_writeback");
+		BT_PROFILE("parallel_solve_iterations");
 
-		btSpinlock::SpinVariable* spinVar = (btSpinlock::SpinVariable*)btAlignedAlloc(sizeof(btSpinlock::SpinVariable), 128);
 		for (int iter = 0; iter < info.m_numIterations; ++iter)
 		{
-			btSpinlock lock (spinVar);
-			lock.Init();
-
-			// Clear the "processed cells" part of the hash
-			memcpy(m_solverHash->m_currentMask[0], emptyCellMask, sizeof(uint32_t)*SPU_HASH_NUMCELLDWORDS);
+			solveColors(m_nonContactColoring,m_tmpSolverNonContactConstraintPool,SPU_SOLVER_ROW_GENERIC,rowSolverGeneric);
 
-			for (int task = 0; task < m_taskScheduler.getMaxOutstandingTasks(); ++task)
+			for (int j=0;j<numConstraints;j++)
 			{
-				SpuSolverTaskDesc* desc = m_taskScheduler.getTask();
-				desc->m_solverCommand = CMD_SOLVER_MANIFOLD_WARMSTART_WRITEBACK;
-				desc->m_solverData.m_solverHash = m_solverHash;
-				desc->m_solverData.m_solverInternalConstraintList = solverInternalConstraintPool;
-				desc->m_solverData.m_solverConstraintList = solverConstraintPool;
-				desc->m_commandData.m_manifoldSetup.m_manifoldHolders = &m_sortedManifolds[0];
-				desc->m_commandData.m_iterate.m_spinLockVar = spinVar;
-
-				m_taskScheduler.issueTask();
-			} 
-			m_taskScheduler.flushTasks();		
+				btSolverBody& bodyA = m_tmpSolverBodyPool[getOrInitSolverBody(constraints[j]->getRigidBodyA())];
+				btSolverBody& bodyB = m_tmpSolverBodyPool[getOrInitSolverBody(constraints[j]->getRigidBodyB())];
+				constraints[j]->solveConstraintObsolete(bodyA,bodyB,info.m_timeStep);
+			}
+
+			solveColors(m_contactColoring,m_tmpSolverContactConstraintPool,SPU_SOLVER_ROW_LOWER_LIMIT,rowSolverLowerLimit);
+			solveColors(m_frictionColoring,m_tmpSolverContactFrictionConstraintPool,SPU_SOLVER_ROW_FRICTION,rowSolverGeneric);
 		}
-		btAlignedFree((void*)spinVar);
 	}
 
-	
-
-
-
-	// Clean up
-	m_sortedManifolds.resize(0);
-	m_sortedConstraints.resize(0);
-	m_allObjects.resize(0);
-	clearHash(m_solverHash);
-
+	solveGroupCacheFriendlyFinish(info);
 
-	m_numberOfContacts = 0;
+	m_allManifolds.resize(0);
+	m_allConstraints.resize(0);
 }
 
 void btParallelSequentialImpulseSolver::reset()
 {
-	m_sortedManifolds.clear();
-	m_allObjects.clear();
-	m_numberOfContacts = 0;
-	clearHash(m_solverHash);
-
-	solverBodyPool_persist.clear();
-	solverBodyOffsetList_persist.clear();
-	solverConstraintPool_persist.clear();
-	solverInternalConstraintPool_persist.clear();
+	btSequentialImpulseConstraintSolver::reset();
+	m_allManifolds.clear();
+	m_allConstraints.clear();
 }
 
 
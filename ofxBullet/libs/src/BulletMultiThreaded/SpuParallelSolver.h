@@ -18,9 +18,10 @@ Written by: Marten Svanfeldt
 #ifndef SPU_PARALLELSOLVER_H
 #define SPU_PARALLELSOLVER_H
 
-#include "BulletDynamics/ConstraintSolver/btConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
 #include "btThreadSupportInterface.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "SpuSolverTask/SpuParallellSolverTask.h"
 
 class SolverTaskScheduler
 {
@@ -49,19 +50,43 @@ public:
 	}
 };
 
-class btParallelSequentialImpulseSolver : public btConstraintSolver
+///btParallelSequentialImpulseSolver collects the islands of a step and solves them together on the worker threads.
+///The rows are set up like btSequentialImpulseConstraintSolver does, then colored so that no two rows of a color share
+///a dynamic body. Each iteration solves the colors one after another and splits the rows of each color over the tasks.
+///The result does not depend on the number of threads, SOLVER_RANDMIZE_ORDER and SOLVER_SIMD_BATCHED are ignored.
+///It replaces the hash cell solver of Bullet 2.73, whose tasks copied btRigidBody objects through the Cell DMA emulation
+///and were never part of the SPU program build. The solver tasks run on PPU or CPU threads and work on the shared pools.
+class btParallelSequentialImpulseSolver : public btSequentialImpulseConstraintSolver
 {
 protected:
 
-	struct SpuSolverHash*						m_solverHash;
-	btAlignedObjectArray<struct ManifoldCellHolder>				m_sortedManifolds;
-	btAlignedObjectArray<struct ConstraintCellHolder>				m_sortedConstraints;
-	btAlignedObjectArray<class btRigidBody*>	m_allObjects;
+	btAlignedObjectArray<btPersistentManifold*>	m_allManifolds;
+	btAlignedObjectArray<btTypedConstraint*>	m_allConstraints;
 
-	int											m_numberOfContacts;	
+	SpuSolverColoring							m_nonContactColoring;
+	SpuSolverColoring							m_contactColoring;
+	SpuSolverColoring							m_frictionColoring;
+
+	///colors used by each solver body while coloring a pool
+	btAlignedObjectArray<unsigned int>			m_bodyColorMask;
+	btAlignedObjectArray<int>					m_bodyMaxColor;
+	btAlignedObjectArray<int>					m_rangeColor;
+	btAlignedObjectArray<SpuSolverRowRange>		m_unsortedRanges;
+	btAlignedObjectArray<bool>					m_rowVisited;
+	///new position of each row after sorting by color
+	btAlignedObjectArray<int>					m_nonContactRowOrder;
+	btAlignedObjectArray<int>					m_contactRowOrder;
+	btAlignedObjectArray<int>					m_frictionRowOrder;
+
+	int											m_minRowsPerTask;
 
 	SolverTaskScheduler							m_taskScheduler;
 
+	///colors the rows and sorts them by color, rowOrder receives the new position of each row
+	void	colorRows(btConstraintArray& rows, SpuSolverColoring& coloring, btAlignedObjectArray<int>& rowOrder);
+
+	void	solveColors(const SpuSolverColoring& coloring, btConstraintArray& rows, int rowType, btSingleConstraintRowSolver rowSolver);
+
 public:
 	btParallelSequentialImpulseSolver (btThreadSupportInterface* threadIf, int maxOutstandingTasks);
 	virtual ~btParallelSequentialImpulseSolver();
@@ -70,6 +95,22 @@ public:
 	virtual btScalar solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints, const btContactSolverInfo& info,class btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,btDispatcher* dispatcher);
 	virtual void allSolved (const btContactSolverInfo& info,class btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc);
 	virtual void reset ();
+
+	///colors with fewer rows than twice this are solved on the calling thread
+	void	setMinRowsPerTask(int minRowsPerTask)
+	{
+		m_minRowsPerTask = minRowsPerTask;
+	}
+	int		getMinRowsPerTask() const
+	{
+		return m_minRowsPerTask;
+	}
+
+	///number of colors used by the last step, for all three row pools together
+	int		getNumColors() const
+	{
+		return m_nonContactColoring.getNumColors()+m_contactColoring.getNumColors()+m_frictionColoring.getNumColors();
+	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,51 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SpuRayBatchTask.h"
+
+void* createRayBatchLocalStoreMemory()
+{
+	//the ray batch tasks read the world and write the result arrays directly
+	return 0;
+}
+
+static void	rayBatchClosestHits(const SpuRayBatchTaskDesc& taskDesc)
+{
+	const int start = taskDesc.m_startRay;
+	btCollisionWorld::RayBatchResults results;
+	results.m_hitFraction = taskDesc.m_results.m_hitFraction + start;
+	results.m_collisionObject = taskDesc.m_results.m_collisionObject + start;
+	results.m_hitNormalWorld = taskDesc.m_results.m_hitNormalWorld ? taskDesc.m_results.m_hitNormalWorld + start : 0;
+	results.m_triangleIndex = taskDesc.m_results.m_triangleIndex ? taskDesc.m_results.m_triangleIndex + start : 0;
+
+	taskDesc.m_world->rayTestBatch(taskDesc.m_rayFromWorld+start,taskDesc.m_rayToWorld+start,taskDesc.m_numRays,results,
+		taskDesc.m_collisionFilterGroup,taskDesc.m_collisionFilterMask);
+}
+
+void	processRayBatchTask(void* userPtr, void* lsMemory)
+{
+	(void)lsMemory;
+	SpuRayBatchTaskDesc* taskDescPtr = (SpuRayBatchTaskDesc*)userPtr;
+
+	switch (taskDescPtr->m_command)
+	{
+	case CMD_RAY_BATCH_CLOSEST_HITS:
+		rayBatchClosestHits(*taskDescPtr);
+		break;
+	default:
+		btAssert(0);
+		break;
+	};
+}
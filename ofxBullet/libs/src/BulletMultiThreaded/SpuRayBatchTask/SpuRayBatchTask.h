@@ -0,0 +1,54 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef SPU_RAY_BATCH_TASK_H
+#define SPU_RAY_BATCH_TASK_H
+
+#include "../PlatformDefinitions.h"
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+
+enum
+{
+	///find the closest hit of each ray of the task with btCollisionWorld::rayTestBatch
+	CMD_RAY_BATCH_CLOSEST_HITS = 1
+};
+
+ATTRIBUTE_ALIGNED16(struct) SpuRayBatchTaskDesc
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	uint32_t						m_command;
+	uint32_t						m_taskId;
+
+	///the world is not modified while the task runs
+	const btCollisionWorld*			m_world;
+	const btVector3*				m_rayFromWorld;
+	const btVector3*				m_rayToWorld;
+	///output arrays of the whole batch, the task writes the entries of its own rays
+	btCollisionWorld::RayBatchResults	m_results;
+	short int						m_collisionFilterGroup;
+	short int						m_collisionFilterMask;
+
+	///range of rays of this task
+	int								m_startRay;
+	int								m_numRays;
+};
+
+void	processRayBatchTask(void* userPtr, void* lsMemory);
+void*	createRayBatchLocalStoreMemory();
+
+#endif //SPU_RAY_BATCH_TASK_H
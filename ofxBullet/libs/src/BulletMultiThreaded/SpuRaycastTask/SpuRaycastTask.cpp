@@ -60,8 +60,8 @@ void* createRaycastLocalStoreMemory()
 
 void GatherCollisionObjectAndShapeData (RaycastGatheredObjectData* gatheredObjectData, RaycastTask_LocalStoreMemory* lsMemPtr, ppu_address_t objectWrapper)
 {
-	register int dmaSize;
-	register ppu_address_t	dmaPpuAddress2;
+	int dmaSize;
+	ppu_address_t	dmaPpuAddress2;
 	/* DMA Collision object wrapper into local store */
 	dmaSize = sizeof(SpuCollisionObjectWrapper);
 	dmaPpuAddress2 = objectWrapper;
@@ -503,10 +503,6 @@ void	spuWalkStacklessQuantizedTreeAgainstRays(RaycastTask_LocalStoreMemory* lsMe
 void performRaycastAgainstConcave (RaycastGatheredObjectData* gatheredObjectData, const SpuRaycastTaskWorkUnit* workUnits, SpuRaycastTaskWorkUnitOut* workUnitsOut, int numWorkUnits, RaycastTask_LocalStoreMemory* lsMemPtr)
 {
 	//order: first collision shape is convex, second concave. m_isSwapped is true, if the original order was opposite
-	register int dmaSize;
-	register ppu_address_t	dmaPpuAddress2;
-
-	
 	btBvhTriangleMeshShape*	trimeshShape = (btBvhTriangleMeshShape*)gatheredObjectData->m_spuCollisionShape;
 
 	//need the mesh interface, for access to triangle vertices
@@ -647,8 +643,8 @@ performRaycastAgainstConvex (RaycastGatheredObjectData* gatheredObjectData, cons
 	ATTRIBUTE_ALIGNED16(char convexHullShape[sizeof(btConvexHullShape)]);
 	if (gatheredObjectData->m_shapeType == CONVEX_HULL_SHAPE_PROXYTYPE)
 	{
-		register int dmaSize;
-		register ppu_address_t	dmaPpuAddress2;
+		int dmaSize;
+		ppu_address_t	dmaPpuAddress2;
 		dmaSize = sizeof(btConvexHullShape);
 		dmaPpuAddress2 = gatheredObjectData->m_collisionShape;
 		cellDmaGet(&convexHullShape, dmaPpuAddress2, dmaSize, DMA_TAG(1), 0, 0);
@@ -682,7 +678,7 @@ void	processRaycastTask(void* userPtr, void* lsMemory)
 	//spu_printf("in processRaycastTask %d\n", taskDesc.numSpuCollisionObjectWrappers);
 	/* for each object */
 	RaycastGatheredObjectData gatheredObjectData;
-	for (int objectId = 0; objectId < taskDesc.numSpuCollisionObjectWrappers; objectId++)
+	for (unsigned int objectId = 0; objectId < taskDesc.numSpuCollisionObjectWrappers; objectId++)
 	{
 		//spu_printf("%d / %d\n", objectId, taskDesc.numSpuCollisionObjectWrappers);
 		
@@ -692,14 +688,14 @@ void	processRaycastTask(void* userPtr, void* lsMemory)
 		if (btBroadphaseProxy::isConcave (gatheredObjectData.m_shapeType))
 		{
 			SpuRaycastTaskWorkUnitOut tWorkUnitsOut[SPU_RAYCAST_WORK_UNITS_PER_TASK];
-			for (int rayId = 0; rayId < taskDesc.numWorkUnits; rayId++)
+			for (unsigned int rayId = 0; rayId < taskDesc.numWorkUnits; rayId++)
 			{
 				tWorkUnitsOut[rayId].hitFraction = 1.0;
 			}
 
 			performRaycastAgainstConcave (&gatheredObjectData, &taskDesc.workUnits[0], &tWorkUnitsOut[0], taskDesc.numWorkUnits, localMemory);
 
-			for (int rayId = 0; rayId < taskDesc.numWorkUnits; rayId++)
+			for (unsigned int rayId = 0; rayId < taskDesc.numWorkUnits; rayId++)
 			{
 				const SpuRaycastTaskWorkUnit& workUnit = taskDesc.workUnits[rayId];
 				if (tWorkUnitsOut[rayId].hitFraction == 1.0)
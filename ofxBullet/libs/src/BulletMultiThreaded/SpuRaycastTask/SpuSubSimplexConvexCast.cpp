@@ -86,12 +86,9 @@ bool	SpuSubsimplexRayCast::calcTimeOfImpact(const btTransform& fromRay,
 
 	btVector3 n;
 	n.setValue(btScalar(0.), btScalar(0.), btScalar(0.));
-	bool hasResult = false;
 	btVector3 c;
 	int maxIter = MAX_ITERATIONS;
 
-	btScalar lastLambda = lambda;
-
 	btScalar dist2 = v.length2();
 
 #ifdef BT_USE_DOUBLE_PRECISION
@@ -124,16 +121,13 @@ bool	SpuSubsimplexRayCast::calcTimeOfImpact(const btTransform& fromRay,
 				lambda = lambda - VdotW / VdotR;
 				interpolatedTransRay.getOrigin().setInterpolate3(fromRay.getOrigin(), toRay.getOrigin(), lambda);
 				interpolatedTransB.getOrigin().setInterpolate3(fromB.getOrigin(), toB.getOrigin(), lambda);
-				lastLambda = lambda;
 				n = v;
-				hasResult = true;
 			}
 		} 
 		m_simplexSolver->addVertex(w, supVertexRay, supVertexB);
 		if (m_simplexSolver->closest(v))
 		{
 			dist2 = v.length2();
-			hasResult = true;
 			//printf("V=%f , %f, %f\n",v[0],v[1],v[2]);
 			//printf("DIST2=%f\n",dist2);
 			//printf("numverts = %i\n",m_simplexSolver->numVertices());
@@ -0,0 +1,39 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "SpuWorldTileTask.h"
+#include "../btWorldTileManager.h"
+
+void* createWorldTileLocalStoreMemory()
+{
+	//the loader allocates the tile data itself
+	return 0;
+}
+
+void	processWorldTileTask(void* userPtr, void* lsMemory)
+{
+	(void)lsMemory;
+	SpuWorldTileTaskDesc* taskDescPtr = (SpuWorldTileTaskDesc*)userPtr;
+
+	switch (taskDescPtr->m_command)
+	{
+	case CMD_WORLD_TILE_LOAD:
+		taskDescPtr->m_loaded = taskDescPtr->m_loader->loadTile(*taskDescPtr->m_tile);
+		break;
+	default:
+		btAssert(0);
+		break;
+	};
+}
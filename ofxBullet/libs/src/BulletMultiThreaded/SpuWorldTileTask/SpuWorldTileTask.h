@@ -0,0 +1,50 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef SPU_WORLD_TILE_TASK_H
+#define SPU_WORLD_TILE_TASK_H
+
+#include "../PlatformDefinitions.h"
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedAllocator.h"
+
+class btWorldTileLoader;
+struct btWorldTile;
+
+enum
+{
+	///load one tile with btWorldTileLoader::loadTile
+	CMD_WORLD_TILE_LOAD = 1
+};
+
+ATTRIBUTE_ALIGNED16(struct) SpuWorldTileTaskDesc
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	uint32_t						m_command;
+	uint32_t						m_taskId;
+
+	btWorldTileLoader*				m_loader;
+	///the tile is only touched by the task until the task completes, 0 for an idle task
+	btWorldTile*					m_tile;
+	///result of loadTile
+	bool							m_loaded;
+};
+
+
+void	processWorldTileTask(void* userPtr, void* lsMemory);
+void*	createWorldTileLocalStoreMemory();
+
+#endif //SPU_WORLD_TILE_TASK_H
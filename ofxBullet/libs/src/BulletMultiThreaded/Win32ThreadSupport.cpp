@@ -22,6 +22,7 @@ subject to the following restrictions:
 #include "SpuCollisionTaskProcess.h"
 
 #include "SpuNarrowPhaseCollisionTask/SpuGatheringCollisionTask.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 
 
@@ -61,12 +62,16 @@ DWORD WINAPI Thread_no_1( LPVOID lpParam )
 		if (userPtr)
 		{
 			btAssert(status->m_status);
-			status->m_userThreadFunc(userPtr,status->m_lsMemory);
+			{
+				BT_ALLOC_TAG_SCOPE(status->m_allocTag);
+				status->m_userThreadFunc(userPtr,status->m_lsMemory);
+			}
 			status->m_status = 2;
 			SetEvent(status->m_eventCompletetHandle);
 		} else
 		{
 			//exit Thread
+			btThreadCachingAllocator::releaseThreadCache();
 			status->m_status = 3;
 			SetEvent(status->m_eventCompletetHandle);
 			printf("Thread with taskId %i with handle %p exiting\n",status->m_taskId, status->m_threadHandle);
@@ -112,6 +117,7 @@ void Win32ThreadSupport::sendRequest(uint32_t uiCommand, ppu_address_t uiArgumen
 			spuStatus.m_commandId = uiCommand;
 			spuStatus.m_status = 1;
 			spuStatus.m_userPtr = (void*)uiArgument0;
+			spuStatus.m_allocTag = btThreadCachingAllocator::getThreadTag();
 
 			///fire event to start new task
 			SetEvent(spuStatus.m_eventStartHandle);
@@ -174,6 +180,31 @@ void Win32ThreadSupport::waitForResponse(unsigned int *puiArgument0, unsigned in
 
 }
 
+bool Win32ThreadSupport::isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
+	btAssert(m_activeSpuStatus.size());
+
+#ifndef SINGLE_THREADED
+	DWORD res = WaitForMultipleObjects(m_completeHandles.size(), &m_completeHandles[0], FALSE, 0);
+	btAssert(res != WAIT_FAILED);
+	if (res == WAIT_TIMEOUT || res == WAIT_FAILED)
+	{
+		return false;
+	}
+	int last = res - WAIT_OBJECT_0;
+
+	btSpuStatus& spuStatus = m_activeSpuStatus[last];
+	btAssert(spuStatus.m_status > 1);
+	spuStatus.m_status = 0;
+#else
+	btSpuStatus& spuStatus = m_activeSpuStatus[0];
+#endif //SINGLE_THREADED
+
+	*puiArgument0 = spuStatus.m_taskId;
+	*puiArgument1 = spuStatus.m_status;
+	return true;
+}
+
 
 
 void Win32ThreadSupport::startThreads(const Win32ThreadConstructionInfo& threadConstructionInfo)
@@ -216,6 +247,7 @@ void Win32ThreadSupport::startThreads(const Win32ThreadConstructionInfo& threadC
 		spuStatus.m_status = 0;
 		spuStatus.m_threadHandle = handle;
 		spuStatus.m_lsMemory = threadConstructionInfo.m_lsMemoryFunc();
+		spuStatus.m_allocTag = BT_ALLOC_TAG_GENERAL;
 		spuStatus.m_userThreadFunc = threadConstructionInfo.m_userThreadFunc;
 
 		printf("started thread %d with threadHandle %p\n",i,handle);
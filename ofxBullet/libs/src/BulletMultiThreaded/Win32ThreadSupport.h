@@ -48,6 +48,8 @@ public:
 		Win32ThreadFunc	m_userThreadFunc;
 		void*	m_userPtr; //for taskDesc etc
 		void*	m_lsMemory; //initialized using Win32LocalStoreMemorySetupFunc
+		///allocation tag of the thread that sent the request, the task runs with it
+		int		m_allocTag;
 
 		void*	m_threadHandle; //this one is calling 'Win32ThreadFunc'
 
@@ -108,6 +110,8 @@ public:
 ///check for messages from SPUs
 	virtual	void waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1);
 
+	virtual bool isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1);
+
 ///start the spus (can be called at the beginning of each frame, to make sure that the right SPU program is loaded)
 	virtual	void startSPU();
 
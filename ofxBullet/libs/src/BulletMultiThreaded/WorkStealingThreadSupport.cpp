@@ -0,0 +1,539 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <stdio.h>
+#include "WorkStealingThreadSupport.h"
+#ifdef USE_PTHREADS
+#include <errno.h>
+#include <sched.h>
+#include <new>
+
+#include "SpuCollisionTaskProcess.h"
+#include "SpuNarrowPhaseCollisionTask/SpuGatheringCollisionTask.h"
+#include "LinearMath/btThreadCachingAllocator.h"
+
+#define checkPThreadFunction(returnValue) \
+    if(0 != returnValue) { \
+        printf("PThread problem at line %i in file %s: %i %d\n", __LINE__, __FILE__, returnValue, errno); \
+    }
+
+enum
+{
+	TASK_IDLE = 0,
+	TASK_BUSY,
+	TASK_DONE
+};
+
+//atomics with the ordering the deque needs, on x86 only the full fence costs an instruction
+static inline long	btAtomicLoadAcquire(volatile long* value)
+{
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+static inline void	btAtomicStoreRelease(volatile long* value, long newValue)
+{
+	__atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+static inline long	btAtomicAdd(volatile long* value, long add)
+{
+	return __atomic_fetch_add(value, add, __ATOMIC_SEQ_CST);
+}
+
+static inline bool	btAtomicCompareExchange(volatile long* value, long expected, long newValue)
+{
+	return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static inline void	btFullMemoryFence()
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+///backs off while spinning, yielding now and then lets the thread that has work run when there are more threads than cores
+static inline void	btSpinWait(int spins)
+{
+	if ((spins & 63) == 0)
+	{
+		sched_yield();
+		return;
+	}
+#if defined (__i386__) || defined (__x86_64__)
+	__asm__ __volatile__ ("pause");
+#endif
+}
+
+
+bool	btWorkStealingDeque::push(btWorkStealingJob* job)
+{
+	long bottom = m_bottom;
+	long top = btAtomicLoadAcquire(&m_top);
+	if (bottom-top >= WORK_STEALING_DEQUE_SIZE)
+		return false;
+	m_jobs[bottom & (WORK_STEALING_DEQUE_SIZE-1)] = job;
+	btAtomicStoreRelease(&m_bottom, bottom+1);
+	return true;
+}
+
+btWorkStealingJob*	btWorkStealingDeque::pop()
+{
+	long bottom = m_bottom-1;
+	m_bottom = bottom;
+	btFullMemoryFence();
+	long top = m_top;
+	if (top > bottom)
+	{
+		m_bottom = bottom+1;
+		return 0;
+	}
+	btWorkStealingJob* job = m_jobs[bottom & (WORK_STEALING_DEQUE_SIZE-1)];
+	if (top == bottom)
+	{
+		//last job, race the thieves for it
+		if (!btAtomicCompareExchange(&m_top, top, top+1))
+			job = 0;
+		m_bottom = bottom+1;
+	}
+	return job;
+}
+
+btWorkStealingJob*	btWorkStealingDeque::steal()
+{
+	long top = btAtomicLoadAcquire(&m_top);
+	btFullMemoryFence();
+	long bottom = btAtomicLoadAcquire(&m_bottom);
+	if (top >= bottom)
+		return 0;
+	btWorkStealingJob* job = m_jobs[top & (WORK_STEALING_DEQUE_SIZE-1)];
+	if (!btAtomicCompareExchange(&m_top, top, top+1))
+		return 0;
+	return job;
+}
+
+
+///shared state of one parallelFor call, lives on the stack of the calling thread
+struct btWorkStealingParallelFor
+{
+	const btParallelForBody*	m_body;
+	volatile long				m_next;
+	long						m_end;
+	long						m_grainSize;
+	///helper jobs that have not finished yet, the call returns when this reaches zero
+	volatile long				m_pendingJobs;
+	btWorkStealingJob			m_jobs[WORK_STEALING_MAX_THREADS];
+};
+
+
+static void *workerThreadFunction(void *argument)
+{
+	WorkStealingThreadSupport::btWorkerThread* worker = (WorkStealingThreadSupport::btWorkerThread*)argument;
+	worker->m_threadSupport->workerLoop(worker->m_threadIndex);
+	btThreadCachingAllocator::releaseThreadCache();
+	return 0;
+}
+
+WorkStealingThreadSupport::WorkStealingThreadSupport(ThreadConstructionInfo& threadConstructionInfo)
+:m_deques(0),
+m_numDeques(0)
+{
+	startThreads(threadConstructionInfo);
+}
+
+WorkStealingThreadSupport::~WorkStealingThreadSupport()
+{
+	checkPThreadFunction(pthread_mutex_lock(&m_mutex));
+	btAtomicStoreRelease(&m_exitThreads, 1);
+	checkPThreadFunction(pthread_cond_broadcast(&m_workCondition));
+	checkPThreadFunction(pthread_mutex_unlock(&m_mutex));
+
+	for (int i=0;i<m_workerThreads.size();i++)
+	{
+		checkPThreadFunction(pthread_join(m_workerThreads[i].m_thread, 0));
+	}
+	m_workerThreads.clear();
+
+	checkPThreadFunction(pthread_key_delete(m_threadIndexKey));
+	checkPThreadFunction(pthread_cond_destroy(&m_doneCondition));
+	checkPThreadFunction(pthread_cond_destroy(&m_workCondition));
+	checkPThreadFunction(pthread_mutex_destroy(&m_mutex));
+
+	for (int i=0;i<m_numDeques;i++)
+	{
+		m_deques[i].~btWorkStealingDeque();
+	}
+	btAlignedFree(m_deques);
+}
+
+void	WorkStealingThreadSupport::startThreads(ThreadConstructionInfo& threadConstructionInfo)
+{
+	int numThreads = btMin(threadConstructionInfo.m_numThreads, int(WORK_STEALING_MAX_THREADS-1));
+	if (numThreads < 0)
+		numThreads = 0;
+
+	m_userThreadFunc = threadConstructionInfo.m_userThreadFunc;
+	m_lsMemoryFunc = threadConstructionInfo.m_lsMemoryFunc;
+	m_spinCount = threadConstructionInfo.m_spinCount;
+	m_numSleepingWorkers = 0;
+	m_numSleepingWaiters = 0;
+	m_workEpoch = 0;
+	m_doneEpoch = 0;
+	m_exitThreads = 0;
+
+	checkPThreadFunction(pthread_mutex_init(&m_mutex, 0));
+	checkPThreadFunction(pthread_cond_init(&m_workCondition, 0));
+	checkPThreadFunction(pthread_cond_init(&m_doneCondition, 0));
+	checkPThreadFunction(pthread_key_create(&m_threadIndexKey, 0));
+
+	//one task id per thread, like PosixThreadSupport, but at least one so tasks can run without threads
+	m_taskStatus.resize(numThreads ? numThreads : 1);
+	initTaskStatus(0);
+
+	m_numDeques = numThreads+1;
+	m_deques = (btWorkStealingDeque*)btAlignedAlloc(sizeof(btWorkStealingDeque)*m_numDeques, 64);
+	for (int i=0;i<m_numDeques;i++)
+	{
+		new (&m_deques[i]) btWorkStealingDeque();
+	}
+
+	//the array must not grow once the threads hold pointers into it
+	m_workerThreads.resize(numThreads);
+	for (int i=0;i<numThreads;i++)
+	{
+		btWorkerThread& worker = m_workerThreads[i];
+		worker.m_threadSupport = this;
+		worker.m_threadIndex = i;
+		checkPThreadFunction(pthread_create(&worker.m_thread, NULL, &workerThreadFunction, (void*)&worker));
+	}
+}
+
+void	WorkStealingThreadSupport::initTaskStatus(int firstTaskId)
+{
+	for (int i=firstTaskId;i<m_taskStatus.size();i++)
+	{
+		btTaskStatus& taskStatus = m_taskStatus[i];
+		taskStatus.m_status = TASK_IDLE;
+		taskStatus.m_userPtr = 0;
+		taskStatus.m_lsMemory = m_lsMemoryFunc();
+		taskStatus.m_job.m_type = btWorkStealingJob::JOB_TASK;
+		taskStatus.m_job.m_taskId = i;
+		taskStatus.m_job.m_allocTag = BT_ALLOC_TAG_GENERAL;
+		taskStatus.m_job.m_parallelFor = 0;
+	}
+}
+
+void	WorkStealingThreadSupport::setNumTasks(int numTasks)
+{
+	int oldNumTasks = m_taskStatus.size();
+	if (numTasks <= oldNumTasks)
+		return;
+	//the deques hold pointers to the jobs inside m_taskStatus
+	for (int i=0;i<oldNumTasks;i++)
+	{
+		btAssert(m_taskStatus[i].m_status == TASK_IDLE);
+	}
+	m_taskStatus.resize(numTasks);
+	initTaskStatus(oldNumTasks);
+}
+
+int	WorkStealingThreadSupport::getCurrentDequeIndex() const
+{
+	//worker threads store index+1, the issuing thread has no entry and owns the last deque
+	long index = (long)pthread_getspecific(m_threadIndexKey);
+	return index ? int(index-1) : m_numDeques-1;
+}
+
+btWorkStealingJob*	WorkStealingThreadSupport::findJob(int dequeIndex)
+{
+	btWorkStealingJob* job = m_deques[dequeIndex].pop();
+	if (job)
+		return job;
+	for (int i=1;i<m_numDeques;i++)
+	{
+		int victim = dequeIndex+i;
+		if (victim >= m_numDeques)
+			victim -= m_numDeques;
+		job = m_deques[victim].steal();
+		if (job)
+			return job;
+	}
+	return 0;
+}
+
+void	WorkStealingThreadSupport::runJob(btWorkStealingJob* job)
+{
+	BT_ALLOC_TAG_SCOPE(job->m_allocTag);
+	if (job->m_type == btWorkStealingJob::JOB_TASK)
+	{
+		btTaskStatus& taskStatus = m_taskStatus[job->m_taskId];
+		m_userThreadFunc(taskStatus.m_userPtr, taskStatus.m_lsMemory);
+		btAtomicStoreRelease(&taskStatus.m_status, TASK_DONE);
+		signalDone();
+	} else
+	{
+		btWorkStealingParallelFor* parallelFor = job->m_parallelFor;
+		runParallelFor(*parallelFor);
+		//the parallelFor can return as soon as this reaches zero, don't touch it afterwards
+		btAtomicAdd(&parallelFor->m_pendingJobs, -1);
+		signalDone();
+	}
+}
+
+void	WorkStealingThreadSupport::pushJob(int dequeIndex, btWorkStealingJob* job)
+{
+	if (!m_deques[dequeIndex].push(job))
+	{
+		runJob(job);
+		return;
+	}
+	wakeWorkers();
+}
+
+void	WorkStealingThreadSupport::wakeWorkers()
+{
+	//pairs with the fence in workerLoop: either the worker sees the new job, or we see the sleeping worker
+	btFullMemoryFence();
+	if (m_numSleepingWorkers)
+	{
+		checkPThreadFunction(pthread_mutex_lock(&m_mutex));
+		m_workEpoch++;
+		checkPThreadFunction(pthread_cond_broadcast(&m_workCondition));
+		checkPThreadFunction(pthread_mutex_unlock(&m_mutex));
+	}
+}
+
+void	WorkStealingThreadSupport::signalDone()
+{
+	btFullMemoryFence();
+	if (m_numSleepingWaiters)
+	{
+		checkPThreadFunction(pthread_mutex_lock(&m_mutex));
+		m_doneEpoch++;
+		checkPThreadFunction(pthread_cond_broadcast(&m_doneCondition));
+		checkPThreadFunction(pthread_mutex_unlock(&m_mutex));
+	}
+}
+
+void	WorkStealingThreadSupport::workerLoop(int threadIndex)
+{
+	checkPThreadFunction(pthread_setspecific(m_threadIndexKey, (void*)(long)(threadIndex+1)));
+
+	int spins = 0;
+	while (!btAtomicLoadAcquire(&m_exitThreads))
+	{
+		btWorkStealingJob* job = findJob(threadIndex);
+		if (job)
+		{
+			runJob(job);
+			spins = 0;
+			continue;
+		}
+		if (++spins < m_spinCount)
+		{
+			btSpinWait(spins);
+			continue;
+		}
+
+		checkPThreadFunction(pthread_mutex_lock(&m_mutex));
+		long epoch = m_workEpoch;
+		m_numSleepingWorkers++;
+		btFullMemoryFence();
+		//look once more after announcing the sleep, a push in between either shows up here or wakes us
+		job = findJob(threadIndex);
+		if (!job)
+		{
+			while ((epoch == m_workEpoch) && !m_exitThreads)
+			{
+				checkPThreadFunction(pthread_cond_wait(&m_workCondition, &m_mutex));
+			}
+		}
+		m_numSleepingWorkers--;
+		checkPThreadFunction(pthread_mutex_unlock(&m_mutex));
+		spins = 0;
+		if (job)
+		{
+			runJob(job);
+		}
+	}
+}
+
+bool	WorkStealingThreadSupport::isWaitDone(volatile long* counter, long doneValue) const
+{
+	if (counter)
+		return btAtomicLoadAcquire(counter) == doneValue;
+	//no counter: wait for any task to finish
+	for (int i=0;i<m_taskStatus.size();i++)
+	{
+		if (btAtomicLoadAcquire((volatile long*)&m_taskStatus[i].m_status) == TASK_DONE)
+			return true;
+	}
+	return false;
+}
+
+///runs queued jobs until the wait is done, then spins and finally sleeps
+void	WorkStealingThreadSupport::helpUntil(volatile long* counter, long doneValue)
+{
+	const int dequeIndex = getCurrentDequeIndex();
+	int spins = 0;
+	while (!isWaitDone(counter,doneValue))
+	{
+		btWorkStealingJob* job = findJob(dequeIndex);
+		if (job)
+		{
+			runJob(job);
+			spins = 0;
+			continue;
+		}
+		if (++spins < m_spinCount)
+		{
+			btSpinWait(spins);
+			continue;
+		}
+
+		checkPThreadFunction(pthread_mutex_lock(&m_mutex));
+		long epoch = m_doneEpoch;
+		m_numSleepingWaiters++;
+		btFullMemoryFence();
+		if (!isWaitDone(counter,doneValue))
+		{
+			while (epoch == m_doneEpoch)
+			{
+				checkPThreadFunction(pthread_cond_wait(&m_doneCondition, &m_mutex));
+			}
+		}
+		m_numSleepingWaiters--;
+		checkPThreadFunction(pthread_mutex_unlock(&m_mutex));
+		spins = 0;
+	}
+}
+
+///send messages to SPUs
+void WorkStealingThreadSupport::sendRequest(uint32_t uiCommand, ppu_address_t uiArgument0, uint32_t taskId)
+{
+	switch (uiCommand)
+	{
+	case 	CMD_GATHER_AND_PROCESS_PAIRLIST:
+		{
+			btAssert(taskId < (uint32_t)m_taskStatus.size());
+			btTaskStatus& taskStatus = m_taskStatus[taskId];
+			btAssert(taskStatus.m_status == TASK_IDLE);
+			taskStatus.m_userPtr = (void*)uiArgument0;
+			taskStatus.m_job.m_allocTag = btThreadCachingAllocator::getThreadTag();
+			taskStatus.m_status = TASK_BUSY;
+			pushJob(getCurrentDequeIndex(), &taskStatus.m_job);
+			break;
+		}
+	default:
+		{
+			///not implemented
+			btAssert(0);
+		}
+
+	};
+}
+
+///check for messages from SPUs
+void WorkStealingThreadSupport::waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
+	helpUntil(0,0);
+
+	bool completed = isTaskCompleted(puiArgument0, puiArgument1);
+	btAssert(completed);
+	(void)completed;
+}
+
+bool WorkStealingThreadSupport::isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
+	//doesn't help with queued jobs, the workers pick them up
+	for (int i=0;i<m_taskStatus.size();i++)
+	{
+		btTaskStatus& taskStatus = m_taskStatus[i];
+		if (btAtomicLoadAcquire(&taskStatus.m_status) == TASK_DONE)
+		{
+			taskStatus.m_status = TASK_IDLE;
+			*puiArgument0 = i;
+			*puiArgument1 = TASK_DONE;
+			return true;
+		}
+	}
+	return false;
+}
+
+void	WorkStealingThreadSupport::runParallelFor(btWorkStealingParallelFor& parallelFor)
+{
+	while (1)
+	{
+		long begin = btAtomicAdd(&parallelFor.m_next, parallelFor.m_grainSize);
+		if (begin >= parallelFor.m_end)
+			break;
+		long end = btMin(begin+parallelFor.m_grainSize, parallelFor.m_end);
+		parallelFor.m_body->forLoop(int(begin), int(end));
+	}
+}
+
+void	WorkStealingThreadSupport::parallelFor(int begin, int end, int grainSize, const btParallelForBody& body)
+{
+	if (begin >= end)
+		return;
+	if (grainSize < 1)
+		grainSize = 1;
+
+	const int numChunks = (end-begin+grainSize-1)/grainSize;
+	const int numHelpers = btMin(numChunks, m_numDeques)-1;
+	if (numHelpers < 1)
+	{
+		body.forLoop(begin,end);
+		return;
+	}
+
+	btWorkStealingParallelFor parallelFor;
+	parallelFor.m_body = &body;
+	parallelFor.m_next = begin;
+	parallelFor.m_end = end;
+	parallelFor.m_grainSize = grainSize;
+	parallelFor.m_pendingJobs = numHelpers;
+
+	//the helpers only hand out chunks, so it does not matter which threads pick them up
+	const int dequeIndex = getCurrentDequeIndex();
+	const int allocTag = btThreadCachingAllocator::getThreadTag();
+	int i;
+	for (i=0;i<numHelpers;i++)
+	{
+		btWorkStealingJob& job = parallelFor.m_jobs[i];
+		job.m_type = btWorkStealingJob::JOB_PARALLEL_FOR;
+		job.m_taskId = -1;
+		job.m_allocTag = allocTag;
+		job.m_parallelFor = &parallelFor;
+		if (!m_deques[dequeIndex].push(&job))
+		{
+			btAtomicAdd(&parallelFor.m_pendingJobs, -(numHelpers-i));
+			break;
+		}
+	}
+	wakeWorkers();
+
+	runParallelFor(parallelFor);
+	helpUntil(&parallelFor.m_pendingJobs, 0);
+}
+
+void WorkStealingThreadSupport::startSPU()
+{
+}
+
+///tell the task scheduler we are done with the SPU tasks
+void WorkStealingThreadSupport::stopSPU()
+{
+}
+
+#endif // USE_PTHREADS
@@ -0,0 +1,201 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "LinearMath/btScalar.h"
+#include "PlatformDefinitions.h"
+
+#ifdef USE_PTHREADS  //platform specific defines are defined in PlatformDefinitions.h
+#include <pthread.h>
+
+#ifndef WORK_STEALING_THREAD_SUPPORT_H
+#define WORK_STEALING_THREAD_SUPPORT_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+
+#include "btThreadSupportInterface.h"
+
+
+typedef void (*WorkStealingThreadFunc)(void* userPtr,void* lsMemory);
+typedef void* (*WorkStealinglsMemorySetupFunc)();
+
+enum
+{
+	WORK_STEALING_DEQUE_SIZE = 1024,
+	WORK_STEALING_MAX_THREADS = 64
+};
+
+///a task or a share of a parallelFor, jobs are owned by the thread support or by the parallelFor call
+struct btWorkStealingJob
+{
+	enum
+	{
+		JOB_TASK,
+		JOB_PARALLEL_FOR
+	};
+	int		m_type;
+	int		m_taskId;
+	///allocation tag of the thread that issued the job, the job runs with it
+	int		m_allocTag;
+	struct btWorkStealingParallelFor*	m_parallelFor;
+};
+
+///Chase-Lev deque with a fixed capacity. Only the owner thread calls push and pop, any thread can steal.
+class btWorkStealingDeque
+{
+	volatile long		m_top;
+	char				m_padding0[64-sizeof(long)];
+	volatile long		m_bottom;
+	char				m_padding1[64-sizeof(long)];
+	btWorkStealingJob*	m_jobs[WORK_STEALING_DEQUE_SIZE];
+
+public:
+	btWorkStealingDeque()
+		:m_top(0),
+		m_bottom(0)
+	{
+	}
+
+	///returns false when the deque is full, the caller then runs the job itself
+	bool	push(btWorkStealingJob* job);
+
+	btWorkStealingJob*	pop();
+
+	btWorkStealingJob*	steal();
+};
+
+///WorkStealingThreadSupport runs SPU style tasks and fine grained parallelFor loops on a pool of threads.
+///Each thread owns a work-stealing deque, the thread that issues work owns one more. Idle threads spin for a
+///while before they sleep, so short jobs do not pay for a system call. The thread that waits for a task or a
+///parallelFor helps by running queued jobs. Tasks, waitForResponse and parallelFor must be issued from a
+///single thread, or from inside parallelFor bodies.
+class WorkStealingThreadSupport : public btThreadSupportInterface
+{
+public:
+
+	struct	ThreadConstructionInfo
+	{
+		ThreadConstructionInfo(char* uniqueName,
+									WorkStealingThreadFunc userThreadFunc,
+									WorkStealinglsMemorySetupFunc	lsMemoryFunc,
+									int numThreads=1,
+									int spinCount=20000
+									)
+									:m_uniqueName(uniqueName),
+									m_userThreadFunc(userThreadFunc),
+									m_lsMemoryFunc(lsMemoryFunc),
+									m_numThreads(numThreads),
+									m_spinCount(spinCount)
+		{
+
+		}
+
+		char*							m_uniqueName;
+		WorkStealingThreadFunc			m_userThreadFunc;
+		WorkStealinglsMemorySetupFunc	m_lsMemoryFunc;
+		int								m_numThreads;
+		///number of unsuccessful attempts to find work before a thread sleeps
+		int								m_spinCount;
+	};
+
+	///each task id has its own local store, the task can run on any thread
+	struct	btTaskStatus
+	{
+		volatile long		m_status;
+		void*				m_userPtr;
+		void*				m_lsMemory;
+		btWorkStealingJob	m_job;
+	};
+
+	struct	btWorkerThread
+	{
+		WorkStealingThreadSupport*	m_threadSupport;
+		int							m_threadIndex;
+		pthread_t					m_thread;
+	};
+
+private:
+
+	btAlignedObjectArray<btTaskStatus>		m_taskStatus;
+	btAlignedObjectArray<btWorkerThread>	m_workerThreads;
+	///one deque per worker thread, the last one belongs to the issuing thread
+	btWorkStealingDeque*					m_deques;
+	int										m_numDeques;
+
+	WorkStealingThreadFunc					m_userThreadFunc;
+	WorkStealinglsMemorySetupFunc			m_lsMemoryFunc;
+	int										m_spinCount;
+
+	pthread_mutex_t							m_mutex;
+	pthread_cond_t							m_workCondition;
+	pthread_cond_t							m_doneCondition;
+	pthread_key_t							m_threadIndexKey;
+	volatile long							m_numSleepingWorkers;
+	volatile long							m_numSleepingWaiters;
+	volatile long							m_workEpoch;
+	volatile long							m_doneEpoch;
+	volatile long							m_exitThreads;
+
+	int		getCurrentDequeIndex() const;
+	btWorkStealingJob*	findJob(int dequeIndex);
+	void	runJob(btWorkStealingJob* job);
+	void	pushJob(int dequeIndex, btWorkStealingJob* job);
+	void	wakeWorkers();
+	void	signalDone();
+	bool	isWaitDone(volatile long* counter, long doneValue) const;
+	void	helpUntil(volatile long* counter, long doneValue);
+	void	runParallelFor(struct btWorkStealingParallelFor& parallelFor);
+	void	initTaskStatus(int firstTaskId);
+
+public:
+
+	WorkStealingThreadSupport(ThreadConstructionInfo& threadConstructionInfo);
+
+	virtual	~WorkStealingThreadSupport();
+
+	void	startThreads(ThreadConstructionInfo&	threadInfo);
+
+	void	workerLoop(int threadIndex);
+
+///send messages to SPUs
+	virtual	void sendRequest(uint32_t uiCommand, ppu_address_t uiArgument0, uint32_t uiArgument1);
+
+///check for messages from SPUs
+	virtual	void waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1);
+
+	virtual bool isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1);
+
+///start the spus (can be called at the beginning of each frame, to make sure that the right SPU program is loaded)
+	virtual	void startSPU();
+
+///tell the task scheduler we are done with the SPU tasks
+	virtual	void stopSPU();
+
+	///task ids are not bound to threads, so the number of task ids can exceed the number of threads.
+	///Grows the number of task ids to numTasks, but never shrinks it. Must not be called while tasks are in flight.
+	virtual void setNumTasks(int numTasks);
+
+	virtual void	parallelFor(int begin, int end, int grainSize, const btParallelForBody& body);
+
+	virtual int		getNumParallelThreads() const
+	{
+		return m_workerThreads.size()+1;
+	}
+
+};
+
+#endif // WORK_STEALING_THREAD_SUPPORT_H
+
+#endif // USE_PTHREADS
@@ -0,0 +1,115 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btParallelDbvtBuilder.h"
+#include "btThreadSupportInterface.h"
+#include "LinearMath/btMinMax.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreadCachingAllocator.h"
+
+enum
+{
+	PARALLEL_DBVT_BUILD_MIN_JOB_LEAVES = 1024,
+	PARALLEL_DBVT_BUILD_JOBS_PER_TASK = 4,
+	PARALLEL_DBVT_BUILD_MAX_TASKS = 64
+};
+
+btParallelDbvtBuilder::btParallelDbvtBuilder(btThreadSupportInterface* threadInterface,int maxNumTasks)
+:m_threadInterface(threadInterface),
+m_maxNumTasks(0),
+m_minJobLeaves(PARALLEL_DBVT_BUILD_MIN_JOB_LEAVES),
+m_numBusyTasks(0)
+{
+	setNumTasks(maxNumTasks);
+	m_threadInterface->startSPU();
+}
+
+btParallelDbvtBuilder::~btParallelDbvtBuilder()
+{
+	if (isBuildRunning())
+	{
+		finishBuild();
+	}
+	m_threadInterface->stopSPU();
+}
+
+void	btParallelDbvtBuilder::setNumTasks(int numTasks)
+{
+	btAssert(!isBuildRunning());
+	m_maxNumTasks = btMax(1,btMin(numTasks,int(PARALLEL_DBVT_BUILD_MAX_TASKS)));
+	m_taskDescs.resize(m_maxNumTasks);
+	m_threadInterface->setNumTasks(m_maxNumTasks);
+}
+
+void	btParallelDbvtBuilder::build(btDbvt* tree)
+{
+	BT_PROFILE("parallelDbvtBuild");
+	startBuild(tree);
+	finishBuild();
+}
+
+void	btParallelDbvtBuilder::startBuild(btDbvt* tree)
+{
+	btAssert(!isBuildRunning());
+	//the tasks run with the tag of this thread
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
+
+	const int numLeaves = tree->m_leaves;
+	const int numTasks = btMin(m_maxNumTasks,numLeaves/btMax(m_minJobLeaves,1));
+	if (numTasks < 2)
+	{
+		m_builder.prepare(tree);
+		for (int job=0;job<m_builder.getNumJobs();job++)
+		{
+			m_builder.buildJob(job);
+		}
+		return;
+	}
+
+	//several jobs per task, as the SAH splits don't balance the job sizes
+	const int numJobs = numTasks*PARALLEL_DBVT_BUILD_JOBS_PER_TASK;
+	m_builder.prepare(tree,(numLeaves+numJobs-1)/numJobs);
+
+	for (int task=0;task<numTasks;task++)
+	{
+		SpuDbvtBuildTaskDesc& taskDesc = m_taskDescs[task];
+		taskDesc.m_command = CMD_DBVT_BUILD_JOBS;
+		taskDesc.m_taskId = task;
+		taskDesc.m_builder = &m_builder;
+		taskDesc.m_firstJob = task;
+		taskDesc.m_jobStride = numTasks;
+	}
+	m_numBusyTasks = numTasks;
+	m_threadInterface->sendTasks(&m_taskDescs[0],sizeof(SpuDbvtBuildTaskDesc),0,numTasks);
+}
+
+bool	btParallelDbvtBuilder::isBuildFinished()
+{
+	unsigned int taskId;
+	unsigned int outputSize;
+	while (m_numBusyTasks && m_threadInterface->isTaskCompleted(&taskId, &outputSize))
+	{
+		m_numBusyTasks--;
+	}
+	return m_numBusyTasks == 0;
+}
+
+bool	btParallelDbvtBuilder::finishBuild()
+{
+	m_threadInterface->waitForTasks(m_numBusyTasks);
+	m_numBusyTasks = 0;
+	return m_builder.commit();
+}
@@ -0,0 +1,81 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_PARALLEL_DBVT_BUILDER_H
+#define BT_PARALLEL_DBVT_BUILDER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "SpuDbvtBuildTask/SpuDbvtBuildTask.h"
+
+class btThreadSupportInterface;
+
+///btParallelDbvtBuilder runs the jobs of a btDbvtBuilder on worker threads, to rebuild a btDbvt with the surface area heuristic.
+///The thread support has to be created with processDbvtBuildTask and createDbvtBuildLocalStoreMemory.
+///build rebuilds a tree at load time, for example both sets of a btDbvtBroadphase:
+///	builder.build(&broadphase->m_sets[0]);
+///	builder.build(&broadphase->m_sets[1]);
+///startBuild and finishBuild run an occasional rebuild in the background, while the tree is still used by the simulation.
+///The new tree only replaces the old one if no leaves were inserted, removed or updated in between, which suits the rarely changing
+///fixed set m_sets[1]. Incremental optimization of the tree, as done by btDbvtBroadphase::collide, can go on meanwhile.
+class btParallelDbvtBuilder
+{
+	btThreadSupportInterface*					m_threadInterface;
+	int											m_maxNumTasks;
+	int											m_minJobLeaves;
+	int											m_numBusyTasks;
+	btDbvtBuilder								m_builder;
+	btAlignedObjectArray<SpuDbvtBuildTaskDesc>	m_taskDescs;
+
+public:
+
+	btParallelDbvtBuilder(btThreadSupportInterface* threadInterface,int maxNumTasks);
+
+	virtual ~btParallelDbvtBuilder();
+
+	///rebuilds the tree and returns when it is done
+	void	build(btDbvt* tree);
+
+	///startBuild takes a snapshot of the tree, builds the top levels on the calling thread and starts the tasks for the rest
+	void	startBuild(btDbvt* tree);
+
+	///isBuildFinished returns true when the tasks of the running build are done, without blocking
+	bool	isBuildFinished();
+
+	///finishBuild waits for the tasks and replaces the nodes of the tree. It returns false when leaves of the tree
+	///were changed since startBuild, then the new nodes are discarded and the tree is left as it is.
+	bool	finishBuild();
+
+	bool	isBuildRunning() const
+	{
+		return m_numBusyTasks > 0;
+	}
+
+	void	setNumTasks(int numTasks);
+
+	///trees with fewer leaves per task use fewer tasks, small trees are built on the calling thread
+	void	setMinJobLeaves(int minJobLeaves)
+	{
+		m_minJobLeaves = minJobLeaves;
+	}
+
+	int		getMinJobLeaves() const
+	{
+		return m_minJobLeaves;
+	}
+};
+
+#endif //BT_PARALLEL_DBVT_BUILDER_H
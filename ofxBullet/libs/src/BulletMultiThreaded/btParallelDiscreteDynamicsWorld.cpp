@@ -0,0 +1,488 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelDiscreteDynamicsWorld.h"
+#include "btThreadSupportInterface.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "LinearMath/btMinMax.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreadCachingAllocator.h"
+#include <string.h>
+
+extern int gNumClampedCcdMotions;
+
+enum
+{
+	PARALLEL_WORLD_MIN_BODIES_PER_TASK = 256,
+	PARALLEL_WORLD_MIN_ISLAND_BATCH_SIZE = 64,
+	PARALLEL_WORLD_MAX_TASKS = 64
+};
+
+SIMD_FORCE_INLINE	int	btGetIslandBatchConstraintIslandId(const btTypedConstraint* lhs)
+{
+	const btCollisionObject& rcolObj0 = lhs->getRigidBodyA();
+	const btCollisionObject& rcolObj1 = lhs->getRigidBodyB();
+	return rcolObj0.getIslandTag()>=0?rcolObj0.getIslandTag():rcolObj1.getIslandTag();
+}
+
+///same order as btDiscreteDynamicsWorld::solveConstraints uses
+class btSortIslandBatchConstraintPredicate
+{
+	public:
+
+		bool operator() ( const btTypedConstraint* lhs, const btTypedConstraint* rhs )
+		{
+			return btGetIslandBatchConstraintIslandId(lhs) < btGetIslandBatchConstraintIslandId(rhs);
+		}
+};
+
+///larger batches first, ties in batch order
+class btSortIslandBatchCostPredicate
+{
+	const SpuSolverIslandBatch*	m_batches;
+
+	public:
+
+		btSortIslandBatchCostPredicate(const SpuSolverIslandBatch* batches)
+			:m_batches(batches)
+		{
+		}
+
+		bool operator() ( int lhs, int rhs )
+		{
+			const int lhsCost = m_batches[lhs].m_numManifolds+m_batches[lhs].m_numConstraints;
+			const int rhsCost = m_batches[rhs].m_numManifolds+m_batches[rhs].m_numConstraints;
+			return (lhsCost > rhsCost) || ((lhsCost == rhsCost) && (lhs < rhs));
+		}
+};
+
+///copies the islands that need solving into flat arrays and groups them into batches
+struct btIslandBatchCollector : public btSimulationIslandManager::IslandCallback
+{
+	btTypedConstraint**								m_sortedConstraints;
+	int												m_numConstraints;
+	int												m_constraintCursor;
+	int												m_minBatchSize;
+
+	btAlignedObjectArray<btCollisionObject*>&		m_bodies;
+	btAlignedObjectArray<btPersistentManifold*>&	m_manifolds;
+	btAlignedObjectArray<btTypedConstraint*>&		m_constraints;
+	btAlignedObjectArray<SpuSolverIslandBatch>&		m_batches;
+	SpuSolverIslandBatch							m_batch;
+
+	btIslandBatchCollector(btTypedConstraint** sortedConstraints,int numConstraints,int minBatchSize,
+		btAlignedObjectArray<btCollisionObject*>& bodies,
+		btAlignedObjectArray<btPersistentManifold*>& manifolds,
+		btAlignedObjectArray<btTypedConstraint*>& constraints,
+		btAlignedObjectArray<SpuSolverIslandBatch>& batches)
+		:m_sortedConstraints(sortedConstraints),
+		m_numConstraints(numConstraints),
+		m_constraintCursor(0),
+		m_minBatchSize(minBatchSize),
+		m_bodies(bodies),
+		m_manifolds(manifolds),
+		m_constraints(constraints),
+		m_batches(batches)
+	{
+		startBatch();
+	}
+
+	btIslandBatchCollector& operator=(btIslandBatchCollector& other)
+	{
+		btAssert(0);
+		(void)other;
+		return *this;
+	}
+
+	void	startBatch()
+	{
+		m_batch.m_firstBody = m_bodies.size();
+		m_batch.m_numBodies = 0;
+		m_batch.m_firstManifold = m_manifolds.size();
+		m_batch.m_numManifolds = 0;
+		m_batch.m_firstConstraint = m_constraints.size();
+		m_batch.m_numConstraints = 0;
+	}
+
+	void	flushBatch()
+	{
+		if (m_batch.m_numManifolds+m_batch.m_numConstraints)
+		{
+			m_batches.push_back(m_batch);
+		}
+		startBatch();
+	}
+
+	virtual	void	ProcessIsland(btCollisionObject** bodies,int numBodies,btPersistentManifold**	manifolds,int numManifolds, int islandId)
+	{
+		int startConstraint = 0;
+		int numCurConstraints = m_numConstraints;
+		if (islandId>=0)
+		{
+			//islands are processed in increasing id order, so the constraints of an island follow those of the previous one
+			if ((m_constraintCursor>0) && (btGetIslandBatchConstraintIslandId(m_sortedConstraints[m_constraintCursor-1]) > islandId))
+			{
+				m_constraintCursor = 0;
+			}
+			while ((m_constraintCursor<m_numConstraints) && (btGetIslandBatchConstraintIslandId(m_sortedConstraints[m_constraintCursor]) < islandId))
+			{
+				m_constraintCursor++;
+			}
+			startConstraint = m_constraintCursor;
+			while ((m_constraintCursor<m_numConstraints) && (btGetIslandBatchConstraintIslandId(m_sortedConstraints[m_constraintCursor]) == islandId))
+			{
+				m_constraintCursor++;
+			}
+			numCurConstraints = m_constraintCursor-startConstraint;
+		}
+
+		///only solve islands with some work, like btDiscreteDynamicsWorld
+		if (!(numManifolds + numCurConstraints))
+			return;
+
+		int i;
+		for (i=0;i<numBodies;i++)
+			m_bodies.push_back(bodies[i]);
+		for (i=0;i<numManifolds;i++)
+			m_manifolds.push_back(manifolds[i]);
+		for (i=0;i<numCurConstraints;i++)
+			m_constraints.push_back(m_sortedConstraints[startConstraint+i]);
+		m_batch.m_numBodies += numBodies;
+		m_batch.m_numManifolds += numManifolds;
+		m_batch.m_numConstraints += numCurConstraints;
+
+		if ((m_batch.m_numManifolds+m_batch.m_numConstraints) >= m_minBatchSize)
+		{
+			flushBatch();
+		}
+	}
+};
+
+
+btParallelDiscreteDynamicsWorld::btParallelDiscreteDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration,btThreadSupportInterface* integrationThreadInterface,int maxNumIntegrationTasks)
+:btDiscreteDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration),
+m_integrationThreadInterface(integrationThreadInterface),
+m_maxNumIntegrationTasks(0),
+m_minBodiesPerTask(PARALLEL_WORLD_MIN_BODIES_PER_TASK),
+m_islandThreadInterface(0),
+m_minIslandBatchSize(PARALLEL_WORLD_MIN_ISLAND_BATCH_SIZE)
+{
+	setNumTasks(maxNumIntegrationTasks);
+	m_integrationThreadInterface->startSPU();
+}
+
+btParallelDiscreteDynamicsWorld::~btParallelDiscreteDynamicsWorld()
+{
+	setIslandThreadSupport(0,0);
+	m_integrationThreadInterface->stopSPU();
+}
+
+void	btParallelDiscreteDynamicsWorld::setNumTasks(int numTasks)
+{
+	m_maxNumIntegrationTasks = btMax(1,btMin(numTasks,int(PARALLEL_WORLD_MAX_TASKS)));
+	m_integrationTaskDescs.resize(m_maxNumIntegrationTasks);
+	m_integrationThreadInterface->setNumTasks(m_maxNumIntegrationTasks);
+}
+
+void	btParallelDiscreteDynamicsWorld::initTaskDesc(SpuIntegrationTaskDesc& desc,int command,btScalar timeStep)
+{
+	desc.m_command = command;
+	desc.m_taskId = 0;
+	desc.m_timeStep = timeStep;
+	desc.m_bodies = 0;
+	desc.m_predictedTransforms = 0;
+	desc.m_collisionObjects = 0;
+	desc.m_aabbs = 0;
+	desc.m_startObject = 0;
+	desc.m_numObjects = 0;
+	desc.m_world = this;
+	desc.m_numClampedCcdMotions = 0;
+}
+
+void	btParallelDiscreteDynamicsWorld::dispatchIntegrationTasks(const SpuIntegrationTaskDesc& desc,int numObjects)
+{
+	if (!numObjects)
+		return;
+
+	const int numTasks = btMin(m_maxNumIntegrationTasks,numObjects/btMax(m_minBodiesPerTask,1));
+	if (numTasks < 2)
+	{
+		SpuIntegrationTaskDesc& taskDesc = m_integrationTaskDescs[0];
+		taskDesc = desc;
+		taskDesc.m_startObject = 0;
+		taskDesc.m_numObjects = numObjects;
+		processIntegrationTask(&taskDesc,0);
+		gNumClampedCcdMotions += taskDesc.m_numClampedCcdMotions;
+		return;
+	}
+
+	int task;
+	for (task=0;task<numTasks;task++)
+	{
+		SpuIntegrationTaskDesc& taskDesc = m_integrationTaskDescs[task];
+		taskDesc = desc;
+		taskDesc.m_taskId = task;
+		taskDesc.m_startObject = (numObjects*task)/numTasks;
+		taskDesc.m_numObjects = (numObjects*(task+1))/numTasks-taskDesc.m_startObject;
+	}
+	m_integrationThreadInterface->runTasks(&m_integrationTaskDescs[0],sizeof(SpuIntegrationTaskDesc),numTasks);
+
+	for (task=0;task<numTasks;task++)
+	{
+		gNumClampedCcdMotions += m_integrationTaskDescs[task].m_numClampedCcdMotions;
+	}
+}
+
+void	btParallelDiscreteDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
+{
+	BT_PROFILE("predictUnconstraintMotion");
+
+	m_integrationBodies.resize(0);
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		btRigidBody* body = btRigidBody::upcast(m_collisionObjects[i]);
+		if (body && !body->isStaticOrKinematicObject())
+		{
+			m_integrationBodies.push_back(body);
+		}
+	}
+
+	SpuIntegrationTaskDesc desc;
+	initTaskDesc(desc,CMD_INTEGRATION_PREDICT_MOTION,timeStep);
+	desc.m_bodies = m_integrationBodies.size() ? &m_integrationBodies[0] : 0;
+	dispatchIntegrationTasks(desc,m_integrationBodies.size());
+}
+
+void	btParallelDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
+{
+	BT_PROFILE("integrateTransforms");
+
+	m_integrationBodies.resize(0);
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		btRigidBody* body = btRigidBody::upcast(m_collisionObjects[i]);
+		if (body)
+		{
+			body->setHitFraction(1.f);
+			if (body->isActive() && (!body->isStaticOrKinematicObject()))
+			{
+				m_integrationBodies.push_back(body);
+			}
+		}
+	}
+	m_predictedTransforms.resize(m_integrationBodies.size());
+
+	SpuIntegrationTaskDesc desc;
+	initTaskDesc(desc,CMD_INTEGRATION_PREDICT_TRANSFORMS,timeStep);
+	desc.m_bodies = m_integrationBodies.size() ? &m_integrationBodies[0] : 0;
+	desc.m_predictedTransforms = m_predictedTransforms.size() ? &m_predictedTransforms[0] : 0;
+	dispatchIntegrationTasks(desc,m_integrationBodies.size());
+
+	//all sweeps are done, now the bodies can move
+	desc.m_command = CMD_INTEGRATION_PROCEED_TO_TRANSFORMS;
+	dispatchIntegrationTasks(desc,m_integrationBodies.size());
+}
+
+void	btParallelDiscreteDynamicsWorld::updateAabbs()
+{
+	BT_PROFILE("updateAabbs");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_BROADPHASE);
+
+	m_aabbObjects.resize(0);
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		btCollisionObject* colObj = m_collisionObjects[i];
+		//only update aabb of active objects
+		if (colObj->isActive())
+		{
+			m_aabbObjects.push_back(colObj);
+		}
+	}
+	const int numObjects = m_aabbObjects.size();
+	m_aabbs.resize(numObjects*2);
+
+	SpuIntegrationTaskDesc desc;
+	initTaskDesc(desc,CMD_INTEGRATION_COMPUTE_AABBS,btScalar(0.));
+	desc.m_collisionObjects = numObjects ? &m_aabbObjects[0] : 0;
+	desc.m_aabbs = numObjects ? &m_aabbs[0] : 0;
+	dispatchIntegrationTasks(desc,numObjects);
+
+	//the broadphase is not thread safe, apply all aabbs in one batch in the original order
+	for (int i=0;i<numObjects;i++)
+	{
+		setBroadphaseAabb(m_aabbObjects[i],m_aabbs[i*2],m_aabbs[i*2+1]);
+	}
+}
+
+void	btParallelDiscreteDynamicsWorld::setIslandThreadSupport(btThreadSupportInterface* solverThreadInterface,int maxNumIslandTasks)
+{
+	if (m_islandThreadInterface)
+	{
+		m_islandThreadInterface->stopSPU();
+	}
+	for (int i=0;i<m_islandSolvers.size();i++)
+	{
+		m_islandSolvers[i]->~btSequentialImpulseConstraintSolver();
+		btAlignedFree(m_islandSolvers[i]);
+	}
+	m_islandSolvers.resize(0);
+
+	m_islandThreadInterface = solverThreadInterface;
+	if (m_islandThreadInterface)
+	{
+		const int numTasks = btMax(1,btMin(maxNumIslandTasks,int(SPU_MAX_SPUS)));
+		for (int i=0;i<numTasks;i++)
+		{
+			void* mem = btAlignedAlloc(sizeof(btSequentialImpulseConstraintSolver),16);
+			m_islandSolvers.push_back(new (mem) btSequentialImpulseConstraintSolver);
+		}
+		m_islandTaskDescs.resize(numTasks);
+		m_islandThreadInterface->startSPU();
+	}
+}
+
+void	btParallelDiscreteDynamicsWorld::buildIslandBatches()
+{
+	m_islandBodies.resize(0);
+	m_islandManifolds.resize(0);
+	m_islandConstraints.resize(0);
+	m_islandBatches.resize(0);
+
+	m_sortedConstraints.resize(m_constraints.size());
+	for (int i=0;i<m_constraints.size();i++)
+	{
+		m_sortedConstraints[i] = m_constraints[i];
+	}
+	m_sortedConstraints.quickSort(btSortIslandBatchConstraintPredicate());
+
+	btIslandBatchCollector collector(m_sortedConstraints.size() ? &m_sortedConstraints[0] : 0,m_sortedConstraints.size(),m_minIslandBatchSize,
+		m_islandBodies,m_islandManifolds,m_islandConstraints,m_islandBatches);
+	m_islandManager->buildAndProcessIslands(getCollisionWorld()->getDispatcher(),getCollisionWorld(),&collector);
+	collector.flushBatch();
+}
+
+int		btParallelDiscreteDynamicsWorld::scheduleIslandBatches()
+{
+	const int numBatches = m_islandBatches.size();
+	const int numTasks = btMin(m_islandSolvers.size(),numBatches);
+
+	m_islandBatchOrder.resize(numBatches);
+	m_islandBatchTask.resize(numBatches);
+	m_islandTaskLoad.resize(numTasks);
+
+	int i;
+	for (i=0;i<numBatches;i++)
+	{
+		m_islandBatchOrder[i] = i;
+	}
+	for (i=0;i<numTasks;i++)
+	{
+		m_islandTaskLoad[i] = 0;
+	}
+	if (numTasks < 2)
+	{
+		return numTasks;
+	}
+
+	m_islandBatchOrder.quickSort(btSortIslandBatchCostPredicate(&m_islandBatches[0]));
+	for (i=0;i<numBatches;i++)
+	{
+		const SpuSolverIslandBatch& batch = m_islandBatches[m_islandBatchOrder[i]];
+		int task = 0;
+		for (int t=1;t<numTasks;t++)
+		{
+			if (m_islandTaskLoad[t] < m_islandTaskLoad[task])
+				task = t;
+		}
+		m_islandBatchTask[m_islandBatchOrder[i]] = task;
+		m_islandTaskLoad[task] += batch.m_numManifolds+batch.m_numConstraints+1;
+	}
+
+	//group the batches by task, the load becomes the start of each task
+	for (i=0;i<numTasks;i++)
+	{
+		m_islandTaskLoad[i] = 0;
+	}
+	for (i=0;i<numBatches;i++)
+	{
+		m_islandTaskLoad[m_islandBatchTask[i]]++;
+	}
+	int start = 0;
+	for (i=0;i<numTasks;i++)
+	{
+		const int count = m_islandTaskLoad[i];
+		m_islandTaskLoad[i] = start;
+		start += count;
+	}
+	for (i=0;i<numBatches;i++)
+	{
+		m_islandBatchOrder[m_islandTaskLoad[m_islandBatchTask[i]]++] = i;
+	}
+	//m_islandTaskLoad now holds the end of each task
+	return numTasks;
+}
+
+void	btParallelDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
+{
+	if (!m_islandThreadInterface)
+	{
+		btDiscreteDynamicsWorld::solveConstraints(solverInfo);
+		return;
+	}
+
+	BT_PROFILE("solveConstraints");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOLVER);
+
+	buildIslandBatches();
+	const int numTasks = scheduleIslandBatches();
+	if (!numTasks)
+		return;
+
+	SpuSolverTaskDesc desc;
+	memset(&desc,0,sizeof(SpuSolverTaskDesc));
+	desc.m_solverCommand = CMD_SOLVER_SOLVE_ISLANDS;
+	desc.m_solverInfo = &solverInfo;
+	desc.m_dispatcher = getCollisionWorld()->getDispatcher();
+	desc.m_islandBodies = m_islandBodies.size() ? &m_islandBodies[0] : 0;
+	desc.m_islandManifolds = m_islandManifolds.size() ? &m_islandManifolds[0] : 0;
+	desc.m_islandConstraints = m_islandConstraints.size() ? &m_islandConstraints[0] : 0;
+	desc.m_islandBatches = &m_islandBatches[0];
+	desc.m_batchOrder = &m_islandBatchOrder[0];
+
+	if (numTasks < 2)
+	{
+		desc.m_islandSolver = m_islandSolvers[0];
+		desc.m_startBatch = 0;
+		desc.m_numBatches = m_islandBatches.size();
+		solveSolverIslands(desc);
+		return;
+	}
+
+	int startBatch = 0;
+	for (int task=0;task<numTasks;task++)
+	{
+		SpuSolverTaskDesc& taskDesc = m_islandTaskDescs[task];
+		taskDesc = desc;
+		taskDesc.m_taskId = task;
+		taskDesc.m_islandSolver = m_islandSolvers[task];
+		taskDesc.m_startBatch = startBatch;
+		taskDesc.m_numBatches = m_islandTaskLoad[task]-startBatch;
+		startBatch = m_islandTaskLoad[task];
+	}
+	m_islandThreadInterface->runTasks(&m_islandTaskDescs[0],sizeof(SpuSolverTaskDesc),numTasks);
+}
@@ -0,0 +1,125 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_DISCRETE_DYNAMICS_WORLD_H
+#define BT_PARALLEL_DISCRETE_DYNAMICS_WORLD_H
+
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btTransform.h"
+#include "SpuIntegrationTask/SpuIntegrationTask.h"
+#include "SpuSolverTask/SpuParallellSolverTask.h"
+
+class btThreadSupportInterface;
+class btRigidBody;
+class btCollisionObject;
+class btPersistentManifold;
+class btTypedConstraint;
+class btSequentialImpulseConstraintSolver;
+
+///btParallelDiscreteDynamicsWorld splits the rigid bodies into chunks and integrates them on worker threads, the aabbs
+///of the collision objects are computed the same way.
+///The thread support has to be created with processIntegrationTask and createIntegrationLocalStoreMemory.
+///The CCD sweeps of integrateTransforms run before any body moves, so all sweeps see the transforms at the
+///start of the step and the result does not depend on the number of threads.
+///Optionally the simulation islands are solved on a second thread support, see setIslandThreadSupport.
+class btParallelDiscreteDynamicsWorld : public btDiscreteDynamicsWorld
+{
+protected:
+
+	btThreadSupportInterface*						m_integrationThreadInterface;
+	int												m_maxNumIntegrationTasks;
+	int												m_minBodiesPerTask;
+
+	btAlignedObjectArray<SpuIntegrationTaskDesc>	m_integrationTaskDescs;
+	btAlignedObjectArray<btRigidBody*>				m_integrationBodies;
+	btAlignedObjectArray<btTransform>				m_predictedTransforms;
+	btAlignedObjectArray<btCollisionObject*>		m_aabbObjects;
+	btAlignedObjectArray<btVector3>					m_aabbs;
+
+	btThreadSupportInterface*						m_islandThreadInterface;
+	int												m_minIslandBatchSize;
+	///one solver per task, so each task has its own scratch memory
+	btAlignedObjectArray<btSequentialImpulseConstraintSolver*>	m_islandSolvers;
+	btAlignedObjectArray<SpuSolverTaskDesc>			m_islandTaskDescs;
+	btAlignedObjectArray<btTypedConstraint*>		m_sortedConstraints;
+	///bodies, manifolds and constraints of all islands of a step, each batch is a range in these arrays
+	btAlignedObjectArray<btCollisionObject*>		m_islandBodies;
+	btAlignedObjectArray<btPersistentManifold*>		m_islandManifolds;
+	btAlignedObjectArray<btTypedConstraint*>		m_islandConstraints;
+	btAlignedObjectArray<SpuSolverIslandBatch>		m_islandBatches;
+	///batches grouped by task
+	btAlignedObjectArray<int>						m_islandBatchOrder;
+	btAlignedObjectArray<int>						m_islandBatchTask;
+	btAlignedObjectArray<int>						m_islandTaskLoad;
+
+	void	initTaskDesc(SpuIntegrationTaskDesc& desc,int command,btScalar timeStep);
+
+	///runs the command over numObjects bodies or collision objects, on the worker threads when there are enough of them
+	void	dispatchIntegrationTasks(const SpuIntegrationTaskDesc& desc,int numObjects);
+
+	virtual void	predictUnconstraintMotion(btScalar timeStep);
+
+	virtual void	integrateTransforms(btScalar timeStep);
+
+	virtual void	solveConstraints(btContactSolverInfo& solverInfo);
+
+	///collects the islands that need solving into batches of at least m_minIslandBatchSize manifolds and constraints
+	void	buildIslandBatches();
+
+	///assigns the batches to tasks, the largest batch first and each batch to the task with the least work
+	int		scheduleIslandBatches();
+
+public:
+
+	btParallelDiscreteDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration,btThreadSupportInterface* integrationThreadInterface,int maxNumIntegrationTasks);
+
+	virtual ~btParallelDiscreteDynamicsWorld();
+
+	///computes the aabbs of the active objects on the worker threads, then updates the broadphase on the calling thread
+	virtual void	updateAabbs();
+
+	virtual void	setNumTasks(int numTasks);
+
+	///chunks with fewer bodies are not worth a task, small worlds are integrated on the calling thread
+	void	setMinBodiesPerTask(int minBodiesPerTask)
+	{
+		m_minBodiesPerTask = minBodiesPerTask;
+	}
+
+	int		getMinBodiesPerTask() const
+	{
+		return m_minBodiesPerTask;
+	}
+
+	///solve the simulation islands on the threads of solverThreadInterface, which has to be created with processSolverTask
+	///and createSolverLocalStoreMemory. Each task solves its islands with its own btSequentialImpulseConstraintSolver,
+	///the constraint solver of the world is not used. Pass 0 to solve the islands with the constraint solver of the world again.
+	void	setIslandThreadSupport(btThreadSupportInterface* solverThreadInterface,int maxNumIslandTasks);
+
+	///small islands are batched together until a batch has this many manifolds and constraints
+	void	setMinIslandBatchSize(int minIslandBatchSize)
+	{
+		m_minIslandBatchSize = minIslandBatchSize;
+	}
+
+	int		getMinIslandBatchSize() const
+	{
+		return m_minIslandBatchSize;
+	}
+
+};
+
+#endif //BT_PARALLEL_DISCRETE_DYNAMICS_WORLD_H
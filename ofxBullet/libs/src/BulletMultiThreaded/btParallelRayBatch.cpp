@@ -0,0 +1,84 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btParallelRayBatch.h"
+#include "btThreadSupportInterface.h"
+#include "LinearMath/btMinMax.h"
+#include "LinearMath/btQuickprof.h"
+
+enum
+{
+	PARALLEL_RAY_BATCH_MIN_RAYS_PER_TASK = 256,
+	PARALLEL_RAY_BATCH_MAX_TASKS = 64
+};
+
+btParallelRayBatch::btParallelRayBatch(btThreadSupportInterface* threadInterface,int maxNumTasks)
+:m_threadInterface(threadInterface),
+m_maxNumTasks(0),
+m_minRaysPerTask(PARALLEL_RAY_BATCH_MIN_RAYS_PER_TASK)
+{
+	setNumTasks(maxNumTasks);
+	m_threadInterface->startSPU();
+}
+
+btParallelRayBatch::~btParallelRayBatch()
+{
+	m_threadInterface->stopSPU();
+}
+
+void	btParallelRayBatch::setNumTasks(int numTasks)
+{
+	m_maxNumTasks = btMax(1,btMin(numTasks,int(PARALLEL_RAY_BATCH_MAX_TASKS)));
+	m_taskDescs.resize(m_maxNumTasks);
+	m_threadInterface->setNumTasks(m_maxNumTasks);
+}
+
+void	btParallelRayBatch::rayTestBatch(const btCollisionWorld* world,const btVector3* rayFromWorld,const btVector3* rayToWorld,int numRays,
+										 btCollisionWorld::RayBatchResults& results,short int collisionFilterGroup,short int collisionFilterMask)
+{
+	BT_PROFILE("parallelRayTestBatch");
+
+	if (!numRays)
+		return;
+
+	SpuRayBatchTaskDesc desc;
+	desc.m_command = CMD_RAY_BATCH_CLOSEST_HITS;
+	desc.m_taskId = 0;
+	desc.m_world = world;
+	desc.m_rayFromWorld = rayFromWorld;
+	desc.m_rayToWorld = rayToWorld;
+	desc.m_results = results;
+	desc.m_collisionFilterGroup = collisionFilterGroup;
+	desc.m_collisionFilterMask = collisionFilterMask;
+	desc.m_startRay = 0;
+	desc.m_numRays = numRays;
+
+	const int numTasks = btMin(m_maxNumTasks,numRays/btMax(m_minRaysPerTask,1));
+	if (numTasks < 2)
+	{
+		processRayBatchTask(&desc,0);
+		return;
+	}
+
+	for (int task=0;task<numTasks;task++)
+	{
+		SpuRayBatchTaskDesc& taskDesc = m_taskDescs[task];
+		taskDesc = desc;
+		taskDesc.m_taskId = task;
+		taskDesc.m_startRay = (numRays*task)/numTasks;
+		taskDesc.m_numRays = (numRays*(task+1))/numTasks-taskDesc.m_startRay;
+	}
+	m_threadInterface->runTasks(&m_taskDescs[0],sizeof(SpuRayBatchTaskDesc),numTasks);
+}
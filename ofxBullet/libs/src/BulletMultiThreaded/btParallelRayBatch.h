@@ -0,0 +1,61 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PARALLEL_RAY_BATCH_H
+#define BT_PARALLEL_RAY_BATCH_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "SpuRayBatchTask/SpuRayBatchTask.h"
+
+class btThreadSupportInterface;
+
+///btParallelRayBatch splits btCollisionWorld::rayTestBatch into ranges of rays and tests them on worker threads.
+///The thread support has to be created with processRayBatchTask and createRayBatchLocalStoreMemory.
+///The broadphase rayTest must be re-entrant, which holds for btDbvtBroadphase, btAxisSweep3 and btSimpleBroadphase.
+///Each ray writes only its own result entries, so the results don't depend on the number of threads.
+class btParallelRayBatch
+{
+	btThreadSupportInterface*					m_threadInterface;
+	int											m_maxNumTasks;
+	int											m_minRaysPerTask;
+	btAlignedObjectArray<SpuRayBatchTaskDesc>	m_taskDescs;
+
+public:
+
+	btParallelRayBatch(btThreadSupportInterface* threadInterface,int maxNumTasks);
+
+	virtual ~btParallelRayBatch();
+
+	///the world must not be modified until rayTestBatch returns
+	void	rayTestBatch(const btCollisionWorld* world,const btVector3* rayFromWorld,const btVector3* rayToWorld,int numRays,
+						 btCollisionWorld::RayBatchResults& results,
+						 short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter,short int collisionFilterMask=btBroadphaseProxy::AllFilter);
+
+	void	setNumTasks(int numTasks);
+
+	///batches with fewer rays per task use fewer tasks, batches below twice this size run on the calling thread
+	void	setMinRaysPerTask(int minRaysPerTask)
+	{
+		m_minRaysPerTask = minRaysPerTask;
+	}
+
+	int		getMinRaysPerTask() const
+	{
+		return m_minRaysPerTask;
+	}
+};
+
+#endif //BT_PARALLEL_RAY_BATCH_H
@@ -14,9 +14,53 @@ subject to the following restrictions:
 */
 
 #include "btThreadSupportInterface.h"
+#include "LinearMath/btQuickprof.h"
 
 btThreadSupportInterface::~btThreadSupportInterface()
 {
 
 }
 
+void	btThreadSupportInterface::parallelFor(int begin, int end, int grainSize, const btParallelForBody& body)
+{
+	(void)grainSize;
+	if (begin < end)
+	{
+		body.forLoop(begin,end);
+	}
+}
+
+void	btThreadSupportInterface::sendTasks(void* taskDescs, int taskDescSize, int firstTask, int numTasks)
+{
+	char* taskDesc = (char*)taskDescs+firstTask*taskDescSize;
+	for (int task=firstTask;task<firstTask+numTasks;task++)
+	{
+		sendRequest(1, (ppu_address_t)taskDesc, task);
+		taskDesc += taskDescSize;
+	}
+}
+
+void	btThreadSupportInterface::waitForTasks(int numTasks)
+{
+	for (int task=0;task<numTasks;task++)
+	{
+		unsigned int taskId;
+		unsigned int outputSize;
+		waitForResponse(&taskId, &outputSize);
+	}
+}
+
+void	btThreadSupportInterface::runTasks(void* taskDescs, int taskDescSize, int numTasks)
+{
+#ifndef BT_NO_PROFILE
+	//the profiler is not thread safe, keep the samples of the worker threads out of the profile tree
+	CProfileManager::Suspend_Profile();
+#endif //BT_NO_PROFILE
+
+	sendTasks(taskDescs,taskDescSize,0,numTasks);
+	waitForTasks(numTasks);
+
+#ifndef BT_NO_PROFILE
+	CProfileManager::Resume_Profile();
+#endif //BT_NO_PROFILE
+}
@@ -21,6 +21,16 @@ subject to the following restrictions:
 #include "PlatformDefinitions.h"
 #include "PpuAddressSpace.h"
 
+///btParallelForBody is the loop body for btThreadSupportInterface::parallelFor.
+///forLoop is called with disjoint sub ranges and can run on several threads at once.
+class btParallelForBody
+{
+public:
+	virtual ~btParallelForBody() {}
+
+	virtual void	forLoop(int begin, int end) const = 0;
+};
+
 class btThreadSupportInterface
 {
 public:
@@ -33,6 +43,14 @@ public:
 ///check for messages from SPUs
 	virtual	void waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1) =0;
 
+	///isTaskCompleted reports a finished task like waitForResponse if there is one, and returns false instead of blocking otherwise.
+	///The default implementation blocks in waitForResponse.
+	virtual bool isTaskCompleted(unsigned int *puiArgument0, unsigned int *puiArgument1)
+	{
+		waitForResponse(puiArgument0,puiArgument1);
+		return true;
+	}
+
 ///start the spus (can be called at the beginning of each frame, to make sure that the right SPU program is loaded)
 	virtual	void startSPU() =0;
 
@@ -42,6 +60,27 @@ public:
 	///tell the task scheduler to use no more than numTasks tasks
 	virtual void	setNumTasks(int numTasks)=0;
 
+	///runs body over [begin,end) in chunks of about grainSize iterations and returns when all chunks are done.
+	///The default implementation runs the whole range on the calling thread.
+	virtual void	parallelFor(int begin, int end, int grainSize, const btParallelForBody& body);
+
+	///number of threads that can run parallelFor chunks at the same time, including the calling thread
+	virtual int		getNumParallelThreads() const
+	{
+		return 1;
+	}
+
+	///sendTasks sends the requests for the tasks firstTask to firstTask+numTasks-1,
+	///task i gets the description at taskDescs+i*taskDescSize as argument.
+	void	sendTasks(void* taskDescs, int taskDescSize, int firstTask, int numTasks);
+
+	///waitForTasks waits until numTasks tasks have reported completion, in any order
+	void	waitForTasks(int numTasks);
+
+	///runTasks sends the tasks 0 to numTasks-1 and returns when all of them are done.
+	///The profiler is suspended meanwhile, so the samples of the worker threads stay out of the profile tree.
+	void	runTasks(void* taskDescs, int taskDescSize, int numTasks);
+
 };
 
 #endif //THREAD_SUPPORT_INTERFACE_H
@@ -0,0 +1,395 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWorldTileManager.h"
+#include "btThreadSupportInterface.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btMappedBvhFile.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "LinearMath/btMinMax.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+btMappedBvhTileLoader::btMappedBvhTileLoader(const char* fileNamePattern)
+{
+	strncpy(m_fileNamePattern,fileNamePattern,sizeof(m_fileNamePattern)-1);
+	m_fileNamePattern[sizeof(m_fileNamePattern)-1] = 0;
+}
+
+bool	btMappedBvhTileLoader::loadTile(btWorldTile& tile)
+{
+	char fileName[512];
+	snprintf(fileName,sizeof(fileName),m_fileNamePattern,tile.m_tileX,tile.m_tileY);
+
+	void* mem = btAlignedAlloc(sizeof(btMappedBvhFile),16);
+	btMappedBvhFile* file = new (mem) btMappedBvhFile();
+	tile.m_userData = file;
+	if (file->open(fileName) != btMappedBvhFile::MAPPED_BVH_OK)
+	{
+		return false;
+	}
+
+	mem = btAlignedAlloc(sizeof(btBvhTriangleMeshShape),16);
+	btBvhTriangleMeshShape* shape = new (mem) btBvhTriangleMeshShape(file->getMeshInterface(),true,false);
+	shape->setOptimizedBvh(file->getOptimizedBvh(),file->getMeshInterface()->getScaling());
+	tile.m_shape = shape;
+	tile.m_transform.setIdentity();
+	return true;
+}
+
+void	btMappedBvhTileLoader::unloadTile(btWorldTile& tile)
+{
+	if (tile.m_shape)
+	{
+		tile.m_shape->~btCollisionShape();
+		btAlignedFree(tile.m_shape);
+		tile.m_shape = 0;
+	}
+	btMappedBvhFile* file = (btMappedBvhFile*)tile.m_userData;
+	if (file)
+	{
+		file->~btMappedBvhFile();
+		btAlignedFree(file);
+		tile.m_userData = 0;
+	}
+}
+
+
+
+btWorldTileManager::btWorldTileManager(btCollisionWorld* world,btWorldTileLoader* loader,btScalar tileSize,btThreadSupportInterface* threadInterface,int maxNumTasks,int upAxis)
+:m_world(world),
+m_loader(loader),
+m_threadInterface(threadInterface),
+m_tileSize(tileSize),
+m_loadRadius(tileSize),
+m_unloadRadius(tileSize*btScalar(1.5)),
+m_upAxis(upAxis),
+m_maxTilesAddedPerUpdate(0),
+m_numBusyTasks(0),
+m_numActiveTiles(0),
+m_numLoadingTiles(0)
+{
+	btAssert(tileSize > btScalar(0.));
+	btAssert(upAxis >= 0 && upAxis < 3);
+
+	m_taskDescs.resize(btMax(maxNumTasks,1));
+	for (int i=0;i<m_taskDescs.size();i++)
+	{
+		m_taskDescs[i].m_command = CMD_WORLD_TILE_LOAD;
+		m_taskDescs[i].m_taskId = i;
+		m_taskDescs[i].m_loader = m_loader;
+		m_taskDescs[i].m_tile = 0;
+		m_taskDescs[i].m_loaded = false;
+	}
+	if (m_threadInterface)
+	{
+		m_threadInterface->setNumTasks(m_taskDescs.size());
+		m_threadInterface->startSPU();
+	}
+}
+
+btWorldTileManager::~btWorldTileManager()
+{
+	while (m_numBusyTasks)
+	{
+		unsigned int taskId;
+		unsigned int status;
+		m_threadInterface->waitForResponse(&taskId, &status);
+		finishTask(taskId);
+	}
+	m_tmpTiles.resize(0);
+	for (int i=0;i<m_tiles.size();i++)
+	{
+		m_tmpTiles.push_back(*m_tiles.getAtIndex(i));
+	}
+	if (m_tmpTiles.size())
+	{
+		destroyTiles(&m_tmpTiles[0],m_tmpTiles.size());
+	}
+	if (m_threadInterface)
+	{
+		m_threadInterface->stopSPU();
+	}
+}
+
+void	btWorldTileManager::setRadius(btScalar loadRadius,btScalar unloadRadius)
+{
+	m_loadRadius = loadRadius;
+	m_unloadRadius = btMax(loadRadius,unloadRadius);
+}
+
+void	btWorldTileManager::getTileCoordinates(const btVector3& position,int& tileX,int& tileY) const
+{
+	tileX = int(floor(position[getAxisX()]/m_tileSize));
+	tileY = int(floor(position[getAxisY()]/m_tileSize));
+}
+
+const btWorldTile*	btWorldTileManager::findTile(int tileX,int tileY) const
+{
+	btWorldTile* const* tile = m_tiles.find(btHashKeyPtr<btWorldTile*>(btWorldTile::getUid(tileX,tileY)));
+	return tile ? *tile : 0;
+}
+
+btScalar	btWorldTileManager::getTileDistance2(const btWorldTile* tile,const btVector3* focusPoints,int numFocusPoints) const
+{
+	const int axisX = getAxisX();
+	const int axisY = getAxisY();
+	const btScalar minX = tile->m_tileX*m_tileSize;
+	const btScalar minY = tile->m_tileY*m_tileSize;
+
+	btScalar minDistance2 = SIMD_INFINITY;
+	for (int i=0;i<numFocusPoints;i++)
+	{
+		//distance from the focus point to the tile square, the up axis is ignored
+		btScalar dx = focusPoints[i][axisX]-btMax(minX,btMin(focusPoints[i][axisX],minX+m_tileSize));
+		btScalar dy = focusPoints[i][axisY]-btMax(minY,btMin(focusPoints[i][axisY],minY+m_tileSize));
+		btSetMin(minDistance2,dx*dx+dy*dy);
+	}
+	return minDistance2;
+}
+
+btWorldTile*	btWorldTileManager::findOrCreateTile(int tileX,int tileY)
+{
+	btHashKeyPtr<btWorldTile*> key(btWorldTile::getUid(tileX,tileY));
+	btWorldTile** tilePtr = m_tiles.find(key);
+	if (tilePtr)
+		return *tilePtr;
+
+	void* mem = btAlignedAlloc(sizeof(btWorldTile),16);
+	btWorldTile* tile = new (mem) btWorldTile();
+	tile->m_tileX = tileX;
+	tile->m_tileY = tileY;
+	tile->m_state = btWorldTile::TILE_QUEUED;
+	tile->m_wanted = true;
+	tile->m_shape = 0;
+	tile->m_transform.setIdentity();
+	tile->m_userData = 0;
+	tile->m_collisionObject = 0;
+	m_tiles.insert(key,tile);
+	m_numLoadingTiles++;
+	return tile;
+}
+
+void	btWorldTileManager::destroyTiles(btWorldTile* const* tiles,int numTiles)
+{
+	int i;
+	//the collision objects of the active tiles leave the world in one batch
+	m_tmpObjects.resize(0);
+	for (i=0;i<numTiles;i++)
+	{
+		if (tiles[i]->m_state == btWorldTile::TILE_ACTIVE)
+			m_tmpObjects.push_back(tiles[i]->m_collisionObject);
+	}
+	if (m_tmpObjects.size())
+	{
+		m_world->removeCollisionObjects(&m_tmpObjects[0],m_tmpObjects.size());
+	}
+
+	for (i=0;i<numTiles;i++)
+	{
+		destroyTile(tiles[i]);
+	}
+}
+
+void	btWorldTileManager::destroyTile(btWorldTile* tile)
+{
+	btAssert(tile->m_state != btWorldTile::TILE_LOADING);
+
+	switch (tile->m_state)
+	{
+	case btWorldTile::TILE_ACTIVE:
+		tile->m_collisionObject->~btCollisionObject();
+		btAlignedFree(tile->m_collisionObject);
+		tile->m_collisionObject = 0;
+		m_numActiveTiles--;
+		m_loader->unloadTile(*tile);
+		break;
+	case btWorldTile::TILE_LOADED:
+	case btWorldTile::TILE_FAILED:
+		m_loader->unloadTile(*tile);
+		break;
+	case btWorldTile::TILE_QUEUED:
+		m_numLoadingTiles--;
+		break;
+	default:
+		break;
+	}
+
+	m_tiles.remove(btHashKeyPtr<btWorldTile*>(tile->getUid()));
+	tile->~btWorldTile();
+	btAlignedFree(tile);
+}
+
+void	btWorldTileManager::finishTask(unsigned int taskId)
+{
+	SpuWorldTileTaskDesc& taskDesc = m_taskDescs[taskId];
+	btWorldTile* tile = taskDesc.m_tile;
+	btAssert(tile && tile->m_state == btWorldTile::TILE_LOADING);
+	tile->m_state = (taskDesc.m_loaded && tile->m_shape) ? btWorldTile::TILE_LOADED : btWorldTile::TILE_FAILED;
+	taskDesc.m_tile = 0;
+	m_numBusyTasks--;
+	m_numLoadingTiles--;
+}
+
+void	btWorldTileManager::collectLoadedTiles()
+{
+	unsigned int taskId;
+	unsigned int status;
+	while (m_numBusyTasks && m_threadInterface->isTaskCompleted(&taskId, &status))
+	{
+		finishTask(taskId);
+	}
+}
+
+void	btWorldTileManager::addLoadedTiles()
+{
+	int numAdded = 0;
+	m_tmpObjects.resize(0);
+	for (int i=0;i<m_tiles.size();i++)
+	{
+		btWorldTile* tile = *m_tiles.getAtIndex(i);
+		if (tile->m_state != btWorldTile::TILE_LOADED)
+			continue;
+		if (m_maxTilesAddedPerUpdate && numAdded >= m_maxTilesAddedPerUpdate)
+			break;
+
+		void* mem = btAlignedAlloc(sizeof(btCollisionObject),16);
+		btCollisionObject* colObj = new (mem) btCollisionObject();
+		colObj->setCollisionShape(tile->m_shape);
+		colObj->setWorldTransform(tile->m_transform);
+		colObj->setCollisionFlags(colObj->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+		colObj->setUserPointer(tile);
+		tile->m_collisionObject = colObj;
+		tile->m_state = btWorldTile::TILE_ACTIVE;
+		m_tmpObjects.push_back(colObj);
+		m_numActiveTiles++;
+		numAdded++;
+	}
+
+	//all tiles loaded since the last update enter the world in one batch
+	if (m_tmpObjects.size())
+	{
+		m_world->addCollisionObjects(&m_tmpObjects[0],m_tmpObjects.size(),btBroadphaseProxy::StaticFilter,btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+	}
+}
+
+void	btWorldTileManager::startLoads(const btVector3* focusPoints,int numFocusPoints)
+{
+	m_tmpTiles.resize(0);
+	for (int i=0;i<m_tiles.size();i++)
+	{
+		btWorldTile* tile = *m_tiles.getAtIndex(i);
+		if (tile->m_state == btWorldTile::TILE_QUEUED)
+			m_tmpTiles.push_back(tile);
+	}
+
+	const int maxLoads = m_threadInterface ? m_taskDescs.size()-m_numBusyTasks : m_taskDescs.size();
+	for (int load=0;load<maxLoads && m_tmpTiles.size();load++)
+	{
+		//nearest queued tile first
+		int nearest = 0;
+		btScalar nearestDistance2 = getTileDistance2(m_tmpTiles[0],focusPoints,numFocusPoints);
+		for (int i=1;i<m_tmpTiles.size();i++)
+		{
+			btScalar distance2 = getTileDistance2(m_tmpTiles[i],focusPoints,numFocusPoints);
+			if (distance2 < nearestDistance2)
+			{
+				nearest = i;
+				nearestDistance2 = distance2;
+			}
+		}
+		btWorldTile* tile = m_tmpTiles[nearest];
+		m_tmpTiles.swap(nearest,m_tmpTiles.size()-1);
+		m_tmpTiles.pop_back();
+
+		tile->m_state = btWorldTile::TILE_LOADING;
+		if (!m_threadInterface)
+		{
+			bool loaded = m_loader->loadTile(*tile);
+			tile->m_state = (loaded && tile->m_shape) ? btWorldTile::TILE_LOADED : btWorldTile::TILE_FAILED;
+			m_numLoadingTiles--;
+			continue;
+		}
+
+		int taskId = 0;
+		while (m_taskDescs[taskId].m_tile)
+			taskId++;
+		SpuWorldTileTaskDesc& taskDesc = m_taskDescs[taskId];
+		taskDesc.m_tile = tile;
+		taskDesc.m_loaded = false;
+		m_numBusyTasks++;
+		m_threadInterface->sendTasks(&m_taskDescs[0],sizeof(SpuWorldTileTaskDesc),taskId,1);
+	}
+}
+
+void	btWorldTileManager::update(const btVector3* focusPoints,int numFocusPoints)
+{
+	BT_PROFILE("btWorldTileManager::update");
+
+	if (m_threadInterface)
+	{
+		collectLoadedTiles();
+	}
+
+	int i;
+	const btScalar unloadRadius2 = m_unloadRadius*m_unloadRadius;
+	for (i=0;i<m_tiles.size();i++)
+	{
+		btWorldTile* tile = *m_tiles.getAtIndex(i);
+		tile->m_wanted = getTileDistance2(tile,focusPoints,numFocusPoints) <= unloadRadius2;
+	}
+
+	const btScalar loadRadius2 = m_loadRadius*m_loadRadius;
+	const btVector3 radius(m_loadRadius,m_loadRadius,m_loadRadius);
+	for (i=0;i<numFocusPoints;i++)
+	{
+		int minX,minY,maxX,maxY;
+		getTileCoordinates(focusPoints[i]-radius,minX,minY);
+		getTileCoordinates(focusPoints[i]+radius,maxX,maxY);
+		for (int tileY=minY;tileY<=maxY;tileY++)
+		{
+			for (int tileX=minX;tileX<=maxX;tileX++)
+			{
+				btWorldTile candidate;
+				candidate.m_tileX = tileX;
+				candidate.m_tileY = tileY;
+				if (getTileDistance2(&candidate,&focusPoints[i],1) <= loadRadius2)
+				{
+					findOrCreateTile(tileX,tileY)->m_wanted = true;
+				}
+			}
+		}
+	}
+
+	//tiles that are still loading are unloaded after they finished
+	m_tmpTiles.resize(0);
+	for (i=0;i<m_tiles.size();i++)
+	{
+		btWorldTile* tile = *m_tiles.getAtIndex(i);
+		if (!tile->m_wanted && tile->m_state != btWorldTile::TILE_LOADING)
+			m_tmpTiles.push_back(tile);
+	}
+	if (m_tmpTiles.size())
+	{
+		destroyTiles(&m_tmpTiles[0],m_tmpTiles.size());
+	}
+
+	addLoadedTiles();
+	startLoads(focusPoints,numFocusPoints);
+}
@@ -0,0 +1,207 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WORLD_TILE_MANAGER_H
+#define BT_WORLD_TILE_MANAGER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btTransform.h"
+#include "SpuWorldTileTask/SpuWorldTileTask.h"
+
+class btCollisionWorld;
+class btCollisionObject;
+class btCollisionShape;
+class btThreadSupportInterface;
+
+///btWorldTile is one cell of the btWorldTileManager grid, the loader fills in the shape, transform and user data.
+struct btWorldTile
+{
+	enum
+	{
+		///waiting for a free task
+		TILE_QUEUED,
+		///loadTile is running
+		TILE_LOADING,
+		///loaded, it is added to the world by the next update
+		TILE_LOADED,
+		///in the world
+		TILE_ACTIVE,
+		///loadTile failed, the tile stays empty until it leaves the unload radius
+		TILE_FAILED
+	};
+
+	///grid coordinates along the two axes orthogonal to the up axis, x and z for the default y up axis
+	int					m_tileX;
+	int					m_tileY;
+	int					m_state;
+	///the tile is within the unload radius of a focus point
+	bool				m_wanted;
+
+	btCollisionShape*	m_shape;
+	btTransform			m_transform;
+	void*				m_userData;
+
+	///created by the manager when the tile is added to the world, its user pointer is the tile
+	btCollisionObject*	m_collisionObject;
+
+	///key for the tile map, grid coordinates are limited to 16 bits
+	static int	getUid(int tileX,int tileY)
+	{
+		return int((unsigned int)(tileX & 0xffff) | ((unsigned int)tileY << 16));
+	}
+
+	int	getUid() const
+	{
+		return getUid(m_tileX,m_tileY);
+	}
+};
+
+///btWorldTileLoader creates and destroys the static collision shapes of the tiles, for example a btBvhTriangleMeshShape
+///built or deserialized from a file, or a btHeightfieldTerrainShape.
+class btWorldTileLoader
+{
+public:
+	virtual ~btWorldTileLoader() {}
+
+	///loadTile runs on a worker thread, several tiles can load at the same time. It sets tile.m_shape and tile.m_transform,
+	///and optionally tile.m_userData, from tile.m_tileX and tile.m_tileY. It must not access the world or record profile samples.
+	///Returning false, or leaving m_shape 0, leaves the tile empty.
+	virtual bool	loadTile(btWorldTile& tile) = 0;
+
+	///unloadTile runs on the thread calling btWorldTileManager::update, for every tile that went through loadTile,
+	///after the tile was removed from the world
+	virtual void	unloadTile(btWorldTile& tile) = 0;
+};
+
+///btMappedBvhTileLoader maps files written by btMappedBvhFile::writeFile, one per tile, and wraps them in a btBvhTriangleMeshShape.
+///The file name is a printf pattern that takes the two tile coordinates, for example "tiles/tile_%d_%d.bvh".
+///The vertices are expected in world coordinates, missing files leave the tile empty.
+class btMappedBvhTileLoader : public btWorldTileLoader
+{
+	char	m_fileNamePattern[256];
+
+public:
+	btMappedBvhTileLoader(const char* fileNamePattern);
+
+	virtual bool	loadTile(btWorldTile& tile);
+
+	virtual void	unloadTile(btWorldTile& tile);
+};
+
+///btWorldTileManager pages static tiles of a large world in and out of a btCollisionWorld around a set of focus points.
+///The world is a grid of square tiles of tileSize. Tiles within the load radius of a focus point are loaded on the worker
+///threads of the thread support, nearest first. update adds the loaded tiles to the world together, so call it between
+///simulation steps. Tiles outside the unload radius of all focus points are removed and unloaded.
+///The thread support has to be created with processWorldTileTask and createWorldTileLocalStoreMemory, and should not be
+///shared with other users because loads can take longer than a simulation step. Without thread support, update loads
+///up to maxNumTasks tiles on the calling thread.
+class btWorldTileManager
+{
+	btCollisionWorld*			m_world;
+	btWorldTileLoader*			m_loader;
+	btThreadSupportInterface*	m_threadInterface;
+	btScalar					m_tileSize;
+	btScalar					m_loadRadius;
+	btScalar					m_unloadRadius;
+	int							m_upAxis;
+	int							m_maxTilesAddedPerUpdate;
+
+	btHashMap<btHashKeyPtr<btWorldTile*>,btWorldTile*>	m_tiles;
+	btAlignedObjectArray<btWorldTile*>					m_tmpTiles;
+	btAlignedObjectArray<btCollisionObject*>			m_tmpObjects;
+	btAlignedObjectArray<SpuWorldTileTaskDesc>			m_taskDescs;
+	int							m_numBusyTasks;
+
+	int							m_numActiveTiles;
+	int							m_numLoadingTiles;
+
+	btWorldTile*	findOrCreateTile(int tileX,int tileY);
+	void	destroyTile(btWorldTile* tile);
+	void	destroyTiles(btWorldTile* const* tiles,int numTiles);
+	void	finishTask(unsigned int taskId);
+	void	collectLoadedTiles();
+	void	addLoadedTiles();
+	void	startLoads(const btVector3* focusPoints,int numFocusPoints);
+	btScalar	getTileDistance2(const btWorldTile* tile,const btVector3* focusPoints,int numFocusPoints) const;
+
+	int		getAxisX() const
+	{
+		return m_upAxis == 0 ? 1 : 0;
+	}
+
+	int		getAxisY() const
+	{
+		return m_upAxis == 2 ? 1 : 2;
+	}
+
+public:
+
+	btWorldTileManager(btCollisionWorld* world,btWorldTileLoader* loader,btScalar tileSize,btThreadSupportInterface* threadInterface=0,int maxNumTasks=1,int upAxis=1);
+
+	///waits for running loads and removes all tiles from the world
+	virtual ~btWorldTileManager();
+
+	///update collects finished loads, adds them to the world, removes tiles that moved out of range and starts new loads
+	void	update(const btVector3* focusPoints,int numFocusPoints);
+
+	///tiles touching the load radius around a focus point are loaded, tiles are unloaded when no focus point is within
+	///the unload radius. The unload radius is at least the load radius, a larger one keeps tiles near a border from cycling.
+	void	setRadius(btScalar loadRadius,btScalar unloadRadius);
+
+	btScalar	getLoadRadius() const
+	{
+		return m_loadRadius;
+	}
+
+	btScalar	getUnloadRadius() const
+	{
+		return m_unloadRadius;
+	}
+
+	///spreads the insertion of a burst of loaded tiles over several updates, 0 adds all loaded tiles at once
+	void	setMaxTilesAddedPerUpdate(int maxTiles)
+	{
+		m_maxTilesAddedPerUpdate = maxTiles;
+	}
+
+	int		getMaxTilesAddedPerUpdate() const
+	{
+		return m_maxTilesAddedPerUpdate;
+	}
+
+	///returns 0 if the tile is not known to the manager
+	const btWorldTile*	findTile(int tileX,int tileY) const;
+
+	void	getTileCoordinates(const btVector3& position,int& tileX,int& tileY) const;
+
+	int		getNumTiles() const
+	{
+		return m_tiles.size();
+	}
+
+	int		getNumActiveTiles() const
+	{
+		return m_numActiveTiles;
+	}
+
+	///tiles that are queued or being loaded
+	int		getNumLoadingTiles() const
+	{
+		return m_numLoadingTiles;
+	}
+};
+
+#endif //BT_WORLD_TILE_MANAGER_H
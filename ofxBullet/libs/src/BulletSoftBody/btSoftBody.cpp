@@ -15,11 +15,13 @@ subject to the following restrictions:
 ///btSoftBody implementation by Nathanael Presson
 
 #include "btSoftBodyInternals.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 //
 btSoftBody::btSoftBody(btSoftBodyWorldInfo*	worldInfo,int node_count,  const btVector3* x,  const btScalar* m)
 :m_worldInfo(worldInfo)
 {	
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	/* Init		*/ 
 	m_internalType		=	CO_SOFT_BODY;
 	m_cfg.aeromodel		=	eAeroModel::V_Point;
@@ -2576,6 +2578,7 @@ btSoftBody::vsolver_t	btSoftBody::getSolver(eVSolver::_ solver)
 //
 void			btSoftBody::defaultCollisionHandler(btCollisionObject* pco)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	switch(m_cfg.collisions&fCollision::RVSmask)
 	{
 	case	fCollision::SDF_RS:
@@ -2616,6 +2619,7 @@ void			btSoftBody::defaultCollisionHandler(btCollisionObject* pco)
 //
 void			btSoftBody::defaultCollisionHandler(btSoftBody* psb)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	const int cf=m_cfg.collisions&psb->m_cfg.collisions;
 	switch(cf&fCollision::SVSmask)
 	{
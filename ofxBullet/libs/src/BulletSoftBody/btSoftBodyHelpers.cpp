@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include <string.h>
 #include "btSoftBodyHelpers.h"
 #include "LinearMath/btConvexHull.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 //
 static void				drawVertex(	btIDebugDraw* idraw,
@@ -279,7 +280,7 @@ void			btSoftBodyHelpers::Draw(	btSoftBody* psb,
 				HullLibrary		hlib;
 				hdsc.mMaxVertices=vertices.size();
 				hlib.CreateConvexHull(hdsc,hres);
-				const btVector3	center=average(hres.m_OutputVertices);
+				const btVector3	center=hres.m_OutputVertices.size()?average(hres.m_OutputVertices):btVector3(0,0,0);
 				add(hres.m_OutputVertices,-center);
 				mul(hres.m_OutputVertices,(btScalar)1);
 				add(hres.m_OutputVertices,center);
@@ -449,6 +450,7 @@ btSoftBody*		btSoftBodyHelpers::CreateRope(	btSoftBodyWorldInfo& worldInfo, cons
 											  int res,
 											  int fixeds)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	/* Create nodes	*/ 
 	const int		r=res+2;
 	btVector3*		x=new btVector3[r];
@@ -485,6 +487,7 @@ btSoftBody*		btSoftBodyHelpers::CreatePatch(btSoftBodyWorldInfo& worldInfo,const
 											   int fixeds,
 											   bool gendiags)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 #define IDX(_x_,_y_)	((_y_)*rx+(_x_))
 	/* Create nodes	*/ 
 	if((resx<2)||(resy<2)) return(0);
@@ -564,6 +567,7 @@ btSoftBody*		btSoftBodyHelpers::CreatePatchUV(btSoftBodyWorldInfo& worldInfo,
 												 bool gendiags,
 												 float* tex_coords)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 
 	/*
 	*
@@ -763,6 +767,7 @@ btSoftBody*		btSoftBodyHelpers::CreateEllipsoid(btSoftBodyWorldInfo& worldInfo,c
 												   const btVector3& radius,
 												   int res)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	struct	Hammersley
 	{
 		static void	Generate(btVector3* x,int n)
@@ -795,6 +800,7 @@ btSoftBody*		btSoftBodyHelpers::CreateFromTriMesh(btSoftBodyWorldInfo& worldInfo
 													 const int* triangles,
 													 int ntriangles)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	int		maxidx=0;
 	int i,j,ni;
 
@@ -836,6 +842,7 @@ btSoftBody*		btSoftBodyHelpers::CreateFromTriMesh(btSoftBodyWorldInfo& worldInfo
 btSoftBody*		btSoftBodyHelpers::CreateFromConvexHull(btSoftBodyWorldInfo& worldInfo,	const btVector3* vertices,
 														int nvertices)
 {
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	HullDesc		hdsc(QF_TRIANGLES,nvertices,vertices);
 	HullResult		hres;
 	HullLibrary		hlib;/*??*/ 
@@ -854,7 +854,7 @@ struct btSoftColliders
 			btSoftBody::Node*	node=(btSoftBody::Node*)lnode->data;
 			btSoftBody::Face*	face=(btSoftBody::Face*)lface->data;
 			btVector3			o=node->m_x;
-			btVector3			p;
+			btVector3			p(0,0,0);
 			btScalar			d=SIMD_INFINITY;
 			ProjectOrigin(	face->m_n[0]->m_x-o,
 				face->m_n[1]->m_x-o,
@@ -20,6 +20,7 @@ subject to the following restrictions:
 //softbody & helpers
 #include "btSoftBody.h"
 #include "btSoftBodyHelpers.h"
+#include "LinearMath/btThreadCachingAllocator.h"
 
 
 
@@ -48,6 +49,7 @@ void	btSoftRigidDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 {
 	btDiscreteDynamicsWorld::predictUnconstraintMotion( timeStep);
 
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 	for ( int i=0;i<m_softBodies.size();++i)
 	{
 		btSoftBody*	psb= m_softBodies[i];
@@ -71,6 +73,7 @@ void	btSoftRigidDynamicsWorld::internalSingleStepSimulation( btScalar timeStep)
 void	btSoftRigidDynamicsWorld::updateSoftBodies()
 {
 	BT_PROFILE("updateSoftBodies");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 
 	for ( int i=0;i<m_softBodies.size();i++)
 	{
@@ -82,6 +85,7 @@ void	btSoftRigidDynamicsWorld::updateSoftBodies()
 void	btSoftRigidDynamicsWorld::solveSoftBodiesConstraints()
 {
 	BT_PROFILE("solveSoftConstraints");
+	BT_ALLOC_TAG_SCOPE(BT_ALLOC_TAG_SOFTBODY);
 
 	if(m_softBodies.size())
 	{
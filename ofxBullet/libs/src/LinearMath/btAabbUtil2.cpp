@@ -0,0 +1,114 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btAabbUtil2.h"
+#include "btCpuFeatureUtility.h"
+
+typedef void (*btAabbOverlapKernel)(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut);
+
+SIMD_FORCE_INLINE const btVector3& btAabbAt(const btVector3* base, int strideInBytes, int i)
+{
+	return *(const btVector3*)((const char*)base + i*strideInBytes);
+}
+
+static void	btAabbOverlapArrayScalar(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut)
+{
+	for (int i=0;i<count;i++)
+	{
+		const btVector3& omin = btAabbAt(aabbMins, strideInBytes, i);
+		const btVector3& omax = btAabbAt(aabbMaxs, strideInBytes, i);
+		overlapOut[i] = (aabbMin[0] <= omax[0] && omin[0] <= aabbMax[0] &&
+			aabbMin[1] <= omax[1] && omin[1] <= aabbMax[1] &&
+			aabbMin[2] <= omax[2] && omin[2] <= aabbMax[2]) ? 1 : 0;
+	}
+}
+
+#ifdef BT_USE_SSE
+
+///one box per iteration, the w lanes are ignored by the movemask
+static void	btAabbOverlapArraySSE2(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut)
+{
+	const __m128 bmin = aabbMin.get128();
+	const __m128 bmax = aabbMax.get128();
+	for (int i=0;i<count;i++)
+	{
+		__m128 omin = btAabbAt(aabbMins, strideInBytes, i).get128();
+		__m128 omax = btAabbAt(aabbMaxs, strideInBytes, i).get128();
+		__m128 overlap = _mm_and_ps(_mm_cmple_ps(bmin, omax), _mm_cmple_ps(omin, bmax));
+		overlapOut[i] = (unsigned char)((_mm_movemask_ps(overlap) & 7) == 7);
+	}
+}
+
+#ifdef BT_ALLOW_AVX2
+///two boxes per iteration
+BT_TARGET_AVX2 static void	btAabbOverlapArrayAVX2(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut)
+{
+	const __m256 bmin = _mm256_broadcast_ps((const __m128*)&aabbMin);
+	const __m256 bmax = _mm256_broadcast_ps((const __m128*)&aabbMax);
+	int i=0;
+	for (;i+2<=count;i+=2)
+	{
+		__m256 omin = _mm256_insertf128_ps(_mm256_castps128_ps256(btAabbAt(aabbMins, strideInBytes, i).get128()), btAabbAt(aabbMins, strideInBytes, i+1).get128(), 1);
+		__m256 omax = _mm256_insertf128_ps(_mm256_castps128_ps256(btAabbAt(aabbMaxs, strideInBytes, i).get128()), btAabbAt(aabbMaxs, strideInBytes, i+1).get128(), 1);
+		__m256 overlap = _mm256_and_ps(_mm256_cmp_ps(bmin, omax, _CMP_LE_OQ), _mm256_cmp_ps(omin, bmax, _CMP_LE_OQ));
+		int mask = _mm256_movemask_ps(overlap);
+		overlapOut[i] = (unsigned char)((mask & 0x07) == 0x07);
+		overlapOut[i+1] = (unsigned char)((mask & 0x70) == 0x70);
+	}
+	_mm256_zeroupper();
+	if (i<count)
+	{
+		btAabbOverlapArraySSE2(aabbMin, aabbMax, &btAabbAt(aabbMins, strideInBytes, i), &btAabbAt(aabbMaxs, strideInBytes, i), strideInBytes, count-i, overlapOut+i);
+	}
+}
+#endif //BT_ALLOW_AVX2
+
+#endif //BT_USE_SSE
+
+static btAabbOverlapKernel	btSelectAabbOverlapKernel()
+{
+	int available = 1 << btCpuFeatureUtility::BT_SIMD_SCALAR;
+#ifdef BT_USE_SSE
+	available |= 1 << btCpuFeatureUtility::BT_SIMD_SSE2;
+#ifdef BT_ALLOW_AVX2
+	available |= 1 << btCpuFeatureUtility::BT_SIMD_AVX2;
+#endif
+#endif
+	switch (btCpuFeatureUtility::selectSimdVariant(available))
+	{
+#ifdef BT_USE_SSE
+	case btCpuFeatureUtility::BT_SIMD_SSE2:
+		return btAabbOverlapArraySSE2;
+#ifdef BT_ALLOW_AVX2
+	case btCpuFeatureUtility::BT_SIMD_AVX2:
+		return btAabbOverlapArrayAVX2;
+#endif
+#endif
+	default:
+		break;
+	};
+	return btAabbOverlapArrayScalar;
+}
+
+static btAabbOverlapKernel	gAabbOverlapKernel = 0;
+
+void	btAabbOverlapArray(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut)
+{
+	if (!gAabbOverlapKernel)
+	{
+		gAabbOverlapKernel = btSelectAabbOverlapKernel();
+	}
+	gAabbOverlapKernel(aabbMin, aabbMax, aabbMins, aabbMaxs, strideInBytes, count, overlapOut);
+}
@@ -55,6 +55,11 @@ SIMD_FORCE_INLINE bool TestAabbAgainstAabb2(const btVector3 &aabbMin1, const btV
 	return overlap;
 }
 
+///Tests one aabb against count aabbs, and writes 1 to overlapOut[i] when aabbMins[i]/aabbMaxs[i] overlaps, 0 otherwise.
+///Consecutive aabbs are strideInBytes apart, so the boxes can stay inside their proxies. Touching boxes overlap and NaN bounds never do,
+///like btSimpleBroadphase::aabbOverlap. The SSE2 or AVX2 variant is selected at runtime (see btCpuFeatureUtility).
+void	btAabbOverlapArray(const btVector3& aabbMin, const btVector3& aabbMax, const btVector3* aabbMins, const btVector3* aabbMaxs, int strideInBytes, int count, unsigned char* overlapOut);
+
 /// conservative test for overlap between triangle and aabb
 SIMD_FORCE_INLINE bool TestTriangleAgainstAabb2(const btVector3 *vertices,
 									const btVector3 &aabbMin, const btVector3 &aabbMax)
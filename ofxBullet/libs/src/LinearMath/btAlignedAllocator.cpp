@@ -14,6 +14,8 @@ subject to the following restrictions:
 */
 
 #include "btAlignedAllocator.h"
+#include "btThreadCachingAllocator.h"
+#include <stdio.h>
 
 int gNumAlignedAllocs = 0;
 int gNumAlignedFree = 0;
@@ -85,6 +87,9 @@ static btAlignedAllocFunc *sAlignedAllocFunc = btAlignedAllocDefault;
 static btAlignedFreeFunc *sAlignedFreeFunc = btAlignedFreeDefault;
 static btAllocFunc *sAllocFunc = btAllocDefault;
 static btFreeFunc *sFreeFunc = btFreeDefault;
+static bool sThreadCaching = false;
+///stays true after btAlignedAllocSetThreadCaching(false), blocks of the btThreadCachingAllocator may still be freed
+static bool sThreadCachingUsed = false;
 
 void btAlignedAllocSetCustomAligned(btAlignedAllocFunc *allocFunc, btAlignedFreeFunc *freeFunc)
 {
@@ -98,9 +103,100 @@ void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc)
   sFreeFunc = freeFunc ? freeFunc : btFreeDefault;
 }
 
+void btAlignedAllocSetThreadCaching(bool enable)
+{
+#ifndef BT_DEBUG_MEMORY_ALLOCATIONS
+  sThreadCaching = enable && btThreadCachingAllocator::init(sAllocFunc,sFreeFunc);
+  sThreadCachingUsed |= sThreadCaching;
+#else
+  (void)enable;
+#endif
+}
+
+#if defined (_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReturnAddress)
+#define BT_RETURN_ADDRESS() _ReturnAddress()
+#elif defined (__GNUC__)
+#define BT_RETURN_ADDRESS() __builtin_return_address(0)
+#else
+#define BT_RETURN_ADDRESS() 0
+#endif
+
+static int sTrackingDepth = 0;
+static int sNumTrackedAllocs = 0;
+static int sNumTrackedFrees = 0;
+static btAlignedAllocRecord sTrackedRecords[BT_ALIGNED_ALLOC_MAX_RECORDS];
+
+static void btTrackAlloc(size_t size,const void* caller,const char* filename,int line)
+{
+	if (sNumTrackedAllocs < BT_ALIGNED_ALLOC_MAX_RECORDS)
+	{
+		btAlignedAllocRecord& record = sTrackedRecords[sNumTrackedAllocs];
+		record.m_size = size;
+		record.m_caller = caller;
+		record.m_filename = filename;
+		record.m_line = line;
+	}
+	sNumTrackedAllocs++;
+}
+
+void	btAlignedAllocBeginTracking()
+{
+	if (!sTrackingDepth++)
+	{
+		sNumTrackedAllocs = 0;
+		sNumTrackedFrees = 0;
+	}
+}
+
+void	btAlignedAllocEndTracking()
+{
+	btAssert(sTrackingDepth>0);
+	if (sTrackingDepth>0)
+		sTrackingDepth--;
+}
+
+bool	btAlignedAllocIsTracking()
+{
+	return sTrackingDepth>0;
+}
+
+int		btAlignedAllocGetNumTrackedAllocs()
+{
+	return sNumTrackedAllocs;
+}
+
+int		btAlignedAllocGetNumTrackedFrees()
+{
+	return sNumTrackedFrees;
+}
+
+const btAlignedAllocRecord*	btAlignedAllocGetTrackedRecord(int index)
+{
+	if (index<0 || index>=sNumTrackedAllocs || index>=BT_ALIGNED_ALLOC_MAX_RECORDS)
+		return 0;
+	return &sTrackedRecords[index];
+}
+
+void	btAlignedAllocPrintTracked()
+{
+	printf("tracked %d allocations and %d frees\n",sNumTrackedAllocs,sNumTrackedFrees);
+	for (int i=0;i<sNumTrackedAllocs && i<BT_ALIGNED_ALLOC_MAX_RECORDS;i++)
+	{
+		const btAlignedAllocRecord& record = sTrackedRecords[i];
+		if (record.m_filename)
+		{
+			printf("allocation #%d of %d bytes at %s, line %d\n",i,(int)record.m_size,record.m_filename,record.m_line);
+		} else
+		{
+			printf("allocation #%d of %d bytes called from %p\n",i,(int)record.m_size,record.m_caller);
+		}
+	}
+}
+
 #ifdef BT_DEBUG_MEMORY_ALLOCATIONS
 //this generic allocator provides the total allocated number of bytes
-#include <stdio.h>
 
 void*   btAlignedAllocInternal  (size_t size, int alignment,int line,char* filename)
 {
@@ -110,6 +206,8 @@ void*   btAlignedAllocInternal  (size_t size, int alignment,int line,char* filen
 
  gTotalBytesAlignedAllocs += size;
  gNumAlignedAllocs++;
+ if (sTrackingDepth)
+   btTrackAlloc(size,BT_RETURN_ADDRESS(),filename,line);
 
  
  real = (char *)sAllocFunc(size + 2*sizeof(void *) + (alignment-1));
@@ -136,6 +234,8 @@ void    btAlignedFreeInternal   (void* ptr,int line,char* filename)
 
  void* real;
  gNumAlignedFree++;
+ if (sTrackingDepth)
+   sNumTrackedFrees++;
 
  if (ptr) {
    real = *((void **)(ptr)-1);
@@ -156,6 +256,14 @@ void    btAlignedFreeInternal   (void* ptr,int line,char* filename)
 void*	btAlignedAllocInternal	(size_t size, int alignment)
 {
 	gNumAlignedAllocs++;
+	if (sTrackingDepth)
+	{
+		btTrackAlloc(size,BT_RETURN_ADDRESS(),0,0);
+	}
+	if (sThreadCaching)
+	{
+		return btThreadCachingAllocator::allocate(size,alignment);
+	}
   void* ptr;
 #if defined (BT_HAS_ALIGNED_ALLOCATOR) || defined(__CELLOS_LV2__)
 	ptr = sAlignedAllocFunc(size, alignment);
@@ -184,7 +292,16 @@ void	btAlignedFreeInternal	(void* ptr)
 	}
 
 	gNumAlignedFree++;
+	if (sTrackingDepth)
+	{
+		sNumTrackedFrees++;
+	}
 //	printf("btAlignedFreeInternal %x\n",ptr);
+	if (sThreadCachingUsed && btThreadCachingAllocator::isCachedBlock(ptr))
+	{
+		btThreadCachingAllocator::deallocate(ptr);
+		return;
+	}
 #if defined (BT_HAS_ALIGNED_ALLOCATOR) || defined(__CELLOS_LV2__)
 	sAlignedFreeFunc(ptr);
 #else
@@ -52,6 +52,38 @@ typedef void (btFreeFunc)(void *memblock);
 void btAlignedAllocSetCustomAligned(btAlignedAllocFunc *allocFunc, btAlignedFreeFunc *freeFunc);
 void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc);
 
+///btAlignedAllocSetThreadCaching(true) serves btAlignedAlloc from the btThreadCachingAllocator, on top of the functions set with btAlignedAllocSetCustom.
+///It enables the per-tag accounting of btThreadCachingAllocator::getTagStats. Set the custom functions first.
+///Blocks are freed by the allocator they came from, also those of btAlignedAllocSetCustomAligned, so the call can be made at any time.
+///Has no effect with BT_DEBUG_MEMORY_ALLOCATIONS.
+void btAlignedAllocSetThreadCaching(bool enable);
+
+///btAlignedAllocRecord is one btAlignedAlloc call seen by the allocation tracker, see btAlignedAllocBeginTracking
+struct btAlignedAllocRecord
+{
+	size_t		m_size;
+	///return address of btAlignedAllocInternal, resolve it with the debugger or addr2line. 0 if the compiler doesn't provide it
+	const void*	m_caller;
+	///file and line of the call, only known with BT_DEBUG_MEMORY_ALLOCATIONS
+	const char*	m_filename;
+	int			m_line;
+};
+
+#define BT_ALIGNED_ALLOC_MAX_RECORDS 64
+
+///btAlignedAllocBeginTracking starts counting the btAlignedAlloc and btAlignedFree calls, and records the call sites of the first
+///BT_ALIGNED_ALLOC_MAX_RECORDS allocations. The tracker doesn't allocate memory itself. Calls can be nested, the counters are
+///reset by the outermost begin and kept until the next one. The counters are not atomic, so track one thread at a time.
+void	btAlignedAllocBeginTracking();
+void	btAlignedAllocEndTracking();
+bool	btAlignedAllocIsTracking();
+int		btAlignedAllocGetNumTrackedAllocs();
+int		btAlignedAllocGetNumTrackedFrees();
+///returns 0 if index is beyond the recorded allocations
+const btAlignedAllocRecord*	btAlignedAllocGetTrackedRecord(int index);
+///prints the counters and the recorded allocations
+void	btAlignedAllocPrintTracked();
+
 ///The btAlignedAllocator is a portable class for aligned memory allocations.
 ///Default implementations for unaligned and aligned allocations can be overridden by a custom allocator using btAlignedAllocSetCustom and btAlignedAllocSetCustomAligned.
 template < typename T , unsigned Alignment >
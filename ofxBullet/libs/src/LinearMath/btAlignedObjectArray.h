@@ -169,7 +169,37 @@ class btAlignedObjectArray
 			m_data[m_size].~T();
 		}
 
-		SIMD_FORCE_INLINE	void	resize(int newsize, const T& fillData=T())
+		///resize without a fill value default constructs the new elements in place, so types
+		///without initialization (btVector3, btTransform) are not copied from an uninitialized temporary
+		SIMD_FORCE_INLINE	void	resize(int newsize)
+		{
+			int curSize = size();
+
+			if (newsize < size())
+			{
+				for(int i = curSize; i < newsize; i++)
+				{
+					m_data[i].~T();
+				}
+			} else
+			{
+				if (newsize > size())
+				{
+					reserve(newsize);
+				}
+#ifdef BT_USE_PLACEMENT_NEW
+				for (int i=curSize;i<newsize;i++)
+				{
+					new ( &m_data[i]) T();
+				}
+#endif //BT_USE_PLACEMENT_NEW
+
+			}
+
+			m_size = newsize;
+		}
+
+		SIMD_FORCE_INLINE	void	resize(int newsize, const T& fillData)
 		{
 			int curSize = size();
 
@@ -198,7 +228,22 @@ class btAlignedObjectArray
 		}
 	
 
-		SIMD_FORCE_INLINE	T&  expand( const T& fillValue=T())
+		SIMD_FORCE_INLINE	T&  expand()
+		{	
+			int sz = size();
+			if( sz == capacity() )
+			{
+				reserve( allocSize(size()) );
+			}
+			m_size++;
+#ifdef BT_USE_PLACEMENT_NEW
+			new (&m_data[sz]) T(); //use the in-place new (not really allocating heap memory)
+#endif
+
+			return m_data[sz];		
+		}
+
+		SIMD_FORCE_INLINE	T&  expand( const T& fillValue)
 		{	
 			int sz = size();
 			if( sz == capacity() )
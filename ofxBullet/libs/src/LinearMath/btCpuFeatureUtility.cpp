@@ -0,0 +1,166 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btCpuFeatureUtility.h"
+
+#ifdef BT_ALLOW_AVX2
+#if defined (_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif //BT_ALLOW_AVX2
+
+static int	gCpuFeatures = -1;
+static btCpuFeatureUtility::btSimdVariant	gMaxSimdVariant = btCpuFeatureUtility::BT_SIMD_AVX512;
+
+#ifdef BT_ALLOW_AVX2
+static void	btCpuId(int leaf, int subLeaf, unsigned int regs[4])
+{
+#if defined (_MSC_VER)
+	int info[4];
+	__cpuidex(info, leaf, subLeaf);
+	regs[0] = info[0]; regs[1] = info[1]; regs[2] = info[2]; regs[3] = info[3];
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+///returns the register state the OS saves on context switch (XCR0), only valid when OSXSAVE is set
+static unsigned long long	btXgetbv()
+{
+#if defined (_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif //BT_ALLOW_AVX2
+
+static int	btDetectCpuFeatures()
+{
+	int features = 0;
+#ifdef BT_ALLOW_AVX2
+	unsigned int regs[4];
+	btCpuId(0, 0, regs);
+	const unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 1)
+		return features;
+
+	btCpuId(1, 0, regs);
+	const unsigned int ecx1 = regs[2];
+	const unsigned int edx1 = regs[3];
+	if (edx1 & (1u << 26))
+		features |= btCpuFeatureUtility::CPU_FEATURE_SSE2;
+	if (ecx1 & (1u << 19))
+		features |= btCpuFeatureUtility::CPU_FEATURE_SSE4_1;
+
+	//AVX state (xmm and ymm) must be enabled by the OS before FMA/AVX2 can be used
+	const bool osxsave = (ecx1 & (1u << 27)) != 0;
+	const bool avx = (ecx1 & (1u << 28)) != 0;
+	const unsigned long long xcr0 = osxsave ? btXgetbv() : 0;
+	const bool osAvx = avx && ((xcr0 & 0x6) == 0x6);
+	const bool osAvx512 = osAvx && ((xcr0 & 0xe0) == 0xe0);
+
+	if (osAvx && (ecx1 & (1u << 12)))
+		features |= btCpuFeatureUtility::CPU_FEATURE_FMA3;
+
+	if (maxLeaf >= 7)
+	{
+		btCpuId(7, 0, regs);
+		const unsigned int ebx7 = regs[1];
+		if (osAvx && (ebx7 & (1u << 5)))
+			features |= btCpuFeatureUtility::CPU_FEATURE_AVX2;
+		if (osAvx512 && (ebx7 & (1u << 16)))
+			features |= btCpuFeatureUtility::CPU_FEATURE_AVX512F;
+	}
+#elif defined (BT_USE_SSE)
+	//the baseline build already requires SSE2
+	features |= btCpuFeatureUtility::CPU_FEATURE_SSE2;
+#endif //BT_ALLOW_AVX2
+	return features;
+}
+
+int	btCpuFeatureUtility::getCpuFeatures()
+{
+	//detection is idempotent, so a concurrent first call only repeats the work
+	if (gCpuFeatures < 0)
+	{
+		gCpuFeatures = btDetectCpuFeatures();
+	}
+	return gCpuFeatures;
+}
+
+btCpuFeatureUtility::btSimdVariant	btCpuFeatureUtility::getSimdVariant()
+{
+	btSimdVariant variant = BT_SIMD_SCALAR;
+#ifdef BT_USE_SSE
+	int features = getCpuFeatures();
+	variant = BT_SIMD_SSE2;
+#ifdef BT_ALLOW_AVX2
+	if (features & CPU_FEATURE_SSE4_1)
+	{
+		variant = BT_SIMD_SSE4_1;
+		if ((features & CPU_FEATURE_AVX2) && (features & CPU_FEATURE_FMA3))
+		{
+			variant = BT_SIMD_AVX2;
+			if (features & CPU_FEATURE_AVX512F)
+				variant = BT_SIMD_AVX512;
+		}
+	}
+#else
+	(void)features;
+#endif //BT_ALLOW_AVX2
+#endif //BT_USE_SSE
+	return variant < gMaxSimdVariant ? variant : gMaxSimdVariant;
+}
+
+btCpuFeatureUtility::btSimdVariant	btCpuFeatureUtility::selectSimdVariant(int availableVariantMask)
+{
+	for (int variant = getSimdVariant(); variant > BT_SIMD_SCALAR; variant--)
+	{
+		if (availableVariantMask & (1 << variant))
+			return btSimdVariant(variant);
+	}
+	return BT_SIMD_SCALAR;
+}
+
+void	btCpuFeatureUtility::setMaxSimdVariant(btSimdVariant maxVariant)
+{
+	gMaxSimdVariant = maxVariant;
+}
+
+const char*	btCpuFeatureUtility::getSimdVariantName(btSimdVariant variant)
+{
+	switch (variant)
+	{
+	case BT_SIMD_SCALAR:
+		return "scalar";
+	case BT_SIMD_SSE2:
+		return "SSE2";
+	case BT_SIMD_SSE4_1:
+		return "SSE4.1";
+	case BT_SIMD_AVX2:
+		return "AVX2";
+	case BT_SIMD_AVX512:
+		return "AVX-512";
+	default:
+		break;
+	};
+	return "unknown";
+}
@@ -0,0 +1,82 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_CPU_FEATURE_UTILITY_H
+#define BT_CPU_FEATURE_UTILITY_H
+
+#include "btScalar.h"
+
+///BT_ALLOW_AVX2 is defined when this compiler can build SSE4.1 and AVX2/FMA kernels next to the SSE2 baseline,
+///so a single binary can select the best kernel at startup. Define BT_NO_RUNTIME_DISPATCH to only build the baseline.
+#if defined (BT_USE_SSE) && !defined (BT_NO_RUNTIME_DISPATCH)
+	#if (defined (__GNUC__) || defined (__clang__)) && (defined (__x86_64__) || defined (__i386__))
+		#define BT_ALLOW_AVX2 1
+		#define BT_TARGET_SSE4_1 __attribute__ ((target ("sse4.1")))
+		#define BT_TARGET_AVX2 __attribute__ ((target ("avx2,fma")))
+		///for AVX2 kernels that have to round exactly like the SSE2 ones, the compiler cannot contract a multiply and add into FMA
+		#define BT_TARGET_AVX2_NO_FMA __attribute__ ((target ("avx2")))
+		#include <immintrin.h>
+	#elif defined (_MSC_VER) && (_MSC_VER >= 1700)
+		#define BT_ALLOW_AVX2 1
+		#define BT_TARGET_SSE4_1
+		#define BT_TARGET_AVX2
+		#define BT_TARGET_AVX2_NO_FMA
+		#include <immintrin.h>
+	#endif
+#endif
+
+///The btCpuFeatureUtility detects the instruction set extensions of the host at runtime, and selects the kernel variant used by
+///the dispatched hot loops (solver rows in btSequentialImpulseConstraintSolver, btVector3::maxDot/minDot and btAabbOverlapArray).
+class btCpuFeatureUtility
+{
+public:
+	enum btCpuFeature
+	{
+		CPU_FEATURE_SSE2	= 1,
+		CPU_FEATURE_SSE4_1	= 2,
+		CPU_FEATURE_FMA3	= 4,
+		CPU_FEATURE_AVX2	= 8,
+		CPU_FEATURE_AVX512F	= 16
+	};
+
+	///kernel variants, ordered from the most portable to the fastest
+	enum btSimdVariant
+	{
+		BT_SIMD_SCALAR = 0,
+		BT_SIMD_SSE2,
+		BT_SIMD_SSE4_1,
+		BT_SIMD_AVX2,
+		BT_SIMD_AVX512,
+		BT_SIMD_NUM_VARIANTS
+	};
+
+	///returns a combination of btCpuFeature flags. AVX2 and AVX512F are only reported when the OS saves the wide registers.
+	static int getCpuFeatures();
+
+	///returns the best variant supported by the host, the compiler and the limit set by setMaxSimdVariant
+	static btSimdVariant getSimdVariant();
+
+	///returns the best variant that is available in availableVariantMask (one bit per btSimdVariant) and not above getSimdVariant().
+	///Kernel families use this to fall back, for example from BT_SIMD_AVX512 to BT_SIMD_AVX2.
+	static btSimdVariant selectSimdVariant(int availableVariantMask);
+
+	///caps the selected variant, for example BT_SIMD_SSE4_1 to get the same results on every host (AVX2 kernels use FMA).
+	///Only affects objects and kernels that select their variant after the call.
+	static void setMaxSimdVariant(btSimdVariant maxVariant);
+
+	static const char* getSimdVariantName(btSimdVariant variant);
+};
+
+#endif //BT_CPU_FEATURE_UTILITY_H
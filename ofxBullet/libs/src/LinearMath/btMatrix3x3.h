@@ -21,7 +21,34 @@ subject to the following restrictions:
 #include "btVector3.h"
 #include "btQuaternion.h"
 
+#ifdef BT_USE_SSE
+///btMat3Dot3_128 returns (r0.dot(v), r1.dot(v), r2.dot(v), 0).
+///The products are transposed so every lane sums (x+y)+z in the same order as btVector3::dot.
+SIMD_FORCE_INLINE __m128 btMat3Dot3_128(__m128 r0, __m128 r1, __m128 r2, __m128 v)
+{
+	__m128 p0 = _mm_mul_ps(r0, v);
+	__m128 p1 = _mm_mul_ps(r1, v);
+	__m128 p2 = _mm_mul_ps(r2, v);
+	__m128 zero = _mm_setzero_ps();
+	__m128 t0 = _mm_unpacklo_ps(p0, p1);	// p0x p1x p0y p1y
+	__m128 t1 = _mm_unpackhi_ps(p0, p1);	// p0z p1z p0w p1w
+	__m128 t2 = _mm_unpacklo_ps(p2, zero);	// p2x 0 p2y 0
+	__m128 t3 = _mm_unpackhi_ps(p2, zero);	// p2z 0 p2w 0
+	__m128 x = _mm_movelh_ps(t0, t2);
+	__m128 y = _mm_movehl_ps(t2, t0);
+	__m128 z = _mm_movelh_ps(t1, t3);
+	return _mm_add_ps(_mm_add_ps(x, y), z);
+}
 
+///btMat3Combine_128 returns r0*v.x + r1*v.y + r2*v.z with the w lane cleared, which is v * [r0 r1 r2] (see btMatrix3x3::tdotx)
+SIMD_FORCE_INLINE __m128 btMat3Combine_128(__m128 r0, __m128 r1, __m128 r2, __m128 v)
+{
+	__m128 a = _mm_mul_ps(r0, bt_splat_ps(v, 0));
+	__m128 b = _mm_mul_ps(r1, bt_splat_ps(v, 1));
+	__m128 c = _mm_mul_ps(r2, bt_splat_ps(v, 2));
+	return _mm_and_ps(_mm_add_ps(_mm_add_ps(a, b), c), btvxyzMaskf);
+}
+#endif //BT_USE_SSE
 
 /**@brief The btMatrix3x3 class implements a 3x3 rotation matrix, to perform linear algebra in combination with btQuaternion, btTransform and btVector3.
  * Make sure to only include a pure orthogonal matrix without scaling. */
@@ -485,9 +512,17 @@ class btMatrix3x3 {
 	SIMD_FORCE_INLINE btMatrix3x3& 
 	btMatrix3x3::operator*=(const btMatrix3x3& m)
 	{
+#ifdef BT_USE_SSE
+		//m may alias this matrix, so read all rows before writing
+		__m128 m0 = m.m_el[0].mVec128, m1 = m.m_el[1].mVec128, m2 = m.m_el[2].mVec128;
+		m_el[0].mVec128 = btMat3Combine_128(m0, m1, m2, m_el[0].mVec128);
+		m_el[1].mVec128 = btMat3Combine_128(m0, m1, m2, m_el[1].mVec128);
+		m_el[2].mVec128 = btMat3Combine_128(m0, m1, m2, m_el[2].mVec128);
+#else
 		setValue(m.tdotx(m_el[0]), m.tdoty(m_el[0]), m.tdotz(m_el[0]),
 				 m.tdotx(m_el[1]), m.tdoty(m_el[1]), m.tdotz(m_el[1]),
 				 m.tdotx(m_el[2]), m.tdoty(m_el[2]), m.tdotz(m_el[2]));
+#endif
 		return *this;
 	}
 	
@@ -501,18 +536,39 @@ class btMatrix3x3 {
 	SIMD_FORCE_INLINE btMatrix3x3 
 	btMatrix3x3::absolute() const
 	{
+#ifdef BT_USE_SSE
+		btMatrix3x3 a;
+		a.m_el[0] = m_el[0].absolute();
+		a.m_el[1] = m_el[1].absolute();
+		a.m_el[2] = m_el[2].absolute();
+		return a;
+#else
 		return btMatrix3x3(
 			btFabs(m_el[0].x()), btFabs(m_el[0].y()), btFabs(m_el[0].z()),
 			btFabs(m_el[1].x()), btFabs(m_el[1].y()), btFabs(m_el[1].z()),
 			btFabs(m_el[2].x()), btFabs(m_el[2].y()), btFabs(m_el[2].z()));
+#endif
 	}
 
 	SIMD_FORCE_INLINE btMatrix3x3 
 	btMatrix3x3::transpose() const 
 	{
+#ifdef BT_USE_SSE
+		__m128 zero = _mm_setzero_ps();
+		__m128 t0 = _mm_unpacklo_ps(m_el[0].mVec128, m_el[1].mVec128);
+		__m128 t1 = _mm_unpackhi_ps(m_el[0].mVec128, m_el[1].mVec128);
+		__m128 t2 = _mm_unpacklo_ps(m_el[2].mVec128, zero);
+		__m128 t3 = _mm_unpackhi_ps(m_el[2].mVec128, zero);
+		btMatrix3x3 t;
+		t.m_el[0].mVec128 = _mm_movelh_ps(t0, t2);
+		t.m_el[1].mVec128 = _mm_movehl_ps(t2, t0);
+		t.m_el[2].mVec128 = _mm_movelh_ps(t1, t3);
+		return t;
+#else
 		return btMatrix3x3(m_el[0].x(), m_el[1].x(), m_el[2].x(),
 								 m_el[0].y(), m_el[1].y(), m_el[2].y(),
 								 m_el[0].z(), m_el[1].z(), m_el[2].z());
+#endif
 	}
 	
 	SIMD_FORCE_INLINE btMatrix3x3 
@@ -538,6 +594,14 @@ class btMatrix3x3 {
 	SIMD_FORCE_INLINE btMatrix3x3 
 	btMatrix3x3::transposeTimes(const btMatrix3x3& m) const
 	{
+#ifdef BT_USE_SSE
+		//row i is m[0]*m_el[0][i] + m[1]*m_el[1][i] + m[2]*m_el[2][i], the column i of this matrix combines the rows of m
+		btMatrix3x3 t = transpose();
+		t.m_el[0].mVec128 = btMat3Combine_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, t.m_el[0].mVec128);
+		t.m_el[1].mVec128 = btMat3Combine_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, t.m_el[1].mVec128);
+		t.m_el[2].mVec128 = btMat3Combine_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, t.m_el[2].mVec128);
+		return t;
+#else
 		return btMatrix3x3(
 			m_el[0].x() * m[0].x() + m_el[1].x() * m[1].x() + m_el[2].x() * m[2].x(),
 			m_el[0].x() * m[0].y() + m_el[1].x() * m[1].y() + m_el[2].x() * m[2].y(),
@@ -548,38 +612,60 @@ class btMatrix3x3 {
 			m_el[0].z() * m[0].x() + m_el[1].z() * m[1].x() + m_el[2].z() * m[2].x(),
 			m_el[0].z() * m[0].y() + m_el[1].z() * m[1].y() + m_el[2].z() * m[2].y(),
 			m_el[0].z() * m[0].z() + m_el[1].z() * m[1].z() + m_el[2].z() * m[2].z());
+#endif
 	}
 	
 	SIMD_FORCE_INLINE btMatrix3x3 
 	btMatrix3x3::timesTranspose(const btMatrix3x3& m) const
 	{
+#ifdef BT_USE_SSE
+		btMatrix3x3 t;
+		t.m_el[0].mVec128 = btMat3Dot3_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, m_el[0].mVec128);
+		t.m_el[1].mVec128 = btMat3Dot3_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, m_el[1].mVec128);
+		t.m_el[2].mVec128 = btMat3Dot3_128(m.m_el[0].mVec128, m.m_el[1].mVec128, m.m_el[2].mVec128, m_el[2].mVec128);
+		return t;
+#else
 		return btMatrix3x3(
 			m_el[0].dot(m[0]), m_el[0].dot(m[1]), m_el[0].dot(m[2]),
 			m_el[1].dot(m[0]), m_el[1].dot(m[1]), m_el[1].dot(m[2]),
 			m_el[2].dot(m[0]), m_el[2].dot(m[1]), m_el[2].dot(m[2]));
-		
+#endif
 	}
 
 	SIMD_FORCE_INLINE btVector3 
 	operator*(const btMatrix3x3& m, const btVector3& v) 
 	{
+#ifdef BT_USE_SSE
+		return btVector3(btMat3Dot3_128(m[0].mVec128, m[1].mVec128, m[2].mVec128, v.mVec128));
+#else
 		return btVector3(m[0].dot(v), m[1].dot(v), m[2].dot(v));
+#endif
 	}
 	
 
 	SIMD_FORCE_INLINE btVector3
 	operator*(const btVector3& v, const btMatrix3x3& m)
 	{
+#ifdef BT_USE_SSE
+		return btVector3(btMat3Combine_128(m[0].mVec128, m[1].mVec128, m[2].mVec128, v.mVec128));
+#else
 		return btVector3(m.tdotx(v), m.tdoty(v), m.tdotz(v));
+#endif
 	}
 
 	SIMD_FORCE_INLINE btMatrix3x3 
 	operator*(const btMatrix3x3& m1, const btMatrix3x3& m2)
 	{
+#ifdef BT_USE_SSE
+		btMatrix3x3 m(m1);
+		m *= m2;
+		return m;
+#else
 		return btMatrix3x3(
 			m2.tdotx( m1[0]), m2.tdoty( m1[0]), m2.tdotz( m1[0]),
 			m2.tdotx( m1[1]), m2.tdoty( m1[1]), m2.tdotz( m1[1]),
 			m2.tdotx( m1[2]), m2.tdoty( m1[2]), m2.tdotz( m1[2]));
+#endif
 	}
 
 /*
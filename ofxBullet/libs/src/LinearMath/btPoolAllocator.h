@@ -18,37 +18,94 @@ subject to the following restrictions:
 
 #include "btScalar.h"
 #include "btAlignedAllocator.h"
+#include "btAlignedObjectArray.h"
 
 ///The btPoolAllocator class allows to efficiently allocate a large pool of objects, instead of dynamically allocating them separately.
+///With growElements > 0 the pool chains a new slab when it runs out, of at least growElements and at least half the current capacity,
+///so the slab count stays logarithmic. Without it, allocate returns 0 when the pool is full and the caller falls back to btAlignedAlloc,
+///which getNumFallbacks counts. trimToHighWaterMark releases grown slabs that weren't needed since the previous trim.
 class btPoolAllocator
 {
+	struct	btPoolSlab
+	{
+		unsigned char*	m_memory;
+		int				m_numElements;
+	};
+
 	int				m_elemSize;
 	int				m_maxElements;
 	int				m_freeCount;
 	void*			m_firstFree;
 	unsigned char*	m_pool;
+	int				m_growElements;
+	int				m_numElements;
+	int				m_highWaterMark;
+	int				m_numGrowths;
+	int				m_numFallbacks;
+	btAlignedObjectArray<btPoolSlab>	m_slabs;
+
+	///links count elements starting at p into a free list ending with last
+	void*	linkElements(unsigned char* p,int count,void* last)
+	{
+		unsigned char* first = p;
+		while (--count) {
+			*(void**)p = (p + m_elemSize);
+			p += m_elemSize;
+		}
+		*(void**)p = last;
+		return first;
+	}
+
+	bool	grow()
+	{
+		if (m_growElements <= 0)
+			return false;
+		btPoolSlab slab;
+		slab.m_numElements = btMax(m_growElements,m_numElements/2);
+		slab.m_memory = (unsigned char*) btAlignedAlloc( static_cast<unsigned int>(m_elemSize*slab.m_numElements),16);
+		if (!slab.m_memory)
+			return false;
+		m_slabs.push_back(slab);
+		m_firstFree = linkElements(slab.m_memory,slab.m_numElements,m_firstFree);
+		m_freeCount += slab.m_numElements;
+		m_numElements += slab.m_numElements;
+		++m_numGrowths;
+		return true;
+	}
+
+	int	findSlab(void* ptr) const
+	{
+		for (int i=0;i<m_slabs.size();i++)
+		{
+			if ((unsigned char*)ptr >= m_slabs[i].m_memory && (unsigned char*)ptr < m_slabs[i].m_memory + m_slabs[i].m_numElements * m_elemSize)
+				return i;
+		}
+		return -1;
+	}
 
 public:
 
-	btPoolAllocator(int elemSize, int maxElements)
+	btPoolAllocator(int elemSize, int maxElements, int growElements = 0)
 		:m_elemSize(elemSize),
-		m_maxElements(maxElements)
+		m_maxElements(maxElements),
+		m_growElements(growElements),
+		m_numElements(maxElements),
+		m_highWaterMark(0),
+		m_numGrowths(0),
+		m_numFallbacks(0)
 	{
 		m_pool = (unsigned char*) btAlignedAlloc( static_cast<unsigned int>(m_elemSize*m_maxElements),16);
 
-		unsigned char* p = m_pool;
-        m_firstFree = p;
+        m_firstFree = linkElements(m_pool,m_maxElements,0);
         m_freeCount = m_maxElements;
-        int count = m_maxElements;
-        while (--count) {
-            *(void**)p = (p + m_elemSize);
-            p += m_elemSize;
-        }
-        *(void**)p = 0;
     }
 
 	~btPoolAllocator()
 	{
+		for (int i=0;i<m_slabs.size();i++)
+		{
+			btAlignedFree( m_slabs[i].m_memory);
+		}
 		btAlignedFree( m_pool);
 	}
 
@@ -57,15 +114,68 @@ public:
 		return m_freeCount;
 	}
 
+	int	getUsedCount() const
+	{
+		return m_numElements - m_freeCount;
+	}
+
+	///capacity of the initial pool and all grown slabs
+	int	getMaxCount() const
+	{
+		return m_numElements;
+	}
+
+	///largest getUsedCount since construction or the last trimToHighWaterMark
+	int	getHighWaterMark() const
+	{
+		return m_highWaterMark;
+	}
+
+	///number of slabs added because the pool ran out
+	int	getNumGrowths() const
+	{
+		return m_numGrowths;
+	}
+
+	///number of allocate calls that returned 0 because the pool was full and couldn't grow
+	int	getNumFallbacks() const
+	{
+		return m_numFallbacks;
+	}
+
+	void	resetCounters()
+	{
+		m_numGrowths = 0;
+		m_numFallbacks = 0;
+	}
+
+	int	getGrowElements() const
+	{
+		return m_growElements;
+	}
+
+	///0 disables growing
+	void	setGrowElements(int growElements)
+	{
+		m_growElements = growElements;
+	}
+
+	///returns 0 when the pool is full and can't grow, the caller then allocates the object elsewhere
 	void*	allocate(int size)
 	{
 		// release mode fix
 		(void)size;
 		btAssert(!size || size<=m_elemSize);
-		btAssert(m_freeCount>0);
+		if (!m_freeCount && !grow())
+		{
+			++m_numFallbacks;
+			return 0;
+		}
         void* result = m_firstFree;
         m_firstFree = *(void**)m_firstFree;
         --m_freeCount;
+		if (getUsedCount() > m_highWaterMark)
+			m_highWaterMark = getUsedCount();
         return result;
 	}
 
@@ -76,6 +186,7 @@ public:
 			{
 				return true;
 			}
+			return findSlab(ptr) >= 0;
 		}
 		return false;
 	}
@@ -83,7 +194,7 @@ public:
 	void	freeMemory(void* ptr)
 	{
 		 if (ptr) {
-            btAssert((unsigned char*)ptr >= m_pool && (unsigned char*)ptr < m_pool + m_maxElements * m_elemSize);
+            btAssert(validPtr(ptr));
 
             *(void**)ptr = m_firstFree;
             m_firstFree = ptr;
@@ -91,6 +202,69 @@ public:
         }
 	}
 
+	///releases grown slabs without allocated elements while the capacity stays at or above the high water mark,
+	///then restarts the high water mark at the current usage. Returns the number of elements released.
+	///This walks the free list, call it between frames or at level changes.
+	int	trimToHighWaterMark()
+	{
+		int released = 0;
+		if (m_slabs.size())
+		{
+			btAlignedObjectArray<int> freeInSlab;
+			freeInSlab.resize(m_slabs.size());
+			int i;
+			for (i=0;i<m_slabs.size();i++)
+			{
+				freeInSlab[i] = 0;
+			}
+			for (void* p = m_firstFree;p;p = *(void**)p)
+			{
+				const int slab = findSlab(p);
+				if (slab >= 0)
+					freeInSlab[slab]++;
+			}
+			int capacity = m_numElements;
+			for (i=m_slabs.size()-1;i>=0;i--)
+			{
+				const bool unused = freeInSlab[i] == m_slabs[i].m_numElements;
+				if (unused && (capacity - m_slabs[i].m_numElements >= m_highWaterMark))
+				{
+					capacity -= m_slabs[i].m_numElements;
+					freeInSlab[i] = -1;
+				}
+			}
+			if (capacity < m_numElements)
+			{
+				//unlink the elements of the released slabs
+				void** link = &m_firstFree;
+				while (*link)
+				{
+					const int slab = findSlab(*link);
+					if ((slab >= 0) && (freeInSlab[slab] < 0))
+						*link = *(void**)*link;
+					else
+						link = (void**)*link;
+				}
+				for (i=m_slabs.size()-1;i>=0;i--)
+				{
+					if (freeInSlab[i] < 0)
+					{
+						released += m_slabs[i].m_numElements;
+						btAlignedFree(m_slabs[i].m_memory);
+						m_slabs.swap(i,m_slabs.size()-1);
+						freeInSlab.swap(i,freeInSlab.size()-1);
+						m_slabs.pop_back();
+						freeInSlab.pop_back();
+					}
+				}
+				m_freeCount -= released;
+				m_numElements -= released;
+			}
+		}
+		m_highWaterMark = getUsedCount();
+		return released;
+	}
+
 	int	getElementSize() const
 	{
 		return m_elemSize;
@@ -47,7 +47,24 @@ public:
 	}
 protected:
 #else //__CELLOS_LV2__ __SPU__
+#ifdef BT_USE_SSE
+	union {
+		__m128 mVec128;
+		btScalar	m_floats[4];
+	};
+public:
+	SIMD_FORCE_INLINE	__m128	get128() const
+	{
+		return mVec128;
+	}
+	SIMD_FORCE_INLINE	void	set128(__m128 v128)
+	{
+		mVec128 = v128;
+	}
+protected:
+#else
 	btScalar	m_floats[4];
+#endif //BT_USE_SSE
 #endif //__CELLOS_LV2__ __SPU__
 
 	public:
@@ -84,7 +101,11 @@ protected:
 
 	SIMD_FORCE_INLINE	bool	operator==(const btQuadWord& other) const
 	{
+#ifdef BT_USE_SSE
+		return (0xf == _mm_movemask_ps(_mm_cmpeq_ps(mVec128, other.mVec128)));
+#else
 		return ((m_floats[3]==other.m_floats[3]) && (m_floats[2]==other.m_floats[2]) && (m_floats[1]==other.m_floats[1]) && (m_floats[0]==other.m_floats[0]));
+#endif
 	}
 
 	SIMD_FORCE_INLINE	bool	operator!=(const btQuadWord& other) const
@@ -152,25 +173,42 @@ protected:
 			m_floats[0] = x, m_floats[1] = y, m_floats[2] = z, m_floats[3] = w;
 		}
 
+#ifdef BT_USE_SSE
+  /**@brief Constructor from a SIMD register */
+		SIMD_FORCE_INLINE btQuadWord(__m128 v128)
+		{
+			mVec128 = v128;
+		}
+#endif //BT_USE_SSE
+
   /**@brief Set each element to the max of the current values and the values of another btQuadWord
    * @param other The other btQuadWord to compare with 
    */
 		SIMD_FORCE_INLINE void	setMax(const btQuadWord& other)
 		{
+#ifdef BT_USE_SSE
+			//operand order keeps our value on ties and NaN, like btSetMax
+			mVec128 = _mm_max_ps(other.mVec128, mVec128);
+#else
 			btSetMax(m_floats[0], other.m_floats[0]);
 			btSetMax(m_floats[1], other.m_floats[1]);
 			btSetMax(m_floats[2], other.m_floats[2]);
 			btSetMax(m_floats[3], other.m_floats[3]);
+#endif
 		}
   /**@brief Set each element to the min of the current values and the values of another btQuadWord
    * @param other The other btQuadWord to compare with 
    */
 		SIMD_FORCE_INLINE void	setMin(const btQuadWord& other)
 		{
+#ifdef BT_USE_SSE
+			mVec128 = _mm_min_ps(other.mVec128, mVec128);
+#else
 			btSetMin(m_floats[0], other.m_floats[0]);
 			btSetMin(m_floats[1], other.m_floats[1]);
 			btSetMin(m_floats[2], other.m_floats[2]);
 			btSetMin(m_floats[3], other.m_floats[3]);
+#endif
 		}
 
 
@@ -21,6 +21,21 @@ subject to the following restrictions:
 #include "btVector3.h"
 #include "btQuadWord.h"
 
+#ifdef BT_USE_SSE
+///Hamilton product of two quaternions stored as (x,y,z,w).
+///Every lane is evaluated as ((a + b) + c) - d in the same order as the scalar code, the w lane negates b and c to subtract them.
+SIMD_FORCE_INLINE __m128 btQuatMul128(__m128 q1, __m128 q2)
+{
+	__m128 a = _mm_mul_ps(bt_splat_ps(q1, 3), q2);
+	__m128 b = _mm_mul_ps(bt_pshufd_ps(q1, BT_SHUFFLE(0,1,2,0)), bt_pshufd_ps(q2, BT_SHUFFLE(3,3,3,0)));
+	__m128 c = _mm_mul_ps(bt_pshufd_ps(q1, BT_SHUFFLE(1,2,0,1)), bt_pshufd_ps(q2, BT_SHUFFLE(2,0,1,1)));
+	__m128 d = _mm_mul_ps(bt_pshufd_ps(q1, BT_SHUFFLE(2,0,1,2)), bt_pshufd_ps(q2, BT_SHUFFLE(1,2,0,2)));
+	b = _mm_xor_ps(b, btvWSignMaskf);
+	c = _mm_xor_ps(c, btvWSignMaskf);
+	return _mm_sub_ps(_mm_add_ps(_mm_add_ps(a, b), c), d);
+}
+#endif //BT_USE_SSE
+
 /**@brief The btQuaternion implements quaternion to perform linear algebra rotations in combination with btMatrix3x3, btVector3 and btTransform. */
 class btQuaternion : public btQuadWord {
 public:
@@ -33,6 +48,12 @@ public:
 	btQuaternion(const btScalar& x, const btScalar& y, const btScalar& z, const btScalar& w) 
 		: btQuadWord(x, y, z, w) 
 	{}
+#ifdef BT_USE_SSE
+  /**@brief Constructor from a SIMD register */
+	SIMD_FORCE_INLINE btQuaternion(__m128 v128)
+		: btQuadWord(v128)
+	{}
+#endif //BT_USE_SSE
   /**@brief Axis angle Constructor
    * @param axis The axis which the rotation is around
    * @param angle The magnitude of the rotation around the angle (Radians) */
@@ -107,7 +128,11 @@ public:
    * @param q The quaternion to add to this one */
 	SIMD_FORCE_INLINE	btQuaternion& operator+=(const btQuaternion& q)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_add_ps(mVec128, q.mVec128);
+#else
 		m_floats[0] += q.x(); m_floats[1] += q.y(); m_floats[2] += q.z(); m_floats[3] += q.m_floats[3];
+#endif
 		return *this;
 	}
 
@@ -115,7 +140,11 @@ public:
    * @param q The quaternion to subtract from this one */
 	btQuaternion& operator-=(const btQuaternion& q) 
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_sub_ps(mVec128, q.mVec128);
+#else
 		m_floats[0] -= q.x(); m_floats[1] -= q.y(); m_floats[2] -= q.z(); m_floats[3] -= q.m_floats[3];
+#endif
 		return *this;
 	}
 
@@ -123,7 +152,11 @@ public:
    * @param s The scalar to scale by */
 	btQuaternion& operator*=(const btScalar& s)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_mul_ps(mVec128, _mm_set1_ps(s));
+#else
 		m_floats[0] *= s; m_floats[1] *= s; m_floats[2] *= s; m_floats[3] *= s;
+#endif
 		return *this;
 	}
 
@@ -132,17 +165,30 @@ public:
    * Equivilant to this = this * q */
 	btQuaternion& operator*=(const btQuaternion& q)
 	{
+#ifdef BT_USE_SSE
+		mVec128 = btQuatMul128(mVec128, q.mVec128);
+#else
 		setValue(m_floats[3] * q.x() + m_floats[0] * q.m_floats[3] + m_floats[1] * q.z() - m_floats[2] * q.y(),
 			m_floats[3] * q.y() + m_floats[1] * q.m_floats[3] + m_floats[2] * q.x() - m_floats[0] * q.z(),
 			m_floats[3] * q.z() + m_floats[2] * q.m_floats[3] + m_floats[0] * q.y() - m_floats[1] * q.x(),
 			m_floats[3] * q.m_floats[3] - m_floats[0] * q.x() - m_floats[1] * q.y() - m_floats[2] * q.z());
+#endif
 		return *this;
 	}
   /**@brief Return the dot product between this quaternion and another
    * @param q The other quaternion */
 	btScalar dot(const btQuaternion& q) const
 	{
+#ifdef BT_USE_SSE
+		//sum the lanes in the same order as the scalar version, ((x+y)+z)+w
+		__m128 vd = _mm_mul_ps(mVec128, q.mVec128);
+		__m128 s = _mm_add_ss(vd, bt_splat_ps(vd, 1));
+		s = _mm_add_ss(s, bt_splat_ps(vd, 2));
+		s = _mm_add_ss(s, bt_splat_ps(vd, 3));
+		return _mm_cvtss_f32(s);
+#else
 		return m_floats[0] * q.x() + m_floats[1] * q.y() + m_floats[2] * q.z() + m_floats[3] * q.m_floats[3];
+#endif
 	}
 
   /**@brief Return the length squared of the quaternion */
@@ -169,7 +215,11 @@ public:
 	SIMD_FORCE_INLINE btQuaternion
 	operator*(const btScalar& s) const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_mul_ps(mVec128, _mm_set1_ps(s)));
+#else
 		return btQuaternion(x() * s, y() * s, z() * s, m_floats[3] * s);
+#endif
 	}
 
 
@@ -213,7 +263,11 @@ public:
   /**@brief Return the inverse of this quaternion */
 	btQuaternion inverse() const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_xor_ps(mVec128, btvxyzSignMaskf));
+#else
 		return btQuaternion(-m_floats[0], -m_floats[1], -m_floats[2], m_floats[3]);
+#endif
 	}
 
   /**@brief Return the sum of this quaternion and the other 
@@ -221,8 +275,12 @@ public:
 	SIMD_FORCE_INLINE btQuaternion
 	operator+(const btQuaternion& q2) const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_add_ps(mVec128, q2.mVec128));
+#else
 		const btQuaternion& q1 = *this;
 		return btQuaternion(q1.x() + q2.x(), q1.y() + q2.y(), q1.z() + q2.z(), q1.m_floats[3] + q2.m_floats[3]);
+#endif
 	}
 
   /**@brief Return the difference between this quaternion and the other 
@@ -230,16 +288,24 @@ public:
 	SIMD_FORCE_INLINE btQuaternion
 	operator-(const btQuaternion& q2) const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_sub_ps(mVec128, q2.mVec128));
+#else
 		const btQuaternion& q1 = *this;
 		return btQuaternion(q1.x() - q2.x(), q1.y() - q2.y(), q1.z() - q2.z(), q1.m_floats[3] - q2.m_floats[3]);
+#endif
 	}
 
   /**@brief Return the negative of this quaternion 
    * This simply negates each element */
 	SIMD_FORCE_INLINE btQuaternion operator-() const
 	{
+#ifdef BT_USE_SSE
+		return btQuaternion(_mm_xor_ps(mVec128, btvSignMaskf));
+#else
 		const btQuaternion& q2 = *this;
 		return btQuaternion( - q2.x(), - q2.y(),  - q2.z(),  - q2.m_floats[3]);
+#endif
 	}
   /**@todo document this and it's use */
 	SIMD_FORCE_INLINE btQuaternion farthest( const btQuaternion& qd) const 
@@ -293,10 +359,14 @@ operator-(const btQuaternion& q)
 /**@brief Return the product of two quaternions */
 SIMD_FORCE_INLINE btQuaternion
 operator*(const btQuaternion& q1, const btQuaternion& q2) {
+#ifdef BT_USE_SSE
+	return btQuaternion(btQuatMul128(q1.get128(), q2.get128()));
+#else
 	return btQuaternion(q1.w() * q2.x() + q1.x() * q2.w() + q1.y() * q2.z() - q1.z() * q2.y(),
 		q1.w() * q2.y() + q1.y() * q2.w() + q1.z() * q2.x() - q1.x() * q2.z(),
 		q1.w() * q2.z() + q1.z() * q2.w() + q1.x() * q2.y() - q1.y() * q2.x(),
 		q1.w() * q2.w() - q1.x() * q2.x() - q1.y() * q2.y() - q1.z() * q2.z()); 
+#endif
 }
 
 SIMD_FORCE_INLINE btQuaternion
@@ -310,6 +310,11 @@ public:
 	static	void						Start_Profile( const char * name );
 	static	void						Stop_Profile( void );
 
+	///the profile tree is not thread safe. Suspend it before worker threads run code that contains BT_PROFILE
+	///samples, and resume it after they finished. Samples that start while suspended are ignored.
+	static	void						Suspend_Profile( void )		{ SuspendCounter++; }
+	static	void						Resume_Profile( void )		{ SuspendCounter--; }
+
 	static	void						CleanupMemory(void)
 	{
 		Root.CleanupMemory();
@@ -336,6 +341,7 @@ private:
 	static	CProfileNode *			CurrentNode;
 	static	int						FrameCounter;
 	static	unsigned long int					ResetTime;
+	static	int						SuspendCounter;
 };
 
 
@@ -129,9 +129,20 @@ inline int	btGetVersion()
 #else
 	//non-windows systems
 
+///GCC and Clang on x86/x86-64 expose SSE2 through __SSE2__ (always set for x86-64), define BT_NO_SSE to force the scalar path
+#if defined (__SSE2__) && (defined (__GNUC__) || defined (__clang__)) && (!defined (BT_USE_DOUBLE_PRECISION)) && (!defined (BT_NO_SSE))
+		#define BT_USE_SSE
+		#include <emmintrin.h>
+#endif
+
 		#define SIMD_FORCE_INLINE inline
+#ifdef BT_USE_SSE
+		#define ATTRIBUTE_ALIGNED16(a) a __attribute__ ((aligned (16)))
+		#define ATTRIBUTE_ALIGNED128(a) a __attribute__ ((aligned (128)))
+#else
 		#define ATTRIBUTE_ALIGNED16(a) a
 		#define ATTRIBUTE_ALIGNED128(a) a
+#endif
 		#ifndef assert
 		#include <assert.h>
 		#endif
@@ -294,6 +305,21 @@ SIMD_FORCE_INLINE btScalar btFsel(btScalar a, btScalar b, btScalar c)
 #endif
 #define btFsels(a,b,c) (btScalar)btFsel(a,b,c)
 
+#ifdef BT_USE_SSE
+///BT_SHUFFLE builds an _mm_shuffle_ps immediate in x,y,z,w order (lane 0 first)
+#define BT_SHUFFLE(x,y,z,w) ((w)<<6 | (z)<<4 | (y)<<2 | (x))
+#define bt_pshufd_ps( _a, _mask ) _mm_shuffle_ps((_a), (_a), (_mask) )
+#define bt_splat_ps( _a, _i )  bt_pshufd_ps((_a), BT_SHUFFLE(_i,_i,_i,_i) )
+
+///lane masks shared by btVector3 and btQuadWord, xyz keeps the first three lanes and clears w
+#define btv3AbsfMask _mm_castsi128_ps(_mm_set_epi32(0x00000000,0x7fffffff,0x7fffffff,0x7fffffff))
+#define btvxyzMaskf _mm_castsi128_ps(_mm_set_epi32(0x00000000,(int)0xffffffff,(int)0xffffffff,(int)0xffffffff))
+#define btvSignMaskf _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000))
+#define btvWSignMaskf _mm_castsi128_ps(_mm_set_epi32((int)0x80000000,0,0,0))
+#define btvxyzSignMaskf _mm_castsi128_ps(_mm_set_epi32(0,(int)0x80000000,(int)0x80000000,(int)0x80000000))
+#define btvWOnef _mm_set_ps(1.f,0.f,0.f,0.f)
+#endif //BT_USE_SSE
+
 
 SIMD_FORCE_INLINE bool btMachineIsLittleEndian()
 {
@@ -22,15 +22,35 @@ Nov.2006
 
 #include "btScalar.h" //for btAssert
 #include "btAlignedAllocator.h"
+#include "btMinMax.h"
+
+///The btStackAllocChunk class is an internal structure for the btStackAlloc memory allocator.
+struct btStackAllocChunk
+{
+	btStackAllocChunk*	next;
+	unsigned char*		data;
+	unsigned int		size;
+};
 
 ///The btBlock class is an internal structure for the btStackAlloc memory allocator.
 struct btBlock
 {
 	btBlock*			previous;
 	unsigned char*		address;
+	btStackAllocChunk*	chunk;
+	unsigned int		usedsize;
+	unsigned int		base;
 };
 
+///chunk size used when a btStackAlloc is created with size 0
+#define BT_STACK_ALLOC_DEFAULT_CHUNKSIZE (64*1024)
+
 ///The StackAlloc class provides some fast stack-based memory allocator (LIFO last-in first-out)
+///It is a linear arena that grows in chunks: when the current chunk is exhausted the next one is used, or allocated
+///with at least the chunk size passed to create. Chunks are kept until destroy, so once the arena has grown to the peak
+///usage of a frame, later frames allocate no memory. beginBlock/endBlock release memory in LIFO order, reset releases
+///everything in O(1). btDiscreteDynamicsWorld resets the arena of its collision configuration at the end of stepSimulation.
+///A btStackAlloc is not thread-safe, use one per thread.
 class btStackAlloc
 {
 public:
@@ -38,51 +58,113 @@ public:
 	btStackAlloc(unsigned int size)	{ ctor();create(size); }
 	~btStackAlloc()		{ destroy(); }
 	
+	///create sets the chunk size and allocates the first chunk, size 0 uses BT_STACK_ALLOC_DEFAULT_CHUNKSIZE and allocates the first chunk on first use
 	inline void		create(unsigned int size)
 	{
 		destroy();
-		data		=  (unsigned char*) btAlignedAlloc(size,16);
-		totalsize	=	size;
+		chunksize	=	size ? size : BT_STACK_ALLOC_DEFAULT_CHUNKSIZE;
+		if(size)
+		{
+			first	=	addChunk(0,size);
+			chunk	=	first;
+		}
 	}
 	inline void		destroy()
 	{
-		btAssert(usedsize==0);
+		btAssert(usedsize==0 && base==0);
 		//Raise(L"StackAlloc is still in use");
 
-		if(usedsize==0)
+		if(usedsize==0 && base==0)
 		{
-			if(!ischild && data)		
-				btAlignedFree(data);
+			if(!ischild)
+			{
+				while(first)
+				{
+					btStackAllocChunk*	next=first->next;
+					btAlignedFree(first);
+					first=next;
+				}
+			}
 
-			data				=	0;
+			first				=	0;
+			chunk				=	0;
 			usedsize			=	0;
+			totalsize			=	0;
+			numchunks			=	0;
 		}
 		
 	}
 
+	///getAvailableMemory returns the memory left in the allocated chunks, without growing
 	int	getAvailableMemory() const
 	{
-		return static_cast<int>(totalsize - usedsize);
+		unsigned int	available=0;
+		if(chunk)
+		{
+			available=chunk->size-usedsize;
+			for(const btStackAllocChunk* c=chunk->next;c;c=c->next)
+				available+=c->size;
+		}
+		return static_cast<int>(available);
+	}
+
+	///getUsedMemory includes the unused tails of chunks that were skipped because an allocation didn't fit
+	unsigned int	getUsedMemory() const
+	{
+		return base+usedsize;
+	}
+
+	unsigned int	getPeakUsage() const
+	{
+		return peaksize;
+	}
+
+	void	resetPeakUsage()
+	{
+		peaksize	=	getUsedMemory();
+	}
+
+	///getTotalSize returns the size of all chunks
+	unsigned int	getTotalSize() const
+	{
+		return totalsize;
+	}
+
+	int		getNumChunks() const
+	{
+		return numchunks;
 	}
 
+	///allocate returns 16 byte aligned memory, it only returns 0 when btAlignedAlloc fails
 	unsigned char*			allocate(unsigned int size)
 	{
-		const unsigned int	nus(usedsize+size);
-		if(nus<totalsize)
+		size=(size+15)&~15u;
+		if(!chunk || usedsize+size>chunk->size)
 		{
-			usedsize=nus;
-			return(data+(usedsize-size));
+			if(!grow(size))
+			{
+				btAssert(0);
+				//&& (L"Not enough memory"));
+				return(0);
+			}
 		}
-		btAssert(0);
-		//&& (L"Not enough memory"));
-		
-		return(0);
+		unsigned char*	p=chunk->data+usedsize;
+		usedsize+=size;
+		if(base+usedsize>peaksize)
+			peaksize=base+usedsize;
+		return(p);
 	}
 	SIMD_FORCE_INLINE btBlock*		beginBlock()
 	{
+		btStackAllocChunk*	c=chunk;
+		const unsigned int	u=usedsize;
+		const unsigned int	b=base;
 		btBlock*	pb = (btBlock*)allocate(sizeof(btBlock));
 		pb->previous	=	current;
-		pb->address		=	data+usedsize;
+		pb->address		=	chunk->data+usedsize;
+		pb->chunk		=	c;
+		pb->usedsize	=	u;
+		pb->base		=	b;
 		current			=	pb;
 		return(pb);
 	}
@@ -93,22 +175,92 @@ public:
 		if(block==current)
 		{
 			current		=	block->previous;
-			usedsize	=	(unsigned int)((block->address-data)-sizeof(btBlock));
+			chunk		=	block->chunk ? block->chunk : first;
+			usedsize	=	block->usedsize;
+			base		=	block->base;
 		}
 	}
+	///reset releases all allocations and blocks at once, the chunks are kept
+	SIMD_FORCE_INLINE void		reset()
+	{
+		current		=	0;
+		chunk		=	first;
+		usedsize	=	0;
+		base		=	0;
+	}
 
 private:
 	void		ctor()
 	{
-		data		=	0;
+		first		=	0;
+		chunk		=	0;
+		chunksize	=	BT_STACK_ALLOC_DEFAULT_CHUNKSIZE;
 		totalsize	=	0;
 		usedsize	=	0;
+		base		=	0;
+		peaksize	=	0;
+		numchunks	=	0;
 		current		=	0;
 		ischild		=	false;
 	}
-	unsigned char*		data;
+	enum	{ CHUNK_HEADERSIZE = (sizeof(btStackAllocChunk)+15)&~15 };
+	btStackAllocChunk*	addChunk(btStackAllocChunk* previous,unsigned int size)
+	{
+		btStackAllocChunk*	c=(btStackAllocChunk*)btAlignedAlloc(CHUNK_HEADERSIZE+size,16);
+		if(c)
+		{
+			c->data	=	((unsigned char*)c)+CHUNK_HEADERSIZE;
+			c->size	=	size;
+			if(previous)
+			{
+				c->next			=	previous->next;
+				previous->next	=	c;
+			}
+			else
+			{
+				c->next		=	first;
+				first		=	c;
+			}
+			totalsize+=size;
+			++numchunks;
+		}
+		return(c);
+	}
+	///grow moves to the next chunk that can hold size bytes, chunks too small for it are skipped and counted as used
+	bool		grow(unsigned int size)
+	{
+		if(!chunk)
+		{
+			if(!first || first->size<size)
+			{
+				if(!addChunk(0,btMax(chunksize,size)))
+					return(false);
+			}
+			chunk		=	first;
+			usedsize	=	0;
+			return(true);
+		}
+		while(chunk->next && chunk->next->size<size)
+		{
+			base	+=	chunk->size;
+			chunk	=	chunk->next;
+			usedsize=	chunk->size;
+		}
+		if(!chunk->next && !addChunk(chunk,btMax(chunksize,size)))
+			return(false);
+		base		+=	chunk->size;
+		chunk		=	chunk->next;
+		usedsize	=	0;
+		return(true);
+	}
+	btStackAllocChunk*	first;
+	btStackAllocChunk*	chunk;
+	unsigned int		chunksize;
 	unsigned int		totalsize;
 	unsigned int		usedsize;
+	unsigned int		base;
+	unsigned int		peaksize;
+	int					numchunks;
 	btBlock*	current;
 	bool		ischild;
 };
@@ -0,0 +1,663 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btThreadCachingAllocator.h"
+#include "btMinMax.h"
+#include <string.h>
+
+static const char* sTagNames[BT_NUM_ALLOC_TAGS] =
+{
+	"general",
+	"broadphase",
+	"narrowphase",
+	"solver",
+	"softbody",
+	"shapes"
+};
+
+const char*	btThreadCachingAllocator::getTagName(int tag)
+{
+	return (tag>=0 && tag<BT_NUM_ALLOC_TAGS) ? sTagNames[tag] : "unknown";
+}
+
+#ifdef BT_HAS_THREAD_LOCAL
+
+#if defined (_MSC_VER)
+#include <intrin.h>
+
+static SIMD_FORCE_INLINE size_t	btAtomicAdd(volatile size_t* value,size_t delta)
+{
+#ifdef _WIN64
+	return (size_t)_InterlockedExchangeAdd64((volatile __int64*)value,(__int64)delta)+delta;
+#else
+	return (size_t)_InterlockedExchangeAdd((volatile long*)value,(long)delta)+delta;
+#endif
+}
+
+static SIMD_FORCE_INLINE bool	btAtomicCompareExchange(volatile size_t* value,size_t expected,size_t desired)
+{
+#ifdef _WIN64
+	return _InterlockedCompareExchange64((volatile __int64*)value,(__int64)desired,(__int64)expected) == (__int64)expected;
+#else
+	return _InterlockedCompareExchange((volatile long*)value,(long)desired,(long)expected) == (long)expected;
+#endif
+}
+
+static SIMD_FORCE_INLINE long	btAtomicExchange(volatile long* value,long desired)
+{
+	return _InterlockedExchange(value,desired);
+}
+
+static SIMD_FORCE_INLINE void	btAtomicRelease(volatile long* value)
+{
+	_InterlockedExchange(value,0);
+}
+
+static SIMD_FORCE_INLINE void	btAtomicStorePointer(void* volatile* slot,void* value)
+{
+	_InterlockedExchangePointer(slot,value);
+}
+
+#else
+
+static SIMD_FORCE_INLINE size_t	btAtomicAdd(volatile size_t* value,size_t delta)
+{
+	return __sync_add_and_fetch(value,delta);
+}
+
+static SIMD_FORCE_INLINE bool	btAtomicCompareExchange(volatile size_t* value,size_t expected,size_t desired)
+{
+	return __sync_bool_compare_and_swap(value,expected,desired);
+}
+
+static SIMD_FORCE_INLINE long	btAtomicExchange(volatile long* value,long desired)
+{
+	return __sync_lock_test_and_set(value,desired);
+}
+
+static SIMD_FORCE_INLINE void	btAtomicRelease(volatile long* value)
+{
+	__sync_lock_release(value);
+}
+
+static SIMD_FORCE_INLINE void	btAtomicStorePointer(void* volatile* slot,void* value)
+{
+	__sync_synchronize();
+	*slot = value;
+}
+
+#endif
+
+///the central lists and the thread cache registry are only locked for batch transfers, a spin lock is enough
+struct btCacheSpinLock
+{
+	volatile long	m_locked;
+
+	void	lock()
+	{
+		while (btAtomicExchange(&m_locked,1))
+		{
+			while (m_locked)
+			{
+			}
+		}
+	}
+
+	void	unlock()
+	{
+		btAtomicRelease(&m_locked);
+	}
+};
+
+enum
+{
+	///header in front of every block: size class and tag at -16.
+	///Large blocks also store the pointer returned by the system allocator at -32 and their size at -24.
+	CACHE_HEADER_SIZE = 16,
+	CACHE_LARGE_HEADER_SIZE = 32,
+	CACHE_MAX_SMALL_SIZE = 32768,
+	CACHE_SPAN_SIZE = 64*1024,
+	///bytes a thread keeps per size class before it returns half of them to the central list
+	CACHE_THREAD_LIST_BYTES = 32*1024,
+	///bytes and allocations plus frees a thread accumulates per tag before it adds them to the shared counters
+	CACHE_FLUSH_BYTES = 64*1024,
+	CACHE_FLUSH_COUNT = 1024,
+	CACHE_LARGE_CLASS = 0xffff,
+	CACHE_PAGE_SHIFT = 12,
+	CACHE_PAGE_SIZE = 1<<CACHE_PAGE_SHIFT,
+	///the page map has three levels of 4096 entries, enough for the pages of 48 bit addresses
+	CACHE_PAGE_MAP_BITS = 12,
+	CACHE_PAGE_MAP_SIZE = 1<<CACHE_PAGE_MAP_BITS
+};
+
+///16 byte steps up to 128, then 4 classes per power of two
+static const unsigned int sClassSizes[] =
+{
+	16,32,48,64,80,96,112,128,
+	160,192,224,256,
+	320,384,448,512,
+	640,768,896,1024,
+	1280,1536,1792,2048,
+	2560,3072,3584,4096,
+	5120,6144,7168,8192,
+	10240,12288,14336,16384,
+	20480,24576,28672,32768
+};
+
+#define CACHE_NUM_CLASSES ((int)(sizeof(sClassSizes)/sizeof(sClassSizes[0])))
+
+///size class of every multiple of 16 bytes up to CACHE_MAX_SMALL_SIZE
+static unsigned char	sClassIndex[CACHE_MAX_SMALL_SIZE/16+1];
+static int				sMaxThreadCount[CACHE_NUM_CLASSES];
+static bool				sInitialized = false;
+
+static void* (*sSystemAlloc)(size_t size) = 0;
+static void (*sSystemFree)(void* ptr) = 0;
+
+struct btCentralList
+{
+	btCacheSpinLock	m_lock;
+	void*			m_head;
+	int				m_count;
+	///one list per cache line, so threads refilling different size classes don't share one
+	char			m_padding[64-sizeof(btCacheSpinLock)-sizeof(void*)-sizeof(int)];
+};
+
+static btCentralList	sCentralLists[CACHE_NUM_CLASSES];
+
+struct btTagCounters
+{
+	volatile size_t	m_liveBytes;
+	volatile size_t	m_peakBytes;
+	volatile size_t	m_numAllocs;
+	volatile size_t	m_numFrees;
+};
+
+static btTagCounters	sTagCounters[BT_NUM_ALLOC_TAGS];
+static volatile size_t	sReservedBytes = 0;
+
+///the page map marks the pages that lie completely inside a span or the system block of a large block. Spans stay marked,
+///large blocks are unmarked before they are freed. Nodes are only added, under sPageMapLock, so lookups don't lock.
+struct btPageMapNode
+{
+	void* volatile	m_children[CACHE_PAGE_MAP_SIZE];
+};
+
+static void* volatile	sPageMap[CACHE_PAGE_MAP_SIZE];
+static btCacheSpinLock	sPageMapLock;
+
+static void*	btCreatePageMapNode(void* volatile* slot,size_t size)
+{
+	sPageMapLock.lock();
+	void* node = *slot;
+	if (!node)
+	{
+		node = sSystemAlloc(size);
+		if (node)
+		{
+			memset(node,0,size);
+			btAtomicAdd(&sReservedBytes,size);
+			btAtomicStorePointer(slot,node);
+		}
+	}
+	sPageMapLock.unlock();
+	return node;
+}
+
+///returns the map entry of a page, or 0 if it doesn't exist and create is false
+static unsigned char*	btGetPageEntry(size_t page,bool create)
+{
+	const size_t mask = CACHE_PAGE_MAP_SIZE-1;
+	const size_t rootIndex = page>>(2*CACHE_PAGE_MAP_BITS);
+	if (rootIndex >= CACHE_PAGE_MAP_SIZE)
+		return 0;
+	btPageMapNode* node = (btPageMapNode*)sPageMap[rootIndex];
+	if (!node)
+	{
+		if (!create)
+			return 0;
+		node = (btPageMapNode*)btCreatePageMapNode(&sPageMap[rootIndex],sizeof(btPageMapNode));
+		if (!node)
+			return 0;
+	}
+	void* volatile* leafSlot = &node->m_children[(page>>CACHE_PAGE_MAP_BITS)&mask];
+	unsigned char* leaf = (unsigned char*)*leafSlot;
+	if (!leaf)
+	{
+		if (!create)
+			return 0;
+		leaf = (unsigned char*)btCreatePageMapNode(leafSlot,CACHE_PAGE_MAP_SIZE);
+		if (!leaf)
+			return 0;
+	}
+	return &leaf[page&mask];
+}
+
+///marks or unmarks the pages that contain [begin,begin+size). Marking fails if the map can't hold the pages.
+static bool	btSetPagesOwned(const char* begin,size_t size,bool owned)
+{
+	const size_t first = (size_t)begin>>CACHE_PAGE_SHIFT;
+	const size_t last = ((size_t)begin+size-1)>>CACHE_PAGE_SHIFT;
+	for (size_t page=first;page<=last;page++)
+	{
+		unsigned char* entry = btGetPageEntry(page,owned);
+		if (entry)
+		{
+			*entry = owned ? 1 : 0;
+		} else if (owned)
+		{
+			if (page>first)
+				btSetPagesOwned(begin,(page-first)<<CACHE_PAGE_SHIFT,false);
+			return false;
+		}
+	}
+	return true;
+}
+
+struct btThreadCacheList
+{
+	void*	m_head;
+	int		m_count;
+};
+
+struct btThreadCache
+{
+	btThreadCacheList	m_lists[CACHE_NUM_CLASSES];
+	ptrdiff_t			m_liveDelta[BT_NUM_ALLOC_TAGS];
+	size_t				m_numAllocs[BT_NUM_ALLOC_TAGS];
+	size_t				m_numFrees[BT_NUM_ALLOC_TAGS];
+	btThreadCache*		m_nextFree;
+};
+
+static btCacheSpinLock	sThreadCacheLock;
+static btThreadCache*	sFreeThreadCaches = 0;
+
+static BT_THREAD_LOCAL btThreadCache*	sThreadCache = 0;
+static BT_THREAD_LOCAL int				sThreadTag = BT_ALLOC_TAG_GENERAL;
+
+bool	btThreadCachingAllocator::init(void* (*allocFunc)(size_t size),void (*freeFunc)(void* ptr))
+{
+	sSystemAlloc = allocFunc;
+	sSystemFree = freeFunc;
+	if (!sInitialized)
+	{
+		int c = 0;
+		for (int i=0;i<=CACHE_MAX_SMALL_SIZE/16;i++)
+		{
+			while (sClassSizes[c] < (unsigned int)i*16)
+				c++;
+			sClassIndex[i] = (unsigned char)c;
+		}
+		for (c=0;c<CACHE_NUM_CLASSES;c++)
+		{
+			sMaxThreadCount[c] = btMax(4,(int)(CACHE_THREAD_LIST_BYTES/sClassSizes[c]));
+		}
+		sInitialized = true;
+	}
+	return true;
+}
+
+static btThreadCache*	btGetThreadCache()
+{
+	btThreadCache* cache = sThreadCache;
+	if (!cache)
+	{
+		sThreadCacheLock.lock();
+		cache = sFreeThreadCaches;
+		if (cache)
+			sFreeThreadCaches = cache->m_nextFree;
+		sThreadCacheLock.unlock();
+		if (!cache)
+		{
+			cache = (btThreadCache*)sSystemAlloc(sizeof(btThreadCache));
+			if (!cache)
+				return 0;
+			memset(cache,0,sizeof(btThreadCache));
+		}
+		sThreadCache = cache;
+	}
+	return cache;
+}
+
+static void	btFlushTag(btThreadCache* cache,int tag)
+{
+	btTagCounters& counters = sTagCounters[tag];
+	const size_t live = btAtomicAdd(&counters.m_liveBytes,(size_t)cache->m_liveDelta[tag]);
+	size_t peak = counters.m_peakBytes;
+	while (((ptrdiff_t)live > (ptrdiff_t)peak) && !btAtomicCompareExchange(&counters.m_peakBytes,peak,live))
+	{
+		peak = counters.m_peakBytes;
+	}
+	btAtomicAdd(&counters.m_numAllocs,cache->m_numAllocs[tag]);
+	btAtomicAdd(&counters.m_numFrees,cache->m_numFrees[tag]);
+	cache->m_liveDelta[tag] = 0;
+	cache->m_numAllocs[tag] = 0;
+	cache->m_numFrees[tag] = 0;
+}
+
+static SIMD_FORCE_INLINE void	btAccountAlloc(btThreadCache* cache,int tag,size_t size)
+{
+	cache->m_liveDelta[tag] += (ptrdiff_t)size;
+	cache->m_numAllocs[tag]++;
+	if (cache->m_liveDelta[tag] >= CACHE_FLUSH_BYTES || cache->m_numAllocs[tag]+cache->m_numFrees[tag] >= CACHE_FLUSH_COUNT)
+		btFlushTag(cache,tag);
+}
+
+static SIMD_FORCE_INLINE void	btAccountFree(btThreadCache* cache,int tag,size_t size)
+{
+	cache->m_liveDelta[tag] -= (ptrdiff_t)size;
+	cache->m_numFrees[tag]++;
+	if (cache->m_liveDelta[tag] <= -CACHE_FLUSH_BYTES || cache->m_numAllocs[tag]+cache->m_numFrees[tag] >= CACHE_FLUSH_COUNT)
+		btFlushTag(cache,tag);
+}
+
+///moves count blocks from the head of the thread list to the central list
+static void	btReleaseBlocks(btThreadCacheList& list,int sizeClass,int count)
+{
+	void* first = list.m_head;
+	void* last = first;
+	for (int i=1;i<count;i++)
+		last = *(void**)last;
+	list.m_head = *(void**)last;
+	list.m_count -= count;
+
+	btCentralList& central = sCentralLists[sizeClass];
+	central.m_lock.lock();
+	*(void**)last = central.m_head;
+	central.m_head = first;
+	central.m_count += count;
+	central.m_lock.unlock();
+}
+
+///takes a batch of blocks from the central list, carving a new span when it is empty
+static bool	btRefillList(btThreadCacheList& list,int sizeClass)
+{
+	const int batch = btMax(1,sMaxThreadCount[sizeClass]/2);
+	btCentralList& central = sCentralLists[sizeClass];
+
+	central.m_lock.lock();
+	if (central.m_head)
+	{
+		void* first = central.m_head;
+		void* last = first;
+		int count = 1;
+		while (count<batch && *(void**)last)
+		{
+			last = *(void**)last;
+			count++;
+		}
+		central.m_head = *(void**)last;
+		central.m_count -= count;
+		central.m_lock.unlock();
+		*(void**)last = list.m_head;
+		list.m_head = first;
+		list.m_count += count;
+		return true;
+	}
+	central.m_lock.unlock();
+
+	//spans are page aligned, so all of their pages can be marked as owned
+	const size_t blockSize = sClassSizes[sizeClass]+CACHE_HEADER_SIZE;
+	const size_t spanSize = (btMax((size_t)CACHE_SPAN_SIZE,blockSize*4)+CACHE_PAGE_SIZE-1)&~(size_t)(CACHE_PAGE_SIZE-1);
+	char* span = (char*)sSystemAlloc(spanSize+CACHE_PAGE_SIZE-1);
+	if (!span)
+		return false;
+	char* block = (char*)(((size_t)span+CACHE_PAGE_SIZE-1)&~(size_t)(CACHE_PAGE_SIZE-1));
+	if (!btSetPagesOwned(block,spanSize,true))
+	{
+		btAssert(0);
+		sSystemFree(span);
+		return false;
+	}
+	btAtomicAdd(&sReservedBytes,spanSize+CACHE_PAGE_SIZE-1);
+	const int numBlocks = (int)(spanSize/blockSize);
+
+	//link the blocks in address order, the first batch goes to the thread, the rest to the central list
+	for (int i=0;i<numBlocks-1;i++)
+		*(void**)(block+i*blockSize) = block+(i+1)*blockSize;
+	const int numThread = btMin(batch,numBlocks);
+	void* lastThread = block+(numThread-1)*blockSize;
+	void* restFirst = *(void**)lastThread;
+	*(void**)lastThread = list.m_head;
+	list.m_head = block;
+	list.m_count += numThread;
+	if (numThread<numBlocks)
+	{
+		void* restLast = block+(numBlocks-1)*blockSize;
+		central.m_lock.lock();
+		*(void**)restLast = central.m_head;
+		central.m_head = restFirst;
+		central.m_count += numBlocks-numThread;
+		central.m_lock.unlock();
+	}
+	return true;
+}
+
+void*	btThreadCachingAllocator::allocate(size_t size,int alignment)
+{
+	btThreadCache* cache = btGetThreadCache();
+	if (!cache)
+		return 0;
+	const int tag = sThreadTag;
+
+	if (size<=CACHE_MAX_SMALL_SIZE && alignment<=16)
+	{
+		const int sizeClass = sClassIndex[(size+15)>>4];
+		btThreadCacheList& list = cache->m_lists[sizeClass];
+		if (!list.m_head && !btRefillList(list,sizeClass))
+			return 0;
+		char* block = (char*)list.m_head;
+		list.m_head = *(void**)block;
+		list.m_count--;
+
+		unsigned short* header = (unsigned short*)block;
+		header[0] = (unsigned short)sizeClass;
+		header[1] = (unsigned short)tag;
+		btAccountAlloc(cache,tag,sClassSizes[sizeClass]);
+		return block+CACHE_HEADER_SIZE;
+	}
+
+	//the block starts in the first page that lies completely inside the system block, only that page is marked as owned
+	const size_t align = alignment>16 ? (size_t)alignment : 16;
+	const size_t realSize = CACHE_PAGE_SIZE-1+CACHE_LARGE_HEADER_SIZE+align-1+btMax(size,(size_t)CACHE_PAGE_SIZE);
+	char* real = (char*)sSystemAlloc(realSize);
+	if (!real)
+		return 0;
+	const size_t firstPage = ((size_t)real+CACHE_PAGE_SIZE-1)&~(size_t)(CACHE_PAGE_SIZE-1);
+	char* ptr = (char*)((firstPage+CACHE_LARGE_HEADER_SIZE+align-1)&~(align-1));
+	if (!btSetPagesOwned(ptr,1,true))
+	{
+		btAssert(0);
+		sSystemFree(real);
+		return 0;
+	}
+	((void**)(ptr-32))[0] = real;
+	*(size_t*)(ptr-24) = size;
+	unsigned short* header = (unsigned short*)(ptr-CACHE_HEADER_SIZE);
+	header[0] = (unsigned short)CACHE_LARGE_CLASS;
+	header[1] = (unsigned short)tag;
+	btAtomicAdd(&sReservedBytes,size);
+	btAccountAlloc(cache,tag,size);
+	return ptr;
+}
+
+void	btThreadCachingAllocator::deallocate(void* ptr)
+{
+	btAssert(isCachedBlock(ptr));
+	char* block = (char*)ptr-CACHE_HEADER_SIZE;
+	const unsigned short* header = (const unsigned short*)block;
+	const int sizeClass = header[0];
+	const int tag = header[1];
+	btThreadCache* cache = btGetThreadCache();
+
+	if (sizeClass == CACHE_LARGE_CLASS)
+	{
+		void* real = ((void**)((char*)ptr-32))[0];
+		const size_t size = *(size_t*)((char*)ptr-24);
+		btAtomicAdd(&sReservedBytes,(size_t)0-size);
+		if (cache)
+			btAccountFree(cache,tag,size);
+		btSetPagesOwned((char*)ptr,1,false);
+		sSystemFree(real);
+		return;
+	}
+
+	if (!cache)
+	{
+		//no thread cache, hand the block to the central list directly
+		btCentralList& central = sCentralLists[sizeClass];
+		central.m_lock.lock();
+		*(void**)block = central.m_head;
+		central.m_head = block;
+		central.m_count++;
+		central.m_lock.unlock();
+		return;
+	}
+	btThreadCacheList& list = cache->m_lists[sizeClass];
+	*(void**)block = list.m_head;
+	list.m_head = block;
+	list.m_count++;
+	if (list.m_count > sMaxThreadCount[sizeClass])
+		btReleaseBlocks(list,sizeClass,list.m_count/2);
+	btAccountFree(cache,tag,sClassSizes[sizeClass]);
+}
+
+bool	btThreadCachingAllocator::isCachedBlock(const void* ptr)
+{
+	const unsigned char* entry = btGetPageEntry((size_t)ptr>>CACHE_PAGE_SHIFT,false);
+	return entry && *entry;
+}
+
+void	btThreadCachingAllocator::releaseThreadCache()
+{
+	btThreadCache* cache = sThreadCache;
+	if (!cache)
+		return;
+	int i;
+	for (i=0;i<BT_NUM_ALLOC_TAGS;i++)
+		btFlushTag(cache,i);
+	for (i=0;i<CACHE_NUM_CLASSES;i++)
+	{
+		if (cache->m_lists[i].m_count)
+			btReleaseBlocks(cache->m_lists[i],i,cache->m_lists[i].m_count);
+	}
+	sThreadCache = 0;
+	sThreadCacheLock.lock();
+	cache->m_nextFree = sFreeThreadCaches;
+	sFreeThreadCaches = cache;
+	sThreadCacheLock.unlock();
+}
+
+int		btThreadCachingAllocator::setThreadTag(int tag)
+{
+	btAssert(tag>=0 && tag<BT_NUM_ALLOC_TAGS);
+	const int previousTag = sThreadTag;
+	sThreadTag = tag;
+	return previousTag;
+}
+
+int		btThreadCachingAllocator::getThreadTag()
+{
+	return sThreadTag;
+}
+
+void	btThreadCachingAllocator::getTagStats(int tag,btAllocTagStats& stats)
+{
+	btAssert(tag>=0 && tag<BT_NUM_ALLOC_TAGS);
+	if (sThreadCache)
+		btFlushTag(sThreadCache,tag);
+	const btTagCounters& counters = sTagCounters[tag];
+	const size_t live = counters.m_liveBytes;
+	stats.m_liveBytes = ((ptrdiff_t)live > 0) ? live : 0;
+	stats.m_peakBytes = counters.m_peakBytes;
+	stats.m_numAllocs = counters.m_numAllocs;
+	stats.m_numFrees = counters.m_numFrees;
+}
+
+void	btThreadCachingAllocator::resetTagPeaks()
+{
+	for (int i=0;i<BT_NUM_ALLOC_TAGS;i++)
+	{
+		if (sThreadCache)
+			btFlushTag(sThreadCache,i);
+		sTagCounters[i].m_peakBytes = sTagCounters[i].m_liveBytes;
+	}
+}
+
+size_t	btThreadCachingAllocator::getReservedBytes()
+{
+	return sReservedBytes;
+}
+
+#else //BT_HAS_THREAD_LOCAL
+
+bool	btThreadCachingAllocator::init(void* (*allocFunc)(size_t size),void (*freeFunc)(void* ptr))
+{
+	(void)allocFunc;
+	(void)freeFunc;
+	return false;
+}
+
+void*	btThreadCachingAllocator::allocate(size_t size,int alignment)
+{
+	(void)size;
+	(void)alignment;
+	btAssert(0);
+	return 0;
+}
+
+void	btThreadCachingAllocator::deallocate(void* ptr)
+{
+	(void)ptr;
+	btAssert(0);
+}
+
+bool	btThreadCachingAllocator::isCachedBlock(const void* ptr)
+{
+	(void)ptr;
+	return false;
+}
+
+void	btThreadCachingAllocator::releaseThreadCache()
+{
+}
+
+int		btThreadCachingAllocator::setThreadTag(int tag)
+{
+	(void)tag;
+	return BT_ALLOC_TAG_GENERAL;
+}
+
+int		btThreadCachingAllocator::getThreadTag()
+{
+	return BT_ALLOC_TAG_GENERAL;
+}
+
+void	btThreadCachingAllocator::getTagStats(int tag,btAllocTagStats& stats)
+{
+	(void)tag;
+	memset(&stats,0,sizeof(stats));
+}
+
+void	btThreadCachingAllocator::resetTagPeaks()
+{
+}
+
+size_t	btThreadCachingAllocator::getReservedBytes()
+{
+	return 0;
+}
+
+#endif //BT_HAS_THREAD_LOCAL
@@ -0,0 +1,122 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_THREAD_CACHING_ALLOCATOR_H
+#define BT_THREAD_CACHING_ALLOCATOR_H
+
+#include "btScalar.h"
+#include <stddef.h>
+
+///BT_HAS_THREAD_LOCAL is defined when the compiler supports thread local variables. Without them btAlignedAllocSetThreadCaching
+///has no effect and the allocation tags are ignored.
+#if defined (_MSC_VER)
+	#define BT_THREAD_LOCAL __declspec(thread)
+	#define BT_HAS_THREAD_LOCAL 1
+#elif defined (__APPLE__)
+	#if defined (__clang__) && defined (__has_feature)
+		#if __has_feature(tls)
+			#define BT_THREAD_LOCAL __thread
+			#define BT_HAS_THREAD_LOCAL 1
+		#endif
+	#endif
+#elif defined (__GNUC__) && !defined (__CELLOS_LV2__) && !defined (__SPU__)
+	#define BT_THREAD_LOCAL __thread
+	#define BT_HAS_THREAD_LOCAL 1
+#endif
+
+///subsystems that allocations are accounted to, see BT_ALLOC_TAG_SCOPE
+enum btAllocTag
+{
+	BT_ALLOC_TAG_GENERAL = 0,
+	BT_ALLOC_TAG_BROADPHASE,
+	BT_ALLOC_TAG_NARROWPHASE,
+	BT_ALLOC_TAG_SOLVER,
+	BT_ALLOC_TAG_SOFTBODY,
+	BT_ALLOC_TAG_SHAPES,
+	BT_NUM_ALLOC_TAGS
+};
+
+struct btAllocTagStats
+{
+	///bytes of the blocks that are allocated and not yet freed, small blocks count with the size of their size class
+	size_t	m_liveBytes;
+	size_t	m_peakBytes;
+	size_t	m_numAllocs;
+	size_t	m_numFrees;
+};
+
+///The btThreadCachingAllocator is the allocator behind btAlignedAlloc after btAlignedAllocSetThreadCaching(true).
+///Small blocks (up to 32KB and 16 byte alignment) come from per-thread free lists, one per size class, so threads don't contend
+///on a lock for most allocations. The lists exchange blocks in batches with a central list per size class, which is refilled
+///from 64KB spans of the btAlignedAllocSetCustom functions. Spans are kept until the process exits. Larger blocks go to the
+///btAlignedAllocSetCustom functions directly.
+///The allocator keeps a map of the 4KB pages its spans and large blocks occupy, so isCachedBlock tells its blocks from blocks of
+///any other allocator without reading their memory. The map covers 48 bit addresses, allocations outside of it fail.
+///Every block is accounted to the tag of the allocating thread, set with BT_ALLOC_TAG_SCOPE. The thread supports of
+///BulletMultiThreaded run each task and parallelFor chunk with the tag of the thread that sent it. Threads add their counts to the
+///shared counters when a tag changed by 64KB or after 1024 allocations and frees, so getTagStats can miss up to 64KB and
+///1024 calls per tag for every other thread.
+class btThreadCachingAllocator
+{
+public:
+
+	///called by btAlignedAllocSetThreadCaching. Returns false if the allocator is not available on this platform.
+	static bool		init(void* (*allocFunc)(size_t size),void (*freeFunc)(void* ptr));
+
+	static void*	allocate(size_t size,int alignment);
+
+	static void		deallocate(void* ptr);
+
+	///returns true for blocks returned by allocate and not yet deallocated. ptr can be any pointer, only the page map is read.
+	static bool		isCachedBlock(const void* ptr);
+
+	///moves the blocks cached by the calling thread to the central lists. Worker threads call this before they exit,
+	///the cache of a thread that exits without it stays allocated.
+	static void		releaseThreadCache();
+
+	///sets the tag of the allocations of the calling thread and returns the previous tag
+	static int		setThreadTag(int tag);
+
+	static int		getThreadTag();
+
+	static void		getTagStats(int tag,btAllocTagStats& stats);
+
+	///sets the peak of every tag to its current live bytes
+	static void		resetTagPeaks();
+
+	static const char*	getTagName(int tag);
+
+	///bytes allocated for spans, large blocks and the page map
+	static size_t	getReservedBytes();
+};
+
+///btAllocTagScope sets the allocation tag of the calling thread for its lifetime, see BT_ALLOC_TAG_SCOPE
+class btAllocTagScope
+{
+	int	m_previousTag;
+public:
+	btAllocTagScope(int tag)
+	{
+		m_previousTag = btThreadCachingAllocator::setThreadTag(tag);
+	}
+	~btAllocTagScope()
+	{
+		btThreadCachingAllocator::setThreadTag(m_previousTag);
+	}
+};
+
+#define BT_ALLOC_TAG_SCOPE( tag ) btAllocTagScope __allocTagScope( tag )
+
+#endif //BT_THREAD_CACHING_ALLOCATOR_H
@@ -81,9 +81,14 @@ public:
 /**@brief Return the transform of the vector */
 	SIMD_FORCE_INLINE btVector3 operator()(const btVector3& x) const
 	{
+#ifdef BT_USE_SSE
+		__m128 r = btMat3Dot3_128(m_basis[0].mVec128, m_basis[1].mVec128, m_basis[2].mVec128, x.mVec128);
+		return btVector3(_mm_and_ps(_mm_add_ps(r, m_origin.mVec128), btvxyzMaskf));
+#else
 		return btVector3(m_basis[0].dot(x) + m_origin.x(), 
 			m_basis[1].dot(x) + m_origin.y(), 
 			m_basis[2].dot(x) + m_origin.z());
+#endif
 	}
 
   /**@brief Return the transform of the vector */
@@ -209,7 +214,12 @@ SIMD_FORCE_INLINE btVector3
 btTransform::invXform(const btVector3& inVec) const
 {
 	btVector3 v = inVec - m_origin;
+#ifdef BT_USE_SSE
+	//transpose() * v without building the transpose
+	return v * m_basis;
+#else
 	return (m_basis.transpose() * v);
+#endif
 }
 
 SIMD_FORCE_INLINE btTransform 
@@ -0,0 +1,195 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btVector3.h"
+#include "btCpuFeatureUtility.h"
+
+///Support vertex search for convex hulls and point clouds.
+///All variants evaluate every dot product as (x*dx + y*dy) + z*dz, like btVector3::dot, and return the first index on ties,
+///so they give identical results. minDot is maxDot along the negated direction, which is exact.
+
+typedef long (*btMaxDotKernel)(const btVector3& dir, const btVector3* array, long array_count, btScalar& dotOut);
+
+static long	btMaxDotScalar(const btVector3& dir, const btVector3* array, long array_count, btScalar& dotOut)
+{
+	btScalar maxDot = -SIMD_INFINITY;
+	long ptIndex = -1;
+	for (long i=0;i<array_count;i++)
+	{
+		btScalar dot = dir.dot(array[i]);
+		if (dot > maxDot)
+		{
+			maxDot = dot;
+			ptIndex = i;
+		}
+	}
+	dotOut = maxDot;
+	return ptIndex;
+}
+
+#ifdef BT_USE_SSE
+
+///pick the best lane, ties go to the lowest index, then finish the tail with the scalar loop
+static long	btMaxDotReduce(const btScalar* lanes, const int* laneIndex, int numLanes, const btVector3& dir, const btVector3* array, long start, long array_count, btScalar& dotOut)
+{
+	btScalar maxDot = -SIMD_INFINITY;
+	long ptIndex = -1;
+	for (int l=0;l<numLanes;l++)
+	{
+		if (laneIndex[l] < 0)
+			continue;
+		if ((lanes[l] > maxDot) || ((lanes[l] == maxDot) && (laneIndex[l] < ptIndex)))
+		{
+			maxDot = lanes[l];
+			ptIndex = laneIndex[l];
+		}
+	}
+	for (long i=start;i<array_count;i++)
+	{
+		btScalar dot = dir.dot(array[i]);
+		if (dot > maxDot)
+		{
+			maxDot = dot;
+			ptIndex = i;
+		}
+	}
+	dotOut = maxDot;
+	return ptIndex;
+}
+
+static long	btMaxDotSSE2(const btVector3& dir, const btVector3* array, long array_count, btScalar& dotOut)
+{
+	const __m128 dx = bt_splat_ps(dir.get128(), 0);
+	const __m128 dy = bt_splat_ps(dir.get128(), 1);
+	const __m128 dz = bt_splat_ps(dir.get128(), 2);
+	__m128 best = _mm_set1_ps(-SIMD_INFINITY);
+	__m128i bestIndex = _mm_set1_epi32(-1);
+	__m128i index = _mm_set_epi32(3,2,1,0);
+	const __m128i four = _mm_set1_epi32(4);
+
+	long i=0;
+	for (;i+4<=array_count;i+=4)
+	{
+		//transpose four vectors into x, y and z registers
+		__m128 t0 = _mm_unpacklo_ps(array[i].get128(), array[i+1].get128());
+		__m128 t1 = _mm_unpackhi_ps(array[i].get128(), array[i+1].get128());
+		__m128 t2 = _mm_unpacklo_ps(array[i+2].get128(), array[i+3].get128());
+		__m128 t3 = _mm_unpackhi_ps(array[i+2].get128(), array[i+3].get128());
+		__m128 x = _mm_movelh_ps(t0, t2);
+		__m128 y = _mm_movehl_ps(t2, t0);
+		__m128 z = _mm_movelh_ps(t1, t3);
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, dx), _mm_mul_ps(y, dy)), _mm_mul_ps(z, dz));
+		__m128 greater = _mm_cmpgt_ps(dot, best);
+		best = _mm_or_ps(_mm_and_ps(greater, dot), _mm_andnot_ps(greater, best));
+		__m128i greaterInt = _mm_castps_si128(greater);
+		bestIndex = _mm_or_si128(_mm_and_si128(greaterInt, index), _mm_andnot_si128(greaterInt, bestIndex));
+		index = _mm_add_epi32(index, four);
+	}
+
+	ATTRIBUTE_ALIGNED16(btScalar lanes[4]);
+	ATTRIBUTE_ALIGNED16(int laneIndex[4]);
+	_mm_store_ps(lanes, best);
+	_mm_store_si128((__m128i*)laneIndex, bestIndex);
+	return btMaxDotReduce(lanes, laneIndex, 4, dir, array, i, array_count, dotOut);
+}
+
+#ifdef BT_ALLOW_AVX2
+BT_TARGET_AVX2_NO_FMA static long	btMaxDotAVX2(const btVector3& dir, const btVector3* array, long array_count, btScalar& dotOut)
+{
+	const __m256 dx = _mm256_set1_ps(dir.x());
+	const __m256 dy = _mm256_set1_ps(dir.y());
+	const __m256 dz = _mm256_set1_ps(dir.z());
+	__m256 best = _mm256_set1_ps(-SIMD_INFINITY);
+	__m256i bestIndex = _mm256_set1_epi32(-1);
+	//the in-lane transpose puts the even vectors in the low half and the odd vectors in the high half
+	__m256i index = _mm256_set_epi32(7,5,3,1,6,4,2,0);
+	const __m256i eight = _mm256_set1_epi32(8);
+
+	long i=0;
+	for (;i+8<=array_count;i+=8)
+	{
+		const btScalar* p = &array[i].x();
+		__m256 a01 = _mm256_loadu_ps(p);
+		__m256 a23 = _mm256_loadu_ps(p+8);
+		__m256 a45 = _mm256_loadu_ps(p+16);
+		__m256 a67 = _mm256_loadu_ps(p+24);
+		__m256 t0 = _mm256_unpacklo_ps(a01, a23);
+		__m256 t1 = _mm256_unpackhi_ps(a01, a23);
+		__m256 t2 = _mm256_unpacklo_ps(a45, a67);
+		__m256 t3 = _mm256_unpackhi_ps(a45, a67);
+		__m256 x = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1,0,1,0));
+		__m256 y = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3,2,3,2));
+		__m256 z = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1,0,1,0));
+		__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, dx), _mm256_mul_ps(y, dy)), _mm256_mul_ps(z, dz));
+		__m256 greater = _mm256_cmp_ps(dot, best, _CMP_GT_OQ);
+		best = _mm256_blendv_ps(best, dot, greater);
+		bestIndex = _mm256_blendv_epi8(bestIndex, index, _mm256_castps_si256(greater));
+		index = _mm256_add_epi32(index, eight);
+	}
+
+	ATTRIBUTE_ALIGNED16(btScalar lanes[8]);
+	ATTRIBUTE_ALIGNED16(int laneIndex[8]);
+	_mm256_storeu_ps(lanes, best);
+	_mm256_storeu_si256((__m256i*)laneIndex, bestIndex);
+	_mm256_zeroupper();
+	return btMaxDotReduce(lanes, laneIndex, 8, dir, array, i, array_count, dotOut);
+}
+#endif //BT_ALLOW_AVX2
+
+#endif //BT_USE_SSE
+
+static btMaxDotKernel	btSelectMaxDotKernel()
+{
+	int available = 1 << btCpuFeatureUtility::BT_SIMD_SCALAR;
+#ifdef BT_USE_SSE
+	available |= 1 << btCpuFeatureUtility::BT_SIMD_SSE2;
+#ifdef BT_ALLOW_AVX2
+	available |= 1 << btCpuFeatureUtility::BT_SIMD_AVX2;
+#endif
+#endif
+	switch (btCpuFeatureUtility::selectSimdVariant(available))
+	{
+#ifdef BT_USE_SSE
+	case btCpuFeatureUtility::BT_SIMD_SSE2:
+		return btMaxDotSSE2;
+#ifdef BT_ALLOW_AVX2
+	case btCpuFeatureUtility::BT_SIMD_AVX2:
+		return btMaxDotAVX2;
+#endif
+#endif
+	default:
+		break;
+	};
+	return btMaxDotScalar;
+}
+
+static btMaxDotKernel	gMaxDotKernel = 0;
+
+long	btVector3::maxDot(const btVector3* array, long array_count, btScalar& dotOut) const
+{
+	if (!gMaxDotKernel)
+	{
+		gMaxDotKernel = btSelectMaxDotKernel();
+	}
+	return gMaxDotKernel(*this, array, array_count, dotOut);
+}
+
+long	btVector3::minDot(const btVector3* array, long array_count, btScalar& dotOut) const
+{
+	btScalar negDot;
+	long ptIndex = (-*this).maxDot(array, array_count, negDot);
+	dotOut = -negDot;
+	return ptIndex;
+}
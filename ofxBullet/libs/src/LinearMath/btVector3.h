@@ -18,7 +18,6 @@ subject to the following restrictions:
 #define SIMD__VECTOR3_H
 
 
-#include "btScalar.h"
 #include "btScalar.h"
 #include "btMinMax.h"
 /**@brief btVector3 can be used to represent 3D points and vectors.
@@ -42,7 +41,7 @@ public:
 	}
 public:
 #else //__CELLOS_LV2__ __SPU__
-#ifdef BT_USE_SSE // WIN32
+#ifdef BT_USE_SSE // WIN32, GCC/Clang with SSE2
 	union {
 		__m128 mVec128;
 		btScalar	m_floats[4];
@@ -80,13 +79,24 @@ public:
 		m_floats[3] = btScalar(0.);
 	}
 
+#ifdef BT_USE_SSE
+  /**@brief Constructor from a SIMD register, the w lane is taken as is */
+	SIMD_FORCE_INLINE btVector3(__m128 v128)
+	{
+		mVec128 = v128;
+	}
+#endif //BT_USE_SSE
 	
 /**@brief Add a vector to this one 
  * @param The vector to add to this one */
 	SIMD_FORCE_INLINE btVector3& operator+=(const btVector3& v)
 	{
-
+#ifdef BT_USE_SSE
+		//the w lane of this vector is left untouched, like the scalar version
+		mVec128 = _mm_add_ps(mVec128, _mm_and_ps(v.mVec128, btvxyzMaskf));
+#else
 		m_floats[0] += v.m_floats[0]; m_floats[1] += v.m_floats[1];m_floats[2] += v.m_floats[2];
+#endif
 		return *this;
 	}
 
@@ -95,14 +105,24 @@ public:
    * @param The vector to subtract */
 	SIMD_FORCE_INLINE btVector3& operator-=(const btVector3& v) 
 	{
+#ifdef BT_USE_SSE
+		mVec128 = _mm_sub_ps(mVec128, _mm_and_ps(v.mVec128, btvxyzMaskf));
+#else
 		m_floats[0] -= v.m_floats[0]; m_floats[1] -= v.m_floats[1];m_floats[2] -= v.m_floats[2];
+#endif
 		return *this;
 	}
   /**@brief Scale the vector
    * @param s Scale factor */
 	SIMD_FORCE_INLINE btVector3& operator*=(const btScalar& s)
 	{
+#ifdef BT_USE_SSE
+		//scale w by one so it is preserved
+		__m128 vs = _mm_set_ps(1.f, s, s, s);
+		mVec128 = _mm_mul_ps(mVec128, vs);
+#else
 		m_floats[0] *= s; m_floats[1] *= s;m_floats[2] *= s;
+#endif
 		return *this;
 	}
 
@@ -118,7 +138,15 @@ public:
    * @param v The other vector in the dot product */
 	SIMD_FORCE_INLINE btScalar dot(const btVector3& v) const
 	{
+#ifdef BT_USE_SSE
+		//sum the lanes in the same order as the scalar version, (x+y)+z
+		__m128 vd = _mm_mul_ps(mVec128, v.mVec128);
+		__m128 s = _mm_add_ss(vd, bt_splat_ps(vd, 1));
+		s = _mm_add_ss(s, bt_splat_ps(vd, 2));
+		return _mm_cvtss_f32(s);
+#else
 		return m_floats[0] * v.m_floats[0] + m_floats[1] * v.m_floats[1] +m_floats[2] * v.m_floats[2];
+#endif
 	}
 
   /**@brief Return the length of the vector squared */
@@ -167,19 +195,30 @@ public:
   /**@brief Return a vector will the absolute values of each element */
 	SIMD_FORCE_INLINE btVector3 absolute() const 
 	{
+#ifdef BT_USE_SSE
+		return btVector3(_mm_and_ps(mVec128, btv3AbsfMask));
+#else
 		return btVector3(
 			btFabs(m_floats[0]), 
 			btFabs(m_floats[1]), 
 			btFabs(m_floats[2]));
+#endif
 	}
   /**@brief Return the cross product between this and another vector 
    * @param v The other vector */
 	SIMD_FORCE_INLINE btVector3 cross(const btVector3& v) const
 	{
+#ifdef BT_USE_SSE
+		//(y1*z2 - z1*y2, z1*x2 - x1*z2, x1*y2 - y1*x2), the w lane is cleared
+		__m128 a = _mm_mul_ps(bt_pshufd_ps(mVec128, BT_SHUFFLE(1,2,0,3)), bt_pshufd_ps(v.mVec128, BT_SHUFFLE(2,0,1,3)));
+		__m128 b = _mm_mul_ps(bt_pshufd_ps(mVec128, BT_SHUFFLE(2,0,1,3)), bt_pshufd_ps(v.mVec128, BT_SHUFFLE(1,2,0,3)));
+		return btVector3(_mm_and_ps(_mm_sub_ps(a, b), btvxyzMaskf));
+#else
 		return btVector3(
 			m_floats[1] * v.m_floats[2] -m_floats[2] * v.m_floats[1],
 			m_floats[2] * v.m_floats[0] - m_floats[0] * v.m_floats[2],
 			m_floats[0] * v.m_floats[1] - m_floats[1] * v.m_floats[0]);
+#endif
 	}
 
 	SIMD_FORCE_INLINE btScalar triple(const btVector3& v1, const btVector3& v2) const
@@ -237,7 +276,12 @@ public:
    * @param v The other vector */
 	SIMD_FORCE_INLINE btVector3& operator*=(const btVector3& v)
 	{
+#ifdef BT_USE_SSE
+		//replace the w lane of v by one so our w is preserved
+		mVec128 = _mm_mul_ps(mVec128, _mm_or_ps(_mm_and_ps(v.mVec128, btvxyzMaskf), btvWOnef));
+#else
 		m_floats[0] *= v.m_floats[0]; m_floats[1] *= v.m_floats[1];m_floats[2] *= v.m_floats[2];
+#endif
 		return *this;
 	}
 
@@ -272,7 +316,11 @@ public:
 
 	SIMD_FORCE_INLINE	bool	operator==(const btVector3& other) const
 	{
+#ifdef BT_USE_SSE
+		return (0xf == _mm_movemask_ps(_mm_cmpeq_ps(mVec128, other.mVec128)));
+#else
 		return ((m_floats[3]==other.m_floats[3]) && (m_floats[2]==other.m_floats[2]) && (m_floats[1]==other.m_floats[1]) && (m_floats[0]==other.m_floats[0]));
+#endif
 	}
 
 	SIMD_FORCE_INLINE	bool	operator!=(const btVector3& other) const
@@ -285,20 +333,29 @@ public:
    */
 		SIMD_FORCE_INLINE void	setMax(const btVector3& other)
 		{
+#ifdef BT_USE_SSE
+			//operand order keeps our value on ties and NaN, like btSetMax
+			mVec128 = _mm_max_ps(other.mVec128, mVec128);
+#else
 			btSetMax(m_floats[0], other.m_floats[0]);
 			btSetMax(m_floats[1], other.m_floats[1]);
 			btSetMax(m_floats[2], other.m_floats[2]);
 			btSetMax(m_floats[3], other.w());
+#endif
 		}
   /**@brief Set each element to the min of the current values and the values of another btVector3
    * @param other The other btVector3 to compare with 
    */
 		SIMD_FORCE_INLINE void	setMin(const btVector3& other)
 		{
+#ifdef BT_USE_SSE
+			mVec128 = _mm_min_ps(other.mVec128, mVec128);
+#else
 			btSetMin(m_floats[0], other.m_floats[0]);
 			btSetMin(m_floats[1], other.m_floats[1]);
 			btSetMin(m_floats[2], other.m_floats[2]);
 			btSetMin(m_floats[3], other.w());
+#endif
 		}
 
 		SIMD_FORCE_INLINE void 	setValue(const btScalar& x, const btScalar& y, const btScalar& z)
@@ -316,40 +373,73 @@ public:
 			v2->setValue(-y()	,x()	,0.);
 		}
 
+  /**@brief Return the index of the vector in array with the largest dot product with this vector
+   * The first index wins on ties, -1 is returned for an empty array. The kernel is selected at runtime, see btCpuFeatureUtility.
+   * @param array The vectors to test, 16 byte aligned
+   * @param array_count The number of vectors
+   * @param dotOut Receives the largest dot product */
+		long	maxDot(const btVector3* array, long array_count, btScalar& dotOut) const;
+
+  /**@brief Return the index of the vector in array with the smallest dot product with this vector
+   * @param array The vectors to test, 16 byte aligned
+   * @param array_count The number of vectors
+   * @param dotOut Receives the smallest dot product */
+		long	minDot(const btVector3* array, long array_count, btScalar& dotOut) const;
+
 };
 
 /**@brief Return the sum of two vectors (Point symantics)*/
 SIMD_FORCE_INLINE btVector3 
 operator+(const btVector3& v1, const btVector3& v2) 
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_add_ps(v1.mVec128, v2.mVec128), btvxyzMaskf));
+#else
 	return btVector3(v1.m_floats[0] + v2.m_floats[0], v1.m_floats[1] + v2.m_floats[1], v1.m_floats[2] + v2.m_floats[2]);
+#endif
 }
 
 /**@brief Return the elementwise product of two vectors */
 SIMD_FORCE_INLINE btVector3 
 operator*(const btVector3& v1, const btVector3& v2) 
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_mul_ps(v1.mVec128, v2.mVec128), btvxyzMaskf));
+#else
 	return btVector3(v1.m_floats[0] * v2.m_floats[0], v1.m_floats[1] * v2.m_floats[1], v1.m_floats[2] * v2.m_floats[2]);
+#endif
 }
 
 /**@brief Return the difference between two vectors */
 SIMD_FORCE_INLINE btVector3 
 operator-(const btVector3& v1, const btVector3& v2)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_sub_ps(v1.mVec128, v2.mVec128), btvxyzMaskf));
+#else
 	return btVector3(v1.m_floats[0] - v2.m_floats[0], v1.m_floats[1] - v2.m_floats[1], v1.m_floats[2] - v2.m_floats[2]);
+#endif
 }
 /**@brief Return the negative of the vector */
 SIMD_FORCE_INLINE btVector3 
 operator-(const btVector3& v)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_xor_ps(v.mVec128, btvSignMaskf), btvxyzMaskf));
+#else
 	return btVector3(-v.m_floats[0], -v.m_floats[1], -v.m_floats[2]);
+#endif
 }
 
 /**@brief Return the vector scaled by s */
 SIMD_FORCE_INLINE btVector3 
 operator*(const btVector3& v, const btScalar& s)
 {
+#ifdef BT_USE_SSE
+	return btVector3(_mm_and_ps(_mm_mul_ps(v.mVec128, _mm_set1_ps(s)), btvxyzMaskf));
+#else
 	return btVector3(v.m_floats[0] * s, v.m_floats[1] * s, v.m_floats[2] * s);
+#endif
 }
 
 /**@brief Return the vector scaled by s */
@@ -371,7 +461,13 @@ operator/(const btVector3& v, const btScalar& s)
 SIMD_FORCE_INLINE btVector3
 operator/(const btVector3& v1, const btVector3& v2)
 {
+#ifdef BT_USE_SSE
+	//divide the w lane by one to avoid a spurious 0/0
+	__m128 denom = _mm_or_ps(_mm_and_ps(v2.mVec128, btvxyzMaskf), btvWOnef);
+	return btVector3(_mm_and_ps(_mm_div_ps(v1.mVec128, denom), btvxyzMaskf));
+#else
 	return btVector3(v1.m_floats[0] / v2.m_floats[0],v1.m_floats[1] / v2.m_floats[1],v1.m_floats[2] / v2.m_floats[2]);
+#endif
 }
 
 /**@brief Return the dot product between two vectors */